@@ -617,6 +617,7 @@ static void ffmpeg_cleanup(int ret)
 #if HAVE_THREADS
     free_input_threads();
 #endif
+    mem_budget_uninit();
     for (i = 0; i < nb_input_files; i++) {
         avformat_close_input(&input_files[i]->ctx);
         av_packet_free(&input_files[i]->pkt);
@@ -647,6 +648,7 @@ static void ffmpeg_cleanup(int ret)
     }
     av_freep(&vstats_filename);
     av_freep(&filter_nbthreads);
+    avio_closep(&stats_profile_avio);
 
     av_freep(&input_streams);
     av_freep(&input_files);
@@ -724,6 +726,8 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
 {
     AVFormatContext *s = of->ctx;
     AVStream *st = ost->st;
+    StageTimer timer;
+    int pkt_size;
     int ret;
 
     /*
@@ -770,7 +774,9 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
             exit_program(1);
         av_packet_move_ref(tmp_pkt, pkt);
         ost->muxing_queue_data_size += tmp_pkt->size;
+        mem_budget_add(MEM_POOL_MUXING, mem_budget_packet_size(tmp_pkt));
         av_fifo_write(ost->muxing_queue, &tmp_pkt, 1);
+        stage_queue_update(&ost->prof_mux, av_fifo_can_read(ost->muxing_queue));
         return;
     }
 
@@ -842,6 +848,7 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
 
     ost->data_size += pkt->size;
     ost->packets_written++;
+    pkt_size = pkt->size;
 
     pkt->stream_index = ost->index;
 
@@ -856,7 +863,9 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
               );
     }
 
+    stage_timer_start(&timer);
     ret = av_interleaved_write_frame(s, pkt);
+    stage_timer_stop(&ost->prof_mux, &timer, 1, 0, pkt_size);
     if (ret < 0) {
         print_error("av_interleaved_write_frame()", ret);
         main_return_code = 1;
@@ -1001,6 +1010,7 @@ static void do_audio_out(OutputFile *of, OutputStream *ost,
 {
     AVCodecContext *enc = ost->enc_ctx;
     AVPacket *pkt = ost->pkt;
+    StageTimer timer;
     int ret;
 
     adjust_frame_pts_to_encoder_tb(of, ost, frame);
@@ -1022,12 +1032,17 @@ static void do_audio_out(OutputFile *of, OutputStream *ost,
                enc->time_base.num, enc->time_base.den);
     }
 
+    stage_timer_start(&timer);
     ret = avcodec_send_frame(enc, frame);
+    stage_timer_stop(&ost->prof_encode, &timer, 1, 0, 0);
     if (ret < 0)
         goto error;
 
     while (1) {
+        stage_timer_start(&timer);
         ret = avcodec_receive_packet(enc, pkt);
+        stage_timer_stop(&ost->prof_encode, &timer, 0, ret >= 0,
+                         ret >= 0 ? pkt->size : 0);
         if (ret == AVERROR(EAGAIN))
             break;
         if (ret < 0)
@@ -1063,6 +1078,7 @@ static void do_subtitle_out(OutputFile *of,
     int subtitle_out_size, nb, i;
     AVCodecContext *enc;
     AVPacket *pkt = ost->pkt;
+    StageTimer timer;
     int64_t pts;
 
     if (sub->pts == AV_NOPTS_VALUE) {
@@ -1111,8 +1127,11 @@ static void do_subtitle_out(OutputFile *of,
 
         ost->frames_encoded++;
 
+        stage_timer_start(&timer);
         subtitle_out_size = avcodec_encode_subtitle(enc, subtitle_out,
                                                     subtitle_out_max_size, sub);
+        stage_timer_stop(&ost->prof_encode, &timer, 1, subtitle_out_size >= 0,
+                         FFMAX(subtitle_out_size, 0));
         if (i == 1)
             sub->num_rects = save_num_rects;
         if (subtitle_out_size < 0) {
@@ -1154,6 +1173,7 @@ static void do_video_out(OutputFile *of,
     int frame_size = 0;
     InputStream *ist = NULL;
     AVFilterContext *filter = ost->filter->filter;
+    StageTimer timer;
 
     init_output_stream_wrapper(ost, next_picture, 1);
     sync_ipts = adjust_frame_pts_to_encoder_tb(of, ost, next_picture);
@@ -1349,14 +1369,19 @@ static void do_video_out(OutputFile *of,
 
         ost->frames_encoded++;
 
+        stage_timer_start(&timer);
         ret = avcodec_send_frame(enc, in_picture);
+        stage_timer_stop(&ost->prof_encode, &timer, 1, 0, 0);
         if (ret < 0)
             goto error;
         // Make sure Closed Captions will not be duplicated
         av_frame_remove_side_data(in_picture, AV_FRAME_DATA_A53_CC);
 
         while (1) {
+            stage_timer_start(&timer);
             ret = avcodec_receive_packet(enc, pkt);
+            stage_timer_stop(&ost->prof_encode, &timer, 0, ret >= 0,
+                             ret >= 0 ? pkt->size : 0);
             update_benchmark("encode_video %d.%d", ost->file_index, ost->index);
             if (ret == AVERROR(EAGAIN))
                 break;
@@ -1515,8 +1540,13 @@ static int reap_filters(int flush)
         filtered_frame = ost->filtered_frame;
 
         while (1) {
+            StageTimer timer;
+
+            stage_timer_start(&timer);
             ret = av_buffersink_get_frame_flags(filter, filtered_frame,
                                                AV_BUFFERSINK_FLAG_NO_REQUEST);
+            stage_timer_stop(&ost->filter->graph->prof_filter, &timer,
+                             0, ret >= 0, 0);
             if (ret < 0) {
                 if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
                     av_log(NULL, AV_LOG_WARNING,
@@ -1958,6 +1988,7 @@ static void flush_encoders(void)
         for (;;) {
             const char *desc = NULL;
             AVPacket *pkt = ost->pkt;
+            StageTimer timer;
             int pkt_size;
 
             switch (enc->codec_type) {
@@ -1972,6 +2003,7 @@ static void flush_encoders(void)
             }
 
             update_benchmark(NULL);
+            stage_timer_start(&timer);
 
             while ((ret = avcodec_receive_packet(enc, pkt)) == AVERROR(EAGAIN)) {
                 ret = avcodec_send_frame(enc, NULL);
@@ -1983,6 +2015,9 @@ static void flush_encoders(void)
                 }
             }
 
+            stage_timer_stop(&ost->prof_encode, &timer, 0, ret >= 0,
+                             ret >= 0 ? pkt->size : 0);
+
             update_benchmark("flush_%s %d.%d", desc, ost->file_index, ost->index);
             if (ret < 0 && ret != AVERROR_EOF) {
                 av_log(NULL, AV_LOG_FATAL, "%s encoding failed: %s\n",
@@ -2159,6 +2194,7 @@ static int ifilter_send_frame(InputFilter *ifilter, AVFrame *frame, int keep_ref
 {
     FilterGraph *fg = ifilter->graph;
     AVFrameSideData *sd;
+    StageTimer timer;
     int need_reinit, ret;
     int buffersrc_flags = AV_BUFFERSRC_FLAG_PUSH;
 
@@ -2208,6 +2244,8 @@ static int ifilter_send_frame(InputFilter *ifilter, AVFrame *frame, int keep_ref
             ret = av_fifo_write(ifilter->frame_queue, &tmp, 1);
             if (ret < 0)
                 av_frame_free(&tmp);
+            else
+                stage_queue_update(&fg->prof_filter, av_fifo_can_read(ifilter->frame_queue));
 
             return ret;
         }
@@ -2225,7 +2263,9 @@ static int ifilter_send_frame(InputFilter *ifilter, AVFrame *frame, int keep_ref
         }
     }
 
+    stage_timer_start(&timer);
     ret = av_buffersrc_add_frame_flags(ifilter->filter, frame, buffersrc_flags);
+    stage_timer_stop(&fg->prof_filter, &timer, ret >= 0, 0, 0);
     if (ret < 0) {
         if (ret != AVERROR_EOF)
             av_log(NULL, AV_LOG_ERROR, "Error while filtering: %s\n", av_err2str(ret));
@@ -2311,11 +2351,15 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output,
 {
     AVFrame *decoded_frame = ist->decoded_frame;
     AVCodecContext *avctx = ist->dec_ctx;
+    StageTimer timer;
     int ret, err = 0;
     AVRational decoded_frame_tb;
 
     update_benchmark(NULL);
+    stage_timer_start(&timer);
     ret = decode(avctx, decoded_frame, got_output, pkt);
+    stage_timer_stop(&ist->prof_decode, &timer, !!pkt, *got_output,
+                     pkt ? pkt->size : 0);
     update_benchmark("decode_audio %d.%d", ist->file_index, ist->st->index);
     if (ret < 0)
         *decode_failed = 1;
@@ -2373,6 +2417,7 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output, int64_
     int i, ret = 0, err = 0;
     int64_t best_effort_timestamp;
     int64_t dts = AV_NOPTS_VALUE;
+    StageTimer timer;
 
     // With fate-indeo3-2, we're getting 0-sized packets before EOF for some
     // reason. This seems like a semi-critical bug. Don't trigger EOF, and
@@ -2397,7 +2442,10 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output, int64_
     }
 
     update_benchmark(NULL);
+    stage_timer_start(&timer);
     ret = decode(ist->dec_ctx, decoded_frame, got_output, pkt);
+    stage_timer_stop(&ist->prof_decode, &timer, !!pkt, *got_output,
+                     pkt ? pkt->size : 0);
     update_benchmark("decode_video %d.%d", ist->file_index, ist->st->index);
     if (ret < 0)
         *decode_failed = 1;
@@ -2495,9 +2543,13 @@ static int transcode_subtitles(InputStream *ist, AVPacket *pkt, int *got_output,
                                int *decode_failed)
 {
     AVSubtitle subtitle;
+    StageTimer timer;
     int free_sub = 1;
-    int i, ret = avcodec_decode_subtitle2(ist->dec_ctx,
-                                          &subtitle, got_output, pkt);
+    int i, ret;
+
+    stage_timer_start(&timer);
+    ret = avcodec_decode_subtitle2(ist->dec_ctx, &subtitle, got_output, pkt);
+    stage_timer_stop(&ist->prof_decode, &timer, 1, *got_output, pkt->size);
 
     check_decode_result(NULL, got_output, ret);
 
@@ -2993,6 +3045,7 @@ static int check_init_output_file(OutputFile *of, int file_index)
 
         while (av_fifo_read(ost->muxing_queue, &pkt, 1) >= 0) {
             ost->muxing_queue_data_size -= pkt->size;
+            mem_budget_add(MEM_POOL_MUXING, -mem_budget_packet_size(pkt));
             write_packet(of, pkt, ost, 1);
             av_packet_free(&pkt);
         }
@@ -3971,7 +4024,12 @@ static void *input_thread(void *arg)
     int ret = 0;
 
     while (1) {
+        StageTimer timer;
+
+        stage_timer_start(&timer);
         ret = av_read_frame(f->ctx, pkt);
+        stage_timer_stop(&f->prof_demux, &timer, 0, ret >= 0,
+                         ret >= 0 ? pkt->size : 0);
 
         if (ret == AVERROR(EAGAIN)) {
             av_usleep(10000);
@@ -3988,6 +4046,7 @@ static void *input_thread(void *arg)
             break;
         }
         av_packet_move_ref(queue_pkt, pkt);
+        mem_budget_input_wait(f, queue_pkt);
         ret = av_thread_message_queue_send(f->in_thread_queue, &queue_pkt, flags);
         if (flags && ret == AVERROR(EAGAIN)) {
             flags = 0;
@@ -4002,10 +4061,13 @@ static void *input_thread(void *arg)
                 av_log(f->ctx, AV_LOG_ERROR,
                        "Unable to send packet to main thread: %s\n",
                        av_err2str(ret));
+            mem_budget_input_release(f, queue_pkt);
             av_packet_free(&queue_pkt);
             av_thread_message_queue_set_err_recv(f->in_thread_queue, ret);
             break;
         }
+        stage_queue_update(&f->prof_demux,
+                           av_thread_message_queue_nb_elems(f->in_thread_queue));
     }
 
     return NULL;
@@ -4019,8 +4081,10 @@ static void free_input_thread(int i)
     if (!f || !f->in_thread_queue)
         return;
     av_thread_message_queue_set_err_send(f->in_thread_queue, AVERROR_EOF);
-    while (av_thread_message_queue_recv(f->in_thread_queue, &pkt, 0) >= 0)
+    while (av_thread_message_queue_recv(f->in_thread_queue, &pkt, 0) >= 0) {
+        mem_budget_input_release(f, pkt);
         av_packet_free(&pkt);
+    }
 
     pthread_join(f->thread, NULL);
     f->joined = 1;
@@ -4040,10 +4104,13 @@ static int init_input_thread(int i)
     int ret;
     InputFile *f = input_files[i];
 
+    /* with a memory budget the queues are bounded in bytes rather than
+     * in packets */
     if (f->thread_queue_size < 0)
-        f->thread_queue_size = (nb_input_files > 1 ? 8 : 0);
+        f->thread_queue_size = (nb_input_files > 1 ? (max_memory > 0 ? 1024 : 8) : 0);
     if (!f->thread_queue_size)
         return 0;
+    f->queued_bytes = 0;
 
     if (f->ctx->pb ? !f->ctx->pb->seekable :
         strcmp(f->ctx->iformat->name, "lavfi"))
@@ -4076,14 +4143,23 @@ static int init_input_threads(void)
 
 static int get_input_packet_mt(InputFile *f, AVPacket **pkt)
 {
-    return av_thread_message_queue_recv(f->in_thread_queue, pkt,
-                                        f->non_blocking ?
-                                        AV_THREAD_MESSAGE_NONBLOCK : 0);
+    int ret = av_thread_message_queue_recv(f->in_thread_queue, pkt,
+                                           f->non_blocking ?
+                                           AV_THREAD_MESSAGE_NONBLOCK : 0);
+    if (ret >= 0) {
+        mem_budget_input_release(f, *pkt);
+        stage_queue_update(&f->prof_demux,
+                           av_thread_message_queue_nb_elems(f->in_thread_queue));
+    }
+    return ret;
 }
 #endif
 
 static int get_input_packet(InputFile *f, AVPacket **pkt)
 {
+    StageTimer timer;
+    int ret;
+
     if (f->readrate || f->rate_emu) {
         int i;
         int64_t file_start = copy_ts * (
@@ -4108,7 +4184,11 @@ static int get_input_packet(InputFile *f, AVPacket **pkt)
         return get_input_packet_mt(f, pkt);
 #endif
     *pkt = f->pkt;
-    return av_read_frame(f->ctx, *pkt);
+    stage_timer_start(&timer);
+    ret = av_read_frame(f->ctx, *pkt);
+    stage_timer_stop(&f->prof_demux, &timer, 0, ret >= 0,
+                     ret >= 0 ? (*pkt)->size : 0);
+    return ret;
 }
 
 static int got_eagain(void)
@@ -4517,9 +4597,12 @@ static int transcode_from_filter(FilterGraph *graph, InputStream **best_ist)
     int nb_requests, nb_requests_max = 0;
     InputFilter *ifilter;
     InputStream *ist;
+    StageTimer timer;
 
     *best_ist = NULL;
+    stage_timer_start(&timer);
     ret = avfilter_graph_request_oldest(graph->graph);
+    stage_timer_stop(&graph->prof_filter, &timer, 0, 0, 0);
     if (ret >= 0)
         return reap_filters(0);
 
@@ -4666,6 +4749,8 @@ static int transcode(void)
 
     timer_start = av_gettime_relative();
 
+    if ((ret = mem_budget_init()) < 0)
+        goto fail;
 #if HAVE_THREADS
     if ((ret = init_input_threads()) < 0)
         goto fail;
@@ -4690,14 +4775,25 @@ static int transcode(void)
             av_log(NULL, AV_LOG_ERROR, "Error while filtering: %s\n", av_err2str(ret));
             break;
         }
+        mem_budget_update_filters();
 
         /* dump report by using the output first video and audio streams */
         print_report(0, timer_start, cur_time);
+        stats_profile_dump(cur_time, 0);
     }
 #if HAVE_THREADS
     free_input_threads();
 #endif
 
+    if (max_memory > 0) {
+        MemBudgetStats st;
+
+        mem_budget_get_stats(&st);
+        av_log(NULL, AV_LOG_VERBOSE,
+               "Peak queued memory: %"PRId64" bytes (budget %"PRId64" bytes)\n",
+               st.peak, max_memory);
+    }
+
     /* at the end of stream, we must flush the decoder buffers */
     for (i = 0; i < nb_input_streams; i++) {
         ist = input_streams[i];
@@ -4711,6 +4807,8 @@ static int transcode(void)
 
     /* write the trailer if needed */
     for (i = 0; i < nb_output_files; i++) {
+        StageTimer timer;
+
         os = output_files[i]->ctx;
         if (!output_files[i]->header_written) {
             av_log(NULL, AV_LOG_ERROR,
@@ -4719,7 +4817,10 @@ static int transcode(void)
                    i, os->url);
             continue;
         }
-        if ((ret = av_write_trailer(os)) < 0) {
+        stage_timer_start(&timer);
+        ret = av_write_trailer(os);
+        stage_timer_stop(&output_files[i]->prof_trailer, &timer, 0, 0, 0);
+        if (ret < 0) {
             av_log(NULL, AV_LOG_ERROR, "Error writing trailer of %s: %s\n", os->url, av_err2str(ret));
             if (exit_on_error)
                 exit_program(1);
@@ -4728,6 +4829,9 @@ static int transcode(void)
 
     /* dump report by using the first video and audio streams */
     print_report(1, timer_start, av_gettime_relative());
+    stats_profile_dump(av_gettime_relative(), 1);
+    if (do_filter_stats)
+        print_filter_stats();
 
     /* close the output files */
     for (i = 0; i < nb_output_files; i++) {
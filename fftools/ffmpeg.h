@@ -236,6 +236,37 @@ typedef struct OptionsContext {
     int        nb_bits_per_raw_sample;
 } OptionsContext;
 
+/* per-stage timing and throughput counters, see ffmpeg_profile.c */
+typedef struct StageStats {
+    int64_t  wall_usec;     ///< wall clock time spent in the stage
+    int64_t  cpu_usec;      ///< CPU time of the calling thread spent in the stage
+    uint64_t nb_calls;      ///< number of timed calls into the stage
+    uint64_t nb_in;         ///< packets/frames consumed by the stage
+    uint64_t nb_out;        ///< packets/frames produced by the stage
+    uint64_t bytes;         ///< payload bytes handled by the stage
+    uint64_t queue;         ///< current occupancy of the queue feeding the stage
+    uint64_t queue_max;     ///< peak occupancy of the queue feeding the stage
+} StageStats;
+
+typedef struct StageTimer {
+    int64_t wall_usec;
+    int64_t cpu_usec;
+} StageTimer;
+
+/* queues accounted in the -max_memory budget */
+enum MemBudgetPool {
+    MEM_POOL_INPUT,         ///< packets queued by the input threads
+    MEM_POOL_FILTER,        ///< frames queued on filter links
+    MEM_POOL_MUXING,        ///< packets queued before the muxer is initialized
+    MEM_POOL_NB
+};
+
+typedef struct MemBudgetStats {
+    int64_t used[MEM_POOL_NB];
+    int64_t total;
+    int64_t peak;
+} MemBudgetStats;
+
 typedef struct InputFilter {
     AVFilterContext    *filter;
     struct InputStream *ist;
@@ -298,6 +329,8 @@ typedef struct FilterGraph {
     int          nb_inputs;
     OutputFilter **outputs;
     int         nb_outputs;
+
+    StageStats prof_filter;
 } FilterGraph;
 
 typedef struct InputStream {
@@ -392,6 +425,8 @@ typedef struct InputStream {
     uint64_t frames_decoded;
     uint64_t samples_decoded;
 
+    StageStats prof_decode;
+
     int64_t *dts_buffer;
     int nb_dts_buffer;
 
@@ -422,12 +457,16 @@ typedef struct InputFile {
 
     AVPacket *pkt;
 
+    StageStats prof_demux;
+
 #if HAVE_THREADS
     AVThreadMessageQueue *in_thread_queue;
     pthread_t thread;           /* thread reading from this file */
     int non_blocking;           /* reading packets from the thread should not block */
     int joined;                 /* the thread has been joined */
     int thread_queue_size;      /* maximum number of queued packets */
+    int64_t queued_bytes;       /* memory held by the packets in in_thread_queue */
+    int64_t queued_ts;          /* timestamp of the last queued packet, in AV_TIME_BASE */
 #endif
 } InputFile;
 
@@ -552,6 +591,9 @@ typedef struct OutputStream {
     uint64_t frames_encoded;
     uint64_t samples_encoded;
 
+    StageStats prof_encode;
+    StageStats prof_mux;
+
     /* packet quality factor */
     int quality;
 
@@ -587,6 +629,8 @@ typedef struct OutputFile {
     int shortest;
 
     int header_written;
+
+    StageStats prof_trailer;
 } OutputFile;
 
 extern InputStream **input_streams;
@@ -615,6 +659,7 @@ extern enum VideoSyncMethod video_sync_method;
 extern float frame_drop_threshold;
 extern int do_benchmark;
 extern int do_benchmark_all;
+extern int do_filter_stats;
 extern int do_deinterlace;
 extern int do_hex_dump;
 extern int do_pkt_dump;
@@ -626,6 +671,9 @@ extern int exit_on_error;
 extern int abort_on_flags;
 extern int print_stats;
 extern int64_t stats_period;
+extern AVIOContext *stats_profile_avio;
+extern int64_t stats_profile_period;
+extern int64_t max_memory;
 extern int qp_hist;
 extern int stdin_interaction;
 extern int frame_bits_per_raw_sample;
@@ -659,6 +707,7 @@ int guess_input_channel_layout(InputStream *ist);
 int configure_filtergraph(FilterGraph *fg);
 void check_filter_outputs(void);
 int filtergraph_is_simple(FilterGraph *fg);
+void print_filter_stats(void);
 int init_simple_filtergraph(InputStream *ist, OutputStream *ost);
 int init_complex_filtergraph(FilterGraph *fg);
 
@@ -681,4 +730,21 @@ int hw_device_setup_for_filter(FilterGraph *fg);
 
 int hwaccel_decode_init(AVCodecContext *avctx);
 
+void stage_timer_start(StageTimer *t);
+void stage_timer_stop(StageStats *s, const StageTimer *t,
+                      uint64_t nb_in, uint64_t nb_out, uint64_t bytes);
+void stage_queue_update(StageStats *s, uint64_t occupancy);
+void stats_profile_dump(int64_t cur_time, int is_last);
+
+int  mem_budget_init(void);
+void mem_budget_uninit(void);
+int64_t mem_budget_packet_size(const AVPacket *pkt);
+void mem_budget_add(enum MemBudgetPool pool, int64_t delta);
+void mem_budget_update_filters(void);
+void mem_budget_get_stats(MemBudgetStats *st);
+#if HAVE_THREADS
+void mem_budget_input_wait(InputFile *f, const AVPacket *pkt);
+void mem_budget_input_release(InputFile *f, const AVPacket *pkt);
+#endif
+
 #endif /* FFTOOLS_FFMPEG_H */
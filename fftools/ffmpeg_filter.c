@@ -1000,6 +1000,8 @@ int configure_filtergraph(FilterGraph *fg)
     cleanup_filtergraph(fg);
     if (!(fg->graph = avfilter_graph_alloc()))
         return AVERROR(ENOMEM);
+    if (do_filter_stats || stats_profile_avio)
+        avfilter_graph_set_stats(fg->graph, 1);
 
     if (simple) {
         OutputStream *ost = fg->outputs[0]->ost;
@@ -1202,3 +1204,42 @@ int filtergraph_is_simple(FilterGraph *fg)
 {
     return !fg->graph_desc;
 }
+
+void print_filter_stats(void)
+{
+    int i;
+    unsigned j;
+
+    for (i = 0; i < nb_filtergraphs; i++) {
+        FilterGraph *fg = filtergraphs[i];
+
+        if (!fg->graph)
+            continue;
+
+        av_log(NULL, AV_LOG_INFO, "Filtergraph #%d:\n", fg->index);
+        for (j = 0; j < fg->graph->nb_filters; j++) {
+            AVFilterContext *f = fg->graph->filters[j];
+            AVFilterStats st;
+            double util = 0.0, imbalance = 0.0;
+
+            if (avfilter_get_stats(f, &st) < 0)
+                continue;
+            if (st.execute_time > 0)
+                util = 100.0 * st.execute_busy_time /
+                       (st.execute_time * (double)st.nb_threads);
+            if (st.execute_busy_time > 0)
+                imbalance = (double)st.execute_max_busy_time * st.nb_threads /
+                            st.execute_busy_time;
+
+            av_log(NULL, AV_LOG_INFO,
+                   "  %-24s %-12s time=%8.3fs activations=%-8"PRIu64" "
+                   "frames_in=%-8"PRId64" frames_out=%-8"PRId64" "
+                   "max_queued=%-4"PRIu64" slice_time=%8.3fs "
+                   "slice_util=%5.1f%% slice_imbalance=%4.2f threads=%d\n",
+                   f->name, f->filter->name, st.activate_time / 1000000.0,
+                   st.nb_activations, st.frames_in, st.frames_out,
+                   st.max_queued_frames, st.execute_time / 1000000.0,
+                   util, imbalance, st.nb_threads);
+        }
+    }
+}
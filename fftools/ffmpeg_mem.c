@@ -0,0 +1,202 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * global budget for the memory held in the queues of the transcoding
+ * pipeline: input thread queues, filter link FIFOs and muxing queues
+ *
+ * The input thread whose queued packets are furthest ahead in time is
+ * stalled first, when three quarters of the budget are used; all the others
+ * are stalled when the budget is exceeded. An input whose queue is empty is
+ * never stalled, so the main thread can always make progress.
+ */
+
+#include <stdint.h>
+
+#include "libavutil/thread.h"
+
+#include "ffmpeg.h"
+
+static AVMutex mem_lock = AV_MUTEX_INITIALIZER;
+static AVCond mem_cond;
+static int mem_cond_inited;
+
+static int64_t mem_used[MEM_POOL_NB];
+static int64_t mem_total;
+static int64_t mem_peak;
+
+static int mem_budget_enabled(void)
+{
+    return max_memory > 0 || stats_profile_avio;
+}
+
+int mem_budget_init(void)
+{
+    int ret;
+
+    if (!mem_cond_inited) {
+        ret = ff_cond_init(&mem_cond, NULL);
+        if (ret)
+            return AVERROR(ret);
+        mem_cond_inited = 1;
+    }
+    return 0;
+}
+
+void mem_budget_uninit(void)
+{
+    if (mem_cond_inited)
+        ff_cond_destroy(&mem_cond);
+    mem_cond_inited = 0;
+}
+
+int64_t mem_budget_packet_size(const AVPacket *pkt)
+{
+    int64_t size = sizeof(*pkt) + (pkt->buf ? pkt->buf->size : pkt->size);
+    int i;
+
+    for (i = 0; i < pkt->side_data_elems; i++)
+        size += pkt->side_data[i].size;
+    return size;
+}
+
+/* must be called with mem_lock held */
+static void update_locked(enum MemBudgetPool pool, int64_t used)
+{
+    mem_total      += used - mem_used[pool];
+    mem_used[pool]  = used;
+    mem_peak        = FFMAX(mem_peak, mem_total);
+    if (mem_cond_inited)
+        ff_cond_broadcast(&mem_cond);
+}
+
+void mem_budget_add(enum MemBudgetPool pool, int64_t delta)
+{
+    if (!mem_budget_enabled() || !delta)
+        return;
+
+    ff_mutex_lock(&mem_lock);
+    update_locked(pool, mem_used[pool] + delta);
+    ff_mutex_unlock(&mem_lock);
+}
+
+void mem_budget_update_filters(void)
+{
+    int64_t used = 0;
+    int i, j, k;
+
+    if (!mem_budget_enabled())
+        return;
+
+    for (i = 0; i < nb_filtergraphs; i++) {
+        AVFilterGraph *graph = filtergraphs[i]->graph;
+
+        for (j = 0; graph && j < graph->nb_filters; j++) {
+            AVFilterContext *f = graph->filters[j];
+
+            for (k = 0; k < f->nb_inputs; k++) {
+                AVFilterLinkStats st;
+
+                if (f->inputs[k] && avfilter_link_get_stats(f->inputs[k], &st) >= 0)
+                    used += st.queued_bytes;
+            }
+        }
+    }
+
+    ff_mutex_lock(&mem_lock);
+    if (used != mem_used[MEM_POOL_FILTER])
+        update_locked(MEM_POOL_FILTER, used);
+    ff_mutex_unlock(&mem_lock);
+}
+
+void mem_budget_get_stats(MemBudgetStats *st)
+{
+    int i;
+
+    ff_mutex_lock(&mem_lock);
+    for (i = 0; i < MEM_POOL_NB; i++)
+        st->used[i] = mem_used[i];
+    st->total = mem_total;
+    st->peak  = mem_peak;
+    ff_mutex_unlock(&mem_lock);
+}
+
+#if HAVE_THREADS
+/* must be called with mem_lock held */
+static int input_must_wait(const InputFile *f, int64_t size)
+{
+    int i;
+
+    if (max_memory <= 0 || !f->queued_bytes)
+        return 0;
+    if (mem_total + size > max_memory)
+        return 1;
+    /* the input furthest ahead is stopped early, keeping the rest of the
+     * budget for the inputs that are behind */
+    if (mem_total + size <= max_memory / 4 * 3)
+        return 0;
+
+    for (i = 0; i < nb_input_files; i++) {
+        const InputFile *f2 = input_files[i];
+
+        if (f2 != f && f2->queued_bytes && f2->queued_ts > f->queued_ts)
+            return 0;
+    }
+    return 1;
+}
+
+void mem_budget_input_wait(InputFile *f, const AVPacket *pkt)
+{
+    const AVStream *st = f->ctx->streams[pkt->stream_index];
+    int64_t size = mem_budget_packet_size(pkt);
+    int waited = 0;
+
+    if (!mem_budget_enabled())
+        return;
+
+    ff_mutex_lock(&mem_lock);
+    while (input_must_wait(f, size)) {
+        if (!waited)
+            av_log(f->ctx, AV_LOG_DEBUG,
+                   "Memory budget exhausted (%"PRId64" bytes queued), "
+                   "stalling input\n", mem_total);
+        waited = 1;
+        ff_cond_wait(&mem_cond, &mem_lock);
+    }
+    if (pkt->dts != AV_NOPTS_VALUE)
+        f->queued_ts = av_rescale_q(pkt->dts, st->time_base, AV_TIME_BASE_Q) +
+                       f->ts_offset;
+    f->queued_bytes += size;
+    update_locked(MEM_POOL_INPUT, mem_used[MEM_POOL_INPUT] + size);
+    ff_mutex_unlock(&mem_lock);
+}
+
+void mem_budget_input_release(InputFile *f, const AVPacket *pkt)
+{
+    int64_t size = mem_budget_packet_size(pkt);
+
+    if (!mem_budget_enabled())
+        return;
+
+    ff_mutex_lock(&mem_lock);
+    f->queued_bytes -= size;
+    update_locked(MEM_POOL_INPUT, mem_used[MEM_POOL_INPUT] - size);
+    ff_mutex_unlock(&mem_lock);
+}
+#endif
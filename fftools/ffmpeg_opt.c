@@ -159,6 +159,7 @@ enum VideoSyncMethod video_sync_method = VSYNC_AUTO;
 float frame_drop_threshold = 0;
 int do_benchmark      = 0;
 int do_benchmark_all  = 0;
+int do_filter_stats   = 0;
 int do_hex_dump       = 0;
 int do_pkt_dump       = 0;
 int copy_ts           = 0;
@@ -176,6 +177,9 @@ int filter_complex_nbthreads = 0;
 int vstats_version = 2;
 int auto_conversion_filters = 1;
 int64_t stats_period = 500000;
+AVIOContext *stats_profile_avio;
+int64_t stats_profile_period = 1000000;
+int64_t max_memory    = 0;
 
 
 static int file_overwrite     = 0;
@@ -305,6 +309,20 @@ static int opt_stats_period(void *optctx, const char *opt, const char *arg)
     return 0;
 }
 
+static int opt_stats_profile_period(void *optctx, const char *opt, const char *arg)
+{
+    int64_t period = parse_time_or_die(opt, arg, 1);
+
+    if (period <= 0) {
+        av_log(NULL, AV_LOG_ERROR, "stats_profile_period %s must be positive.\n", arg);
+        return AVERROR(EINVAL);
+    }
+
+    stats_profile_period = period;
+
+    return 0;
+}
+
 static int opt_audio_codec(void *optctx, const char *opt, const char *arg)
 {
     OptionsContext *o = optctx;
@@ -3506,6 +3524,24 @@ static int opt_progress(void *optctx, const char *opt, const char *arg)
     return 0;
 }
 
+static int opt_stats_profile(void *optctx, const char *opt, const char *arg)
+{
+    AVIOContext *avio = NULL;
+    int ret;
+
+    if (!strcmp(arg, "-"))
+        arg = "pipe:";
+    ret = avio_open2(&avio, arg, AVIO_FLAG_WRITE, &int_cb, NULL);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Failed to open stats profile URL \"%s\": %s\n",
+               arg, av_err2str(ret));
+        return ret;
+    }
+    avio_closep(&stats_profile_avio);
+    stats_profile_avio = avio;
+    return 0;
+}
+
 int opt_timelimit(void *optctx, const char *opt, const char *arg)
 {
 #if HAVE_SETRLIMIT
@@ -3599,6 +3635,15 @@ const OptionDef options[] = {
       "add timings for each task" },
     { "progress",       HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_progress },
       "write program-readable progress information", "url" },
+    { "filter_stats",   OPT_BOOL | OPT_EXPERT,                       { &do_filter_stats },
+      "print per-filter execution statistics at the end" },
+    { "stats_profile",  HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_stats_profile },
+        "write per-stage timing statistics as JSON", "url" },
+    { "stats_profile_period", HAS_ARG | OPT_EXPERT,                  { .func_arg = opt_stats_profile_period },
+        "set the period at which -stats_profile output is written", "time" },
+    { "max_memory",     HAS_ARG | OPT_INT64 | OPT_EXPERT,            { &max_memory },
+        "set the memory budget for packets and frames queued between the "
+        "processing stages", "bytes" },
     { "stdin",          OPT_BOOL | OPT_EXPERT,                       { &stdin_interaction },
       "enable or disable interaction on standard input" },
     { "timelimit",      HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_timelimit },
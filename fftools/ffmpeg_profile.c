@@ -0,0 +1,260 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * per-stage profiling of the transcoding pipeline, written as JSON
+ */
+
+#include <stdint.h>
+#include <time.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/bprint.h"
+#include "libavutil/thread.h"
+#include "libavutil/time.h"
+
+#include "ffmpeg.h"
+
+/* the demuxer counters are updated from the input threads */
+static AVMutex stats_lock = AV_MUTEX_INITIALIZER;
+
+static int64_t thread_cpu_usec(void)
+{
+#if HAVE_CLOCK_GETTIME && defined(CLOCK_THREAD_CPUTIME_ID)
+    struct timespec ts;
+
+    if (!clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts))
+        return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+#endif
+    return 0;
+}
+
+void stage_timer_start(StageTimer *t)
+{
+    if (!stats_profile_avio)
+        return;
+    t->wall_usec = av_gettime_relative();
+    t->cpu_usec  = thread_cpu_usec();
+}
+
+void stage_timer_stop(StageStats *s, const StageTimer *t,
+                      uint64_t nb_in, uint64_t nb_out, uint64_t bytes)
+{
+    int64_t wall, cpu;
+
+    if (!stats_profile_avio)
+        return;
+
+    wall = av_gettime_relative();
+    cpu  = thread_cpu_usec();
+
+    ff_mutex_lock(&stats_lock);
+    s->wall_usec += wall - t->wall_usec;
+    s->cpu_usec  += cpu  - t->cpu_usec;
+    s->nb_calls++;
+    s->nb_in     += nb_in;
+    s->nb_out    += nb_out;
+    s->bytes     += bytes;
+    ff_mutex_unlock(&stats_lock);
+}
+
+void stage_queue_update(StageStats *s, uint64_t occupancy)
+{
+    if (!stats_profile_avio)
+        return;
+
+    ff_mutex_lock(&stats_lock);
+    s->queue     = occupancy;
+    s->queue_max = FFMAX(s->queue_max, occupancy);
+    ff_mutex_unlock(&stats_lock);
+}
+
+static void print_json_string(AVBPrint *bp, const char *str)
+{
+    av_bprint_chars(bp, '"', 1);
+    for (; str && *str; str++) {
+        switch (*str) {
+        case '"':  av_bprintf(bp, "\\\"");  break;
+        case '\\': av_bprintf(bp, "\\\\");  break;
+        case '\n': av_bprintf(bp, "\\n");   break;
+        case '\r': av_bprintf(bp, "\\r");   break;
+        case '\t': av_bprintf(bp, "\\t");   break;
+        default:
+            if ((unsigned char)*str < 0x20)
+                av_bprintf(bp, "\\u%04x", (unsigned char)*str);
+            else
+                av_bprint_chars(bp, *str, 1);
+        }
+    }
+    av_bprint_chars(bp, '"', 1);
+}
+
+static const char *media_type_string(enum AVMediaType type)
+{
+    const char *str = av_get_media_type_string(type);
+    return str ? str : "unknown";
+}
+
+static void print_stage(AVBPrint *bp, const char *name, const StageStats *s)
+{
+    av_bprintf(bp, "\"%s\":{\"wall_us\":%"PRId64",\"cpu_us\":%"PRId64","
+               "\"calls\":%"PRIu64",\"in\":%"PRIu64",\"out\":%"PRIu64","
+               "\"bytes\":%"PRIu64",\"queue\":%"PRIu64",\"queue_max\":%"PRIu64"}",
+               name, s->wall_usec, s->cpu_usec, s->nb_calls, s->nb_in,
+               s->nb_out, s->bytes, s->queue, s->queue_max);
+}
+
+static void print_filter(AVBPrint *bp, const AVFilterContext *f, int idx)
+{
+    AVFilterStats st;
+    unsigned i;
+
+    if (avfilter_get_stats(f, &st) < 0)
+        return;
+
+    av_bprintf(bp, "%s{\"name\":", idx ? "," : "");
+    print_json_string(bp, f->name);
+    av_bprintf(bp, ",\"filter\":\"%s\",\"time_us\":%"PRId64",\"activations\":%"PRIu64","
+               "\"frames_in\":%"PRId64",\"frames_out\":%"PRId64","
+               "\"queued\":%"PRIu64",\"queued_max\":%"PRIu64","
+               "\"slice_time_us\":%"PRId64",\"slice_busy_us\":%"PRId64","
+               "\"slice_max_busy_us\":%"PRId64","
+               "\"slice_executes\":%"PRIu64",\"slice_jobs\":%"PRIu64",\"threads\":%d,"
+               "\"inputs\":[",
+               f->filter->name, st.activate_time, st.nb_activations,
+               st.frames_in, st.frames_out, st.queued_frames, st.max_queued_frames,
+               st.execute_time, st.execute_busy_time, st.execute_max_busy_time,
+               st.nb_executes, st.nb_jobs, st.nb_threads);
+    for (i = 0; i < f->nb_inputs; i++) {
+        AVFilterLinkStats lst = { 0 };
+
+        if (f->inputs[i])
+            avfilter_link_get_stats(f->inputs[i], &lst);
+        av_bprintf(bp, "%s{\"queued\":%"PRIu64",\"queued_max\":%"PRIu64"}",
+                   i ? "," : "", lst.queued_frames, lst.max_queued_frames);
+    }
+    av_bprintf(bp, "]}");
+}
+
+static void print_memory(AVBPrint *bp)
+{
+    MemBudgetStats st;
+
+    mem_budget_get_stats(&st);
+    av_bprintf(bp, "\"memory\":{\"input\":%"PRId64",\"filter\":%"PRId64","
+               "\"muxing\":%"PRId64",\"total\":%"PRId64",\"peak\":%"PRId64","
+               "\"budget\":%"PRId64"}",
+               st.used[MEM_POOL_INPUT], st.used[MEM_POOL_FILTER],
+               st.used[MEM_POOL_MUXING], st.total, st.peak, max_memory);
+}
+
+/**
+ * Write one JSON object describing all pipeline stages to the -stats_profile
+ * output. Non-final reports are rate limited to -stats_profile_period.
+ */
+void stats_profile_dump(int64_t cur_time, int is_last)
+{
+    static int64_t last_time = -1;
+    AVBPrint bp;
+    int i, j;
+
+    if (!stats_profile_avio)
+        return;
+
+    if (!is_last) {
+        if (last_time == -1) {
+            last_time = cur_time;
+            return;
+        }
+        if (cur_time - last_time < stats_profile_period)
+            return;
+    }
+    last_time = cur_time;
+
+    av_bprint_init(&bp, 0, AV_BPRINT_SIZE_UNLIMITED);
+    ff_mutex_lock(&stats_lock);
+
+    av_bprintf(&bp, "{\"time_us\":%"PRId64",\"final\":%d,\"inputs\":[",
+               cur_time, !!is_last);
+    for (i = 0; i < nb_input_files; i++) {
+        InputFile *f = input_files[i];
+
+        av_bprintf(&bp, "%s{\"file\":%d,\"url\":", i ? "," : "", i);
+        print_json_string(&bp, f->ctx->url);
+        av_bprintf(&bp, ",");
+        print_stage(&bp, "demux", &f->prof_demux);
+        av_bprintf(&bp, ",\"streams\":[");
+        for (j = 0; j < f->nb_streams; j++) {
+            InputStream *ist = input_streams[f->ist_index + j];
+
+            av_bprintf(&bp, "%s{\"index\":%d,\"type\":\"%s\",", j ? "," : "",
+                       ist->st->index,
+                       media_type_string(ist->st->codecpar->codec_type));
+            print_stage(&bp, "decode", &ist->prof_decode);
+            av_bprintf(&bp, "}");
+        }
+        av_bprintf(&bp, "]}");
+    }
+
+    av_bprintf(&bp, "],\"filtergraphs\":[");
+    for (i = 0; i < nb_filtergraphs; i++) {
+        FilterGraph *fg = filtergraphs[i];
+
+        av_bprintf(&bp, "%s{\"index\":%d,\"simple\":%d,", i ? "," : "",
+                   fg->index, filtergraph_is_simple(fg));
+        print_stage(&bp, "filter", &fg->prof_filter);
+        av_bprintf(&bp, ",\"filters\":[");
+        for (j = 0; fg->graph && j < fg->graph->nb_filters; j++)
+            print_filter(&bp, fg->graph->filters[j], j);
+        av_bprintf(&bp, "]}");
+    }
+
+    av_bprintf(&bp, "],\"outputs\":[");
+    for (i = 0; i < nb_output_files; i++) {
+        OutputFile *of = output_files[i];
+
+        av_bprintf(&bp, "%s{\"file\":%d,\"url\":", i ? "," : "", i);
+        print_json_string(&bp, of->ctx->url);
+        av_bprintf(&bp, ",");
+        print_stage(&bp, "trailer", &of->prof_trailer);
+        av_bprintf(&bp, ",\"streams\":[");
+        for (j = 0; j < of->ctx->nb_streams; j++) {
+            OutputStream *ost = output_streams[of->ost_index + j];
+
+            av_bprintf(&bp, "%s{\"index\":%d,\"type\":\"%s\",", j ? "," : "",
+                       ost->index,
+                       media_type_string(ost->st->codecpar->codec_type));
+            print_stage(&bp, "encode", &ost->prof_encode);
+            av_bprintf(&bp, ",");
+            print_stage(&bp, "mux", &ost->prof_mux);
+            av_bprintf(&bp, "}");
+        }
+        av_bprintf(&bp, "]}");
+    }
+    av_bprintf(&bp, "],");
+    print_memory(&bp);
+    av_bprintf(&bp, "}\n");
+
+    ff_mutex_unlock(&stats_lock);
+
+    if (av_bprint_is_complete(&bp))
+        avio_write(stats_profile_avio, bp.str, bp.len);
+    avio_flush(stats_profile_avio);
+    av_bprint_finalize(&bp, NULL);
+}
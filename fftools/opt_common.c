@@ -20,7 +20,10 @@
 
 #include "config.h"
 
+#include <errno.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "cmdutils.h"
 #include "opt_common.h"
@@ -1076,6 +1079,31 @@ int opt_cpucount(void *optctx, const char *opt, const char *arg)
     return ret;
 }
 
+int opt_shared_threads(void *optctx, const char *opt, const char *arg)
+{
+    int ret;
+    int count;
+
+    static const AVOption opts[] = {
+        {"count", NULL, 0, AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX},
+        {NULL},
+    };
+    static const AVClass class = {
+        .class_name = "shared_threads",
+        .item_name  = av_default_item_name,
+        .option     = opts,
+        .version    = LIBAVUTIL_VERSION_INT,
+    };
+    const AVClass *pclass = &class;
+
+    ret = av_opt_eval_int(&pclass, opts, arg, &count);
+
+    if (!ret)
+        av_set_shared_thread_count(count);
+
+    return ret;
+}
+
 static void expand_filename_template(AVBPrint *bp, const char *template,
                                      struct tm *tm)
 {
@@ -1221,6 +1249,22 @@ int opt_max_alloc(void *optctx, const char *opt, const char *arg)
     return 0;
 }
 
+int opt_hugepage_threshold(void *optctx, const char *opt, const char *arg)
+{
+    char *tail;
+    long long threshold;
+
+    errno = 0;
+    threshold = strtoll(arg, &tail, 10);
+    if (tail == arg || *tail || threshold < 0 || errno == ERANGE ||
+        (unsigned long long)threshold > SIZE_MAX) {
+        av_log(NULL, AV_LOG_ERROR, "Invalid hugepage_threshold \"%s\".\n", arg);
+        return AVERROR(EINVAL);
+    }
+    av_hugepage_threshold(threshold);
+    return 0;
+}
+
 int opt_loglevel(void *optctx, const char *opt, const char *arg)
 {
     const struct { const char *name; int level; } log_levels[] = {
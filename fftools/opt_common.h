@@ -186,6 +186,8 @@ int init_report(const char *env, FILE **file);
 
 int opt_max_alloc(void *optctx, const char *opt, const char *arg);
 
+int opt_hugepage_threshold(void *optctx, const char *opt, const char *arg);
+
 /**
  * Override the cpuflags.
  */
@@ -196,6 +198,11 @@ int opt_cpuflags(void *optctx, const char *opt, const char *arg);
  */
 int opt_cpucount(void *optctx, const char *opt, const char *arg);
 
+/**
+ * Set the size of the slice thread pool shared by all contexts.
+ */
+int opt_shared_threads(void *optctx, const char *opt, const char *arg);
+
 #define CMDUTILS_COMMON_OPTIONS                                                                                         \
     { "L",           OPT_EXIT,             { .func_arg = show_license },     "show license" },                          \
     { "h",           OPT_EXIT,             { .func_arg = show_help },        "show help", "topic" },                    \
@@ -223,8 +230,10 @@ int opt_cpucount(void *optctx, const char *opt, const char *arg);
     { "v",           HAS_ARG,              { .func_arg = opt_loglevel },     "set logging level", "loglevel" },         \
     { "report",      0,                    { .func_arg = opt_report },       "generate a report" },                     \
     { "max_alloc",   HAS_ARG,              { .func_arg = opt_max_alloc },    "set maximum size of a single allocated block", "bytes" }, \
+    { "hugepage_threshold", HAS_ARG | OPT_EXPERT, { .func_arg = opt_hugepage_threshold }, "allocate blocks of at least this size in huge pages", "bytes" }, \
     { "cpuflags",    HAS_ARG | OPT_EXPERT, { .func_arg = opt_cpuflags },     "force specific cpu flags", "flags" },     \
     { "cpucount",    HAS_ARG | OPT_EXPERT, { .func_arg = opt_cpucount },     "force specific cpu count", "count" },     \
+    { "shared_threads", HAS_ARG | OPT_EXPERT, { .func_arg = opt_shared_threads }, "share one pool of slice threads between all contexts", "count" }, \
     { "hide_banner", OPT_BOOL | OPT_EXPERT, {&hide_banner},     "do not show program banner", "hide_banner" },          \
     CMDUTILS_COMMON_OPTIONS_AVDEVICE                                                                                    \
 
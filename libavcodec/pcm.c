@@ -37,10 +37,73 @@
 #include "internal.h"
 #include "mathops.h"
 #include "pcm_tablegen.h"
+#include "pcmdsp.h"
+
+/* the DSP functions work on multiples of 16 samples, the rest is done here */
+static void pack_s24le(const PCMDSPContext *dsp, uint8_t *dst,
+                       const int32_t *src, int n)
+{
+    int i = n & ~15;
+
+    if (i)
+        dsp->pack_s24le(dst, src, i);
+    for (; i < n; i++)
+        AV_WL24(dst + 3 * i, src[i] >> 8);
+}
+
+static void unpack_s24le(const PCMDSPContext *dsp, int32_t *dst,
+                         const uint8_t *src, int n)
+{
+    int i = n & ~15;
+
+    if (i)
+        dsp->unpack_s24le(dst, src, i);
+    for (; i < n; i++)
+        dst[i] = AV_RL24(src + 3 * i) << 8;
+}
+
+/* interleaved to planar: unpack blocks of whole sample frames into a
+ * buffer, then scatter them to the channels */
+static void unpack_s24le_planar(const PCMDSPContext *dsp, uint8_t **dst,
+                                const uint8_t *src, int n, int channels)
+{
+    int32_t buf[1024];
+    const int block = FFMAX(FF_ARRAY_ELEMS(buf) / channels, 1);
+    int i, c, j;
+
+    if (channels > FF_ARRAY_ELEMS(buf)) {
+        for (i = 0; i < n; i++)
+            for (c = 0; c < channels; c++, src += 3)
+                ((int32_t *)dst[c])[i] = AV_RL24(src) << 8;
+        return;
+    }
+
+    for (i = 0; i < n; i += block) {
+        const int len = FFMIN(block, n - i);
+
+        unpack_s24le(dsp, buf, src, len * channels);
+        src += 3 * len * channels;
+        for (c = 0; c < channels; c++) {
+            int32_t *d = (int32_t *)dst[c] + i;
+            for (j = 0; j < len; j++)
+                d[j] = buf[j * channels + c];
+        }
+    }
+}
+
+typedef struct PCMEncode {
+    PCMDSPContext dsp;
+} PCMEncode;
 
 static av_cold int pcm_encode_init(AVCodecContext *avctx)
 {
+    PCMEncode *s = avctx->priv_data;
+
     avctx->frame_size = 0;
+    if (CONFIG_PCMDSP &&
+        (avctx->codec->id == AV_CODEC_ID_PCM_S24LE ||
+         avctx->codec->id == AV_CODEC_ID_PCM_S24LE_PLANAR))
+        ff_pcmdsp_init(&s->dsp);
 #if !CONFIG_HARDCODED_TABLES
     switch (avctx->codec->id) {
 #define INIT_ONCE(id, name)                                                 \
@@ -96,6 +159,7 @@ static av_cold int pcm_encode_init(AVCodecContext *avctx)
 static int pcm_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
                             const AVFrame *frame, int *got_packet_ptr)
 {
+    PCMEncode *s = avctx->priv_data;
     int n, c, sample_size, v, ret;
     const short *samples;
     unsigned char *dst;
@@ -122,10 +186,14 @@ static int pcm_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
         ENCODE(uint32_t, be32, samples, dst, n, 0, 0x80000000)
         break;
     case AV_CODEC_ID_PCM_S24LE:
-        ENCODE(int32_t, le24, samples, dst, n, 8, 0)
+        pack_s24le(&s->dsp, dst, (const int32_t *)samples, n);
         break;
     case AV_CODEC_ID_PCM_S24LE_PLANAR:
-        ENCODE_PLANAR(int32_t, le24, dst, n, 8, 0)
+        n /= avctx->ch_layout.nb_channels;
+        for (c = 0; c < avctx->ch_layout.nb_channels; c++) {
+            pack_s24le(&s->dsp, dst, (const int32_t *)frame->extended_data[c], n);
+            dst += 3 * n;
+        }
         break;
     case AV_CODEC_ID_PCM_S24BE:
         ENCODE(int32_t, be24, samples, dst, n, 8, 0)
@@ -247,6 +315,7 @@ typedef struct PCMDecode {
     void (*vector_fmul_scalar)(float *dst, const float *src, float mul,
                                int len);
     float   scale;
+    PCMDSPContext dsp;
 } PCMDecode;
 
 static av_cold int pcm_decode_init(AVCodecContext *avctx)
@@ -285,13 +354,23 @@ static av_cold int pcm_decode_init(AVCodecContext *avctx)
         s->vector_fmul_scalar = fdsp->vector_fmul_scalar;
         av_free(fdsp);
         break;
+    case AV_CODEC_ID_PCM_S24LE:
+    case AV_CODEC_ID_PCM_S24LE_PLANAR:
+        if (CONFIG_PCMDSP)
+            ff_pcmdsp_init(&s->dsp);
+        break;
     default:
         break;
     }
 
     avctx->sample_fmt = avctx->codec->sample_fmts[0];
 
-    if (avctx->sample_fmt == AV_SAMPLE_FMT_S32)
+    /* deinterleaving while unpacking is cheaper than a separate pass */
+    if (avctx->codec->sample_fmts[1] != AV_SAMPLE_FMT_NONE &&
+        avctx->request_sample_fmt == avctx->codec->sample_fmts[1])
+        avctx->sample_fmt = avctx->codec->sample_fmts[1];
+
+    if (av_get_packed_sample_fmt(avctx->sample_fmt) == AV_SAMPLE_FMT_S32)
         avctx->bits_per_raw_sample = av_get_bits_per_sample(avctx->codec_id);
 
     return 0;
@@ -390,10 +469,18 @@ static int pcm_decode_frame(AVCodecContext *avctx, AVFrame *frame,
         DECODE(32, be32, src, samples, n, 0, 0x80000000)
         break;
     case AV_CODEC_ID_PCM_S24LE:
-        DECODE(32, le24, src, samples, n, 8, 0)
+        if (avctx->sample_fmt == AV_SAMPLE_FMT_S32P)
+            unpack_s24le_planar(&s->dsp, frame->extended_data, src,
+                                n / channels, channels);
+        else
+            unpack_s24le(&s->dsp, (int32_t *)samples, src, n);
         break;
     case AV_CODEC_ID_PCM_S24LE_PLANAR:
-        DECODE_PLANAR(32, le24, src, samples, n, 8, 0);
+        n /= channels;
+        for (c = 0; c < channels; c++) {
+            unpack_s24le(&s->dsp, (int32_t *)frame->extended_data[c], src, n);
+            src += 3 * n;
+        }
         break;
     case AV_CODEC_ID_PCM_S24BE:
         DECODE(32, be24, src, samples, n, 8, 0)
@@ -560,6 +647,7 @@ const FFCodec ff_ ## name_ ## _encoder = {                                  \
     .p.type       = AVMEDIA_TYPE_AUDIO,                                     \
     .p.id         = AV_CODEC_ID_ ## id_,                                    \
     .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_VARIABLE_FRAME_SIZE,    \
+    .priv_data_size = sizeof(PCMEncode),                                    \
     .init         = pcm_encode_init,                                        \
     FF_CODEC_ENCODE_CB(pcm_encode_frame),                                   \
     .p.sample_fmts = (const enum AVSampleFormat[]){ sample_fmt_,             \
@@ -574,8 +662,8 @@ const FFCodec ff_ ## name_ ## _encoder = {                                  \
 #define PCM_ENCODER(id, sample_fmt, name, long_name)                        \
     PCM_ENCODER_3(CONFIG_ ## id ## _ENCODER, id, sample_fmt, name, long_name)
 
-#define PCM_DECODER_0(id, sample_fmt, name, long_name)
-#define PCM_DECODER_1(id_, sample_fmt_, name_, long_name_)                  \
+#define PCM_DECODER_0(id, sample_fmt, alt_fmt, name, long_name)
+#define PCM_DECODER_1(id_, sample_fmt_, alt_fmt_, name_, long_name_)        \
 const FFCodec ff_ ## name_ ## _decoder = {                                  \
     .p.name         = #name_,                                               \
     .p.long_name    = NULL_IF_CONFIG_SMALL(long_name_),                     \
@@ -585,17 +673,22 @@ const FFCodec ff_ ## name_ ## _decoder = {                                  \
     .init           = pcm_decode_init,                                      \
     FF_CODEC_DECODE_CB(pcm_decode_frame),                                    \
     .p.capabilities = AV_CODEC_CAP_DR1,                                     \
-    .p.sample_fmts  = (const enum AVSampleFormat[]){ sample_fmt_,           \
+    .p.sample_fmts  = (const enum AVSampleFormat[]){ sample_fmt_, alt_fmt_, \
                                                      AV_SAMPLE_FMT_NONE },  \
     .caps_internal  = FF_CODEC_CAP_INIT_THREADSAFE,                         \
 }
 
-#define PCM_DECODER_2(cf, id, sample_fmt, name, long_name)                  \
-    PCM_DECODER_ ## cf(id, sample_fmt, name, long_name)
-#define PCM_DECODER_3(cf, id, sample_fmt, name, long_name)                  \
-    PCM_DECODER_2(cf, id, sample_fmt, name, long_name)
+#define PCM_DECODER_2(cf, id, sample_fmt, alt_fmt, name, long_name)         \
+    PCM_DECODER_ ## cf(id, sample_fmt, alt_fmt, name, long_name)
+#define PCM_DECODER_3(cf, id, sample_fmt, alt_fmt, name, long_name)         \
+    PCM_DECODER_2(cf, id, sample_fmt, alt_fmt, name, long_name)
 #define PCM_DECODER(id, sample_fmt, name, long_name)                        \
-    PCM_DECODER_3(CONFIG_ ## id ## _DECODER, id, sample_fmt, name, long_name)
+    PCM_DECODER_3(CONFIG_ ## id ## _DECODER, id, sample_fmt,                \
+                  AV_SAMPLE_FMT_NONE, name, long_name)
+/* a decoder that outputs alt_fmt instead when it is requested */
+#define PCM_DECODER_ALT(id, sample_fmt, alt_fmt, name, long_name)           \
+    PCM_DECODER_3(CONFIG_ ## id ## _DECODER, id, sample_fmt,                \
+                  alt_fmt, name, long_name)
 
 #define PCM_CODEC(id, sample_fmt_, name, long_name_)                    \
     PCM_ENCODER(id, sample_fmt_, name, long_name_);                     \
@@ -619,7 +712,8 @@ PCM_CODEC  (PCM_S16LE,        AV_SAMPLE_FMT_S16, pcm_s16le,        "PCM signed 1
 PCM_CODEC  (PCM_S16LE_PLANAR, AV_SAMPLE_FMT_S16P,pcm_s16le_planar, "PCM signed 16-bit little-endian planar");
 PCM_CODEC  (PCM_S24BE,        AV_SAMPLE_FMT_S32, pcm_s24be,        "PCM signed 24-bit big-endian");
 PCM_CODEC  (PCM_S24DAUD,      AV_SAMPLE_FMT_S16, pcm_s24daud,      "PCM D-Cinema audio signed 24-bit");
-PCM_CODEC  (PCM_S24LE,        AV_SAMPLE_FMT_S32, pcm_s24le,        "PCM signed 24-bit little-endian");
+PCM_ENCODER(PCM_S24LE,        AV_SAMPLE_FMT_S32, pcm_s24le,        "PCM signed 24-bit little-endian");
+PCM_DECODER_ALT(PCM_S24LE,    AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_S32P, pcm_s24le, "PCM signed 24-bit little-endian");
 PCM_CODEC  (PCM_S24LE_PLANAR, AV_SAMPLE_FMT_S32P,pcm_s24le_planar, "PCM signed 24-bit little-endian planar");
 PCM_CODEC  (PCM_S32BE,        AV_SAMPLE_FMT_S32, pcm_s32be,        "PCM signed 32-bit big-endian");
 PCM_CODEC  (PCM_S32LE,        AV_SAMPLE_FMT_S32, pcm_s32le,        "PCM signed 32-bit little-endian");
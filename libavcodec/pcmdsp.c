@@ -0,0 +1,49 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/intreadwrite.h"
+#include "pcmdsp.h"
+
+static void unpack_s24le_c(int32_t *dst, const uint8_t *src, int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++)
+        dst[i] = AV_RL24(src + 3 * i) << 8;
+}
+
+static void pack_s24le_c(uint8_t *dst, const int32_t *src, int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++)
+        AV_WL24(dst + 3 * i, src[i] >> 8);
+}
+
+av_cold void ff_pcmdsp_init(PCMDSPContext *c)
+{
+    c->unpack_s24le = unpack_s24le_c;
+    c->pack_s24le   = pack_s24le_c;
+
+    if (ARCH_X86)
+        ff_pcmdsp_init_x86(c);
+}
@@ -0,0 +1,45 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_PCMDSP_H
+#define AVCODEC_PCMDSP_H
+
+#include <stdint.h>
+
+typedef struct PCMDSPContext {
+    /**
+     * Convert signed 24-bit little-endian samples to int32, with the
+     * sample in the 24 most significant bits.
+     * @param len number of samples
+     *            constraints: multiple of 16 greater than zero
+     */
+    void (*unpack_s24le)(int32_t *dst, const uint8_t *src, int len);
+
+    /**
+     * Store the 24 most significant bits of int32 samples as signed 24-bit
+     * little-endian samples.
+     * @param len number of samples
+     *            constraints: multiple of 16 greater than zero
+     */
+    void (*pack_s24le)(uint8_t *dst, const int32_t *src, int len);
+} PCMDSPContext;
+
+void ff_pcmdsp_init(PCMDSPContext *c);
+void ff_pcmdsp_init_x86(PCMDSPContext *c);
+
+#endif /* AVCODEC_PCMDSP_H */
@@ -0,0 +1,182 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem_internal.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libavcodec/pcmdsp.h"
+
+#if HAVE_SSSE3_INLINE
+DECLARE_ASM_ALIGNED(32, static const uint32_t, pd_pack_s24_perm)[8] = {
+    0, 1, 2, 4, 5, 6, 3, 7,
+};
+/* the avx2 unpack loads both of these as one mask, keep them together */
+DECLARE_ASM_ALIGNED(32, static const int8_t, pb_unpack_s24)[32] = {
+    -1,  0,  1,  2, -1,  3,  4,  5, -1,  6,  7,  8, -1,  9, 10, 11,
+    -1,  4,  5,  6, -1,  7,  8,  9, -1, 10, 11, 12, -1, 13, 14, 15,
+};
+DECLARE_ASM_ALIGNED(16, static const int8_t, pb_pack_s24)[16] = {
+     1,  2,  3,  5,  6,  7,  9, 10, 11, 13, 14, 15, -1, -1, -1, -1,
+};
+
+/* 16 samples (48 bytes in, 64 bytes out) per iteration; the last 12 input
+ * bytes are loaded from offset 32 so that nothing past the end is read */
+static void pcm_unpack_s24le_ssse3(int32_t *dst, const uint8_t *src, int len)
+{
+    __asm__ volatile(
+        "movdqa           %3, %%xmm2        \n\t"
+        "movdqa           %4, %%xmm3        \n\t"
+        "1:                                 \n\t"
+        "movdqu     (%1), %%xmm0            \n\t"
+        "movdqu   12(%1), %%xmm1            \n\t"
+        "pshufb      %%xmm2, %%xmm0         \n\t"
+        "pshufb      %%xmm2, %%xmm1         \n\t"
+        "movdqu      %%xmm0,   (%0)         \n\t"
+        "movdqu      %%xmm1, 16(%0)         \n\t"
+        "movdqu   24(%1), %%xmm0            \n\t"
+        "movdqu   32(%1), %%xmm1            \n\t"
+        "pshufb      %%xmm2, %%xmm0         \n\t"
+        "pshufb      %%xmm3, %%xmm1         \n\t"
+        "movdqu      %%xmm0, 32(%0)         \n\t"
+        "movdqu      %%xmm1, 48(%0)         \n\t"
+        "add             $48, %1            \n\t"
+        "add             $64, %0            \n\t"
+        "sub             $16, %2            \n\t"
+        " jg              1b                \n\t"
+        : "+r"(dst), "+r"(src), "+r"(len)
+        : "m"(pb_unpack_s24[0]), "m"(pb_unpack_s24[16])
+        : "memory", XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm3",) "cc"
+    );
+}
+
+/* 16 samples (64 bytes in, 48 bytes out) per iteration */
+static void pcm_pack_s24le_ssse3(uint8_t *dst, const int32_t *src, int len)
+{
+    __asm__ volatile(
+        "movdqa           %3, %%xmm1        \n\t"
+        "1:                                 \n\t"
+        "movdqu     (%1), %%xmm0            \n\t"
+        "pshufb      %%xmm1, %%xmm0         \n\t"
+        "movq        %%xmm0,   (%0)         \n\t"
+        "psrldq          $8, %%xmm0         \n\t"
+        "movd        %%xmm0,  8(%0)         \n\t"
+        "movdqu   16(%1), %%xmm0            \n\t"
+        "pshufb      %%xmm1, %%xmm0         \n\t"
+        "movq        %%xmm0, 12(%0)         \n\t"
+        "psrldq          $8, %%xmm0         \n\t"
+        "movd        %%xmm0, 20(%0)         \n\t"
+        "movdqu   32(%1), %%xmm0            \n\t"
+        "pshufb      %%xmm1, %%xmm0         \n\t"
+        "movq        %%xmm0, 24(%0)         \n\t"
+        "psrldq          $8, %%xmm0         \n\t"
+        "movd        %%xmm0, 32(%0)         \n\t"
+        "movdqu   48(%1), %%xmm0            \n\t"
+        "pshufb      %%xmm1, %%xmm0         \n\t"
+        "movq        %%xmm0, 36(%0)         \n\t"
+        "psrldq          $8, %%xmm0         \n\t"
+        "movd        %%xmm0, 44(%0)         \n\t"
+        "add             $64, %1            \n\t"
+        "add             $48, %0            \n\t"
+        "sub             $16, %2            \n\t"
+        " jg              1b                \n\t"
+        : "+r"(dst), "+r"(src), "+r"(len)
+        : "m"(pb_pack_s24[0])
+        : "memory", XMM_CLOBBERS("xmm0", "xmm1",) "cc"
+    );
+}
+
+#if HAVE_AVX2_INLINE
+static void pcm_unpack_s24le_avx2(int32_t *dst, const uint8_t *src, int len)
+{
+    __asm__ volatile(
+        "vbroadcasti128   %3, %%ymm2                    \n\t"
+        "vmovdqu          %4, %%ymm3                    \n\t"
+        "1:                                             \n\t"
+        "vmovdqu      (%1), %%xmm0                      \n\t"
+        "vmovdqu    24(%1), %%xmm1                      \n\t"
+        "vinserti128 $1, 12(%1), %%ymm0, %%ymm0         \n\t"
+        "vinserti128 $1, 32(%1), %%ymm1, %%ymm1         \n\t"
+        "vpshufb     %%ymm2, %%ymm0, %%ymm0             \n\t"
+        "vpshufb     %%ymm3, %%ymm1, %%ymm1             \n\t"
+        "vmovdqu     %%ymm0,   (%0)                     \n\t"
+        "vmovdqu     %%ymm1, 32(%0)                     \n\t"
+        "add             $48, %1                        \n\t"
+        "add             $64, %0                        \n\t"
+        "sub             $16, %2                        \n\t"
+        " jg              1b                            \n\t"
+        "vzeroupper                                     \n\t"
+        : "+r"(dst), "+r"(src), "+r"(len)
+        : "m"(pb_unpack_s24[0]), "m"(pb_unpack_s24[0])
+        : "memory", XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm3",) "cc"
+    );
+}
+
+static void pcm_pack_s24le_avx2(uint8_t *dst, const int32_t *src, int len)
+{
+    __asm__ volatile(
+        "vbroadcasti128   %3, %%ymm1                    \n\t"
+        "vmovdqu          %4, %%ymm2                    \n\t"
+        "1:                                             \n\t"
+        "vmovdqu       (%1), %%ymm0                     \n\t"
+        "vpshufb     %%ymm1, %%ymm0, %%ymm0             \n\t"
+        /* move the 12 bytes of the high lane next to those of the low lane */
+        "vpermd      %%ymm0, %%ymm2, %%ymm0             \n\t"
+        "vmovdqu     %%xmm0,   (%0)                     \n\t"
+        "vextracti128 $1, %%ymm0, %%xmm0                \n\t"
+        "vmovq       %%xmm0, 16(%0)                     \n\t"
+        "vmovdqu     32(%1), %%ymm0                     \n\t"
+        "vpshufb     %%ymm1, %%ymm0, %%ymm0             \n\t"
+        "vpermd      %%ymm0, %%ymm2, %%ymm0             \n\t"
+        "vmovdqu     %%xmm0, 24(%0)                     \n\t"
+        "vextracti128 $1, %%ymm0, %%xmm0                \n\t"
+        "vmovq       %%xmm0, 40(%0)                     \n\t"
+        "add             $64, %1                        \n\t"
+        "add             $48, %0                        \n\t"
+        "sub             $16, %2                        \n\t"
+        " jg              1b                            \n\t"
+        "vzeroupper                                     \n\t"
+        : "+r"(dst), "+r"(src), "+r"(len)
+        : "m"(pb_pack_s24[0]), "m"(pd_pack_s24_perm[0])
+        : "memory", XMM_CLOBBERS("xmm0", "xmm1", "xmm2",) "cc"
+    );
+}
+#endif /* HAVE_AVX2_INLINE */
+#endif /* HAVE_SSSE3_INLINE */
+
+av_cold void ff_pcmdsp_init_x86(PCMDSPContext *c)
+{
+#if HAVE_SSSE3_INLINE
+    int cpu_flags = av_get_cpu_flags();
+
+    if (INLINE_SSSE3(cpu_flags)) {
+        c->unpack_s24le = pcm_unpack_s24le_ssse3;
+        c->pack_s24le   = pcm_pack_s24le_ssse3;
+    }
+#if HAVE_AVX2_INLINE
+    if (INLINE_AVX2(cpu_flags) && !(cpu_flags & AV_CPU_FLAG_AVXSLOW)) {
+        c->unpack_s24le = pcm_unpack_s24le_avx2;
+        c->pack_s24le   = pcm_pack_s24le_avx2;
+    }
+#endif
+#endif /* HAVE_SSSE3_INLINE */
+}
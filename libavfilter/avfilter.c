@@ -19,6 +19,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <stdatomic.h>
+
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
 #include "libavutil/buffer.h"
@@ -33,6 +35,7 @@
 #include "libavutil/rational.h"
 #include "libavutil/samplefmt.h"
 #include "libavutil/thread.h"
+#include "libavutil/time.h"
 
 #define FF_INTERNAL_FIELDS 1
 #include "framequeue.h"
@@ -630,6 +633,7 @@ static const AVOption avfilter_options[] = {
     { "thread_type", "Allowed thread types", OFFSET(thread_type), AV_OPT_TYPE_FLAGS,
         { .i64 = AVFILTER_THREAD_SLICE }, 0, INT_MAX, FLAGS, "thread_type" },
         { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = FLAGS, .unit = "thread_type" },
+        { "frame", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_FRAME }, .flags = FLAGS, .unit = "thread_type" },
     { "enable", "set enable expression", OFFSET(enable_str), AV_OPT_TYPE_STRING, {.str=NULL}, .flags = TFLAGS },
     { "threads", "Allowed number of threads", OFFSET(nb_threads), AV_OPT_TYPE_INT,
         { .i64 = 0 }, 0, INT_MAX, FLAGS },
@@ -661,6 +665,43 @@ static int default_execute(AVFilterContext *ctx, avfilter_action_func *func, voi
     return 0;
 }
 
+typedef struct ExecuteStatsContext {
+    avfilter_action_func *func;
+    void *arg;
+    atomic_int_least64_t busy_time;
+} ExecuteStatsContext;
+
+static int execute_stats_job(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ExecuteStatsContext *s = arg;
+    int64_t start = av_gettime_relative();
+    int ret = s->func(ctx, s->arg, jobnr, nb_jobs);
+
+    atomic_fetch_add_explicit(&s->busy_time, av_gettime_relative() - start,
+                              memory_order_relaxed);
+    return ret;
+}
+
+int ff_filter_execute_stats(AVFilterContext *ctx, avfilter_action_func *func,
+                            void *arg, int *ret, int nb_jobs)
+{
+    AVFilterInternal *fi = ctx->internal;
+    ExecuteStatsContext s = { .func = func, .arg = arg };
+    int64_t start;
+    int err;
+
+    atomic_init(&s.busy_time, 0);
+
+    start = av_gettime_relative();
+    err   = fi->execute(ctx, execute_stats_job, &s, ret, nb_jobs);
+    fi->execute_time      += av_gettime_relative() - start;
+    fi->execute_busy_time += atomic_load_explicit(&s.busy_time, memory_order_relaxed);
+    fi->nb_executes++;
+    fi->nb_jobs           += FFMAX(nb_jobs, 0);
+
+    return err;
+}
+
 AVFilterContext *ff_filter_alloc(const AVFilter *filter, const char *inst_name)
 {
     AVFilterContext *ret;
@@ -804,6 +845,8 @@ void avfilter_free(AVFilterContext *filter)
 
 int ff_filter_get_nb_threads(AVFilterContext *ctx)
 {
+    if (ctx->thread_type & AVFILTER_THREAD_FRAME)
+        return 1;
     if (ctx->nb_threads > 0)
         return FFMIN(ctx->nb_threads, ctx->graph->nb_threads);
     return ctx->graph->nb_threads;
@@ -905,7 +948,13 @@ int avfilter_init_dict(AVFilterContext *ctx, AVDictionary **options)
         return ret;
     }
 
-    if (ctx->filter->flags & AVFILTER_FLAG_SLICE_THREADS &&
+    if (ctx->filter->flags & AVFILTER_FLAG_FRAME_THREADS &&
+        ctx->thread_type & ctx->graph->thread_type & AVFILTER_THREAD_FRAME &&
+        ctx->graph->internal->thread_execute) {
+        /* the slice jobs of each frame run serially in its frame job */
+        ctx->thread_type             = AVFILTER_THREAD_FRAME;
+        ctx->internal->frame_execute = ctx->graph->internal->thread_execute;
+    } else if (ctx->filter->flags & AVFILTER_FLAG_SLICE_THREADS &&
         ctx->thread_type & ctx->graph->thread_type & AVFILTER_THREAD_SLICE &&
         ctx->graph->internal->thread_execute) {
         ctx->thread_type       = AVFILTER_THREAD_SLICE;
@@ -1058,6 +1107,8 @@ int ff_filter_frame(AVFilterLink *link, AVFrame *frame)
         av_frame_free(&frame);
         return ret;
     }
+    link->max_queued_frames = FFMAX(link->max_queued_frames,
+                                    ff_framequeue_queued_frames(&link->fifo));
     ff_filter_set_ready(link->dst, 300);
     return 0;
 
@@ -1354,14 +1405,25 @@ static int ff_filter_activate_default(AVFilterContext *filter)
 
 int ff_filter_activate(AVFilterContext *filter)
 {
+    int stats = filter->graph && filter->graph->internal->stats;
+    int64_t start = 0;
     int ret;
 
     /* Generic timeline support is not yet implemented but should be easy */
     av_assert1(!(filter->filter->flags & AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC &&
                  filter->filter->activate));
     filter->ready = 0;
-    ret = filter->filter->activate ? filter->filter->activate(filter) :
-          ff_filter_activate_default(filter);
+    if (stats)
+        start = av_gettime_relative();
+    if (filter->thread_type & AVFILTER_THREAD_FRAME)
+        ret = ff_filter_frame_thread_activate(filter);
+    else
+        ret = filter->filter->activate ? filter->filter->activate(filter) :
+              ff_filter_activate_default(filter);
+    if (stats) {
+        filter->internal->activate_time += av_gettime_relative() - start;
+        filter->internal->nb_activations++;
+    }
     if (ret == FFERROR_NOT_READY)
         ret = 0;
     return ret;
@@ -1566,6 +1628,60 @@ int ff_inoutlink_check_flow(AVFilterLink *inlink, AVFilterLink *outlink)
 }
 
 
+int avfilter_get_stats(const AVFilterContext *ctx, AVFilterStats *stats)
+{
+    const AVFilterInternal *fi = ctx->internal;
+    unsigned i;
+
+    if (!ctx->graph)
+        return AVERROR(EINVAL);
+
+    memset(stats, 0, sizeof(*stats));
+    stats->activate_time     = fi->activate_time;
+    stats->nb_activations    = fi->nb_activations;
+    stats->execute_time      = fi->execute_time;
+    stats->execute_busy_time = fi->execute_busy_time;
+    stats->execute_max_busy_time = fi->execute_max_busy_time;
+    stats->nb_executes       = fi->nb_executes;
+    stats->nb_jobs           = fi->nb_jobs;
+    if (ctx->thread_type & AVFILTER_THREAD_FRAME)
+        stats->nb_threads    = ctx->nb_threads > 0 ?
+                               FFMIN(ctx->nb_threads, ctx->graph->nb_threads) :
+                               ctx->graph->nb_threads;
+    else if (ctx->thread_type & AVFILTER_THREAD_SLICE)
+        stats->nb_threads    = ff_filter_get_nb_threads((AVFilterContext *)ctx);
+    else
+        stats->nb_threads    = 1;
+
+    for (i = 0; i < ctx->nb_inputs; i++) {
+        const AVFilterLink *link = ctx->inputs[i];
+        if (!link)
+            continue;
+        stats->frames_in        += link->frame_count_out;
+        stats->queued_frames    += ff_framequeue_queued_frames(&link->fifo);
+        stats->max_queued_frames = FFMAX(stats->max_queued_frames,
+                                         link->max_queued_frames);
+    }
+    for (i = 0; i < ctx->nb_outputs; i++) {
+        if (ctx->outputs[i])
+            stats->frames_out += ctx->outputs[i]->frame_count_in;
+    }
+
+    return 0;
+}
+
+int avfilter_link_get_stats(const AVFilterLink *link, AVFilterLinkStats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->frames_in         = link->frame_count_in;
+    stats->frames_out        = link->frame_count_out;
+    stats->queued_frames     = ff_framequeue_queued_frames(&link->fifo);
+    stats->queued_samples    = ff_framequeue_queued_samples(&link->fifo);
+    stats->max_queued_frames = link->max_queued_frames;
+    stats->queued_bytes      = ff_framequeue_queued_bytes(&link->fifo);
+    return 0;
+}
+
 const AVClass *avfilter_get_class(void)
 {
     return &avfilter_class;
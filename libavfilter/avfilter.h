@@ -125,6 +125,12 @@ enum AVMediaType avfilter_pad_get_type(const AVFilterPad *pads, int pad_idx);
  * and processing them concurrently.
  */
 #define AVFILTER_FLAG_SLICE_THREADS         (1 << 2)
+/**
+ * The filter has a single video input and output and processes every frame
+ * independently of the other frames, so that several frames can be filtered
+ * concurrently and output in order (see AVFILTER_THREAD_FRAME).
+ */
+#define AVFILTER_FLAG_FRAME_THREADS         (1 << 4)
 /**
  * The filter is a "metadata" filter - it does not modify the frame data in any
  * way. It may only affect the metadata (i.e. those fields copied by
@@ -401,6 +407,12 @@ unsigned avfilter_filter_pad_count(const AVFilter *filter, int is_output);
  * Process multiple parts of the frame concurrently.
  */
 #define AVFILTER_THREAD_SLICE (1 << 0)
+/**
+ * Process multiple frames concurrently. This adds up to one frame of latency
+ * per thread, so filters only use it when it is explicitly enabled in
+ * AVFilterContext.thread_type.
+ */
+#define AVFILTER_THREAD_FRAME (1 << 1)
 
 typedef struct AVFilterInternal AVFilterInternal;
 
@@ -430,7 +442,7 @@ struct AVFilterContext {
      *
      * May be set by the caller before initializing the filter to forbid some
      * or all kinds of multithreading for this filter. The default is allowing
-     * everything.
+     * slice threading; frame threading must be requested explicitly.
      *
      * When the filter is initialized, this field is combined using bit AND with
      * AVFilterGraph.thread_type to get the final mask used for determining
@@ -717,6 +729,11 @@ struct AVFilterLink {
      */
     int status_out;
 
+    /**
+     * Highest number of frames ever queued in fifo.
+     */
+    uint64_t max_queued_frames;
+
 #endif /* FF_INTERNAL_FIELDS */
 
 };
@@ -837,6 +854,93 @@ int avfilter_insert_filter(AVFilterLink *link, AVFilterContext *filt,
  */
 const AVClass *avfilter_get_class(void);
 
+/**
+ * Execution statistics of a filter instance.
+ *
+ * The timing and job counters are only updated while collection is enabled
+ * on the filter graph with avfilter_graph_set_stats(); the frame counters are
+ * always available.
+ */
+typedef struct AVFilterStats {
+    /**
+     * Time spent in the activate() or filter_frame() callbacks of the filter,
+     * in microseconds, and the number of activations.
+     */
+    int64_t  activate_time;
+    uint64_t nb_activations;
+
+    /**
+     * Number of frames consumed on all inputs and produced on all outputs.
+     */
+    int64_t  frames_in;
+    int64_t  frames_out;
+
+    /**
+     * Number of frames currently queued on all inputs, and the highest number
+     * of frames ever queued on a single input.
+     */
+    uint64_t queued_frames;
+    uint64_t max_queued_frames;
+
+    /**
+     * Wall-clock time spent running slice jobs, in microseconds, and the
+     * summed time spent in the individual jobs by all threads. The ratio
+     * execute_busy_time / (execute_time * nb_threads) is the slice thread
+     * utilisation.
+     */
+    int64_t  execute_time;
+    int64_t  execute_busy_time;
+    uint64_t nb_executes;
+    uint64_t nb_jobs;
+
+    /**
+     * Number of threads available to the filter for slice jobs.
+     */
+    int nb_threads;
+
+    /**
+     * Time spent in jobs by the busiest thread of each slice threaded
+     * execution, summed over all executions, in microseconds.
+     * execute_max_busy_time * nb_threads / execute_busy_time is the load
+     * imbalance between the threads: values well above 1 mean the jobs are
+     * uneven or fewer than the threads, and more, smaller jobs would finish
+     * sooner.
+     */
+    int64_t  execute_max_busy_time;
+} AVFilterStats;
+
+/**
+ * Retrieve the execution statistics of a filter instance.
+ *
+ * @param ctx    the filter instance, must be part of a filter graph
+ * @param stats  the structure to fill
+ * @return >= 0 in case of success, a negative AVERROR code otherwise
+ */
+int avfilter_get_stats(const AVFilterContext *ctx, AVFilterStats *stats);
+
+/**
+ * Queue statistics of a filter link.
+ */
+typedef struct AVFilterLinkStats {
+    int64_t  frames_in;          ///< number of frames sent through the link
+    int64_t  frames_out;         ///< number of frames taken from the link
+    uint64_t queued_frames;      ///< number of frames currently queued
+    uint64_t queued_samples;     ///< number of audio samples currently queued
+    uint64_t max_queued_frames;  ///< highest number of frames ever queued
+    /**
+     * size in bytes of the buffers referenced by the queued frames;
+     * buffers shared by several frames are counted once per frame
+     */
+    uint64_t queued_bytes;
+} AVFilterLinkStats;
+
+/**
+ * Retrieve the queue statistics of a filter link.
+ *
+ * @return >= 0 in case of success, a negative AVERROR code otherwise
+ */
+int avfilter_link_get_stats(const AVFilterLink *link, AVFilterLinkStats *stats);
+
 typedef struct AVFilterGraphInternal AVFilterGraphInternal;
 
 /**
@@ -999,6 +1103,18 @@ int avfilter_graph_create_filter(AVFilterContext **filt_ctx, const AVFilter *fil
  */
 void avfilter_graph_set_auto_convert(AVFilterGraph *graph, unsigned flags);
 
+/**
+ * Enable or disable the collection of execution statistics for the filters
+ * of the graph, see avfilter_get_stats().
+ *
+ * Collecting statistics adds a clock read around every filter activation and
+ * slice-threaded job, so it is disabled by default.
+ *
+ * @param enable  non-zero to enable collection, 0 to disable it; counters
+ *                collected so far are kept
+ */
+void avfilter_graph_set_stats(AVFilterGraph *graph, int enable);
+
 enum {
     AVFILTER_AUTO_CONVERT_ALL  =  0, /**< all automatic conversions enabled */
     AVFILTER_AUTO_CONVERT_NONE = -1, /**< all automatic conversions disabled */
@@ -62,6 +62,8 @@ typedef struct BufferSinkContext {
     int sample_rates_size;
 
     AVFrame *peeked_frame;
+
+    unsigned batch_samples;             ///< samples to accumulate for av_buffersink_get_frames()
 } BufferSinkContext;
 
 #define NB_ITEMS(list) (list ## _size / sizeof(*list))
@@ -154,6 +156,66 @@ int attribute_align_arg av_buffersink_get_samples(AVFilterContext *ctx,
     return get_frame_internal(ctx, frame, 0, nb_samples);
 }
 
+/* wait until enough samples for a batch are queued on the input */
+static int wait_batch(AVFilterContext *ctx, int nb_frames, int flags)
+{
+    BufferSinkContext *buf = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    int ret;
+
+    while (ff_framequeue_queued_samples(&inlink->fifo) < buf->batch_samples &&
+           ff_framequeue_queued_frames(&inlink->fifo) < nb_frames &&
+           !inlink->status_in) {
+        if ((flags & AV_BUFFERSINK_FLAG_NO_REQUEST)) {
+            return AVERROR(EAGAIN);
+        } else if (inlink->frame_wanted_out) {
+            ret = ff_filter_graph_run_once(ctx->graph);
+            if (ret < 0)
+                return ret;
+        } else {
+            ff_inlink_request_frame(inlink);
+        }
+    }
+    return 0;
+}
+
+int attribute_align_arg av_buffersink_get_frames(AVFilterContext *ctx, AVFrame **frames,
+                                                 int nb_frames, int flags)
+{
+    BufferSinkContext *buf = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    uint64_t nb_samples;
+    int i, ret;
+
+    if (nb_frames <= 0 || (flags & AV_BUFFERSINK_FLAG_PEEK))
+        return AVERROR(EINVAL);
+
+    if (buf->batch_samples && !buf->peeked_frame) {
+        ret = wait_batch(ctx, nb_frames, flags);
+        if (ret < 0)
+            return ret;
+    }
+
+    ret = get_frame_internal(ctx, frames[0], flags, inlink->min_samples);
+    if (ret < 0)
+        return ret;
+    nb_samples = frames[0]->nb_samples;
+
+    /* only take what is already queued, the graph is not run again */
+    for (i = 1; i < nb_frames; i++) {
+        if (buf->batch_samples && nb_samples >= buf->batch_samples)
+            break;
+        if (!ff_inlink_queued_frames(inlink))
+            break;
+        ret = get_frame_internal(ctx, frames[i], flags | AV_BUFFERSINK_FLAG_NO_REQUEST,
+                                 inlink->min_samples);
+        if (ret < 0)
+            break;
+        nb_samples += frames[i]->nb_samples;
+    }
+    return i;
+}
+
 #if FF_API_BUFFERSINK_ALLOC
 AVBufferSinkParams *av_buffersink_params_alloc(void)
 {
@@ -208,6 +270,17 @@ void av_buffersink_set_frame_size(AVFilterContext *ctx, unsigned frame_size)
     inlink->min_samples = inlink->max_samples = frame_size;
 }
 
+int av_buffersink_set_batch_samples(AVFilterContext *ctx, unsigned nb_samples)
+{
+    BufferSinkContext *buf = ctx->priv;
+
+    av_assert0(ctx->filter->activate == activate);
+    if (ctx->input_pads[0].type != AVMEDIA_TYPE_AUDIO)
+        return AVERROR(EINVAL);
+    buf->batch_samples = nb_samples;
+    return 0;
+}
+
 #define MAKE_AVFILTERLINK_ACCESSOR(type, field) \
 type av_buffersink_get_##field(const AVFilterContext *ctx) { \
     av_assert0(ctx->filter->activate == activate); \
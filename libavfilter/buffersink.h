@@ -139,6 +139,20 @@ AVABufferSinkParams *av_abuffersink_params_alloc(void);
  */
 void av_buffersink_set_frame_size(AVFilterContext *ctx, unsigned frame_size);
 
+/**
+ * Set the number of samples av_buffersink_get_frames() accumulates on an
+ * audio buffer sink before returning.
+ *
+ * Frames are returned as they were output by the filter graph, without
+ * being split or merged, so this avoids the copies done by
+ * av_buffersink_set_frame_size() when the caller accepts frames of variable
+ * size. Must not be combined with av_buffersink_set_frame_size().
+ *
+ * @param nb_samples  number of samples in a batch, 0 to disable
+ * @return 0 on success, AVERROR(EINVAL) if ctx is not an audio buffer sink
+ */
+int av_buffersink_set_batch_samples(AVFilterContext *ctx, unsigned nb_samples);
+
 /**
  * @defgroup lavfi_buffersink_accessors Buffer sink accessors
  * Get the properties of the stream
@@ -202,6 +216,33 @@ int av_buffersink_get_frame(AVFilterContext *ctx, AVFrame *frame);
  */
 int av_buffersink_get_samples(AVFilterContext *ctx, AVFrame *frame, int nb_samples);
 
+/**
+ * Get several frames with filtered data from sink at once.
+ *
+ * The first frame is obtained as with av_buffersink_get_frame_flags(); the
+ * following ones are only taken if they are already queued in the sink, the
+ * filter graph is not run again for them.
+ *
+ * If a batch size was set with av_buffersink_set_batch_samples(), the filter
+ * graph is run until at least that many samples or nb_frames frames are
+ * queued, or the end of the stream is reached. The returned frames then
+ * contain at least that many samples, unless nb_frames frames are returned
+ * or the end of the stream is reached first.
+ *
+ * @param ctx       pointer to a buffersink or abuffersink filter context.
+ * @param frames    array of nb_frames allocated frames, which will be filled
+ *                  with data. The data must be freed using av_frame_unref() /
+ *                  av_frame_free()
+ * @param nb_frames maximal number of frames to return
+ * @param flags     a combination of AV_BUFFERSINK_FLAG_* flags;
+ *                  AV_BUFFERSINK_FLAG_PEEK is not supported
+ *
+ * @return the number of frames returned (at least 1), or a negative AVERROR
+ *         code with the same meaning as for av_buffersink_get_frame().
+ */
+int av_buffersink_get_frames(AVFilterContext *ctx, AVFrame **frames,
+                             int nb_frames, int flags);
+
 /**
  * @}
  */
@@ -175,7 +175,7 @@ static int push_frame(AVFilterGraph *graph)
     return 0;
 }
 
-int attribute_align_arg av_buffersrc_add_frame_flags(AVFilterContext *ctx, AVFrame *frame, int flags)
+static int add_frame_internal(AVFilterContext *ctx, AVFrame *frame, int flags)
 {
     BufferSourceContext *s = ctx->priv;
     AVFrame *copy;
@@ -193,8 +193,6 @@ FF_ENABLE_DEPRECATION_WARNINGS
 
     s->nb_failed_requests = 0;
 
-    if (!frame)
-        return av_buffersrc_close(ctx, AV_NOPTS_VALUE, flags);
     if (s->eof)
         return AVERROR(EINVAL);
 
@@ -243,7 +241,20 @@ FF_ENABLE_DEPRECATION_WARNINGS
         }
     }
 
-    ret = ff_filter_frame(ctx->outputs[0], copy);
+    return ff_filter_frame(ctx->outputs[0], copy);
+}
+
+int attribute_align_arg av_buffersrc_add_frame_flags(AVFilterContext *ctx, AVFrame *frame, int flags)
+{
+    BufferSourceContext *s = ctx->priv;
+    int ret;
+
+    if (!frame) {
+        s->nb_failed_requests = 0;
+        return av_buffersrc_close(ctx, AV_NOPTS_VALUE, flags);
+    }
+
+    ret = add_frame_internal(ctx, frame, flags);
     if (ret < 0)
         return ret;
 
@@ -256,6 +267,31 @@ FF_ENABLE_DEPRECATION_WARNINGS
     return 0;
 }
 
+int attribute_align_arg av_buffersrc_add_frames(AVFilterContext *ctx, AVFrame **frames,
+                                                int nb_frames, int flags)
+{
+    int i, ret;
+
+    if (nb_frames < 0)
+        return AVERROR(EINVAL);
+
+    for (i = 0; i < nb_frames; i++) {
+        if (!frames[i])
+            return AVERROR(EINVAL);
+        ret = add_frame_internal(ctx, frames[i], flags);
+        if (ret < 0)
+            return ret;
+    }
+
+    if ((flags & AV_BUFFERSRC_FLAG_PUSH)) {
+        ret = push_frame(ctx->graph);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
 int av_buffersrc_close(AVFilterContext *ctx, int64_t pts, unsigned flags)
 {
     BufferSourceContext *s = ctx->priv;
@@ -202,6 +202,28 @@ av_warn_unused_result
 int av_buffersrc_add_frame_flags(AVFilterContext *buffer_src,
                                  AVFrame *frame, int flags);
 
+/**
+ * Add several frames to the buffer source at once.
+ *
+ * This is equivalent to calling av_buffersrc_add_frame_flags() for every
+ * frame, except that with AV_BUFFERSRC_FLAG_PUSH the filter graph is run only
+ * once, after all the frames have been queued.
+ *
+ * @param buffer_src  pointer to a buffer source context
+ * @param frames      array of nb_frames frames; NULL entries are not allowed,
+ *                    use av_buffersrc_close() to mark EOF
+ * @param nb_frames   number of frames in the array
+ * @param flags       a combination of AV_BUFFERSRC_FLAG_*, applied to all
+ *                    the frames
+ * @return            >= 0 in case of success, a negative AVERROR code in
+ *                    case of failure. On failure, the frames preceding the
+ *                    one that failed have been added, the others are not
+ *                    touched.
+ */
+av_warn_unused_result
+int av_buffersrc_add_frames(AVFilterContext *buffer_src, AVFrame **frames,
+                            int nb_frames, int flags);
+
 /**
  * Close the buffer source after EOF.
  *
@@ -27,6 +27,18 @@ static inline FFFrameBucket *bucket(FFFrameQueue *fq, size_t idx)
     return &fq->queue[(fq->tail + idx) & (fq->allocated - 1)];
 }
 
+static size_t frame_bytes(const AVFrame *frame)
+{
+    size_t bytes = 0;
+    int i;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(frame->buf) && frame->buf[i]; i++)
+        bytes += frame->buf[i]->size;
+    for (i = 0; i < frame->nb_extended_buf; i++)
+        bytes += frame->extended_buf[i]->size;
+    return bytes;
+}
+
 void ff_framequeue_global_init(FFFrameQueueGlobal *fqg)
 {
 }
@@ -34,13 +46,16 @@ void ff_framequeue_global_init(FFFrameQueueGlobal *fqg)
 static void check_consistency(FFFrameQueue *fq)
 {
 #if defined(ASSERT_LEVEL) && ASSERT_LEVEL >= 2
-    uint64_t nb_samples = 0;
+    uint64_t nb_samples = 0, nb_bytes = 0;
     size_t i;
 
     av_assert0(fq->queued == fq->total_frames_head - fq->total_frames_tail);
-    for (i = 0; i < fq->queued; i++)
+    for (i = 0; i < fq->queued; i++) {
         nb_samples += bucket(fq, i)->frame->nb_samples;
+        nb_bytes   += bucket(fq, i)->bytes;
+    }
     av_assert0(nb_samples == fq->total_samples_head - fq->total_samples_tail);
+    av_assert0(nb_bytes == fq->queued_bytes);
 #endif
 }
 
@@ -88,7 +103,9 @@ int ff_framequeue_add(FFFrameQueue *fq, AVFrame *frame)
     }
     b = bucket(fq, fq->queued);
     b->frame = frame;
+    b->bytes = frame_bytes(frame);
     fq->queued++;
+    fq->queued_bytes += b->bytes;
     fq->total_frames_head++;
     fq->total_samples_head += frame->nb_samples;
     check_consistency(fq);
@@ -107,6 +124,7 @@ AVFrame *ff_framequeue_take(FFFrameQueue *fq)
     fq->tail &= fq->allocated - 1;
     fq->total_frames_tail++;
     fq->total_samples_tail += b->frame->nb_samples;
+    fq->queued_bytes -= b->bytes;
     fq->samples_skipped = 0;
     check_consistency(fq);
     return b->frame;
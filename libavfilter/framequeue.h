@@ -33,6 +33,7 @@
 
 typedef struct FFFrameBucket {
     AVFrame *frame;
+    size_t bytes;
 } FFFrameBucket;
 
 /**
@@ -100,6 +101,11 @@ typedef struct FFFrameQueue {
      */
     uint64_t total_samples_tail;
 
+    /**
+     * Size in bytes of the buffers referenced by the queued frames.
+     */
+    uint64_t queued_bytes;
+
     /**
      * Indicate that samples are skipped
      */
@@ -156,6 +162,15 @@ static inline uint64_t ff_framequeue_queued_samples(const FFFrameQueue *fq)
     return fq->total_samples_head - fq->total_samples_tail;
 }
 
+/**
+ * Get the size in bytes of the buffers referenced by the queued frames.
+ * Buffers shared between several frames are counted once per frame.
+ */
+static inline uint64_t ff_framequeue_queued_bytes(const FFFrameQueue *fq)
+{
+    return fq->queued_bytes;
+}
+
 /**
  * Update the statistics after a frame accessed using ff_framequeue_peek()
  * was modified.
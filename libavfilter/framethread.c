@@ -0,0 +1,178 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Frame-level multithreading for filters that filter every frame
+ * independently.
+ *
+ * Up to one frame per thread is taken from the input, the frames are
+ * filtered concurrently as the jobs of one execute() call on the graph
+ * threads, and the results are sent to the output in input order.
+ */
+
+#define FF_INTERNAL_FIELDS 1
+#include "framequeue.h"
+
+#include "libavutil/avassert.h"
+#include "libavutil/frame.h"
+
+#include "avfilter.h"
+#include "filters.h"
+#include "internal.h"
+#include "video.h"
+
+#define MAX_FRAME_THREADS 64
+
+typedef struct FrameThreadBatch {
+    AVFrame *in[MAX_FRAME_THREADS];
+    AVFrame *out[MAX_FRAME_THREADS];
+    int      passthrough[MAX_FRAME_THREADS];
+} FrameThreadBatch;
+
+static int frame_thread_job(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    FrameThreadBatch *b = arg;
+    AVFilterLink *inlink = ctx->inputs[0];
+
+    if (b->passthrough[jobnr])
+        return 0;
+    return inlink->dstpad->filter_frame_mt(inlink, b->in[jobnr], b->out[jobnr]);
+}
+
+static int frame_thread_count(AVFilterContext *ctx)
+{
+    int nb_threads = ctx->graph->nb_threads;
+
+    if (ctx->nb_threads > 0)
+        nb_threads = FFMIN(nb_threads, ctx->nb_threads);
+    return av_clip(nb_threads, 1, MAX_FRAME_THREADS);
+}
+
+/* a queued command due at this frame must run before it is filtered */
+static int command_due(AVFilterContext *ctx, AVFilterLink *inlink, const AVFrame *frame)
+{
+    return ctx->command_queue &&
+           ctx->command_queue->time <= frame->pts * av_q2d(inlink->time_base);
+}
+
+int ff_filter_frame_thread_activate(AVFilterContext *ctx)
+{
+    AVFilterLink *inlink  = ctx->inputs[0];
+    AVFilterLink *outlink = ctx->outputs[0];
+    FrameThreadBatch b = { { 0 } };
+    int rets[MAX_FRAME_THREADS];
+    int nb_threads = frame_thread_count(ctx);
+    int nb_queued, nb_frames, i, ret = 0;
+
+    av_assert1(ctx->nb_inputs == 1 && ctx->nb_outputs == 1);
+    av_assert1(inlink->dstpad->filter_frame_mt);
+
+    FF_FILTER_FORWARD_STATUS_BACK(outlink, inlink);
+
+    nb_queued = ff_inlink_queued_frames(inlink);
+    if (!nb_queued) {
+        FF_FILTER_FORWARD_STATUS(inlink, outlink);
+        FF_FILTER_FORWARD_WANTED(outlink, inlink);
+        return FFERROR_NOT_READY;
+    }
+
+    /* wait for a full batch unless the input is finished */
+    if (nb_queued < nb_threads && !inlink->status_in) {
+        if (ff_outlink_frame_wanted(outlink))
+            ff_inlink_request_frame(inlink);
+        return 0;
+    }
+
+    nb_frames = FFMIN(nb_queued, nb_threads);
+    for (i = 0; i < nb_frames; i++) {
+        AVFrame *frame;
+
+        if (i && command_due(ctx, inlink, ff_inlink_peek_frame(inlink, 0)))
+            break;
+
+        ret = ff_inlink_consume_frame(inlink, &frame);
+        if (ret < 0)
+            goto fail;
+        av_assert1(ret > 0);
+        b.in[i] = frame;
+
+        if (ctx->is_disabled &&
+            ctx->filter->flags & AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC) {
+            b.passthrough[i] = 1;
+            continue;
+        }
+
+        b.out[i] = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+        if (!b.out[i]) {
+            i++;
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        ret = av_frame_copy_props(b.out[i], frame);
+        if (ret < 0) {
+            i++;
+            goto fail;
+        }
+    }
+    nb_frames = i;
+
+    ctx->internal->frame_execute(ctx, frame_thread_job, &b, rets, nb_frames);
+
+    for (i = 0; i < nb_frames; i++) {
+        AVFrame *out;
+
+        if (b.passthrough[i]) {
+            out     = b.in[i];
+            b.in[i] = NULL;
+        } else {
+            if (rets[i] < 0) {
+                ret = rets[i];
+                goto fail_output;
+            }
+            out      = b.out[i];
+            b.out[i] = NULL;
+            av_frame_free(&b.in[i]);
+        }
+
+        ret = ff_filter_frame(outlink, out);
+        if (ret < 0) {
+            i++;
+            goto fail_output;
+        }
+    }
+
+    /* run again for the next batch, or to forward the EOF after the last */
+    if (ff_inlink_queued_frames(inlink) || inlink->status_in)
+        ff_filter_set_ready(ctx, 100);
+    return 0;
+
+fail_output:
+    for (; i < nb_frames; i++) {
+        av_frame_free(&b.in[i]);
+        av_frame_free(&b.out[i]);
+    }
+    return ret;
+fail:
+    nb_frames = i;
+    for (i = 0; i < nb_frames; i++) {
+        av_frame_free(&b.in[i]);
+        av_frame_free(&b.out[i]);
+    }
+    return ret;
+}
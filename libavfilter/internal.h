@@ -103,6 +103,22 @@ struct AVFilterPad {
      */
     int (*filter_frame)(AVFilterLink *link, AVFrame *frame);
 
+    /**
+     * Frame-threaded filtering callback, used instead of filter_frame when
+     * the filter instance runs with AVFILTER_THREAD_FRAME. It is called
+     * concurrently for different frames and must not modify any state shared
+     * between frames.
+     *
+     * The output frame is allocated on the output link by the caller and
+     * has the properties of the input frame. Neither frame is owned by the
+     * callback.
+     *
+     * Input pads of filters with AVFILTER_FLAG_FRAME_THREADS only.
+     *
+     * @return >= 0 on success, a negative AVERROR on error
+     */
+    int (*filter_frame_mt)(AVFilterLink *link, const AVFrame *in, AVFrame *out);
+
     /**
      * Frame request callback. A call to this should result in some progress
      * towards producing output over the given link. This should return zero
@@ -133,15 +149,42 @@ struct AVFilterGraphInternal {
     void *thread;
     avfilter_execute_func *thread_execute;
     FFFrameQueueGlobal frame_queues;
+    /**
+     * Collect per-filter execution statistics, see avfilter_graph_set_stats().
+     */
+    int stats;
 };
 
 struct AVFilterInternal {
     avfilter_execute_func *execute;
+
+    /**
+     * Graph-level execute function used to filter several frames at once
+     * with AVFILTER_THREAD_FRAME.
+     */
+    avfilter_execute_func *frame_execute;
+
+    /* execution statistics, only updated if the graph has stats enabled */
+    int64_t  activate_time;
+    uint64_t nb_activations;
+    int64_t  execute_time;
+    int64_t  execute_busy_time;
+    int64_t  execute_max_busy_time;
+    uint64_t nb_executes;
+    uint64_t nb_jobs;
 };
 
+/**
+ * Run ff_filter_execute() while accounting the time spent in the jobs.
+ */
+int ff_filter_execute_stats(AVFilterContext *ctx, avfilter_action_func *func,
+                            void *arg, int *ret, int nb_jobs);
+
 static av_always_inline int ff_filter_execute(AVFilterContext *ctx, avfilter_action_func *func,
                                               void *arg, int *ret, int nb_jobs)
 {
+    if (ctx->graph && ctx->graph->internal->stats)
+        return ff_filter_execute_stats(ctx, func, arg, ret, nb_jobs);
     return ctx->internal->execute(ctx, func, arg, ret, nb_jobs);
 }
 
@@ -358,6 +401,14 @@ AVFilterContext *ff_filter_alloc(const AVFilter *filter, const char *inst_name);
 
 int ff_filter_activate(AVFilterContext *filter);
 
+/**
+ * Activation function for filter instances running with
+ * AVFILTER_THREAD_FRAME: take several frames from the input, filter them
+ * concurrently with AVFilterPad.filter_frame_mt and send them to the output
+ * in order.
+ */
+int ff_filter_frame_thread_activate(AVFilterContext *ctx);
+
 /**
  * Remove a filter from a graph;
  */
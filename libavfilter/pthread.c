@@ -59,7 +59,8 @@ static void slice_thread_uninit(ThreadContext *c)
 static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
                           void *arg, int *ret, int nb_jobs)
 {
-    ThreadContext *c = ctx->graph->internal->thread;
+    AVFilterGraphInternal *gi = ctx->graph->internal;
+    ThreadContext *c = gi->thread;
 
     if (nb_jobs <= 0)
         return 0;
@@ -68,7 +69,15 @@ static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
     c->func        = func;
     c->rets        = ret;
 
+    avpriv_slicethread_set_stats(c->thread, gi->stats);
     avpriv_slicethread_execute(c->thread, nb_jobs, 0);
+
+    if (gi->stats) {
+        AVSliceThreadStats st;
+
+        avpriv_slicethread_get_stats(c->thread, &st);
+        ctx->internal->execute_max_busy_time += st.max_busy_time;
+    }
     return 0;
 }
 
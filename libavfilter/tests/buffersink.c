@@ -0,0 +1,155 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+
+#include "libavutil/channel_layout.h"
+#include "libavutil/frame.h"
+#include "libavutil/samplefmt.h"
+
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersink.h"
+#include "libavfilter/buffersrc.h"
+
+static const int frame_sizes[] = { 100, 300, 250, 700, 50, 900, 400, 120, 30 };
+#define NB_FRAMES (sizeof(frame_sizes) / sizeof(frame_sizes[0]))
+
+static int build_graph(AVFilterGraph *graph, const char *src_name, const char *src_args,
+                       const char *sink_name, AVFilterContext **src, AVFilterContext **sink)
+{
+    int ret;
+
+    ret = avfilter_graph_create_filter(src, avfilter_get_by_name(src_name), "in",
+                                       src_args, NULL, graph);
+    if (ret < 0)
+        return ret;
+    ret = avfilter_graph_create_filter(sink, avfilter_get_by_name(sink_name), "out",
+                                       NULL, NULL, graph);
+    if (ret < 0)
+        return ret;
+    ret = avfilter_link(*src, 0, *sink, 0);
+    if (ret < 0)
+        return ret;
+    return avfilter_graph_config(graph, NULL);
+}
+
+static int test_audio(unsigned batch_samples, int max_frames, int push)
+{
+    AVFilterGraph *graph = avfilter_graph_alloc();
+    AVFilterContext *src, *sink;
+    AVFrame *in[NB_FRAMES] = { NULL }, *out[NB_FRAMES] = { NULL };
+    int64_t pts = 0;
+    int i, ret;
+
+    printf("batch_samples %u, max_frames %d%s\n", batch_samples, max_frames,
+           push ? ", push" : "");
+
+    if (!graph)
+        return AVERROR(ENOMEM);
+    ret = build_graph(graph, "abuffer",
+                      "sample_rate=8000:sample_fmt=s16:channel_layout=mono",
+                      "abuffersink", &src, &sink);
+    if (ret < 0)
+        goto end;
+    ret = av_buffersink_set_batch_samples(sink, batch_samples);
+    if (ret < 0)
+        goto end;
+
+    for (i = 0; i < NB_FRAMES; i++) {
+        out[i] = av_frame_alloc();
+        in[i]  = av_frame_alloc();
+        if (!in[i] || !out[i]) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        in[i]->format      = AV_SAMPLE_FMT_S16;
+        in[i]->sample_rate = 8000;
+        in[i]->nb_samples  = frame_sizes[i];
+        in[i]->pts         = pts;
+        av_channel_layout_default(&in[i]->ch_layout, 1);
+        ret = av_frame_get_buffer(in[i], 0);
+        if (ret < 0)
+            goto end;
+        av_samples_set_silence(in[i]->extended_data, 0, in[i]->nb_samples, 1,
+                               AV_SAMPLE_FMT_S16);
+        pts += frame_sizes[i];
+    }
+
+    ret = av_buffersrc_add_frames(src, in, NB_FRAMES, push ? AV_BUFFERSRC_FLAG_PUSH : 0);
+    if (ret < 0)
+        goto end;
+    ret = av_buffersrc_close(src, pts, 0);
+    if (ret < 0)
+        goto end;
+
+    while ((ret = av_buffersink_get_frames(sink, out, max_frames, 0)) > 0) {
+        int nb_samples = 0;
+
+        for (i = 0; i < ret; i++) {
+            nb_samples += out[i]->nb_samples;
+            av_frame_unref(out[i]);
+        }
+        printf("  %d frames, %d samples\n", ret, nb_samples);
+    }
+    if (ret == AVERROR_EOF)
+        ret = 0;
+
+end:
+    for (i = 0; i < NB_FRAMES; i++) {
+        av_frame_free(&in[i]);
+        av_frame_free(&out[i]);
+    }
+    avfilter_graph_free(&graph);
+    return ret;
+}
+
+static int test_video(void)
+{
+    AVFilterGraph *graph = avfilter_graph_alloc();
+    AVFilterContext *src, *sink;
+    int ret;
+
+    if (!graph)
+        return AVERROR(ENOMEM);
+    ret = build_graph(graph, "buffer",
+                      "video_size=16x16:pix_fmt=gray:time_base=1/25",
+                      "buffersink", &src, &sink);
+    if (ret >= 0) {
+        ret = av_buffersink_set_batch_samples(sink, 1000);
+        printf("video batch_samples: %s\n",
+               ret == AVERROR(EINVAL) ? "rejected" : "accepted");
+        ret = 0;
+    }
+    avfilter_graph_free(&graph);
+    return ret;
+}
+
+int main(void)
+{
+    int ret;
+
+    if ((ret = test_audio(0,    4,         0)) < 0 ||
+        (ret = test_audio(1000, NB_FRAMES, 0)) < 0 ||
+        (ret = test_audio(1000, 2,         0)) < 0 ||
+        (ret = test_audio(1000, NB_FRAMES, 1)) < 0 ||
+        (ret = test_video()) < 0) {
+        fprintf(stderr, "test failed: %s\n", av_err2str(ret));
+        return 1;
+    }
+    return 0;
+}
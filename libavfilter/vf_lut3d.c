@@ -1196,6 +1196,15 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     return ff_filter_frame(outlink, out);
 }
 
+static int filter_frame_mt(AVFilterLink *inlink, const AVFrame *in, AVFrame *out)
+{
+    AVFilterContext *ctx = inlink->dst;
+    LUT3DContext *lut3d = ctx->priv;
+    ThreadData td = { .in = (AVFrame *)in, .out = out };
+
+    return lut3d->interp(ctx, &td, 0, 1);
+}
+
 static int process_command(AVFilterContext *ctx, const char *cmd, const char *args,
                            char *res, int res_len, int flags)
 {
@@ -1291,10 +1300,11 @@ static av_cold void lut3d_uninit(AVFilterContext *ctx)
 
 static const AVFilterPad lut3d_inputs[] = {
     {
-        .name         = "default",
-        .type         = AVMEDIA_TYPE_VIDEO,
-        .filter_frame = filter_frame,
-        .config_props = config_input,
+        .name            = "default",
+        .type            = AVMEDIA_TYPE_VIDEO,
+        .filter_frame    = filter_frame,
+        .filter_frame_mt = filter_frame_mt,
+        .config_props    = config_input,
     },
 };
 
@@ -1315,7 +1325,8 @@ const AVFilter ff_vf_lut3d = {
     FILTER_OUTPUTS(lut3d_outputs),
     FILTER_PIXFMTS_ARRAY(pix_fmts),
     .priv_class    = &lut3d_class,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS |
+                     AVFILTER_FLAG_FRAME_THREADS,
     .process_command = process_command,
 };
 #endif
@@ -2199,6 +2210,15 @@ static int filter_frame_1d(AVFilterLink *inlink, AVFrame *in)
     return ff_filter_frame(outlink, out);
 }
 
+static int filter_frame_mt_1d(AVFilterLink *inlink, const AVFrame *in, AVFrame *out)
+{
+    AVFilterContext *ctx = inlink->dst;
+    LUT1DContext *lut1d = ctx->priv;
+    ThreadData td = { .in = (AVFrame *)in, .out = out };
+
+    return lut1d->interp(ctx, &td, 0, 1);
+}
+
 static int lut1d_process_command(AVFilterContext *ctx, const char *cmd, const char *args,
                            char *res, int res_len, int flags)
 {
@@ -2219,10 +2239,11 @@ static int lut1d_process_command(AVFilterContext *ctx, const char *cmd, const ch
 
 static const AVFilterPad lut1d_inputs[] = {
     {
-        .name         = "default",
-        .type         = AVMEDIA_TYPE_VIDEO,
-        .filter_frame = filter_frame_1d,
-        .config_props = config_input_1d,
+        .name            = "default",
+        .type            = AVMEDIA_TYPE_VIDEO,
+        .filter_frame    = filter_frame_1d,
+        .filter_frame_mt = filter_frame_mt_1d,
+        .config_props    = config_input_1d,
     },
 };
 
@@ -2242,7 +2263,8 @@ const AVFilter ff_vf_lut1d = {
     FILTER_OUTPUTS(lut1d_outputs),
     FILTER_PIXFMTS_ARRAY(pix_fmts),
     .priv_class    = &lut1d_class,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS |
+                     AVFILTER_FLAG_FRAME_THREADS,
     .process_command = lut1d_process_command,
 };
 #endif
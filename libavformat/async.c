@@ -44,6 +44,7 @@
 #define BUFFER_CAPACITY         (4 * 1024 * 1024)
 #define READ_BACK_CAPACITY      (4 * 1024 * 1024)
 #define SHORT_SEEK_THRESHOLD    (256 * 1024)
+#define MAX_WINDOWS             16
 
 typedef struct RingBuffer
 {
@@ -51,8 +52,17 @@ typedef struct RingBuffer
     int           read_back_capacity;
 
     int           read_pos;
+    int64_t       pos;              /* logical position of the first byte in the fifo */
 } RingBuffer;
 
+/* one independently prefetched range of the input */
+typedef struct Window {
+    RingBuffer      ring;
+    int             io_error;
+    int             io_eof_reached;
+    unsigned        last_used;
+} Window;
+
 typedef struct Context {
     AVClass        *class;
     URLContext     *inner;
@@ -64,12 +74,20 @@ typedef struct Context {
     int64_t         seek_ret;
 
     int             inner_io_error;
-    int             io_error;
-    int             io_eof_reached;
+    int64_t         inner_pos;
 
     int64_t         logical_pos;
     int64_t         logical_size;
-    RingBuffer      ring;
+
+    Window          windows[MAX_WINDOWS];
+    int             nb_windows;
+    int             active;             /* window the reads are served from */
+    int             filling;            /* window the background thread fills */
+    unsigned        use_count;
+
+    /* options */
+    int             buffer_size;
+    int             read_back_size;
 
     pthread_cond_t  cond_wakeup_main;
     pthread_cond_t  cond_wakeup_background;
@@ -96,10 +114,26 @@ static void ring_destroy(RingBuffer *ring)
     av_fifo_freep2(&ring->fifo);
 }
 
-static void ring_reset(RingBuffer *ring)
+static void ring_reset(RingBuffer *ring, int64_t pos)
 {
     av_fifo_reset2(ring->fifo);
     ring->read_pos = 0;
+    ring->pos      = pos;
+}
+
+/* logical position of the end of the buffered data */
+static int64_t ring_end(RingBuffer *ring)
+{
+    return ring->pos + av_fifo_can_read(ring->fifo);
+}
+
+static void ring_trim_read_back(RingBuffer *ring)
+{
+    if (ring->read_pos > ring->read_back_capacity) {
+        av_fifo_drain2(ring->fifo, ring->read_pos - ring->read_back_capacity);
+        ring->pos     += ring->read_pos - ring->read_back_capacity;
+        ring->read_pos = ring->read_back_capacity;
+    }
 }
 
 static int ring_size(RingBuffer *ring)
@@ -120,11 +154,7 @@ static int ring_read(RingBuffer *ring, void *dest, int buf_size)
     if (dest)
         ret = av_fifo_peek(ring->fifo, dest, buf_size, ring->read_pos);
     ring->read_pos += buf_size;
-
-    if (ring->read_pos > ring->read_back_capacity) {
-        av_fifo_drain2(ring->fifo, ring->read_pos - ring->read_back_capacity);
-        ring->read_pos = ring->read_back_capacity;
-    }
+    ring_trim_read_back(ring);
 
     return ret;
 }
@@ -144,21 +174,70 @@ static int wrapped_url_read(void *src, void *dst, size_t *size)
 
 static int ring_write(RingBuffer *ring, URLContext *h, size_t size)
 {
+    int ret;
+
     av_assert2(size <= ring_space(ring));
-    return av_fifo_write_from_cb(ring->fifo, wrapped_url_read, h, &size);
+    ret = av_fifo_write_from_cb(ring->fifo, wrapped_url_read, h, &size);
+    /* the callback reports EOF or errors even after writing some data */
+    return size > 0 ? size : ret;
 }
 
-static int ring_size_of_read_back(RingBuffer *ring)
+/* the window that was used least recently, to be reused for a new range */
+static int lru_window(Context *c)
 {
-    return ring->read_pos;
+    int lru = 0;
+
+    for (int i = 1; i < c->nb_windows; i++)
+        if (c->windows[i].last_used < c->windows[lru].last_used)
+            lru = i;
+    return lru;
 }
 
-static int ring_drain(RingBuffer *ring, int offset)
+static int window_can_fill(Window *w)
 {
-    av_assert2(offset >= -ring_size_of_read_back(ring));
-    av_assert2(offset <= ring_size(ring));
-    ring->read_pos += offset;
-    return 0;
+    return !w->io_eof_reached && ring_space(&w->ring) > 0;
+}
+
+/*
+ * Pick the window to fill next. The active window is preferred; the other
+ * windows are only topped up while it is mostly full, so the inner
+ * protocol does not have to seek back and forth for every small read.
+ */
+static int next_fill_window(Context *c)
+{
+    Window *active = &c->windows[c->active];
+    int best = -1;
+
+    if (c->filling == c->active ? window_can_fill(active) :
+        !active->io_eof_reached && ring_space(&active->ring) >= c->buffer_size / 2)
+        return c->active;
+
+    if (c->filling != c->active && window_can_fill(&c->windows[c->filling]))
+        return c->filling;
+
+    for (int i = 0; i < c->nb_windows; i++) {
+        if (i == c->active || !c->windows[i].last_used ||
+            !window_can_fill(&c->windows[i]))
+            continue;
+        if (best < 0 || c->windows[i].last_used > c->windows[best].last_used)
+            best = i;
+    }
+    if (best < 0 && window_can_fill(active))
+        best = c->active;
+
+    return best;
+}
+
+/* the window holding pos, or close enough before it to read up to it */
+static int find_window(Context *c, int64_t pos)
+{
+    for (int i = 0; i < c->nb_windows; i++) {
+        RingBuffer *ring = &c->windows[i].ring;
+        if (c->windows[i].last_used && pos >= ring->pos &&
+            pos < ring_end(ring) + SHORT_SEEK_THRESHOLD)
+            return i;
+    }
+    return -1;
 }
 
 static int async_check_interrupt(void *arg)
@@ -179,17 +258,20 @@ static void *async_buffer_task(void *arg)
 {
     URLContext   *h    = arg;
     Context      *c    = h->priv_data;
-    RingBuffer   *ring = &c->ring;
     int           ret  = 0;
     int64_t       seek_ret;
 
     while (1) {
+        Window *w;
+        int64_t end;
         int fifo_space, to_copy;
 
         pthread_mutex_lock(&c->mutex);
         if (async_check_interrupt(h)) {
-            c->io_eof_reached = 1;
-            c->io_error       = AVERROR_EXIT;
+            for (int i = 0; i < c->nb_windows; i++) {
+                c->windows[i].io_eof_reached = 1;
+                c->windows[i].io_error       = AVERROR_EXIT;
+            }
             pthread_cond_signal(&c->cond_wakeup_main);
             pthread_mutex_unlock(&c->mutex);
             break;
@@ -198,9 +280,14 @@ static void *async_buffer_task(void *arg)
         if (c->seek_request) {
             seek_ret = ffurl_seek(c->inner, c->seek_pos, c->seek_whence);
             if (seek_ret >= 0) {
-                c->io_eof_reached = 0;
-                c->io_error       = 0;
-                ring_reset(ring);
+                int i = lru_window(c);
+                w = &c->windows[i];
+                w->io_eof_reached = 0;
+                w->io_error       = 0;
+                w->last_used      = ++c->use_count;
+                ring_reset(&w->ring, seek_ret);
+                c->active = c->filling = i;
+                c->inner_pos = seek_ret;
             }
 
             c->seek_completed = 1;
@@ -213,23 +300,41 @@ static void *async_buffer_task(void *arg)
             continue;
         }
 
-        fifo_space = ring_space(ring);
-        if (c->io_eof_reached || fifo_space <= 0) {
+        c->filling = next_fill_window(c);
+        if (c->filling < 0) {
+            c->filling = c->active;
             pthread_cond_signal(&c->cond_wakeup_main);
             pthread_cond_wait(&c->cond_wakeup_background, &c->mutex);
             pthread_mutex_unlock(&c->mutex);
             continue;
         }
+        w          = &c->windows[c->filling];
+        fifo_space = ring_space(&w->ring);
+        end        = ring_end(&w->ring);
         pthread_mutex_unlock(&c->mutex);
 
+        if (end != c->inner_pos) {
+            seek_ret = ffurl_seek(c->inner, end, SEEK_SET);
+            if (seek_ret < 0) {
+                pthread_mutex_lock(&c->mutex);
+                w->io_eof_reached = 1;
+                w->io_error       = seek_ret;
+                pthread_cond_signal(&c->cond_wakeup_main);
+                pthread_mutex_unlock(&c->mutex);
+                continue;
+            }
+            c->inner_pos = end;
+        }
+
         to_copy = FFMIN(4096, fifo_space);
-        ret = ring_write(ring, h, to_copy);
+        ret = ring_write(&w->ring, h, to_copy);
 
         pthread_mutex_lock(&c->mutex);
+        c->inner_pos = ring_end(&w->ring);
         if (ret <= 0) {
-            c->io_eof_reached = 1;
+            w->io_eof_reached = 1;
             if (c->inner_io_error < 0)
-                c->io_error = c->inner_io_error;
+                w->io_error = c->inner_io_error;
         }
 
         pthread_cond_signal(&c->cond_wakeup_main);
@@ -247,10 +352,6 @@ static int async_open(URLContext *h, const char *arg, int flags, AVDictionary **
 
     av_strstart(arg, "async:", &arg);
 
-    ret = ring_init(&c->ring, BUFFER_CAPACITY, READ_BACK_CAPACITY);
-    if (ret < 0)
-        goto fifo_fail;
-
     /* wrap interrupt callback */
     c->interrupt_callback = h->interrupt_callback;
     ret = ffurl_open_whitelist(&c->inner, arg, flags, &interrupt_callback, options, h->protocol_whitelist, h->protocol_blacklist, h);
@@ -262,6 +363,17 @@ static int async_open(URLContext *h, const char *arg, int flags, AVDictionary **
     c->logical_size = ffurl_size(c->inner);
     h->is_streamed  = c->inner->is_streamed;
 
+    /* filling several windows needs seeking */
+    if (h->is_streamed)
+        c->nb_windows = 1;
+    for (int i = 0; i < c->nb_windows; i++) {
+        ret = ring_init(&c->windows[i].ring, c->buffer_size, c->read_back_size);
+        if (ret < 0)
+            goto fifo_fail;
+    }
+    /* the first window starts at the beginning */
+    c->windows[0].last_used = ++c->use_count;
+
     ret = pthread_mutex_init(&c->mutex, NULL);
     if (ret != 0) {
         ret = AVERROR(ret);
@@ -299,10 +411,11 @@ cond_wakeup_background_fail:
 cond_wakeup_main_fail:
     pthread_mutex_destroy(&c->mutex);
 mutex_fail:
+fifo_fail:
+    for (int i = 0; i < c->nb_windows; i++)
+        ring_destroy(&c->windows[i].ring);
     ffurl_closep(&c->inner);
 url_fail:
-    ring_destroy(&c->ring);
-fifo_fail:
     return ret;
 }
 
@@ -324,7 +437,8 @@ static int async_close(URLContext *h)
     pthread_cond_destroy(&c->cond_wakeup_main);
     pthread_mutex_destroy(&c->mutex);
     ffurl_closep(&c->inner);
-    ring_destroy(&c->ring);
+    for (int i = 0; i < c->nb_windows; i++)
+        ring_destroy(&c->windows[i].ring);
 
     return 0;
 }
@@ -332,7 +446,6 @@ static int async_close(URLContext *h)
 static int async_read_internal(URLContext *h, void *dest, int size)
 {
     Context      *c       = h->priv_data;
-    RingBuffer   *ring    = &c->ring;
     int     read_complete = !dest;
     int           to_read = size;
     int           ret     = 0;
@@ -340,6 +453,8 @@ static int async_read_internal(URLContext *h, void *dest, int size)
     pthread_mutex_lock(&c->mutex);
 
     while (to_read > 0) {
+        Window     *w    = &c->windows[c->active];
+        RingBuffer *ring = &w->ring;
         int fifo_size, to_copy;
         if (async_check_interrupt(h)) {
             ret = AVERROR_EXIT;
@@ -357,10 +472,10 @@ static int async_read_internal(URLContext *h, void *dest, int size)
 
             if (to_read <= 0 || !read_complete)
                 break;
-        } else if (c->io_eof_reached) {
+        } else if (w->io_eof_reached) {
             if (ret <= 0) {
-                if (c->io_error)
-                    ret = c->io_error;
+                if (w->io_error)
+                    ret = w->io_error;
                 else
                     ret = AVERROR_EOF;
             }
@@ -384,11 +499,9 @@ static int async_read(URLContext *h, unsigned char *buf, int size)
 static int64_t async_seek(URLContext *h, int64_t pos, int whence)
 {
     Context      *c    = h->priv_data;
-    RingBuffer   *ring = &c->ring;
     int64_t       ret;
     int64_t       new_logical_pos;
-    int fifo_size;
-    int fifo_size_of_read_back;
+    int           i;
 
     if (whence == AVSEEK_SIZE) {
         av_log(h, AV_LOG_TRACE, "async_seek: AVSEEK_SIZE: %"PRId64"\n", (int64_t)c->logical_size);
@@ -405,30 +518,38 @@ static int64_t async_seek(URLContext *h, int64_t pos, int whence)
     if (new_logical_pos < 0)
         return AVERROR(EINVAL);
 
-    fifo_size = ring_size(ring);
-    fifo_size_of_read_back = ring_size_of_read_back(ring);
     if (new_logical_pos == c->logical_pos) {
         /* current position */
         return c->logical_pos;
-    } else if ((new_logical_pos >= (c->logical_pos - fifo_size_of_read_back)) &&
-               (new_logical_pos < (c->logical_pos + fifo_size + SHORT_SEEK_THRESHOLD))) {
-        int pos_delta = (int)(new_logical_pos - c->logical_pos);
+    }
+
+    pthread_mutex_lock(&c->mutex);
+    i = find_window(c, new_logical_pos);
+    if (i >= 0) {
+        Window *w = &c->windows[i];
+        int64_t buffered_pos = FFMIN(new_logical_pos, ring_end(&w->ring));
+
         /* fast seek */
-        av_log(h, AV_LOG_TRACE, "async_seek: fask_seek %"PRId64" from %d dist:%d/%d\n",
-                new_logical_pos, (int)c->logical_pos,
-                (int)(new_logical_pos - c->logical_pos), fifo_size);
+        av_log(h, AV_LOG_TRACE, "async_seek: fast_seek %"PRId64" from %"PRId64" in window %d\n",
+               new_logical_pos, c->logical_pos, i);
+
+        c->active      = i;
+        w->last_used   = ++c->use_count;
+        w->ring.read_pos = buffered_pos - w->ring.pos;
+        ring_trim_read_back(&w->ring);
+        c->logical_pos = buffered_pos;
+        pthread_cond_signal(&c->cond_wakeup_background);
+        pthread_mutex_unlock(&c->mutex);
 
-        if (pos_delta > 0) {
-            // fast seek forwards
-            async_read_internal(h, NULL, pos_delta);
-        } else {
-            // fast seek backwards
-            ring_drain(ring, pos_delta);
-            c->logical_pos = new_logical_pos;
-        }
+        // read forwards up to the position if it is not buffered yet
+        if (new_logical_pos > buffered_pos)
+            async_read_internal(h, NULL, new_logical_pos - buffered_pos);
 
         return c->logical_pos;
-    } else if (c->logical_size <= 0) {
+    }
+    pthread_mutex_unlock(&c->mutex);
+
+    if (c->logical_size <= 0) {
         /* can not seek */
         return AVERROR(EINVAL);
     } else if (new_logical_pos > c->logical_size) {
@@ -468,6 +589,9 @@ static int64_t async_seek(URLContext *h, int64_t pos, int whence)
 #define D AV_OPT_FLAG_DECODING_PARAM
 
 static const AVOption options[] = {
+    { "prefetch_size", "size of the data prefetched ahead of the read position in each window", OFFSET(buffer_size), AV_OPT_TYPE_INT, { .i64 = BUFFER_CAPACITY }, 4096, INT_MAX / 4, D },
+    { "read_back_size", "size of the data kept behind the read position in each window", OFFSET(read_back_size), AV_OPT_TYPE_INT, { .i64 = READ_BACK_CAPACITY }, 0, INT_MAX / 4, D },
+    { "prefetch_windows", "number of independently prefetched ranges", OFFSET(nb_windows), AV_OPT_TYPE_INT, { .i64 = 1 }, 1, MAX_WINDOWS, D },
     {NULL},
 };
 
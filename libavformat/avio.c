@@ -58,6 +58,7 @@ static const AVOption options[] = {
     {"protocol_whitelist", "List of protocols that are allowed to be used", OFFSET(protocol_whitelist), AV_OPT_TYPE_STRING, { .str = NULL },  0, 0, D },
     {"protocol_blacklist", "List of protocols that are not allowed to be used", OFFSET(protocol_blacklist), AV_OPT_TYPE_STRING, { .str = NULL },  0, 0, D },
     {"rw_timeout", "Timeout for IO operations (in microseconds)", offsetof(URLContext, rw_timeout), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, AV_OPT_FLAG_ENCODING_PARAM | AV_OPT_FLAG_DECODING_PARAM },
+    {"max_buffer_size", "Grow the read buffer up to this size on sequential reads (0 disables)", OFFSET(max_buffer_size), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1 << 28, D },
     { NULL }
 };
 
@@ -648,6 +649,13 @@ int ffurl_get_short_seek(URLContext *h)
     return h->prot->url_get_short_seek(h);
 }
 
+int ffurl_advise(URLContext *h, int64_t offset, int64_t len, enum URLAdvice advice)
+{
+    if (!h || !h->prot || !h->prot->url_advise)
+        return AVERROR(ENOSYS);
+    return h->prot->url_advise(h, offset, len, advice);
+}
+
 int ffurl_shutdown(URLContext *h, int flags)
 {
     if (!h || !h->prot || !h->prot->url_shutdown)
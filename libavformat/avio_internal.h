@@ -77,6 +77,22 @@ typedef struct FFIOContext {
      * is updated each time a successful writeout ends up further position-wise
      */
     int64_t written_output_size;
+
+    /**
+     * Adaptive read buffer sizing: the buffer grows from min_buffer_size
+     * up to max_buffer_size while the data is read sequentially and shrinks
+     * back when seeks dominate. Disabled if max_buffer_size is 0.
+     */
+    int min_buffer_size;
+    int max_buffer_size;
+    int sequential_fills;
+    int short_seeks;
+    int64_t last_seek_pos;
+
+    /**
+     * A callback passing access pattern hints to the underlying protocol.
+     */
+    int (*advise)(void *opaque, int64_t offset, int64_t len, enum URLAdvice advice);
 } FFIOContext;
 
 static av_always_inline FFIOContext *ffiocontext(AVIOContext *ctx)
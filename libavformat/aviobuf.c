@@ -36,6 +36,17 @@
 
 #define IO_BUFFER_SIZE 32768
 
+/**
+ * Number of consecutive refills of the whole buffer after which the access
+ * is considered sequential and the buffer is grown.
+ */
+#define SEQUENTIAL_FILLS 4
+/**
+ * Number of consecutive seeks done before a buffer's worth of data was
+ * consumed after which the buffer is shrunk.
+ */
+#define SHORT_SEEKS 2
+
 /**
  * Do seeks within this distance ahead of the current buffer by skipping
  * data instead of calling the protocol seek function, for seekable
@@ -74,6 +85,7 @@ const AVClass ff_avio_class = {
 };
 
 static void fill_buffer(AVIOContext *s);
+static void adapt_buffer_on_seek(AVIOContext *s, int64_t offset);
 static int url_resetbuf(AVIOContext *s, int flags);
 /** @warning must be called before any I/O */
 static int set_buf_size(AVIOContext *s, int buf_size);
@@ -125,6 +137,7 @@ void ffio_init_context(FFIOContext *ctx,
     ctx->current_type        = AVIO_DATA_MARKER_UNKNOWN;
     ctx->last_time           = AV_NOPTS_VALUE;
     ctx->short_seek_get      = NULL;
+    ctx->advise              = NULL;
 #if FF_API_AVIOCONTEXT_WRITTEN
 FF_DISABLE_DEPRECATION_WARNINGS
     s->written               = 0;
@@ -335,6 +348,8 @@ int64_t avio_seek(AVIOContext *s, int64_t offset, int whence)
         if ((res = s->seek(s->opaque, offset, SEEK_SET)) < 0)
             return res;
         ctx->seek_count++;
+        if (!s->write_flag && ctx->max_buffer_size)
+            adapt_buffer_on_seek(s, offset);
         if (!s->write_flag)
             s->buf_end = s->buffer;
         s->buf_ptr = s->buf_ptr_max = s->buffer;
@@ -537,6 +552,51 @@ static int read_packet_wrapper(AVIOContext *s, uint8_t *buf, int size)
 
 /* Input stream */
 
+/* offset is the target of the seek, the buffer still holds the old data */
+static void adapt_buffer_on_seek(AVIOContext *s, int64_t offset)
+{
+    FFIOContext *const ctx = ffiocontext(s);
+    int64_t consumed = s->pos - (s->buf_end - s->buf_ptr) - ctx->last_seek_pos;
+
+    ctx->sequential_fills = 0;
+    ctx->last_seek_pos    = offset;
+
+    if (consumed >= s->buffer_size) {
+        ctx->short_seeks = 0;
+        return;
+    }
+    if (++ctx->short_seeks < SHORT_SEEKS || s->buffer_size <= ctx->min_buffer_size)
+        return;
+
+    ctx->short_seeks = 0;
+    if (set_buf_size(s, FFMAX(s->buffer_size >> 1, ctx->min_buffer_size)) < 0)
+        return;
+    if (s->buffer_size == ctx->min_buffer_size && ctx->advise)
+        ctx->advise(s->opaque, 0, 0, URL_ADVISE_NORMAL);
+}
+
+/* grow the buffer after enough refills of the whole buffer without seeks,
+ * dst is the start of the next refill; return 1 if the buffer was grown */
+static int grow_buffer_on_fill(AVIOContext *s, const uint8_t *dst)
+{
+    FFIOContext *const ctx = ffiocontext(s);
+    int first;
+
+    if (dst != s->buffer || s->buffer_size >= ctx->max_buffer_size ||
+        ++ctx->sequential_fills < SEQUENTIAL_FILLS)
+        return 0;
+
+    ctx->sequential_fills = 0;
+    first = s->buffer_size == ctx->min_buffer_size;
+    if (set_buf_size(s, FFMIN((int64_t)s->buffer_size << 1, ctx->max_buffer_size)) < 0) {
+        av_log(s, AV_LOG_WARNING, "Failed to increase buffer size\n");
+        return 0;
+    }
+    if (first && ctx->advise)
+        ctx->advise(s->opaque, 0, 0, URL_ADVISE_SEQUENTIAL);
+    return 1;
+}
+
 static void fill_buffer(AVIOContext *s)
 {
     FFIOContext *const ctx = (FFIOContext *)s;
@@ -574,6 +634,11 @@ static void fill_buffer(AVIOContext *s)
         len = ctx->orig_buffer_size;
     }
 
+    if (ctx->max_buffer_size && s->read_packet && grow_buffer_on_fill(s, dst)) {
+        s->checksum_ptr = dst = s->buffer;
+        len = s->buffer_size;
+    }
+
     len = read_packet_wrapper(s, dst, len);
     if (len == AVERROR_EOF) {
         /* do not modify buffer if EOF reached so that a seek back can
@@ -588,6 +653,10 @@ static void fill_buffer(AVIOContext *s)
         s->buf_end = dst + len;
         ffiocontext(s)->bytes_read += len;
         s->bytes_read = ffiocontext(s)->bytes_read;
+        /* let the protocol start reading the next refill */
+        if (ctx->max_buffer_size && ctx->advise &&
+            s->buffer_size > ctx->min_buffer_size)
+            ctx->advise(s->opaque, s->pos, s->buffer_size, URL_ADVISE_WILLNEED);
     }
 }
 
@@ -1005,6 +1074,12 @@ int ffio_fdopen(AVIOContext **s, URLContext *h)
             (*s)->seekable |= AVIO_SEEKABLE_TIME;
     }
     ((FFIOContext*)(*s))->short_seek_get = (int (*)(void *))ffurl_get_short_seek;
+    ((FFIOContext*)(*s))->advise = (int (*)(void *, int64_t, int64_t, enum URLAdvice))ffurl_advise;
+    if (h->max_buffer_size > buffer_size && !max_packet_size &&
+        !(h->flags & AVIO_FLAG_WRITE)) {
+        ((FFIOContext*)(*s))->min_buffer_size = buffer_size;
+        ((FFIOContext*)(*s))->max_buffer_size = h->max_buffer_size;
+    }
     (*s)->av_class = &ff_avio_class;
     return 0;
 }
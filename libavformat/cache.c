@@ -23,16 +23,34 @@
 
 /**
  * @TODO
- *      support keeping files
  *      support filling with a background thread
  */
 
+/*
+ * Without the block_size option everything read is stored in an unbounded
+ * temporary file. With it the input is cached in aligned blocks: a memory
+ * tier holds the most recently used blocks, and an optional disk tier in
+ * cache_dir keeps blocks across processes, in files named after a hash of
+ * the URL and the validators of the resource, up to disk_cache_size bytes.
+ * Only resources with a validator use it: the ETag or Last-Modified header
+ * of HTTP, or the modification time of local files.
+ */
+
+#define _DEFAULT_SOURCE
+#define _BSD_SOURCE
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
 #include "libavutil/internal.h"
+#include "libavutil/md5.h"
+#include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/tree.h"
 #include "avformat.h"
+#include "internal.h"
+#if HAVE_DIRENT_H
+#include <dirent.h>
+#include <utime.h>
+#endif
 #include <fcntl.h>
 #if HAVE_IO_H
 #include <io.h>
@@ -41,6 +59,7 @@
 #include <unistd.h>
 #endif
 #include <sys/stat.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include "os_support.h"
 #include "url.h"
@@ -51,6 +70,13 @@ typedef struct CacheEntry {
     int size;
 } CacheEntry;
 
+typedef struct CacheBlock {
+    int64_t index;
+    uint8_t *data;
+    int size;                       ///< less than block_size only at the end of the input
+    struct CacheBlock *prev, *next; ///< LRU list, most recently used first
+} CacheBlock;
+
 typedef struct Context {
     AVClass *class;
     int fd;
@@ -64,6 +90,20 @@ typedef struct Context {
     URLContext *inner;
     int64_t cache_hit, cache_miss;
     int read_ahead_limit;
+
+    /* block cache */
+    int block_size;
+    int64_t mem_cache_size;
+    char *cache_dir;
+    int64_t disk_cache_size;
+    int prefetch_blocks;
+    struct AVTreeNode *blocks;
+    CacheBlock *lru_first, *lru_last;
+    int nb_blocks, max_blocks;
+    int64_t size;
+    char key[33];                   ///< name of the disk tier files, empty without disk tier
+    int64_t disk_used;
+    int64_t disk_hit;
 } Context;
 
 static int cmp(const void *key, const void *node)
@@ -71,6 +111,13 @@ static int cmp(const void *key, const void *node)
     return FFDIFFSIGN(*(const int64_t *)key, ((const CacheEntry *) node)->logical_pos);
 }
 
+static int block_cmp(const void *key, const void *node)
+{
+    return FFDIFFSIGN(*(const int64_t *)key, ((const CacheBlock *) node)->index);
+}
+
+static int block_open(URLContext *h, const char *url);
+
 static int cache_open(URLContext *h, const char *arg, int flags, AVDictionary **options)
 {
     int ret;
@@ -79,6 +126,14 @@ static int cache_open(URLContext *h, const char *arg, int flags, AVDictionary **
 
     av_strstart(arg, "cache:", &arg);
 
+    if (c->block_size) {
+        ret = ffurl_open_whitelist(&c->inner, arg, flags, &h->interrupt_callback,
+                                   options, h->protocol_whitelist, h->protocol_blacklist, h);
+        if (ret < 0)
+            return ret;
+        return block_open(h, arg);
+    }
+
     c->fd = avpriv_tempfile("ffcache", &buffername, 0, h);
     if (c->fd < 0){
         av_log(h, AV_LOG_ERROR, "Failed to create tempfile\n");
@@ -96,6 +151,470 @@ static int cache_open(URLContext *h, const char *arg, int flags, AVDictionary **
                                 options, h->protocol_whitelist, h->protocol_blacklist, h);
 }
 
+/* block cache */
+
+static void lru_unlink(Context *c, CacheBlock *b)
+{
+    if (b->prev)
+        b->prev->next = b->next;
+    else
+        c->lru_first = b->next;
+    if (b->next)
+        b->next->prev = b->prev;
+    else
+        c->lru_last = b->prev;
+    b->prev = b->next = NULL;
+}
+
+static void lru_push_front(Context *c, CacheBlock *b)
+{
+    b->prev = NULL;
+    b->next = c->lru_first;
+    if (c->lru_first)
+        c->lru_first->prev = b;
+    else
+        c->lru_last = b;
+    c->lru_first = b;
+}
+
+static void block_free(CacheBlock **pb)
+{
+    if (*pb)
+        av_freep(&(*pb)->data);
+    av_freep(pb);
+}
+
+static void evict_block(Context *c)
+{
+    CacheBlock *b = c->lru_last;
+    struct AVTreeNode *node = NULL;
+
+    lru_unlink(c, b);
+    av_tree_insert(&c->blocks, &b->index, block_cmp, &node);
+    av_free(node);
+    block_free(&b);
+    c->nb_blocks--;
+}
+
+static int insert_block(Context *c, CacheBlock *b)
+{
+    struct AVTreeNode *node = av_tree_node_alloc();
+
+    if (!node)
+        return AVERROR(ENOMEM);
+    if (c->nb_blocks >= c->max_blocks)
+        evict_block(c);
+    av_tree_insert(&c->blocks, b, block_cmp, &node);
+    av_free(node);
+    lru_push_front(c, b);
+    c->nb_blocks++;
+    return 0;
+}
+
+static CacheBlock *block_alloc(Context *c, int64_t index)
+{
+    CacheBlock *b = av_mallocz(sizeof(*b));
+
+    if (!b)
+        return NULL;
+    b->data = av_malloc(c->block_size);
+    if (!b->data) {
+        av_freep(&b);
+        return NULL;
+    }
+    b->index = index;
+    return b;
+}
+
+#if HAVE_DIRENT_H
+typedef struct DiskFile {
+    char   *name;
+    int64_t size;
+    time_t  mtime;
+} DiskFile;
+
+static int disk_file_cmp(const void *a, const void *b)
+{
+    const DiskFile *fa = a, *fb = b;
+    return FFDIFFSIGN(fa->mtime, fb->mtime);
+}
+
+/*
+ * Add up the size of the block files in the cache directory and delete the
+ * least recently used ones until the total is at most limit. Other
+ * processes may use the directory at the same time, so the size is only
+ * known approximately between two scans.
+ */
+static void disk_scan(URLContext *h, int64_t limit)
+{
+    Context *c = h->priv_data;
+    DiskFile *files = NULL;
+    unsigned files_size = 0;
+    int nb_files = 0;
+    struct dirent *entry;
+    DIR *dir = opendir(c->cache_dir);
+
+    c->disk_used = 0;
+    if (!dir)
+        return;
+
+    while ((entry = readdir(dir))) {
+        const char *ext = strrchr(entry->d_name, '.');
+        struct stat st;
+        char *path;
+        DiskFile *tmp;
+
+        if (!ext || strcmp(ext, ".blk"))
+            continue;
+        path = av_asprintf("%s/%s", c->cache_dir, entry->d_name);
+        if (!path)
+            break;
+        if (stat(path, &st) < 0) {
+            av_free(path);
+            continue;
+        }
+        tmp = av_fast_realloc(files, &files_size, (nb_files + 1) * sizeof(*files));
+        if (!tmp) {
+            av_free(path);
+            break;
+        }
+        files = tmp;
+        files[nb_files].name  = path;
+        files[nb_files].size  = st.st_size;
+        files[nb_files].mtime = st.st_mtime;
+        c->disk_used += st.st_size;
+        nb_files++;
+    }
+    closedir(dir);
+
+    if (nb_files)
+        qsort(files, nb_files, sizeof(*files), disk_file_cmp);
+    for (int i = 0; i < nb_files; i++) {
+        if (c->disk_used > limit && !unlink(files[i].name))
+            c->disk_used -= files[i].size;
+        av_free(files[i].name);
+    }
+    av_free(files);
+}
+
+static char *block_path(Context *c, int64_t index)
+{
+    return av_asprintf("%s/%s-%"PRId64".blk", c->cache_dir, c->key, index);
+}
+
+static CacheBlock *disk_load(URLContext *h, int64_t index)
+{
+    Context *c = h->priv_data;
+    int64_t expected = FFMIN(c->block_size, c->size - index * c->block_size);
+    CacheBlock *b;
+    char *path;
+    int fd, ret;
+
+    if (!c->key[0] || expected <= 0)
+        return NULL;
+    path = block_path(c, index);
+    if (!path)
+        return NULL;
+    fd = avpriv_open(path, O_RDONLY);
+    if (fd < 0) {
+        av_free(path);
+        return NULL;
+    }
+
+    b = block_alloc(c, index);
+    ret = b ? read(fd, b->data, expected) : -1;
+    close(fd);
+    if (ret != expected) {
+        block_free(&b);
+    } else {
+        b->size = ret;
+        /* the modification time orders the blocks for eviction */
+        utime(path, NULL);
+    }
+    av_free(path);
+
+    return b;
+}
+
+static void disk_store(URLContext *h, const CacheBlock *b)
+{
+    Context *c = h->priv_data;
+    char *path, *tmp;
+    int fd, ret;
+
+    if (!c->key[0])
+        return;
+    path = block_path(c, b->index);
+    tmp  = av_asprintf("%s.tmp", path ? path : "");
+    if (!path || !tmp)
+        goto end;
+
+    /* another process may be writing the same block */
+    fd = avpriv_open(tmp, O_WRONLY | O_CREAT | O_EXCL, 0666);
+    if (fd < 0)
+        goto end;
+    ret = write(fd, b->data, b->size);
+    close(fd);
+    if (ret != b->size || rename(tmp, path) < 0) {
+        unlink(tmp);
+        goto end;
+    }
+
+    c->disk_used += b->size;
+    if (c->disk_cache_size && c->disk_used > c->disk_cache_size)
+        disk_scan(h, c->disk_cache_size / 4 * 3);
+end:
+    av_free(path);
+    av_free(tmp);
+}
+#else
+static CacheBlock *disk_load(URLContext *h, int64_t index)
+{
+    return NULL;
+}
+
+static void disk_store(URLContext *h, const CacheBlock *b)
+{
+}
+#endif
+
+/* compute the name of the disk tier files of the resource, return 0 if it
+ * has no validator telling whether the stored blocks are still current */
+static int compute_key(URLContext *h, const char *url)
+{
+    Context *c = h->priv_data;
+    uint8_t *etag = NULL, *last_modified = NULL;
+    uint8_t digest[16];
+    char mtime[64] = "";
+    struct stat st;
+    char *str = NULL;
+    int fd;
+
+    av_opt_get(c->inner, "etag",          AV_OPT_SEARCH_CHILDREN, &etag);
+    av_opt_get(c->inner, "last_modified", AV_OPT_SEARCH_CHILDREN, &last_modified);
+
+    /* local files have no HTTP validators, their modification time is used */
+    fd = ffurl_get_file_handle(c->inner);
+    if (fd >= 0 && !fstat(fd, &st) && S_ISREG(st.st_mode)) {
+#if HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+        snprintf(mtime, sizeof(mtime), "%"PRId64".%09ld",
+                 (int64_t)st.st_mtim.tv_sec, (long)st.st_mtim.tv_nsec);
+#else
+        snprintf(mtime, sizeof(mtime), "%"PRId64, (int64_t)st.st_mtime);
+#endif
+    }
+
+    if ((etag && *etag) || (last_modified && *last_modified) || *mtime)
+        str = av_asprintf("%s\n%d\n%"PRId64"\n%s\n%s\n%s", url, c->block_size,
+                          c->size, etag ? (char *)etag : "",
+                          last_modified ? (char *)last_modified : "", mtime);
+    if (str) {
+        av_md5_sum(digest, str, strlen(str));
+        ff_data_to_hex(c->key, digest, sizeof(digest), 1);
+    }
+    av_free(str);
+    av_free(etag);
+    av_free(last_modified);
+    return !!c->key[0];
+}
+
+static int block_open(URLContext *h, const char *url)
+{
+    Context *c = h->priv_data;
+
+    c->max_blocks = FFMIN(FFMAX(c->mem_cache_size / c->block_size, 2), INT_MAX);
+    c->prefetch_blocks = FFMIN(c->prefetch_blocks, c->max_blocks - 1);
+    c->size = ffurl_size(c->inner);
+
+    if (c->cache_dir) {
+#if HAVE_DIRENT_H
+        /* the size is part of the key, stored blocks are unusable without it
+         * and without a validator a changed resource could be served stale */
+        if (c->size <= 0) {
+            av_log(h, AV_LOG_WARNING, "Unknown input size, not using the disk cache\n");
+        } else if (!compute_key(h, url)) {
+            av_log(h, AV_LOG_WARNING, "No validator for the input, not using the disk cache\n");
+        } else if (c->disk_cache_size) {
+            disk_scan(h, c->disk_cache_size);
+        }
+#else
+        av_log(h, AV_LOG_WARNING, "The disk cache is not supported on this platform\n");
+#endif
+    }
+
+    return 0;
+}
+
+static CacheBlock *find_block(Context *c, int64_t index)
+{
+    return av_tree_find(c->blocks, &index, block_cmp, NULL);
+}
+
+/* read one block from the inner protocol, which is at its start */
+static int fetch_block(URLContext *h, int64_t index, CacheBlock **pb)
+{
+    Context *c = h->priv_data;
+    CacheBlock *b = block_alloc(c, index);
+    int ret = 0;
+
+    if (!b)
+        return AVERROR(ENOMEM);
+
+    while (b->size < c->block_size) {
+        ret = ffurl_read(c->inner, b->data + b->size, c->block_size - b->size);
+        if (ret <= 0)
+            break;
+        b->size      += ret;
+        c->inner_pos += ret;
+    }
+    if (ret < 0 && ret != AVERROR_EOF) {
+        block_free(&b);
+        return ret;
+    }
+    if (b->size < c->block_size) {
+        c->is_true_eof = 1;
+        c->end = index * c->block_size + b->size;
+    }
+    if (!b->size) {
+        block_free(&b);
+        return AVERROR_EOF;
+    }
+    /* blocks already cached are read again when reading up to a block */
+    if (find_block(c, index)) {
+        block_free(&b);
+        *pb = find_block(c, index);
+        return 0;
+    }
+
+    c->cache_miss++;
+    disk_store(h, b);
+    if ((ret = insert_block(c, b)) < 0) {
+        block_free(&b);
+        return ret;
+    }
+    *pb = b;
+    return 0;
+}
+
+static int get_block(URLContext *h, int64_t index, CacheBlock **pb)
+{
+    Context *c = h->priv_data;
+    int64_t pos = index * c->block_size;
+    CacheBlock *b = find_block(c, index);
+    int ret;
+
+    if (b) {
+        c->cache_hit++;
+        lru_unlink(c, b);
+        lru_push_front(c, b);
+        *pb = b;
+        return 0;
+    }
+
+    if (c->is_true_eof && pos >= c->end)
+        return AVERROR_EOF;
+
+    b = disk_load(h, index);
+    if (b) {
+        c->disk_hit++;
+        if ((ret = insert_block(c, b)) < 0) {
+            block_free(&b);
+            return ret;
+        }
+        *pb = b;
+        return 0;
+    }
+
+    if (c->inner_pos != pos) {
+        int64_t r = ffurl_seek(c->inner, pos, SEEK_SET);
+        if (r < 0) {
+            /* read up to the block if the inner protocol cannot seek */
+            if (c->inner_pos > pos || c->inner_pos % c->block_size ||
+                (c->read_ahead_limit >= 0 && pos - c->inner_pos > c->read_ahead_limit)) {
+                av_log(h, AV_LOG_ERROR, "Failed to perform internal seek\n");
+                return r;
+            }
+            while (c->inner_pos < pos) {
+                ret = fetch_block(h, c->inner_pos / c->block_size, &b);
+                if (ret < 0)
+                    return ret;
+            }
+        } else {
+            c->inner_pos = r;
+        }
+    }
+
+    ret = fetch_block(h, index, pb);
+    if (ret < 0)
+        return ret;
+
+    /* read through the following blocks while the connection is positioned */
+    for (int i = 1; i <= c->prefetch_blocks && !c->is_true_eof; i++) {
+        if (find_block(c, index + i) || fetch_block(h, index + i, &b) < 0)
+            break;
+    }
+
+    return 0;
+}
+
+static int block_read(URLContext *h, unsigned char *buf, int size)
+{
+    Context *c = h->priv_data;
+    int64_t index = c->logical_pos / c->block_size;
+    int offset = c->logical_pos % c->block_size;
+    CacheBlock *b;
+    int ret = get_block(h, index, &b);
+
+    if (ret < 0)
+        return ret;
+    if (offset >= b->size)
+        return AVERROR_EOF;
+
+    size = FFMIN(size, b->size - offset);
+    memcpy(buf, b->data + offset, size);
+    c->logical_pos += size;
+    c->end = FFMAX(c->end, c->logical_pos);
+    return size;
+}
+
+static int64_t block_seek(URLContext *h, int64_t pos, int whence)
+{
+    Context *c = h->priv_data;
+
+    if (whence == AVSEEK_SIZE) {
+        if (c->size >= 0)
+            return c->size;
+        if (c->is_true_eof)
+            return c->end;
+        return ffurl_seek(c->inner, pos, whence);
+    }
+
+    if (whence == SEEK_CUR) {
+        pos += c->logical_pos;
+    } else if (whence == SEEK_END) {
+        if (c->size >= 0)
+            pos += c->size;
+        else if (c->is_true_eof)
+            pos += c->end;
+        else
+            return AVERROR(ENOSYS);
+    } else if (whence != SEEK_SET) {
+        return AVERROR(EINVAL);
+    }
+    if (pos < 0)
+        return AVERROR(EINVAL);
+
+    /* the inner protocol is only moved when a block is missing */
+    return c->logical_pos = pos;
+}
+
+static int enu_free_block(void *opaque, void *elem)
+{
+    CacheBlock *b = elem;
+    block_free(&b);
+    return 0;
+}
+
 static int add_entry(URLContext *h, const unsigned char *buf, int size)
 {
     Context *c= h->priv_data;
@@ -165,6 +684,9 @@ static int cache_read(URLContext *h, unsigned char *buf, int size)
     CacheEntry *entry, *next[2] = {NULL, NULL};
     int64_t r;
 
+    if (c->block_size)
+        return block_read(h, buf, size);
+
     entry = av_tree_find(c->root, &c->logical_pos, cmp, (void**)next);
 
     if (!entry)
@@ -229,6 +751,9 @@ static int64_t cache_seek(URLContext *h, int64_t pos, int whence)
     Context *c= h->priv_data;
     int64_t ret;
 
+    if (c->block_size)
+        return block_seek(h, pos, whence);
+
     if (whence == AVSEEK_SIZE) {
         pos= ffurl_seek(c->inner, pos, whence);
         if(pos <= 0){
@@ -300,6 +825,15 @@ static int cache_close(URLContext *h)
     Context *c= h->priv_data;
     int ret;
 
+    if (c->block_size) {
+        av_log(h, AV_LOG_INFO, "Statistics, cache hits:%"PRId64" disk cache hits:%"PRId64
+               " cache misses:%"PRId64"\n", c->cache_hit, c->disk_hit, c->cache_miss);
+        ffurl_closep(&c->inner);
+        av_tree_enumerate(c->blocks, NULL, NULL, enu_free_block);
+        av_tree_destroy(c->blocks);
+        return 0;
+    }
+
     av_log(h, AV_LOG_INFO, "Statistics, cache hits:%"PRId64" cache misses:%"PRId64"\n",
            c->cache_hit, c->cache_miss);
 
@@ -322,6 +856,11 @@ static int cache_close(URLContext *h)
 
 static const AVOption options[] = {
     { "read_ahead_limit", "Amount in bytes that may be read ahead when seeking isn't supported, -1 for unlimited", OFFSET(read_ahead_limit), AV_OPT_TYPE_INT, { .i64 = 65536 }, -1, INT_MAX, D },
+    { "block_size", "Cache the input in blocks of this size, 0 stores everything read in a temporary file", OFFSET(block_size), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1 << 26, D },
+    { "mem_cache_size", "Amount in bytes of blocks kept in memory", OFFSET(mem_cache_size), AV_OPT_TYPE_INT64, { .i64 = 64 << 20 }, 0, INT64_MAX, D },
+    { "cache_dir", "Directory keeping blocks across processes", OFFSET(cache_dir), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, D },
+    { "disk_cache_size", "Amount in bytes of blocks kept in cache_dir, 0 for unlimited", OFFSET(disk_cache_size), AV_OPT_TYPE_INT64, { .i64 = 1LL << 30 }, 0, INT64_MAX, D },
+    { "prefetch_blocks", "Number of blocks read through after a missing block", OFFSET(prefetch_blocks), AV_OPT_TYPE_INT, { .i64 = 1 }, 0, 64, D },
     {NULL},
 };
 
@@ -47,6 +47,7 @@
 #include "http.h"
 #endif
 #include "internal.h"
+#include "ioworker.h"
 #include "isom.h"
 #include "os_support.h"
 #include "url.h"
@@ -140,6 +141,7 @@ typedef struct OutputStream {
     int64_t gop_size;
     AVRational sar;
     int coding_dependency;
+    FFIOWorker *io;
 } OutputStream;
 
 typedef struct DASHContext {
@@ -198,6 +200,8 @@ typedef struct DASHContext {
     AVRational min_playback_rate;
     AVRational max_playback_rate;
     int64_t update_period;
+    int async_io;
+    int async_io_queue_size;
 } DASHContext;
 
 static struct codec_string {
@@ -443,9 +447,98 @@ static void set_codec_str(AVFormatContext *s, AVCodecParameters *par,
     }
 }
 
+static void set_http_options(AVDictionary **options, DASHContext *c);
+static int dashenc_delete_segment_file(AVFormatContext *s, const char* file);
+
+/* With async_io, the media segments of each representation are opened,
+ * written, closed and deleted by an I/O worker owned by its OutputStream,
+ * so that the representations are written concurrently. The manifests are
+ * only written once the workers of the segments they reference are idle. */
+
+enum DASHIOJobType {
+    DASH_IO_JOB_OPEN,
+    DASH_IO_JOB_WRITE,
+    DASH_IO_JOB_CLOSE,
+    DASH_IO_JOB_DELETE,
+};
+
+static int dash_io_run_job(AVFormatContext *s, void *opaque, AVIOContext **pb,
+                           FFIOJob *job)
+{
+    DASHContext *c = s->priv_data;
+    OutputStream *os = opaque;
+    AVDictionary *opts = NULL;
+    int ret = 0;
+
+    switch (job->type) {
+    case DASH_IO_JOB_OPEN:
+        set_http_options(&opts, c);
+        ret = dashenc_io_open(s, pb, job->url, &opts);
+        av_dict_free(&opts);
+        if (ret < 0)
+            ret = handle_io_open_error(s, ret, job->url);
+        break;
+    case DASH_IO_JOB_WRITE:
+        if (*pb) {
+            avio_write(*pb, job->data, job->size);
+            avio_flush(*pb);
+        }
+        break;
+    case DASH_IO_JOB_CLOSE:
+        dashenc_io_close(s, pb, job->url);
+        if (job->new_url)
+            ret = ff_rename(job->url, job->new_url, os->ctx);
+        break;
+    case DASH_IO_JOB_DELETE:
+        ret = dashenc_delete_segment_file(s, job->url);
+        break;
+    }
+    return ret;
+}
+
+static int dash_io_queue(OutputStream *os, enum DASHIOJobType type, const char *url,
+                         const char *new_url, const uint8_t *data, int size)
+{
+    FFIOJob job = { .type = type, .size = size };
+
+    if ((url     && !(job.url     = av_strdup(url))) ||
+        (new_url && !(job.new_url = av_strdup(new_url))) ||
+        (data    && !(job.data    = av_memdup(data, size)))) {
+        ff_io_job_free(&job);
+        return AVERROR(ENOMEM);
+    }
+    return ff_io_worker_submit(os->io, &job);
+}
+
+/* Waits until the workers of all the representations are idle. */
+static int dash_io_wait_all(AVFormatContext *s)
+{
+    DASHContext *c = s->priv_data;
+    int ret = 0;
+
+    for (int i = 0; i < s->nb_streams; i++) {
+        OutputStream *os = &c->streams[i];
+        int err = os->io ? ff_io_worker_wait(os->io) : 0;
+        if (!ret)
+            ret = err;
+    }
+    return ret;
+}
+
+/* Writes segment data, through the worker once the init segment is done. */
+static int dash_out_write(OutputStream *os, const uint8_t *buf, int size)
+{
+    if (os->out)
+        avio_write(os->out, buf, size);
+    else if (os->io)
+        return dash_io_queue(os, DASH_IO_JOB_WRITE, NULL, NULL, buf, size);
+    return 0;
+}
+
 static int flush_dynbuf(DASHContext *c, OutputStream *os, int *range_length)
 {
     uint8_t *buffer;
+    int ret;
 
     if (!os->ctx->pb) {
         return AVERROR(EINVAL);
@@ -459,13 +552,14 @@ static int flush_dynbuf(DASHContext *c, OutputStream *os, int *range_length)
         // write out to file
         *range_length = avio_close_dyn_buf(os->ctx->pb, &buffer);
         os->ctx->pb = NULL;
-        if (os->out)
-            avio_write(os->out, buffer + os->written_len, *range_length - os->written_len);
+        ret = dash_out_write(os, buffer + os->written_len, *range_length - os->written_len);
         os->written_len = 0;
         av_free(buffer);
 
         // re-open buffer
-        return avio_open_dyn_buf(&os->ctx->pb);
+        if (avio_open_dyn_buf(&os->ctx->pb) < 0)
+            return AVERROR(ENOMEM);
+        return ret;
     } else {
         *range_length = avio_tell(os->ctx->pb) - os->pos;
         return 0;
@@ -618,6 +712,7 @@ static void dash_free(AVFormatContext *s)
         return;
     for (i = 0; i < s->nb_streams; i++) {
         OutputStream *os = &c->streams[i];
+        ff_io_worker_stop(&os->io);
         if (os->ctx && os->ctx->pb) {
             if (!c->single_file)
                 ffio_free_dyn_buf(&os->ctx->pb);
@@ -1595,6 +1690,16 @@ static int dash_init(AVFormatContext *s)
             return ret;
         os->init_start_pos = 0;
 
+        if (c->async_io && !c->single_file) {
+#if HAVE_THREADS
+            if ((ret = ff_io_worker_start(&os->io, s, os, c->async_io_queue_size,
+                                          dash_io_run_job)) < 0)
+                return ret;
+#else
+            av_log(s, AV_LOG_WARNING, "Asynchronous output requires threads, writing synchronously\n");
+#endif
+        }
+
         av_dict_copy(&opts, c->format_options, 0);
         if (!as->seg_duration)
             as->seg_duration = c->seg_duration;
@@ -1894,10 +1999,18 @@ static int dashenc_delete_segment_file(AVFormatContext *s, const char* file)
     return 0;
 }
 
-static inline void dashenc_delete_media_segments(AVFormatContext *s, OutputStream *os, int remove_count)
+static inline int dashenc_delete_media_segments(AVFormatContext *s, OutputStream *os, int remove_count)
 {
+    int ret = 0;
+
     for (int i = 0; i < remove_count; ++i) {
-        dashenc_delete_segment_file(s, os->segments[i]->file);
+        if (os->io) {
+            int err = dash_io_queue(os, DASH_IO_JOB_DELETE, os->segments[i]->file, NULL, NULL, 0);
+            if (!ret)
+                ret = err;
+        } else {
+            dashenc_delete_segment_file(s, os->segments[i]->file);
+        }
 
         // Delete the segment regardless of whether the file was successfully deleted
         av_free(os->segments[i]);
@@ -1905,6 +2018,7 @@ static inline void dashenc_delete_media_segments(AVFormatContext *s, OutputStrea
 
     os->nb_segments -= remove_count;
     memmove(os->segments, os->segments + remove_count, os->nb_segments * sizeof(*os->segments));
+    return ret;
 }
 
 static int dash_flush(AVFormatContext *s, int final, int stream)
@@ -1965,6 +2079,11 @@ static int dash_flush(AVFormatContext *s, int final, int stream)
 
         if (c->single_file) {
             find_index_range(s, os->full_path, os->pos, &index_length);
+        } else if (os->io) {
+            ret = dash_io_queue(os, DASH_IO_JOB_CLOSE, os->temp_path,
+                                use_rename ? os->full_path : NULL, NULL, 0);
+            if (ret < 0)
+                break;
         } else {
             dashenc_io_close(s, &os->out, os->temp_path);
 
@@ -1997,8 +2116,11 @@ static int dash_flush(AVFormatContext *s, int final, int stream)
         for (i = 0; i < s->nb_streams; i++) {
             OutputStream *os = &c->streams[i];
             int remove_count = os->nb_segments - c->window_size - c->extra_window_size;
-            if (remove_count > 0)
-                dashenc_delete_media_segments(s, os, remove_count);
+            if (remove_count > 0) {
+                int err = dashenc_delete_media_segments(s, os, remove_count);
+                if (err < 0 && ret >= 0)
+                    ret = err;
+            }
         }
     }
 
@@ -2035,8 +2157,11 @@ static int dash_flush(AVFormatContext *s, int final, int stream)
         }
         // In streaming mode the manifest is written at the beginning
         // of the segment instead
-        if (!c->streaming || final)
+        if (!c->streaming || final) {
+            if ((ret = dash_io_wait_all(s)) < 0)
+                return ret;
             ret = write_manifest(s, final);
+        }
     }
     return ret;
 }
@@ -2257,13 +2382,24 @@ static int dash_write_packet(AVFormatContext *s, AVPacket *pkt)
                  os->filename);
         snprintf(os->temp_path, sizeof(os->temp_path),
                  use_rename ? "%s.tmp" : "%s", os->full_path);
-        set_http_options(&opts, c);
-        ret = dashenc_io_open(s, &os->out, os->temp_path, &opts);
-        av_dict_free(&opts);
-        if (ret < 0) {
-            return handle_io_open_error(s, ret, os->temp_path);
+        if (os->io) {
+            if ((ret = dash_io_queue(os, DASH_IO_JOB_OPEN, os->temp_path, NULL, NULL, 0)) < 0)
+                return ret;
+        } else {
+            set_http_options(&opts, c);
+            ret = dashenc_io_open(s, &os->out, os->temp_path, &opts);
+            av_dict_free(&opts);
+            if (ret < 0) {
+                return handle_io_open_error(s, ret, os->temp_path);
+            }
         }
 
+        // the previous segment of this representation, which the manifest
+        // and its playlist reference, must be complete; the other
+        // representations keep writing theirs
+        if (os->io && (c->streaming || c->lhls) && (ret = ff_io_worker_wait(os->io)) < 0)
+            return ret;
+
         // in streaming mode, the segments are available for playing
         // before fully written but the manifest is needed so that
         // clients and discover the segment filenames.
@@ -2286,6 +2422,10 @@ static int dash_write_packet(AVFormatContext *s, AVPacket *pkt)
         if (os->out) {
             avio_write(os->out, buf + os->written_len, len - os->written_len);
             avio_flush(os->out);
+        } else if (os->io) {
+            if ((ret = dash_io_queue(os, DASH_IO_JOB_WRITE, NULL, NULL,
+                                     buf + os->written_len, len - os->written_len)) < 0)
+                return ret;
         }
         os->written_len = len;
     }
@@ -2296,7 +2436,7 @@ static int dash_write_packet(AVFormatContext *s, AVPacket *pkt)
 static int dash_write_trailer(AVFormatContext *s)
 {
     DASHContext *c = s->priv_data;
-    int i;
+    int i, io_ret = 0;
 
     if (s->nb_streams > 0) {
         OutputStream *os = &c->streams[0];
@@ -2312,6 +2452,14 @@ static int dash_write_trailer(AVFormatContext *s)
     }
     dash_flush(s, 1, -1);
 
+    for (i = 0; i < s->nb_streams; i++) {
+        int ret = ff_io_worker_stop(&c->streams[i].io);
+        if (ret < 0 && !io_ret) {
+            av_log(s, AV_LOG_ERROR, "Asynchronous output failed: %s\n", av_err2str(ret));
+            io_ret = ret;
+        }
+    }
+
     if (c->remove_at_exit) {
         for (i = 0; i < s->nb_streams; ++i) {
             OutputStream *os = &c->streams[i];
@@ -2332,7 +2480,7 @@ static int dash_write_trailer(AVFormatContext *s)
         }
     }
 
-    return 0;
+    return io_ret;
 }
 
 static int dash_check_bitstream(AVFormatContext *s, AVStream *st,
@@ -2404,6 +2552,8 @@ static const AVOption options[] = {
     { "min_playback_rate", "Set desired minimum playback rate", OFFSET(min_playback_rate), AV_OPT_TYPE_RATIONAL, { .dbl = 1.0 }, 0.5, 1.5, E },
     { "max_playback_rate", "Set desired maximum playback rate", OFFSET(max_playback_rate), AV_OPT_TYPE_RATIONAL, { .dbl = 1.0 }, 0.5, 1.5, E },
     { "update_period", "Set the mpd update interval", OFFSET(update_period), AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, E},
+    { "async_io", "write the segments of each representation from its own thread", OFFSET(async_io), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, E },
+    { "async_io_queue_size", "maximum number of pending output operations per representation", OFFSET(async_io_queue_size), AV_OPT_TYPE_INT, { .i64 = 64 }, 1, 4096, E },
     { NULL },
 };
 
@@ -19,10 +19,16 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#define _DEFAULT_SOURCE
+#define _BSD_SOURCE // needed for syscall() and MAP_POPULATE
+
 #include "config_components.h"
 
+#include <stdatomic.h>
+
 #include "libavutil/avstring.h"
 #include "libavutil/internal.h"
+#include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "avformat.h"
 #if HAVE_DIRENT_H
@@ -35,11 +41,24 @@
 #if HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#if HAVE_MMAP
+#include <sys/mman.h>
+#endif
+#if HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
 #include <sys/stat.h>
 #include <stdlib.h>
 #include "os_support.h"
 #include "url.h"
 
+#if HAVE_LINUX_IO_URING_H && defined(IORING_FEAT_RW_CUR_POS) && defined(__NR_io_uring_setup)
+#define FILE_IO_URING 1
+#else
+#define FILE_IO_URING 0
+#endif
+
 /* Some systems may not have S_ISFIFO */
 #ifndef S_ISFIFO
 #  ifdef S_IFIFO
@@ -69,6 +88,38 @@
 
 /* standard file protocol */
 
+enum FileReadMode {
+    FILE_READ_READ,
+    FILE_READ_MMAP,
+    FILE_READ_IO_URING,
+};
+
+#if FILE_IO_URING
+typedef struct FileUringBlock {
+    uint8_t *data;
+    int      pending;
+    int      size;          ///< number of bytes read or negative AVERROR
+} FileUringBlock;
+
+typedef struct FileUring {
+    int                   fd;
+    void                 *sq_ring, *cq_ring;
+    size_t                sq_ring_size, cq_ring_size;
+    struct io_uring_sqe  *sqes;
+    size_t                sqes_size;
+    unsigned             *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned             *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe  *cqes;
+
+    /* blocks[(first + i) % nb_blocks] holds the data at start + i * block_size */
+    FileUringBlock       *blocks;
+    int                   nb_blocks;
+    int                   first;
+    int64_t               start;
+    int                   nb_pending;
+} FileUring;
+#endif
+
 typedef struct FileContext {
     const AVClass *class;
     int fd;
@@ -76,9 +127,22 @@ typedef struct FileContext {
     int blocksize;
     int follow;
     int seekable;
+    int read_mode;
+    int uring_depth;
+    int uring_block_size;
 #if HAVE_DIRENT_H
     DIR *dir;
 #endif
+
+    /* read position and file size with the mmap and io_uring read modes */
+    int64_t pos;
+    int64_t size;
+#if HAVE_MMAP
+    uint8_t *map;
+#endif
+#if FILE_IO_URING
+    FileUring uring;
+#endif
 } FileContext;
 
 static const AVOption file_options[] = {
@@ -86,6 +150,12 @@ static const AVOption file_options[] = {
     { "blocksize", "set I/O operation maximum block size", offsetof(FileContext, blocksize), AV_OPT_TYPE_INT, { .i64 = INT_MAX }, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
     { "follow", "Follow a file as it is being written", offsetof(FileContext, follow), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { "seekable", "Sets if the file is seekable", offsetof(FileContext, seekable), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, 0, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "read_mode", "set how regular files opened for reading are read", offsetof(FileContext, read_mode), AV_OPT_TYPE_INT, { .i64 = FILE_READ_READ }, FILE_READ_READ, FILE_READ_IO_URING, AV_OPT_FLAG_DECODING_PARAM, "read_mode" },
+        { "read",     "read() system calls",                0, AV_OPT_TYPE_CONST, { .i64 = FILE_READ_READ },     0, 0, AV_OPT_FLAG_DECODING_PARAM, "read_mode" },
+        { "mmap",     "copy from a memory mapping of the file", 0, AV_OPT_TYPE_CONST, { .i64 = FILE_READ_MMAP },     0, 0, AV_OPT_FLAG_DECODING_PARAM, "read_mode" },
+        { "io_uring", "io_uring with queued readahead",     0, AV_OPT_TYPE_CONST, { .i64 = FILE_READ_IO_URING }, 0, 0, AV_OPT_FLAG_DECODING_PARAM, "read_mode" },
+    { "io_uring_depth", "number of reads queued ahead with io_uring", offsetof(FileContext, uring_depth), AV_OPT_TYPE_INT, { .i64 = 4 }, 2, 64, AV_OPT_FLAG_DECODING_PARAM },
+    { "io_uring_block_size", "size of the reads queued with io_uring", offsetof(FileContext, uring_block_size), AV_OPT_TYPE_INT, { .i64 = 1 << 20 }, 4096, 1 << 28, AV_OPT_FLAG_DECODING_PARAM },
     { NULL }
 };
 
@@ -108,11 +178,275 @@ static const AVClass pipe_class = {
     .version    = LIBAVUTIL_VERSION_INT,
 };
 
+#if FILE_IO_URING
+static int uring_enter(FileUring *u, unsigned to_submit, unsigned min_complete)
+{
+    int ret;
+
+    do {
+        ret = syscall(__NR_io_uring_enter, u->fd, to_submit, min_complete,
+                      min_complete ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while (ret < 0 && errno == EINTR);
+
+    return ret < 0 ? AVERROR(errno) : ret;
+}
+
+/* queue the read of block i at the file offset pos */
+static int uring_submit(FileContext *c, int i, int64_t pos)
+{
+    FileUring *u = &c->uring;
+    unsigned tail = *u->sq_tail;
+    unsigned idx  = tail & *u->sq_mask;
+    struct io_uring_sqe *sqe = &u->sqes[idx];
+    int ret;
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode    = IORING_OP_READ;
+    sqe->fd        = c->fd;
+    sqe->off       = pos;
+    sqe->addr      = (uintptr_t)u->blocks[i].data;
+    sqe->len       = c->uring_block_size;
+    sqe->user_data = i;
+    u->sq_array[idx] = idx;
+    atomic_store_explicit((atomic_uint *)u->sq_tail, tail + 1, memory_order_release);
+
+    ret = uring_enter(u, 1, 0);
+    if (ret < 0)
+        return ret;
+
+    u->blocks[i].pending = 1;
+    u->nb_pending++;
+    return 0;
+}
+
+/* wait for at least one completion and reap all available ones */
+static int uring_reap(FileUring *u)
+{
+    unsigned head = *u->cq_head;
+    int ret = uring_enter(u, 0, 1);
+
+    if (ret < 0)
+        return ret;
+
+    while (head != atomic_load_explicit((atomic_uint *)u->cq_tail, memory_order_acquire)) {
+        struct io_uring_cqe *cqe = &u->cqes[head & *u->cq_mask];
+        FileUringBlock *b = &u->blocks[cqe->user_data];
+
+        b->size    = cqe->res;
+        b->pending = 0;
+        u->nb_pending--;
+        head++;
+    }
+    atomic_store_explicit((atomic_uint *)u->cq_head, head, memory_order_release);
+
+    return 0;
+}
+
+static int uring_drain(FileUring *u)
+{
+    while (u->nb_pending) {
+        int ret = uring_reap(u);
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
+}
+
+/* restart the readahead window at pos */
+static int uring_restart(FileContext *c, int64_t pos)
+{
+    FileUring *u = &c->uring;
+    int ret = uring_drain(u);
+
+    if (ret < 0)
+        return ret;
+
+    u->first = 0;
+    u->start = pos;
+    for (int i = 0; i < u->nb_blocks; i++) {
+        ret = uring_submit(c, i, pos + (int64_t)i * c->uring_block_size);
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
+}
+
+static int uring_read(FileContext *c, unsigned char *buf, int size)
+{
+    FileUring *u = &c->uring;
+    int64_t window = (int64_t)u->nb_blocks * c->uring_block_size;
+    FileUringBlock *b;
+    int offset, ret;
+
+    if (c->pos < u->start || c->pos >= u->start + window) {
+        ret = uring_restart(c, c->pos);
+        if (ret < 0)
+            return ret;
+    }
+
+    /* recycle the blocks before the read position for reads further ahead */
+    while (c->pos >= u->start + c->uring_block_size) {
+        while (u->blocks[u->first].pending)
+            if ((ret = uring_reap(u)) < 0)
+                return ret;
+        ret = uring_submit(c, u->first, u->start + window);
+        if (ret < 0)
+            return ret;
+        u->first  = (u->first + 1) % u->nb_blocks;
+        u->start += c->uring_block_size;
+    }
+
+    b = &u->blocks[u->first];
+    while (b->pending)
+        if ((ret = uring_reap(u)) < 0)
+            return ret;
+    if (b->size < 0) {
+        ret = b->size;
+        /* retry the read the next time */
+        u->start = INT64_MAX;
+        return ret;
+    }
+
+    offset = c->pos - u->start;
+    if (offset >= b->size) {
+        /* a short completion is not necessarily the end of the file: the
+         * read may have been cut short or the file may have grown since,
+         * only a read returning nothing now means end of file */
+        do {
+            ret = pread(c->fd, buf, size, c->pos);
+        } while (ret < 0 && errno == EINTR);
+        return ret < 0 ? AVERROR(errno) : ret;
+    }
+
+    size = FFMIN(size, b->size - offset);
+    memcpy(buf, b->data + offset, size);
+    return size;
+}
+
+static void uring_uninit(FileContext *c)
+{
+    FileUring *u = &c->uring;
+
+    if (u->fd > 0) {
+        uring_drain(u);
+        close(u->fd);
+    }
+    if (u->sqes)
+        munmap(u->sqes, u->sqes_size);
+    if (u->cq_ring && u->cq_ring != u->sq_ring)
+        munmap(u->cq_ring, u->cq_ring_size);
+    if (u->sq_ring)
+        munmap(u->sq_ring, u->sq_ring_size);
+    for (int i = 0; u->blocks && i < u->nb_blocks; i++)
+        av_freep(&u->blocks[i].data);
+    av_freep(&u->blocks);
+    memset(u, 0, sizeof(*u));
+}
+
+static int uring_init(FileContext *c)
+{
+    FileUring *u = &c->uring;
+    struct io_uring_params p = { 0 };
+    int ret;
+
+    ret = syscall(__NR_io_uring_setup, c->uring_depth, &p);
+    if (ret < 0)
+        return AVERROR(errno);
+    u->fd = ret;
+
+    /* IORING_OP_READ came with the same kernel as this feature */
+    if (!(p.features & IORING_FEAT_RW_CUR_POS)) {
+        uring_uninit(c);
+        return AVERROR(ENOSYS);
+    }
+
+    u->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    u->cq_ring_size = p.cq_off.cqes  + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        u->sq_ring_size = u->cq_ring_size = FFMAX(u->sq_ring_size, u->cq_ring_size);
+
+    u->sq_ring = mmap(NULL, u->sq_ring_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQ_RING);
+    if (u->sq_ring == MAP_FAILED) {
+        u->sq_ring = NULL;
+        goto fail;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        u->cq_ring = u->sq_ring;
+    } else {
+        u->cq_ring = mmap(NULL, u->cq_ring_size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_CQ_RING);
+        if (u->cq_ring == MAP_FAILED) {
+            u->cq_ring = NULL;
+            goto fail;
+        }
+    }
+    u->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    u->sqes = mmap(NULL, u->sqes_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES);
+    if (u->sqes == MAP_FAILED) {
+        u->sqes = NULL;
+        goto fail;
+    }
+
+    u->sq_head  = (unsigned *)((uint8_t *)u->sq_ring + p.sq_off.head);
+    u->sq_tail  = (unsigned *)((uint8_t *)u->sq_ring + p.sq_off.tail);
+    u->sq_mask  = (unsigned *)((uint8_t *)u->sq_ring + p.sq_off.ring_mask);
+    u->sq_array = (unsigned *)((uint8_t *)u->sq_ring + p.sq_off.array);
+    u->cq_head  = (unsigned *)((uint8_t *)u->cq_ring + p.cq_off.head);
+    u->cq_tail  = (unsigned *)((uint8_t *)u->cq_ring + p.cq_off.tail);
+    u->cq_mask  = (unsigned *)((uint8_t *)u->cq_ring + p.cq_off.ring_mask);
+    u->cqes     = (struct io_uring_cqe *)((uint8_t *)u->cq_ring + p.cq_off.cqes);
+
+    u->nb_blocks = c->uring_depth;
+    u->blocks    = av_calloc(u->nb_blocks, sizeof(*u->blocks));
+    if (!u->blocks) {
+        uring_uninit(c);
+        return AVERROR(ENOMEM);
+    }
+    for (int i = 0; i < u->nb_blocks; i++) {
+        u->blocks[i].data = av_malloc(c->uring_block_size);
+        if (!u->blocks[i].data) {
+            uring_uninit(c);
+            return AVERROR(ENOMEM);
+        }
+    }
+    /* no data is buffered until the first read */
+    u->start = INT64_MAX;
+
+    return 0;
+fail:
+    ret = AVERROR(errno);
+    uring_uninit(c);
+    return ret;
+}
+#endif /* FILE_IO_URING */
+
 static int file_read(URLContext *h, unsigned char *buf, int size)
 {
     FileContext *c = h->priv_data;
     int ret;
     size = FFMIN(size, c->blocksize);
+#if HAVE_MMAP
+    if (c->map) {
+        size = FFMIN(size, c->size - c->pos);
+        if (size <= 0)
+            return AVERROR_EOF;
+        memcpy(buf, c->map + c->pos, size);
+        c->pos += size;
+        return size;
+    }
+#endif
+#if FILE_IO_URING
+    if (c->uring.fd > 0) {
+        ret = uring_read(c, buf, size);
+        if (ret == 0)
+            return AVERROR_EOF;
+        if (ret > 0)
+            c->pos += ret;
+        return ret;
+    }
+#endif
     ret = read(c->fd, buf, size);
     if (ret == 0 && c->follow)
         return AVERROR(EAGAIN);
@@ -245,6 +579,54 @@ static int file_open(URLContext *h, const char *filename, int flags)
     if (c->seekable >= 0)
         h->is_streamed = !c->seekable;
 
+    if (c->read_mode != FILE_READ_READ) {
+        if (flags & AVIO_FLAG_WRITE || c->follow || h->is_streamed ||
+            fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+            av_log(h, AV_LOG_VERBOSE, "Read mode not supported for this file, "
+                   "using read()\n");
+            return 0;
+        }
+        c->size = st.st_size;
+        c->pos  = 0;
+    }
+
+    if (c->read_mode == FILE_READ_MMAP) {
+#if HAVE_MMAP
+        if (c->size > 0 && c->size <= SIZE_MAX) {
+            void *map = mmap(NULL, c->size, PROT_READ, MAP_SHARED, fd, 0);
+            if (map != MAP_FAILED)
+                c->map = map;
+        }
+        if (!c->map)
+            av_log(h, AV_LOG_VERBOSE, "Could not map the file, using read()\n");
+#else
+        av_log(h, AV_LOG_VERBOSE, "mmap is not supported, using read()\n");
+#endif
+    } else if (c->read_mode == FILE_READ_IO_URING) {
+#if FILE_IO_URING
+        int ret = uring_init(c);
+        if (ret < 0)
+            av_log(h, AV_LOG_VERBOSE, "Could not set up io_uring (%s), using read()\n",
+                   av_err2str(ret));
+#else
+        av_log(h, AV_LOG_VERBOSE, "io_uring is not supported, using read()\n");
+#endif
+    }
+
+    return 0;
+}
+
+/* whether the reads track the position in c->pos instead of the file offset */
+static int file_positioned(FileContext *c)
+{
+#if HAVE_MMAP
+    if (c->map)
+        return 1;
+#endif
+#if FILE_IO_URING
+    if (c->uring.fd > 0)
+        return 1;
+#endif
     return 0;
 }
 
@@ -260,15 +642,90 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
         return ret < 0 ? AVERROR(errno) : (S_ISFIFO(st.st_mode) ? 0 : st.st_size);
     }
 
+    if (file_positioned(c)) {
+        /* the reads do not use the file offset, track the position here */
+        if (whence == SEEK_CUR)
+            pos += c->pos;
+        else if (whence == SEEK_END)
+            pos += c->size;
+        else if (whence != SEEK_SET)
+            return AVERROR(EINVAL);
+        if (pos < 0)
+            return AVERROR(EINVAL);
+        return c->pos = pos;
+    }
+
     ret = lseek(c->fd, pos, whence);
 
     return ret < 0 ? AVERROR(errno) : ret;
 }
 
+#if HAVE_MMAP && HAVE_MADVISE && HAVE_SYSCONF
+/* the reads of the mmap mode come from the mapping, hint it directly */
+static int file_advise_map(FileContext *c, int64_t offset, int64_t len,
+                           enum URLAdvice advice)
+{
+    static const int madv[] = {
+        [URL_ADVISE_NORMAL]     = MADV_NORMAL,
+        [URL_ADVISE_SEQUENTIAL] = MADV_SEQUENTIAL,
+        [URL_ADVISE_WILLNEED]   = MADV_WILLNEED,
+    };
+    long page_size = sysconf(_SC_PAGESIZE);
+    int64_t start, end;
+
+    if (page_size <= 0)
+        return AVERROR(ENOSYS);
+    if (offset < 0 || len < 0)
+        return AVERROR(EINVAL);
+
+    end   = len && len <= c->size - offset ? offset + len : c->size;
+    start = FFMIN(offset, c->size) / page_size * page_size;
+    if (end <= start)
+        return 0;
+
+    if (madvise(c->map + start, end - start, madv[advice]) < 0)
+        return AVERROR(errno);
+    return 0;
+}
+#endif
+
+static int file_advise(URLContext *h, int64_t offset, int64_t len,
+                       enum URLAdvice advice)
+{
+    av_unused FileContext *c = h->priv_data;
+
+#if HAVE_MMAP && HAVE_MADVISE && HAVE_SYSCONF
+    if (c->map)
+        return file_advise_map(c, offset, len, advice);
+#endif
+#if HAVE_POSIX_FADVISE
+    {
+        static const int fadvise[] = {
+            [URL_ADVISE_NORMAL]     = POSIX_FADV_NORMAL,
+            [URL_ADVISE_SEQUENTIAL] = POSIX_FADV_SEQUENTIAL,
+            [URL_ADVISE_WILLNEED]   = POSIX_FADV_WILLNEED,
+        };
+        int ret = posix_fadvise(c->fd, offset, len, fadvise[advice]);
+        return ret ? AVERROR(ret) : 0;
+    }
+#else
+    return AVERROR(ENOSYS);
+#endif
+}
+
 static int file_close(URLContext *h)
 {
     FileContext *c = h->priv_data;
-    int ret = close(c->fd);
+    int ret;
+
+#if HAVE_MMAP
+    if (c->map)
+        munmap(c->map, c->size);
+#endif
+#if FILE_IO_URING
+    uring_uninit(c);
+#endif
+    ret = close(c->fd);
     return (ret == -1) ? AVERROR(errno) : 0;
 }
 
@@ -364,6 +821,7 @@ const URLProtocol ff_file_protocol = {
     .url_seek            = file_seek,
     .url_close           = file_close,
     .url_get_file_handle = file_get_handle,
+    .url_advise          = file_advise,
     .url_check           = file_check,
     .url_delete          = file_delete,
     .url_move            = file_move,
@@ -54,6 +54,7 @@
 #endif
 #include "hlsplaylist.h"
 #include "internal.h"
+#include "ioworker.h"
 #include "os_support.h"
 
 typedef enum {
@@ -257,6 +258,9 @@ typedef struct HLSContext {
     char *headers;
     int has_default_key; /* has DEFAULT field of var_stream_map */
     int has_video_m3u8; /* has video stream m3u8 list */
+    int async_io;
+    int async_io_queue_size;
+    FFIOWorker *io;
 } HLSContext;
 
 static int strftime_expand(const char *fmt, char **dest)
@@ -586,6 +590,118 @@ static int hls_delete_file(HLSContext *hls, AVFormatContext *avf,
     return 0;
 }
 
+/* Asynchronous output: completed segments and playlists are handed over to
+ * an I/O worker as in-memory buffers, together with the renames and
+ * deletions that depend on them, and processed in submission order. */
+
+enum HLSIOJobType {
+    HLS_IO_JOB_WRITE,
+    HLS_IO_JOB_RENAME,
+    HLS_IO_JOB_DELETE,
+};
+
+static int hls_io_run_job(AVFormatContext *s, void *opaque, AVIOContext **pb,
+                          FFIOJob *job)
+{
+    HLSContext *hls = s->priv_data;
+    AVDictionary *options = NULL;
+    int ret = 0;
+
+    switch (job->type) {
+    case HLS_IO_JOB_WRITE:
+        for (int i = 0; i < 2; i++) {
+            av_dict_copy(&options, job->options, 0);
+            set_http_options(s, &options, hls);
+            ret = hlsenc_io_open(s, pb, job->url, &options);
+            av_dict_free(&options);
+            if (ret < 0)
+                break;
+            avio_write(*pb, job->data, job->size);
+            if ((ret = hlsenc_io_close(s, pb, job->url)) >= 0)
+                break;
+            av_log(s, AV_LOG_WARNING, "upload of '%s' failed,"
+                   " will retry with a new http session.\n", job->url);
+            ff_format_io_close(s, pb);
+        }
+        if (ret < 0)
+            av_log(s, hls->ignore_io_errors ? AV_LOG_WARNING : AV_LOG_ERROR,
+                   "Failed to write '%s'\n", job->url);
+        break;
+    case HLS_IO_JOB_RENAME:
+        ret = ff_rename(job->url, job->new_url, s);
+        break;
+    case HLS_IO_JOB_DELETE:
+        ret = hls_delete_file(hls, job->avf, job->url, job->proto);
+        break;
+    }
+    return hls->ignore_io_errors ? 0 : ret;
+}
+
+
+/* The following helpers perform the operation right away, or queue it for
+ * the I/O worker when asynchronous output is enabled, in which case the
+ * output is buffered in memory between open and close. */
+static int hls_output_open(AVFormatContext *s, AVIOContext **pb, const char *filename,
+                           AVDictionary **options)
+{
+    HLSContext *hls = s->priv_data;
+
+    if (hls->io)
+        return avio_open_dyn_buf(pb);
+    return hlsenc_io_open(s, pb, filename, options);
+}
+
+static int hls_output_close(AVFormatContext *s, AVIOContext **pb, char *filename,
+                            AVDictionary *options)
+{
+    HLSContext *hls = s->priv_data;
+
+    if (hls->io) {
+        FFIOJob job = { .type = HLS_IO_JOB_WRITE };
+
+        if (!*pb)
+            return 0;
+        job.size = avio_close_dyn_buf(*pb, &job.data);
+        *pb = NULL;
+        job.url = av_strdup(filename);
+        if (!job.url || av_dict_copy(&job.options, options, 0) < 0) {
+            ff_io_job_free(&job);
+            return AVERROR(ENOMEM);
+        }
+        return ff_io_worker_submit(hls->io, &job);
+    }
+    return hlsenc_io_close(s, pb, filename);
+}
+
+static int hls_output_rename(HLSContext *hls, const char *oldpath, const char *newpath)
+{
+    if (hls->io) {
+        FFIOJob job = { .type = HLS_IO_JOB_RENAME };
+
+        job.url     = av_strdup(oldpath);
+        job.new_url = av_strdup(newpath);
+        if (!job.url || !job.new_url) {
+            ff_io_job_free(&job);
+            return AVERROR(ENOMEM);
+        }
+        return ff_io_worker_submit(hls->io, &job);
+    }
+    return ff_rename(oldpath, newpath, hls);
+}
+
+static int hls_output_delete(HLSContext *hls, AVFormatContext *avf,
+                             const char *path, const char *proto)
+{
+    if (hls->io) {
+        FFIOJob job = { .type = HLS_IO_JOB_DELETE, .avf = avf, .proto = proto };
+
+        if (!(job.url = av_strdup(path)))
+            return AVERROR(ENOMEM);
+        return ff_io_worker_submit(hls->io, &job);
+    }
+    return hls_delete_file(hls, avf, path, proto);
+}
+
 static int hls_delete_old_segments(AVFormatContext *s, HLSContext *hls,
                                    VariantStream *vs)
 {
@@ -663,7 +779,7 @@ static int hls_delete_old_segments(AVFormatContext *s, HLSContext *hls,
         }
 
         proto = avio_find_protocol_name(s->url);
-        if (ret = hls_delete_file(hls, vs->avf, path.str, proto))
+        if (ret = hls_output_delete(hls, vs->avf, path.str, proto))
             goto fail;
 
         if ((segment->sub_filename[0] != '\0')) {
@@ -680,7 +796,7 @@ static int hls_delete_old_segments(AVFormatContext *s, HLSContext *hls,
                 goto fail;
             }
 
-            if (ret = hls_delete_file(hls, vs->vtt_avf, path.str, proto))
+            if (ret = hls_output_delete(hls, vs->vtt_avf, path.str, proto))
                 goto fail;
         }
         av_bprint_clear(&path);
@@ -1055,7 +1171,7 @@ static int sls_flag_check_duration_size(HLSContext *hls, VariantStream *vs)
 static void sls_flag_file_rename(HLSContext *hls, VariantStream *vs, char *old_filename) {
     if ((hls->flags & (HLS_SECOND_LEVEL_SEGMENT_SIZE | HLS_SECOND_LEVEL_SEGMENT_DURATION)) &&
         strlen(vs->current_segment_final_filename_fmt)) {
-        ff_rename(old_filename, vs->avf->url, hls);
+        hls_output_rename(hls, old_filename, vs->avf->url);
     }
 }
 
@@ -1316,6 +1432,7 @@ static void hls_free_segments(HLSSegment *p)
 
 static int hls_rename_temp_file(AVFormatContext *s, AVFormatContext *oc)
 {
+    HLSContext *hls = s->priv_data;
     size_t len = strlen(oc->url);
     char *final_filename = av_strdup(oc->url);
     int ret;
@@ -1323,7 +1440,7 @@ static int hls_rename_temp_file(AVFormatContext *s, AVFormatContext *oc)
     if (!final_filename)
         return AVERROR(ENOMEM);
     final_filename[len-4] = '\0';
-    ret = ff_rename(oc->url, final_filename, s);
+    ret = hls_output_rename(hls, oc->url, final_filename);
     oc->url[len-4] = '\0';
     av_freep(&final_filename);
     return ret;
@@ -1399,7 +1516,7 @@ static int create_master_playlist(AVFormatContext *s,
 
     set_http_options(s, &options, hls);
     snprintf(temp_filename, sizeof(temp_filename), use_temp_file ? "%s.tmp" : "%s", hls->master_m3u8_url);
-    ret = hlsenc_io_open(s, &hls->m3u8_out, temp_filename, &options);
+    ret = hls_output_open(s, &hls->m3u8_out, temp_filename, &options);
     av_dict_free(&options);
     if (ret < 0) {
         av_log(s, AV_LOG_ERROR, "Failed to open master play list file '%s'\n",
@@ -1524,9 +1641,9 @@ static int create_master_playlist(AVFormatContext *s,
 fail:
     if (ret >=0)
         hls->master_m3u8_created = 1;
-    hlsenc_io_close(s, &hls->m3u8_out, temp_filename);
+    hls_output_close(s, &hls->m3u8_out, temp_filename, NULL);
     if (use_temp_file)
-        ff_rename(temp_filename, hls->master_m3u8_url, s);
+        hls_output_rename(hls, temp_filename, hls->master_m3u8_url);
 
     return ret;
 }
@@ -1538,7 +1655,7 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
     int target_duration = 0;
     int ret = 0;
     char temp_filename[MAX_URL_SIZE];
-    char temp_vtt_filename[MAX_URL_SIZE];
+    char temp_vtt_filename[MAX_URL_SIZE] = "";
     int64_t sequence = FFMAX(hls->start_sequence, vs->sequence - vs->nb_entries);
     const char *proto = avio_find_protocol_name(vs->m3u8_name);
     int is_file_proto = proto && !strcmp(proto, "file");
@@ -1574,7 +1691,7 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
 
     set_http_options(s, &options, hls);
     snprintf(temp_filename, sizeof(temp_filename), use_temp_file ? "%s.tmp" : "%s", vs->m3u8_name);
-    if ((ret = hlsenc_io_open(s, byterange_mode ? &hls->m3u8_out : &vs->out, temp_filename, &options)) < 0) {
+    if ((ret = hls_output_open(s, byterange_mode ? &hls->m3u8_out : &vs->out, temp_filename, &options)) < 0) {
         if (hls->ignore_io_errors)
             ret = 0;
         goto fail;
@@ -1630,7 +1747,7 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
 
     if (vs->vtt_m3u8_name) {
         snprintf(temp_vtt_filename, sizeof(temp_vtt_filename), use_temp_file ? "%s.tmp" : "%s", vs->vtt_m3u8_name);
-        if ((ret = hlsenc_io_open(s, &hls->sub_m3u8_out, temp_vtt_filename, &options)) < 0) {
+        if ((ret = hls_output_open(s, &hls->sub_m3u8_out, temp_vtt_filename, &options)) < 0) {
             if (hls->ignore_io_errors)
                 ret = 0;
             goto fail;
@@ -1653,15 +1770,15 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
 
 fail:
     av_dict_free(&options);
-    ret = hlsenc_io_close(s, byterange_mode ? &hls->m3u8_out : &vs->out, temp_filename);
+    ret = hls_output_close(s, byterange_mode ? &hls->m3u8_out : &vs->out, temp_filename, NULL);
     if (ret < 0) {
         return ret;
     }
-    hlsenc_io_close(s, &hls->sub_m3u8_out, vs->vtt_m3u8_name);
+    hls_output_close(s, &hls->sub_m3u8_out, temp_vtt_filename, NULL);
     if (use_temp_file) {
-        ff_rename(temp_filename, vs->m3u8_name, s);
+        hls_output_rename(hls, temp_filename, vs->m3u8_name);
         if (vs->vtt_m3u8_name)
-            ff_rename(temp_vtt_filename, vs->vtt_m3u8_name, s);
+            hls_output_rename(hls, temp_vtt_filename, vs->vtt_m3u8_name);
     }
     if (ret >= 0 && hls->master_pl_name)
         if (create_master_playlist(s, vs) < 0)
@@ -2356,11 +2473,14 @@ static int hls_init_file_resend(AVFormatContext *s, VariantStream *vs)
     int ret = 0;
 
     set_http_options(s, &options, hls);
-    ret = hlsenc_io_open(s, &vs->out, vs->base_output_dirname, &options);
+    ret = hls_output_open(s, &vs->out, vs->base_output_dirname, &options);
     av_dict_free(&options);
     if (ret < 0)
         return ret;
     avio_write(vs->out, vs->init_buffer, vs->init_range_length);
+    /* the I/O worker writes the data to the URL it is given */
+    if (hls->io)
+        return hls_output_close(s, &vs->out, vs->base_output_dirname, NULL);
     hlsenc_io_close(s, &vs->out, hls->fmp4_init_filename);
 
     return ret;
@@ -2557,7 +2677,7 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
 
                 set_http_options(s, &options, hls);
 
-                ret = hlsenc_io_open(s, &vs->out, filename, &options);
+                ret = hls_output_open(s, &vs->out, filename, &options);
                 if (ret < 0) {
                     av_log(s, hls->ignore_io_errors ? AV_LOG_WARNING : AV_LOG_ERROR,
                            "Failed to open file '%s'\n", filename);
@@ -2574,8 +2694,14 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
                     av_dict_free(&options);
                     return ret;
                 }
-                ret = hlsenc_io_close(s, &vs->out, filename);
-                if (ret < 0) {
+                ret = hls_output_close(s, &vs->out, filename, options);
+                if (ret < 0 && hls->io) {
+                    /* the I/O thread already retried */
+                    av_dict_free(&options);
+                    av_freep(&vs->temp_buffer);
+                    av_freep(&filename);
+                    return ret;
+                } else if (ret < 0) {
                     av_log(s, AV_LOG_WARNING, "upload segment failed,"
                            " will retry with a new http session.\n");
                     ff_format_io_close(s, &vs->out);
@@ -2678,6 +2804,8 @@ static void hls_deinit(AVFormatContext *s)
     int i = 0;
     VariantStream *vs = NULL;
 
+    ff_io_worker_stop(&hls->io);
+
     for (i = 0; i < hls->nb_varstreams; i++) {
         vs = &hls->var_streams[i];
 
@@ -2714,11 +2842,16 @@ static int hls_write_trailer(struct AVFormatContext *s)
     const char *proto = NULL;
     int use_temp_file = 0;
     int i;
-    int ret = 0;
+    int ret = 0, io_ret = 0;
     VariantStream *vs = NULL;
     AVDictionary *options = NULL;
     int range_length, byterange_mode;
 
+    /* finish the pending output, the last segments are written directly;
+     * errors are only reported without ignore_io_errors */
+    if ((io_ret = ff_io_worker_stop(&hls->io)) < 0)
+        av_log(s, AV_LOG_ERROR, "Asynchronous output failed: %s\n", av_err2str(io_ret));
+
     for (i = 0; i < hls->nb_varstreams; i++) {
         char *filename = NULL;
         vs = &hls->var_streams[i];
@@ -2840,7 +2973,7 @@ failed:
         av_free(old_filename);
     }
 
-    return 0;
+    return io_ret;
 }
 
 
@@ -3092,6 +3225,16 @@ static int hls_init(AVFormatContext *s)
         vs->number++;
     }
 
+    if (hls->async_io) {
+#if HAVE_THREADS
+        if ((ret = ff_io_worker_start(&hls->io, s, NULL, hls->async_io_queue_size,
+                                      hls_io_run_job)) < 0)
+            return ret;
+#else
+        av_log(s, AV_LOG_WARNING, "Asynchronous output requires threads, writing synchronously\n");
+#endif
+    }
+
     return ret;
 }
 
@@ -3159,6 +3302,8 @@ static const AVOption options[] = {
     {"timeout", "set timeout for socket I/O operations", OFFSET(timeout), AV_OPT_TYPE_DURATION, { .i64 = -1 }, -1, INT_MAX, .flags = E },
     {"ignore_io_errors", "Ignore IO errors for stable long-duration runs with network output", OFFSET(ignore_io_errors), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, E },
     {"headers", "set custom HTTP headers, can override built in default headers", OFFSET(headers), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, E },
+    {"async_io", "write segments and playlists from a background thread", OFFSET(async_io), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, E },
+    {"async_io_queue_size", "maximum number of pending asynchronous output operations", OFFSET(async_io_queue_size), AV_OPT_TYPE_INT, { .i64 = 16 }, 1, 1024, E },
     { NULL },
 };
 
@@ -32,6 +32,7 @@
 #include "libavutil/opt.h"
 #include "libavutil/time.h"
 #include "libavutil/parseutils.h"
+#include "libavutil/thread.h"
 
 #include "avformat.h"
 #include "http.h"
@@ -79,6 +80,8 @@ typedef struct HTTPContext {
     char *headers;
     char *mime_type;
     char *http_version;
+    char *etag;
+    char *last_modified;
     char *user_agent;
     char *referer;
     char *content_type;
@@ -134,6 +137,9 @@ typedef struct HTTPContext {
     char *new_location;
     AVDictionary *redirect_cache;
     uint64_t filesize_from_content_range;
+    int parallel_requests;
+    int request_size;
+    struct HTTPParallel *parallel;
 } HTTPContext;
 
 #define OFFSET(x) offsetof(HTTPContext, x)
@@ -153,6 +159,8 @@ static const AVOption options[] = {
     { "post_data", "set custom HTTP post data", OFFSET(post_data), AV_OPT_TYPE_BINARY, .flags = D | E },
     { "mime_type", "export the MIME type", OFFSET(mime_type), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
     { "http_version", "export the http response version", OFFSET(http_version), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
+    { "etag", "export the ETag of the resource", OFFSET(etag), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
+    { "last_modified", "export the Last-Modified date of the resource", OFFSET(last_modified), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
     { "cookies", "set cookies to be sent in applicable future requests, use newline delimited Set-Cookie HTTP field value syntax", OFFSET(cookies), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, D },
     { "icy", "request ICY metadata", OFFSET(icy), AV_OPT_TYPE_BOOL, { .i64 = 1 }, 0, 1, D },
     { "icy_metadata_headers", "return ICY metadata headers", OFFSET(icy_metadata_headers), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, AV_OPT_FLAG_EXPORT },
@@ -176,6 +184,8 @@ static const AVOption options[] = {
     { "resource", "The resource requested by a client", OFFSET(resource), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, E },
     { "reply_code", "The http status code to return to a client", OFFSET(reply_code), AV_OPT_TYPE_INT, { .i64 = 200}, INT_MIN, 599, E},
     { "short_seek_size", "Threshold to favor readahead over seek.", OFFSET(short_seek_size), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX, D },
+    { "parallel_requests", "number of concurrent range requests used to read the resource", OFFSET(parallel_requests), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 16, D },
+    { "request_size", "size in bytes of each parallel range request", OFFSET(request_size), AV_OPT_TYPE_INT, { .i64 = 4 * 1024 * 1024 }, 4096, INT_MAX, D },
     { NULL }
 };
 
@@ -184,6 +194,9 @@ static int http_connect(URLContext *h, const char *path, const char *local_path,
                         const char *proxyauth);
 static int http_read_header(URLContext *h);
 static int http_shutdown(URLContext *h, int flags);
+#if HAVE_THREADS
+static void parallel_close(HTTPContext *s);
+#endif
 
 void ff_http_init_auth_state(URLContext *dest, const URLContext *src)
 {
@@ -494,6 +507,11 @@ int ff_http_do_new_request2(URLContext *h, const char *uri, AVDictionary **opts)
             return ret;
     }
 
+#if HAVE_THREADS
+    /* the new resource is read on the main connection */
+    parallel_close(s);
+#endif
+
     if (s->willclose)
         return AVERROR_EOF;
 
@@ -686,6 +704,308 @@ fail:
     return ret;
 }
 
+#if HAVE_THREADS
+/* Parallel range requests: the resource is split into request_size chunks
+ * which are fetched by parallel_requests worker threads, each on its own
+ * persistent connection, into a window of slots read in order by
+ * http_read(). */
+
+typedef struct HTTPRangeChunk {
+    int64_t  index;                 ///< chunk held by the slot, -1 if free
+    uint8_t *data;
+    int      size;                  ///< chunk size or AVERROR, valid if done
+    int      done;
+} HTTPRangeChunk;
+
+typedef struct HTTPRangeWorker {
+    URLContext *h;
+    URLContext *conn;
+    uint8_t    *buf;
+    pthread_t   thread;
+} HTTPRangeWorker;
+
+typedef struct HTTPParallel {
+    pthread_mutex_t  mutex;
+    pthread_cond_t   cond;
+    HTTPRangeWorker *workers;
+    int              nb_workers;
+    HTTPRangeChunk  *chunks;
+    int              nb_chunks;
+    int64_t          nb_total_chunks;
+    int64_t          read_chunk;    ///< chunk http_read() is currently reading
+    int64_t          next_chunk;    ///< next chunk to hand out to a worker
+    unsigned         generation;    ///< bumped whenever the window is reset
+    int              abort;
+    AVIOInterruptCB  interrupt_callback;
+} HTTPParallel;
+
+static int parallel_check_interrupt(void *arg)
+{
+    URLContext  *h = arg;
+    HTTPContext *s = h->priv_data;
+    return s->parallel->abort || ff_check_interrupt(&h->interrupt_callback);
+}
+
+static int parallel_connect(URLContext *h, URLContext **conn,
+                            uint64_t start, uint64_t end)
+{
+    HTTPContext *s = h->priv_data;
+    AVDictionary *opts = NULL;
+    int ret;
+
+    av_dict_copy(&opts, s->chained_options, 0);
+    av_dict_set(&opts, "headers",    s->headers,    0);
+    av_dict_set(&opts, "user_agent", s->user_agent, 0);
+    av_dict_set(&opts, "referer",    s->referer,    0);
+    av_dict_set(&opts, "cookies",    s->cookies,    0);
+    av_dict_set(&opts, "http_proxy", s->http_proxy, 0);
+    av_dict_set_int(&opts, "seekable",          1,     0);
+    av_dict_set_int(&opts, "multiple_requests", 1,     0);
+    av_dict_set_int(&opts, "icy",               0,     0);
+    av_dict_set_int(&opts, "offset",            start, 0);
+    av_dict_set_int(&opts, "end_offset",        end,   0);
+
+    ret = ffurl_open_whitelist(conn, s->location, AVIO_FLAG_READ,
+                               &s->parallel->interrupt_callback, &opts,
+                               h->protocol_whitelist, h->protocol_blacklist, h);
+    av_dict_free(&opts);
+    return ret;
+}
+
+/* Issue a new range request on an idle persistent connection. */
+static int parallel_request(URLContext *conn, uint64_t start, uint64_t end)
+{
+    HTTPContext *cs = conn->priv_data;
+    AVDictionary *options = NULL;
+    int ret;
+
+    if (!cs->hd || cs->willclose)
+        return AVERROR_EOF;
+
+    cs->chunkend      = 0;
+    cs->off           = start;
+    cs->end_off       = end;
+    cs->icy_data_read = 0;
+    ret = http_open_cnx(conn, &options);
+    av_dict_free(&options);
+    return ret;
+}
+
+static int parallel_fetch(HTTPRangeWorker *w, int64_t index)
+{
+    URLContext  *h = w->h;
+    HTTPContext *s = h->priv_data, *cs;
+    uint64_t start = index * s->request_size;
+    int len = FFMIN(s->request_size, s->filesize - start);
+    int ret, pos = 0;
+
+    if (!w->conn || parallel_request(w->conn, start, start + len) < 0) {
+        ffurl_closep(&w->conn);
+        if ((ret = parallel_connect(h, &w->conn, start, start + len)) < 0)
+            return ret;
+    }
+
+    cs = w->conn->priv_data;
+    if (cs->off != start || (cs->http_code != 206 && len != s->filesize)) {
+        av_log(h, AV_LOG_ERROR, "Server did not honour the range request "
+               "for bytes %"PRIu64"-%"PRIu64"\n", start, start + len - 1);
+        ffurl_closep(&w->conn);
+        return AVERROR(EIO);
+    }
+
+    while (pos < len) {
+        ret = ffurl_read(w->conn, w->buf + pos, len - pos);
+        if (ret <= 0) {
+            ffurl_closep(&w->conn);
+            return ret < 0 && ret != AVERROR_EOF ? ret : AVERROR(EIO);
+        }
+        pos += ret;
+    }
+    return len;
+}
+
+static void *parallel_worker(void *arg)
+{
+    HTTPRangeWorker *w = arg;
+    HTTPContext     *s = w->h->priv_data;
+    HTTPParallel    *p = s->parallel;
+
+    pthread_mutex_lock(&p->mutex);
+    while (!p->abort) {
+        HTTPRangeChunk *c;
+        unsigned generation;
+        int64_t index;
+        int ret;
+
+        if (p->next_chunk >= p->nb_total_chunks ||
+            p->next_chunk >= p->read_chunk + p->nb_chunks) {
+            pthread_cond_wait(&p->cond, &p->mutex);
+            continue;
+        }
+        index      = p->next_chunk++;
+        generation = p->generation;
+        pthread_mutex_unlock(&p->mutex);
+
+        ret = parallel_fetch(w, index);
+
+        pthread_mutex_lock(&p->mutex);
+        /* drop results made stale by a seek while the request was running */
+        if (generation != p->generation || index < p->read_chunk)
+            continue;
+        c = &p->chunks[index % p->nb_chunks];
+        FFSWAP(uint8_t *, c->data, w->buf);
+        c->index = index;
+        c->size  = ret;
+        c->done  = 1;
+        pthread_cond_broadcast(&p->cond);
+    }
+    pthread_mutex_unlock(&p->mutex);
+
+    return NULL;
+}
+
+static void parallel_close(HTTPContext *s)
+{
+    HTTPParallel *p = s->parallel;
+    int i;
+
+    if (!p)
+        return;
+
+    pthread_mutex_lock(&p->mutex);
+    p->abort = 1;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->mutex);
+
+    for (i = 0; i < p->nb_workers; i++) {
+        pthread_join(p->workers[i].thread, NULL);
+        ffurl_closep(&p->workers[i].conn);
+        av_freep(&p->workers[i].buf);
+    }
+    for (i = 0; i < p->nb_chunks; i++)
+        av_freep(&p->chunks[i].data);
+    av_freep(&p->workers);
+    av_freep(&p->chunks);
+    pthread_cond_destroy(&p->cond);
+    pthread_mutex_destroy(&p->mutex);
+    av_freep(&s->parallel);
+}
+
+static int parallel_open(URLContext *h)
+{
+    HTTPContext  *s = h->priv_data;
+    HTTPParallel *p;
+    int i, n = s->parallel_requests, ret;
+
+    if (!(p = av_mallocz(sizeof(*p))))
+        return AVERROR(ENOMEM);
+    if ((ret = pthread_mutex_init(&p->mutex, NULL))) {
+        av_free(p);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&p->cond, NULL))) {
+        pthread_mutex_destroy(&p->mutex);
+        av_free(p);
+        return AVERROR(ret);
+    }
+    s->parallel = p;
+
+    p->nb_total_chunks = (s->filesize + s->request_size - 1) / s->request_size;
+    p->interrupt_callback.callback = parallel_check_interrupt;
+    p->interrupt_callback.opaque   = h;
+
+    /* Two slots per worker, so that every worker can fetch ahead while the
+     * reader is still consuming the previous round. */
+    p->chunks  = av_calloc(2 * n, sizeof(*p->chunks));
+    p->workers = av_calloc(n, sizeof(*p->workers));
+    if (!p->chunks || !p->workers)
+        goto nomem;
+    for (; p->nb_chunks < 2 * n; p->nb_chunks++) {
+        p->chunks[p->nb_chunks].index = -1;
+        if (!(p->chunks[p->nb_chunks].data = av_malloc(s->request_size)))
+            goto nomem;
+    }
+    for (i = 0; i < n; i++) {
+        p->workers[i].h = h;
+        if (!(p->workers[i].buf = av_malloc(s->request_size)))
+            goto nomem;
+    }
+    for (; p->nb_workers < n; p->nb_workers++) {
+        ret = pthread_create(&p->workers[p->nb_workers].thread, NULL,
+                             parallel_worker, &p->workers[p->nb_workers]);
+        if (ret) {
+            av_log(h, AV_LOG_ERROR, "pthread_create failed: %s\n", av_err2str(AVERROR(ret)));
+            parallel_close(s);
+            return AVERROR(ret);
+        }
+    }
+
+    av_log(h, AV_LOG_VERBOSE, "Reading with %d parallel range requests of %d bytes\n",
+           n, s->request_size);
+
+    /* the workers use their own connections from now on */
+    ffurl_closep(&s->hd);
+    return 0;
+nomem:
+    parallel_close(s);
+    return AVERROR(ENOMEM);
+}
+
+static int parallel_read(URLContext *h, uint8_t *buf, int size)
+{
+    HTTPContext  *s = h->priv_data;
+    HTTPParallel *p = s->parallel;
+    int64_t index = s->off / s->request_size;
+    int offset    = s->off % s->request_size;
+    HTTPRangeChunk *c;
+    int ret;
+
+    if (s->off >= s->filesize)
+        return AVERROR_EOF;
+
+    pthread_mutex_lock(&p->mutex);
+    if (index < p->read_chunk || index >= p->read_chunk + p->nb_chunks) {
+        /* outside of the window, drop everything and restart from here */
+        for (int i = 0; i < p->nb_chunks; i++) {
+            p->chunks[i].index = -1;
+            p->chunks[i].done  = 0;
+        }
+        p->generation++;
+        p->read_chunk = p->next_chunk = index;
+    } else {
+        for (; p->read_chunk < index; p->read_chunk++) {
+            c = &p->chunks[p->read_chunk % p->nb_chunks];
+            c->index = -1;
+            c->done  = 0;
+        }
+        p->next_chunk = FFMAX(p->next_chunk, index);
+    }
+    pthread_cond_broadcast(&p->cond);
+
+    c = &p->chunks[index % p->nb_chunks];
+    while (!c->done || c->index != index)
+        pthread_cond_wait(&p->cond, &p->mutex);
+
+    if (c->size < 0) {
+        ret = c->size;
+        /* let the next read retry the chunk */
+        c->done = 0;
+        c->index = -1;
+        p->generation++;
+        p->next_chunk = index;
+    } else if (offset >= c->size) {
+        ret = AVERROR(EIO);
+    } else {
+        ret = FFMIN(size, c->size - offset);
+        memcpy(buf, c->data + offset, ret);
+        s->off += ret;
+    }
+    pthread_mutex_unlock(&p->mutex);
+
+    return ret;
+}
+#endif /* HAVE_THREADS */
+
 static int http_open(URLContext *h, const char *uri, int flags,
                      AVDictionary **options)
 {
@@ -728,6 +1048,17 @@ static int http_open(URLContext *h, const char *uri, int flags,
         return http_listen(h, uri, flags, options);
     }
     ret = http_open_cnx(h, options);
+#if HAVE_THREADS
+    if (ret >= 0 && s->parallel_requests > 1 && !(flags & AVIO_FLAG_WRITE) &&
+        !h->is_streamed && s->filesize != UINT64_MAX && s->filesize > 0 &&
+#if CONFIG_ZLIB
+        !s->compressed &&
+#endif
+        !s->icy_metaint && s->off == 0) {
+        if (parallel_open(h) < 0)
+            av_log(h, AV_LOG_WARNING, "Failed to start parallel range requests\n");
+    }
+#endif
 bail_out:
     if (ret < 0) {
         av_dict_free(&s->chained_options);
@@ -1214,6 +1545,12 @@ static int process_line(URLContext *h, char *line, int line_count)
         } else if (!av_strcasecmp(tag, "Content-Type")) {
             av_free(s->mime_type);
             s->mime_type = av_strdup(p);
+        } else if (!av_strcasecmp(tag, "ETag")) {
+            av_free(s->etag);
+            s->etag = av_strdup(p);
+        } else if (!av_strcasecmp(tag, "Last-Modified")) {
+            av_free(s->last_modified);
+            s->last_modified = av_strdup(p);
         } else if (!av_strcasecmp(tag, "Set-Cookie")) {
             if (parse_cookie(s, p, &s->cookie_dict))
                 av_log(h, AV_LOG_WARNING, "Unable to parse '%s'\n", p);
@@ -1811,6 +2148,11 @@ static int http_read(URLContext *h, uint8_t *buf, int size)
 {
     HTTPContext *s = h->priv_data;
 
+#if HAVE_THREADS
+    if (s->parallel)
+        return parallel_read(h, buf, size);
+#endif
+
     if (s->icy_metaint > 0) {
         size = store_icy(h, size);
         if (size < 0)
@@ -1889,6 +2231,10 @@ static int http_close(URLContext *h)
     av_freep(&s->inflate_buffer);
 #endif /* CONFIG_ZLIB */
 
+#if HAVE_THREADS
+    parallel_close(s);
+#endif
+
     if (s->hd && !s->end_chunked_post)
         /* Close the write direction by sending the end of chunked encoding. */
         ret = http_shutdown(h, h->flags);
@@ -1931,6 +2277,10 @@ static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int fo
         return AVERROR(EINVAL);
     s->off = off;
 
+    /* the parallel reader picks up the new position on the next read */
+    if (s->parallel)
+        return off;
+
     if (s->off && h->is_streamed)
         return AVERROR(ENOSYS);
 
@@ -1987,6 +2337,8 @@ static int http_get_short_seek(URLContext *h)
     HTTPContext *s = h->priv_data;
     if (s->short_seek_size >= 1)
         return s->short_seek_size;
+    if (s->parallel)
+        return s->request_size;
     return ffurl_get_short_seek(s->hd);
 }
 
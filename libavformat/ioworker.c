@@ -0,0 +1,211 @@
+/*
+ * Background thread for muxer output operations
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include "libavutil/error.h"
+#include "libavutil/fifo.h"
+#include "libavutil/mem.h"
+#include "libavutil/thread.h"
+
+#include "internal.h"
+#include "ioworker.h"
+
+void ff_io_job_free(FFIOJob *job)
+{
+    av_freep(&job->url);
+    av_freep(&job->new_url);
+    av_freep(&job->data);
+    av_dict_free(&job->options);
+}
+
+#if HAVE_THREADS
+struct FFIOWorker {
+    AVFormatContext *s;
+    void *opaque;
+    int (*run_job)(AVFormatContext *s, void *opaque, AVIOContext **pb, FFIOJob *job);
+    AVIOContext *pb;        ///< output kept open by the thread
+    AVFifo *jobs;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int busy;
+    int abort;
+    int error;              ///< first error met by the thread
+};
+
+static void *io_worker_thread(void *arg)
+{
+    FFIOWorker *w = arg;
+    FFIOJob job;
+    int ret;
+
+    pthread_mutex_lock(&w->mutex);
+    for (;;) {
+        if (av_fifo_read(w->jobs, &job, 1) >= 0) {
+            w->busy = 1;
+            pthread_cond_broadcast(&w->cond);
+            pthread_mutex_unlock(&w->mutex);
+
+            ret = w->run_job(w->s, w->opaque, &w->pb, &job);
+            ff_io_job_free(&job);
+
+            pthread_mutex_lock(&w->mutex);
+            w->busy = 0;
+            if (ret < 0 && !w->error)
+                w->error = ret;
+            pthread_cond_broadcast(&w->cond);
+        } else if (w->abort) {
+            break;
+        } else {
+            pthread_cond_wait(&w->cond, &w->mutex);
+        }
+    }
+    pthread_mutex_unlock(&w->mutex);
+
+    ff_format_io_close(w->s, &w->pb);
+    return NULL;
+}
+
+int ff_io_worker_start(FFIOWorker **pw, AVFormatContext *s, void *opaque,
+                       int queue_size,
+                       int (*run_job)(AVFormatContext *s, void *opaque,
+                                      AVIOContext **pb, FFIOJob *job))
+{
+    FFIOWorker *w;
+    int ret;
+
+    w = av_mallocz(sizeof(*w));
+    if (!w)
+        return AVERROR(ENOMEM);
+    w->s       = s;
+    w->opaque  = opaque;
+    w->run_job = run_job;
+    w->jobs    = av_fifo_alloc2(queue_size, sizeof(FFIOJob), 0);
+    if (!w->jobs) {
+        av_free(w);
+        return AVERROR(ENOMEM);
+    }
+    if ((ret = pthread_mutex_init(&w->mutex, NULL))) {
+        av_fifo_freep2(&w->jobs);
+        av_free(w);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&w->cond, NULL))) {
+        pthread_mutex_destroy(&w->mutex);
+        av_fifo_freep2(&w->jobs);
+        av_free(w);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_create(&w->thread, NULL, io_worker_thread, w))) {
+        pthread_cond_destroy(&w->cond);
+        pthread_mutex_destroy(&w->mutex);
+        av_fifo_freep2(&w->jobs);
+        av_free(w);
+        return AVERROR(ret);
+    }
+    *pw = w;
+
+    return 0;
+}
+
+int ff_io_worker_submit(FFIOWorker *w, FFIOJob *job)
+{
+    int ret;
+
+    pthread_mutex_lock(&w->mutex);
+    while (!av_fifo_can_write(w->jobs) && !w->error)
+        pthread_cond_wait(&w->cond, &w->mutex);
+    ret = w->error;
+    if (!ret) {
+        av_fifo_write(w->jobs, job, 1);
+        pthread_cond_broadcast(&w->cond);
+    }
+    pthread_mutex_unlock(&w->mutex);
+
+    if (ret < 0)
+        ff_io_job_free(job);
+    return ret;
+}
+
+int ff_io_worker_wait(FFIOWorker *w)
+{
+    int ret;
+
+    pthread_mutex_lock(&w->mutex);
+    while (av_fifo_can_read(w->jobs) || w->busy)
+        pthread_cond_wait(&w->cond, &w->mutex);
+    ret = w->error;
+    pthread_mutex_unlock(&w->mutex);
+
+    return ret;
+}
+
+int ff_io_worker_stop(FFIOWorker **pw)
+{
+    FFIOWorker *w = *pw;
+    FFIOJob job;
+    int ret;
+
+    if (!w)
+        return 0;
+
+    pthread_mutex_lock(&w->mutex);
+    w->abort = 1;
+    pthread_cond_broadcast(&w->cond);
+    pthread_mutex_unlock(&w->mutex);
+    pthread_join(w->thread, NULL);
+
+    while (av_fifo_read(w->jobs, &job, 1) >= 0)
+        ff_io_job_free(&job);
+    ret = w->error;
+
+    pthread_cond_destroy(&w->cond);
+    pthread_mutex_destroy(&w->mutex);
+    av_fifo_freep2(&w->jobs);
+    av_freep(pw);
+
+    return ret;
+}
+#else
+int ff_io_worker_start(FFIOWorker **pw, AVFormatContext *s, void *opaque,
+                       int queue_size,
+                       int (*run_job)(AVFormatContext *s, void *opaque,
+                                      AVIOContext **pb, FFIOJob *job))
+{
+    return AVERROR(ENOSYS);
+}
+
+int ff_io_worker_submit(FFIOWorker *w, FFIOJob *job)
+{
+    ff_io_job_free(job);
+    return AVERROR(ENOSYS);
+}
+
+int ff_io_worker_wait(FFIOWorker *w)
+{
+    return 0;
+}
+
+int ff_io_worker_stop(FFIOWorker **pw)
+{
+    return 0;
+}
+#endif /* HAVE_THREADS */
@@ -0,0 +1,89 @@
+/*
+ * Background thread for muxer output operations
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_IOWORKER_H
+#define AVFORMAT_IOWORKER_H
+
+#include <stdint.h>
+
+#include "libavutil/dict.h"
+#include "avformat.h"
+
+/**
+ * An output operation, interpreted by the run_job callback of the worker.
+ * All the pointers except avf and proto are owned by the job.
+ */
+typedef struct FFIOJob {
+    int type;               ///< operation, defined by the muxer
+    char *url;
+    char *new_url;          ///< rename target
+    uint8_t *data;
+    int size;
+    AVDictionary *options;
+    AVFormatContext *avf;   ///< context to run the operation with, if not the muxer's
+    const char *proto;
+} FFIOJob;
+
+typedef struct FFIOWorker FFIOWorker;
+
+/**
+ * Free the contents of a job.
+ */
+void ff_io_job_free(FFIOJob *job);
+
+/**
+ * Start a thread running the submitted jobs in submission order.
+ *
+ * @param s          muxer the jobs are run for
+ * @param opaque     passed to run_job
+ * @param queue_size maximum number of jobs waiting to be run
+ * @param run_job    called from the thread for every job; pb is an output
+ *                   the thread keeps open between jobs and closes when it
+ *                   exits. The first error returned is kept and makes the
+ *                   following submissions fail.
+ */
+int ff_io_worker_start(FFIOWorker **pw, AVFormatContext *s, void *opaque,
+                       int queue_size,
+                       int (*run_job)(AVFormatContext *s, void *opaque,
+                                      AVIOContext **pb, FFIOJob *job));
+
+/**
+ * Queue a job, blocking while the queue is full. Takes ownership of the
+ * job contents, which are freed on failure.
+ *
+ * @return 0 or the first error met by the worker
+ */
+int ff_io_worker_submit(FFIOWorker *w, FFIOJob *job);
+
+/**
+ * Wait until all the submitted jobs have been run.
+ *
+ * @return 0 or the first error met by the worker
+ */
+int ff_io_worker_wait(FFIOWorker *w);
+
+/**
+ * Run the pending jobs, stop the thread and free the worker.
+ *
+ * @return 0 or the first error met by the worker
+ */
+int ff_io_worker_stop(FFIOWorker **pw);
+
+#endif /* AVFORMAT_IOWORKER_H */
@@ -160,6 +160,28 @@ typedef struct MOVIndexRange {
     int64_t end;
 } MOVIndexRange;
 
+/**
+ * Position reached while expanding the sample tables into the AVIndex, so
+ * that building it can be resumed on demand.
+ */
+typedef struct MOVIndexCursor {
+    unsigned int chunk;         ///< chunk holding the next sample to index
+    unsigned int chunk_sample;  ///< position of that sample inside its chunk
+    unsigned int sample;        ///< next sample number
+    unsigned int nb_samples;    ///< number of samples the complete index holds
+    unsigned int stts_index;
+    unsigned int stts_sample;
+    unsigned int stsc_index;
+    unsigned int stss_index;
+    unsigned int stps_index;
+    unsigned int rap_group_index;
+    unsigned int rap_group_sample;
+    unsigned int distance;
+    int64_t offset;
+    int64_t dts;
+    uint64_t stream_size;
+} MOVIndexCursor;
+
 typedef struct MOVStreamContext {
     AVIOContext *pb;
     int pb_is_copied;
@@ -198,6 +220,8 @@ typedef struct MOVStreamContext {
     int64_t current_index;
     MOVIndexRange* index_ranges;
     MOVIndexRange* current_index_range;
+    int lazy_index;       ///< sample tables are kept and the index is extended on demand
+    MOVIndexCursor index_cursor;
     unsigned int bytes_per_frame;
     unsigned int samples_per_frame;
     int dv_audio_container;
@@ -283,6 +307,7 @@ typedef struct MOVContext {
     int use_absolute_path;
     int ignore_editlist;
     int advanced_editlist;
+    int lazy_index;
     int ignore_chapters;
     int seek_individually;
     int64_t next_root_atom; ///< offset of the next root atom
@@ -3510,15 +3510,30 @@ static void mov_estimate_video_delay(MOVContext *c, AVStream* st)
 
     if (st->codecpar->video_delay <= 0 && msc->ctts_data &&
         st->codecpar->codec_id == AV_CODEC_ID_H264) {
+        // An index built on demand only covers the first samples so far, so
+        // take the remaining timestamps from stts.
+        int nb_samples = msc->lazy_index ? msc->index_cursor.nb_samples : sti->nb_index_entries;
+        int64_t dts = sti->nb_index_entries ? sti->index_entries[0].timestamp : 0;
+        unsigned int stts_ind = 0, stts_sample = 0;
+
         st->codecpar->video_delay = 0;
-        for (int ind = 0; ind < sti->nb_index_entries && ctts_ind < msc->ctts_count; ++ind) {
+        for (int ind = 0; ind < nb_samples && ctts_ind < msc->ctts_count; ++ind) {
             // Point j to the last elem of the buffer and insert the current pts there.
             j = buf_start;
             buf_start = (buf_start + 1);
             if (buf_start == MAX_REORDER_DELAY + 1)
                 buf_start = 0;
 
-            pts_buf[j] = sti->index_entries[ind].timestamp + msc->ctts_data[ctts_ind].duration;
+            if (!msc->lazy_index) {
+                dts = sti->index_entries[ind].timestamp;
+            } else if (ind) {
+                dts += msc->stts_data[stts_ind].duration;
+                if (stts_ind + 1 < msc->stts_count && ++stts_sample == msc->stts_data[stts_ind].count) {
+                    stts_sample = 0;
+                    stts_ind++;
+                }
+            }
+            pts_buf[j] = dts + msc->ctts_data[ctts_ind].duration;
 
             // The timestamps that are already in the sorted buffer, and are greater than the
             // current pts, are exactly the timestamps that need to be buffered to output PTS
@@ -3969,20 +3984,267 @@ static int build_open_gop_key_points(AVStream *st)
     return 0;
 }
 
+/* number of samples indexed at a time when the index is built on demand */
+#define MOV_LAZY_INDEX_BATCH 1024
+
+/**
+ * Append index entries for at most nb_samples further samples, resuming the
+ * walk over the chunk and sample tables where the previous call stopped.
+ *
+ * @return 1 once all samples are indexed, 0 if some remain, a negative error
+ *         code if the tables are inconsistent
+ */
+static int mov_build_index_samples(MOVContext *mov, AVStream *st, unsigned int nb_samples)
+{
+    MOVStreamContext *sc = st->priv_data;
+    FFStream *const sti = ffstream(st);
+    MOVIndexCursor *cur = &sc->index_cursor;
+    unsigned int sample_size;
+    int rap_group_present = sc->rap_group_count && sc->rap_group;
+    int key_off = (sc->keyframe_count && sc->keyframes[0] > 0) || (sc->stps_count && sc->stps_data[0] > 0);
+
+    for (; cur->chunk < sc->chunk_count; cur->chunk++, cur->chunk_sample = 0) {
+        if (!nb_samples)
+            return 0;
+
+        if (!cur->chunk_sample) {
+            int64_t next_offset = cur->chunk + 1 < sc->chunk_count ? sc->chunk_offsets[cur->chunk + 1] : INT64_MAX;
+            cur->offset = sc->chunk_offsets[cur->chunk];
+            while (mov_stsc_index_valid(cur->stsc_index, sc->stsc_count) &&
+                cur->chunk + 1 == sc->stsc_data[cur->stsc_index + 1].first)
+                cur->stsc_index++;
+
+            if (next_offset > cur->offset && sc->sample_size>0 && sc->sample_size < sc->stsz_sample_size &&
+                sc->stsc_data[cur->stsc_index].count * (int64_t)sc->stsz_sample_size > next_offset - cur->offset) {
+                av_log(mov->fc, AV_LOG_WARNING, "STSZ sample size %d invalid (too large), ignoring\n", sc->stsz_sample_size);
+                sc->stsz_sample_size = sc->sample_size;
+            }
+            if (sc->stsz_sample_size>0 && sc->stsz_sample_size < sc->sample_size) {
+                av_log(mov->fc, AV_LOG_WARNING, "STSZ sample size %d invalid (too small), ignoring\n", sc->stsz_sample_size);
+                sc->stsz_sample_size = sc->sample_size;
+            }
+        }
+
+        for (; cur->chunk_sample < sc->stsc_data[cur->stsc_index].count; cur->chunk_sample++) {
+            int keyframe = 0;
+            if (!nb_samples--)
+                return 0;
+            if (cur->sample >= sc->sample_count) {
+                av_log(mov->fc, AV_LOG_ERROR, "wrong sample count\n");
+                return AVERROR_INVALIDDATA;
+            }
+
+            if (!sc->keyframe_absent && (!sc->keyframe_count || cur->sample+key_off == sc->keyframes[cur->stss_index])) {
+                keyframe = 1;
+                if (cur->stss_index + 1 < sc->keyframe_count)
+                    cur->stss_index++;
+            } else if (sc->stps_count && cur->sample+key_off == sc->stps_data[cur->stps_index]) {
+                keyframe = 1;
+                if (cur->stps_index + 1 < sc->stps_count)
+                    cur->stps_index++;
+            }
+            if (rap_group_present && cur->rap_group_index < sc->rap_group_count) {
+                if (sc->rap_group[cur->rap_group_index].index > 0)
+                    keyframe = 1;
+                if (++cur->rap_group_sample == sc->rap_group[cur->rap_group_index].count) {
+                    cur->rap_group_sample = 0;
+                    cur->rap_group_index++;
+                }
+            }
+            if (sc->keyframe_absent
+                && !sc->stps_count
+                && !rap_group_present
+                && (st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO || (!cur->chunk && !cur->chunk_sample)))
+                 keyframe = 1;
+            if (keyframe)
+                cur->distance = 0;
+            sample_size = sc->stsz_sample_size > 0 ? sc->stsz_sample_size : sc->sample_sizes[cur->sample];
+            if (sc->pseudo_stream_id == -1 ||
+               sc->stsc_data[cur->stsc_index].id - 1 == sc->pseudo_stream_id) {
+                AVIndexEntry *e;
+                if (sample_size > 0x3FFFFFFF) {
+                    av_log(mov->fc, AV_LOG_ERROR, "Sample size %u is too large\n", sample_size);
+                    return AVERROR_INVALIDDATA;
+                }
+                e = &sti->index_entries[sti->nb_index_entries++];
+                e->pos = cur->offset;
+                e->timestamp = cur->dts;
+                e->size = sample_size;
+                e->min_distance = cur->distance;
+                e->flags = keyframe ? AVINDEX_KEYFRAME : 0;
+                av_log(mov->fc, AV_LOG_TRACE, "AVIndex stream %d, sample %u, offset %"PRIx64", dts %"PRId64", "
+                        "size %u, distance %u, keyframe %d\n", st->index, cur->sample,
+                        cur->offset, cur->dts, sample_size, cur->distance, keyframe);
+                if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && sti->nb_index_entries < 100)
+                    ff_rfps_add_frame(mov->fc, st, cur->dts);
+            }
+
+            cur->offset += sample_size;
+            cur->stream_size += sample_size;
+
+            cur->dts += sc->stts_data[cur->stts_index].duration;
+
+            cur->distance++;
+            cur->stts_sample++;
+            cur->sample++;
+            if (cur->stts_index + 1 < sc->stts_count && cur->stts_sample == sc->stts_data[cur->stts_index].count) {
+                cur->stts_sample = 0;
+                cur->stts_index++;
+            }
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * Check whether the index of st can be built on demand and prepare for it.
+ * Only tracks whose index is a plain expansion of the sample tables qualify;
+ * edit list fix-ups, skipped stsd entries and tables the expansion would
+ * reject all need the complete index at open.
+ *
+ * @param stream_size set to the total size of the samples
+ * @return 1 if the index is built on demand, 0 otherwise
+ */
+static int mov_lazy_index_init(MOVContext *mov, AVStream *st, uint64_t *stream_size)
+{
+    MOVStreamContext *sc = st->priv_data;
+    uint64_t nb_samples = 0, size = 0;
+    unsigned int i, stsc_index = 0;
+
+    if (sc->elst_count && !mov->ignore_editlist && mov->advanced_editlist)
+        return 0;
+    if (sc->sample_size > 0 && sc->stsz_sample_size > 0 &&
+        sc->sample_size != sc->stsz_sample_size)
+        return 0;
+    if (sc->pseudo_stream_id != -1)
+        for (i = 0; i < sc->stsc_count; i++)
+            if (sc->stsc_data[i].id - 1 != sc->pseudo_stream_id)
+                return 0;
+
+    for (i = 0; i < sc->chunk_count; i++) {
+        while (mov_stsc_index_valid(stsc_index, sc->stsc_count) &&
+               i + 1 == sc->stsc_data[stsc_index + 1].first)
+            stsc_index++;
+        nb_samples += (unsigned)sc->stsc_data[stsc_index].count;
+    }
+    if (nb_samples <= MOV_LAZY_INDEX_BATCH || nb_samples > sc->sample_count)
+        return 0;
+
+    if (sc->stsz_sample_size > 0) {
+        if (sc->stsz_sample_size > 0x3FFFFFFF)
+            return 0;
+        size = sc->stsz_sample_size * nb_samples;
+    } else {
+        for (i = 0; i < nb_samples; i++) {
+            if ((unsigned)sc->sample_sizes[i] > 0x3FFFFFFF)
+                return 0;
+            size += (unsigned)sc->sample_sizes[i];
+        }
+    }
+
+    sc->index_cursor.nb_samples = nb_samples;
+    sc->lazy_index = 1;
+    *stream_size = size;
+    return 1;
+}
+
+static void mov_free_index_tables(MOVStreamContext *sc)
+{
+    av_freep(&sc->chunk_offsets);
+    av_freep(&sc->sample_sizes);
+    av_freep(&sc->keyframes);
+    av_freep(&sc->stts_data);
+    av_freep(&sc->stps_data);
+    av_freep(&sc->rap_group);
+}
+
+/**
+ * Expand the ctts entries such that we have a 1-1 mapping with samples, as
+ * the fragment and edit list code index them by sample. The read position
+ * in the table is moved to the same sample.
+ */
+static int mov_expand_ctts(MOVStreamContext *sc)
+{
+    MOVCtts *ctts_data_old = sc->ctts_data;
+    unsigned int ctts_count_old = sc->ctts_count;
+    int64_t sample = sc->ctts_sample;
+
+    if (!ctts_data_old)
+        return 0;
+    if (sc->sample_count >= UINT_MAX / sizeof(*sc->ctts_data))
+        return AVERROR(ENOMEM);
+    sc->ctts_count = 0;
+    sc->ctts_allocated_size = 0;
+    sc->ctts_data = av_fast_realloc(NULL, &sc->ctts_allocated_size,
+                            sc->sample_count * sizeof(*sc->ctts_data));
+    if (!sc->ctts_data) {
+        av_free(ctts_data_old);
+        return AVERROR(ENOMEM);
+    }
+
+    memset((uint8_t*)(sc->ctts_data), 0, sc->ctts_allocated_size);
+
+    for (unsigned int i = 0; i < ctts_count_old &&
+                             sc->ctts_count < sc->sample_count; i++)
+        for (unsigned int j = 0; j < ctts_data_old[i].count &&
+                                 sc->ctts_count < sc->sample_count; j++)
+            add_ctts_entry(&sc->ctts_data, &sc->ctts_count,
+                           &sc->ctts_allocated_size, 1,
+                           ctts_data_old[i].duration);
+
+    for (int64_t i = 0; i < sc->ctts_index && i < ctts_count_old; i++)
+        sample += ctts_data_old[i].count;
+    sc->ctts_index  = sample;
+    sc->ctts_sample = 0;
+
+    av_free(ctts_data_old);
+    return 0;
+}
+
+/**
+ * Index up to nb_samples more samples of a stream whose index is built on
+ * demand. The sample tables are released once the index is complete.
+ */
+static int mov_extend_index(MOVContext *mov, AVStream *st, unsigned int nb_samples)
+{
+    MOVStreamContext *sc = st->priv_data;
+    FFStream *const sti = ffstream(st);
+    MOVIndexCursor *cur = &sc->index_cursor;
+    AVIndexEntry *entries;
+    int ret;
+
+    if (!sc->lazy_index)
+        return 0;
+
+    nb_samples = FFMIN(nb_samples, cur->nb_samples - cur->sample);
+    entries = av_fast_realloc(sti->index_entries, &sti->index_entries_allocated_size,
+                              (sti->nb_index_entries + nb_samples) * sizeof(*entries));
+    if (!entries)
+        return AVERROR(ENOMEM);
+    sti->index_entries = entries;
+
+    ret = mov_build_index_samples(mov, st, nb_samples);
+    if (ret < 0)
+        return ret;
+    if (ret || cur->sample >= cur->nb_samples) {
+        /* ctts was left run-length coded while the index was incomplete */
+        sc->lazy_index = 0;
+        mov_free_index_tables(sc);
+        return mov_expand_ctts(sc);
+    }
+    return 0;
+}
+
 static void mov_build_index(MOVContext *mov, AVStream *st)
 {
     MOVStreamContext *sc = st->priv_data;
     FFStream *const sti = ffstream(st);
     int64_t current_offset;
     int64_t current_dts = 0;
-    unsigned int stts_index = 0;
     unsigned int stsc_index = 0;
-    unsigned int stss_index = 0;
-    unsigned int stps_index = 0;
-    unsigned int i, j;
+    unsigned int i;
     uint64_t stream_size = 0;
-    MOVCtts *ctts_data_old = sc->ctts_data;
-    unsigned int ctts_count_old = sc->ctts_count;
 
     int ret = build_open_gop_key_points(st);
     if (ret < 0)
@@ -4034,136 +4296,34 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
     /* only use old uncompressed audio chunk demuxing when stts specifies it */
     if (!(st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO &&
           sc->stts_count == 1 && sc->stts_data[0].duration == 1)) {
-        unsigned int current_sample = 0;
-        unsigned int stts_sample = 0;
-        unsigned int sample_size;
-        unsigned int distance = 0;
-        unsigned int rap_group_index = 0;
-        unsigned int rap_group_sample = 0;
-        int rap_group_present = sc->rap_group_count && sc->rap_group;
-        int key_off = (sc->keyframe_count && sc->keyframes[0] > 0) || (sc->stps_count && sc->stps_data[0] > 0);
-
         current_dts -= sc->dts_shift;
 
         if (!sc->sample_count || sti->nb_index_entries)
             return;
         if (sc->sample_count >= UINT_MAX / sizeof(*sti->index_entries) - sti->nb_index_entries)
             return;
-        if (av_reallocp_array(&sti->index_entries,
-                              sti->nb_index_entries + sc->sample_count,
-                              sizeof(*sti->index_entries)) < 0) {
-            sti->nb_index_entries = 0;
-            return;
-        }
-        sti->index_entries_allocated_size = (sti->nb_index_entries + sc->sample_count) * sizeof(*sti->index_entries);
 
-        if (ctts_data_old) {
-            // Expand ctts entries such that we have a 1-1 mapping with samples
-            if (sc->sample_count >= UINT_MAX / sizeof(*sc->ctts_data))
+        memset(&sc->index_cursor, 0, sizeof(sc->index_cursor));
+        sc->index_cursor.dts = current_dts;
+
+        if (mov->lazy_index && mov_lazy_index_init(mov, st, &stream_size)) {
+            if (mov_extend_index(mov, st, MOV_LAZY_INDEX_BATCH) < 0)
                 return;
-            sc->ctts_count = 0;
-            sc->ctts_allocated_size = 0;
-            sc->ctts_data = av_fast_realloc(NULL, &sc->ctts_allocated_size,
-                                    sc->sample_count * sizeof(*sc->ctts_data));
-            if (!sc->ctts_data) {
-                av_free(ctts_data_old);
+        } else {
+            if (av_reallocp_array(&sti->index_entries,
+                                  sti->nb_index_entries + sc->sample_count,
+                                  sizeof(*sti->index_entries)) < 0) {
+                sti->nb_index_entries = 0;
                 return;
             }
+            sti->index_entries_allocated_size = (sti->nb_index_entries + sc->sample_count) * sizeof(*sti->index_entries);
 
-            memset((uint8_t*)(sc->ctts_data), 0, sc->ctts_allocated_size);
-
-            for (i = 0; i < ctts_count_old &&
-                        sc->ctts_count < sc->sample_count; i++)
-                for (j = 0; j < ctts_data_old[i].count &&
-                            sc->ctts_count < sc->sample_count; j++)
-                    add_ctts_entry(&sc->ctts_data, &sc->ctts_count,
-                                   &sc->ctts_allocated_size, 1,
-                                   ctts_data_old[i].duration);
-            av_free(ctts_data_old);
-        }
-
-        for (i = 0; i < sc->chunk_count; i++) {
-            int64_t next_offset = i+1 < sc->chunk_count ? sc->chunk_offsets[i+1] : INT64_MAX;
-            current_offset = sc->chunk_offsets[i];
-            while (mov_stsc_index_valid(stsc_index, sc->stsc_count) &&
-                i + 1 == sc->stsc_data[stsc_index + 1].first)
-                stsc_index++;
-
-            if (next_offset > current_offset && sc->sample_size>0 && sc->sample_size < sc->stsz_sample_size &&
-                sc->stsc_data[stsc_index].count * (int64_t)sc->stsz_sample_size > next_offset - current_offset) {
-                av_log(mov->fc, AV_LOG_WARNING, "STSZ sample size %d invalid (too large), ignoring\n", sc->stsz_sample_size);
-                sc->stsz_sample_size = sc->sample_size;
-            }
-            if (sc->stsz_sample_size>0 && sc->stsz_sample_size < sc->sample_size) {
-                av_log(mov->fc, AV_LOG_WARNING, "STSZ sample size %d invalid (too small), ignoring\n", sc->stsz_sample_size);
-                sc->stsz_sample_size = sc->sample_size;
-            }
-
-            for (j = 0; j < sc->stsc_data[stsc_index].count; j++) {
-                int keyframe = 0;
-                if (current_sample >= sc->sample_count) {
-                    av_log(mov->fc, AV_LOG_ERROR, "wrong sample count\n");
-                    return;
-                }
-
-                if (!sc->keyframe_absent && (!sc->keyframe_count || current_sample+key_off == sc->keyframes[stss_index])) {
-                    keyframe = 1;
-                    if (stss_index + 1 < sc->keyframe_count)
-                        stss_index++;
-                } else if (sc->stps_count && current_sample+key_off == sc->stps_data[stps_index]) {
-                    keyframe = 1;
-                    if (stps_index + 1 < sc->stps_count)
-                        stps_index++;
-                }
-                if (rap_group_present && rap_group_index < sc->rap_group_count) {
-                    if (sc->rap_group[rap_group_index].index > 0)
-                        keyframe = 1;
-                    if (++rap_group_sample == sc->rap_group[rap_group_index].count) {
-                        rap_group_sample = 0;
-                        rap_group_index++;
-                    }
-                }
-                if (sc->keyframe_absent
-                    && !sc->stps_count
-                    && !rap_group_present
-                    && (st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO || (i==0 && j==0)))
-                     keyframe = 1;
-                if (keyframe)
-                    distance = 0;
-                sample_size = sc->stsz_sample_size > 0 ? sc->stsz_sample_size : sc->sample_sizes[current_sample];
-                if (sc->pseudo_stream_id == -1 ||
-                   sc->stsc_data[stsc_index].id - 1 == sc->pseudo_stream_id) {
-                    AVIndexEntry *e;
-                    if (sample_size > 0x3FFFFFFF) {
-                        av_log(mov->fc, AV_LOG_ERROR, "Sample size %u is too large\n", sample_size);
-                        return;
-                    }
-                    e = &sti->index_entries[sti->nb_index_entries++];
-                    e->pos = current_offset;
-                    e->timestamp = current_dts;
-                    e->size = sample_size;
-                    e->min_distance = distance;
-                    e->flags = keyframe ? AVINDEX_KEYFRAME : 0;
-                    av_log(mov->fc, AV_LOG_TRACE, "AVIndex stream %d, sample %u, offset %"PRIx64", dts %"PRId64", "
-                            "size %u, distance %u, keyframe %d\n", st->index, current_sample,
-                            current_offset, current_dts, sample_size, distance, keyframe);
-                    if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && sti->nb_index_entries < 100)
-                        ff_rfps_add_frame(mov->fc, st, current_dts);
-                }
-
-                current_offset += sample_size;
-                stream_size += sample_size;
-
-                current_dts += sc->stts_data[stts_index].duration;
+            if (mov_expand_ctts(sc) < 0)
+                return;
 
-                distance++;
-                stts_sample++;
-                current_sample++;
-                if (stts_index + 1 < sc->stts_count && stts_sample == sc->stts_data[stts_index].count) {
-                    stts_sample = 0;
-                    stts_index++;
-                }
-            }
+            if (mov_build_index_samples(mov, st, UINT_MAX) < 0)
+                return;
+            stream_size = sc->index_cursor.stream_size;
         }
         if (st->duration > 0)
             st->codecpar->bit_rate = stream_size*8*sc->time_scale/st->duration;
@@ -4513,14 +4673,10 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         && sc->time_scale == st->codecpar->sample_rate) {
             ffstream(st)->need_parsing = AVSTREAM_PARSE_FULL;
     }
-    /* Do not need those anymore. */
-    av_freep(&sc->chunk_offsets);
-    av_freep(&sc->sample_sizes);
-    av_freep(&sc->keyframes);
-    av_freep(&sc->stts_data);
-    av_freep(&sc->stps_data);
+    /* Do not need those anymore, unless the index is built on demand. */
+    if (!sc->lazy_index)
+        mov_free_index_tables(sc);
     av_freep(&sc->elst_data);
-    av_freep(&sc->rap_group);
     av_freep(&sc->sync_group);
     av_freep(&sc->sgpd_sync);
 
@@ -4932,7 +5088,7 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     int64_t dts, pts = AV_NOPTS_VALUE;
     int data_offset = 0;
     unsigned entries, first_sample_flags = frag->flags;
-    int flags, distance, i;
+    int flags, distance, i, ret;
     int64_t prev_dts = AV_NOPTS_VALUE;
     int next_frag_index = -1, index_entry_pos;
     size_t requested_size;
@@ -4959,6 +5115,8 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     sc = st->priv_data;
     if (sc->pseudo_stream_id+1 != frag->stsd_id && sc->pseudo_stream_id != -1)
         return 0;
+    if ((ret = mov_extend_index(c, st, UINT_MAX)) < 0)
+        return ret;
 
     // Find the next frag_index index that has a valid index_entry for
     // the current track_id.
@@ -7774,6 +7932,8 @@ static void mov_read_chapters(AVFormatContext *s)
         sti = ffstream(st);
 
         sc = st->priv_data;
+        if (mov_extend_index(mov, st, UINT_MAX) < 0)
+            continue;
         cur_pos = avio_tell(sc->pb);
 
         if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
@@ -8359,6 +8519,27 @@ static int mov_read_header(AVFormatContext *s)
     return 0;
 }
 
+/**
+ * Make sure the index of every stream built on demand covers the current
+ * sample and the one after it.
+ */
+static int mov_update_lazy_indexes(AVFormatContext *s)
+{
+    MOVContext *mov = s->priv_data;
+
+    for (int i = 0; i < s->nb_streams; i++) {
+        AVStream *st = s->streams[i];
+        MOVStreamContext *sc = st->priv_data;
+
+        if (sc->lazy_index && sc->current_sample + 1 >= ffstream(st)->nb_index_entries) {
+            int ret = mov_extend_index(mov, st, MOV_LAZY_INDEX_BATCH);
+            if (ret < 0)
+                return ret;
+        }
+    }
+    return 0;
+}
+
 static AVIndexEntry *mov_find_next_sample(AVFormatContext *s, AVStream **st)
 {
     AVIndexEntry *sample = NULL;
@@ -8483,6 +8664,8 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
     int ret;
     mov->fc = s;
  retry:
+    if ((ret = mov_update_lazy_indexes(s)) < 0)
+        return ret;
     sample = mov_find_next_sample(s, &st);
     if (!sample || (mov->next_root_atom && sample->pos > mov->next_root_atom)) {
         if (!mov->next_root_atom)
@@ -8681,6 +8864,35 @@ static int can_seek_to_key_sample(AVStream *st, int sample, int64_t requested_pt
     return 1;
 }
 
+/**
+ * Extend an index built on demand up to the first keyframe after timestamp,
+ * so that searching it finds the same sample as searching the complete index.
+ */
+static int mov_extend_index_to(MOVContext *mov, AVStream *st, int64_t timestamp)
+{
+    MOVStreamContext *sc = st->priv_data;
+    FFStream *const sti = ffstream(st);
+    int i, ret;
+
+    if (!sc->lazy_index)
+        return 0;
+
+    for (i = sti->nb_index_entries - 1; i >= 0 && sti->index_entries[i].timestamp > timestamp; i--)
+        if (sti->index_entries[i].flags & AVINDEX_KEYFRAME)
+            return 0;
+
+    i = sti->nb_index_entries;
+    while (sc->lazy_index) {
+        if ((ret = mov_extend_index(mov, st, MOV_LAZY_INDEX_BATCH)) < 0)
+            return ret;
+        for (; i < sti->nb_index_entries; i++)
+            if (sti->index_entries[i].flags & AVINDEX_KEYFRAME &&
+                sti->index_entries[i].timestamp > timestamp)
+                return 0;
+    }
+    return 0;
+}
+
 static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp, int flags)
 {
     MOVStreamContext *sc = st->priv_data;
@@ -8696,6 +8908,10 @@ static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp,
     if (ret < 0)
         return ret;
 
+    ret = mov_extend_index_to(s->priv_data, st, timestamp);
+    if (ret < 0)
+        return ret;
+
     for (;;) {
         sample = av_index_search_timestamp(st, timestamp, flags);
         av_log(s, AV_LOG_TRACE, "stream %d, timestamp %"PRId64", sample %d\n", st->index, timestamp, sample);
@@ -8804,7 +9020,11 @@ static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_ti
         }
         while (1) {
             MOVStreamContext *sc;
-            AVIndexEntry *entry = mov_find_next_sample(s, &st);
+            AVIndexEntry *entry;
+            int ret = mov_update_lazy_indexes(s);
+            if (ret < 0)
+                return ret;
+            entry = mov_find_next_sample(s, &st);
             if (!entry)
                 return AVERROR_INVALIDDATA;
             sc = st->priv_data;
@@ -8835,6 +9055,9 @@ static const AVOption mov_options[] = {
         0, 1, FLAGS},
     {"ignore_chapters", "", OFFSET(ignore_chapters), AV_OPT_TYPE_BOOL, {.i64 = 0},
         0, 1, FLAGS},
+    {"lazy_index", "Build the sample index on demand instead of when opening the file",
+        OFFSET(lazy_index), AV_OPT_TYPE_BOOL, {.i64 = 0},
+        0, 1, FLAGS},
     {"use_mfra_for",
         "use mfra for fragment timestamps",
         OFFSET(use_mfra_for), AV_OPT_TYPE_INT, {.i64 = FF_MOV_FLAG_MFRA_AUTO},
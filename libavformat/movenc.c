@@ -68,7 +68,7 @@
 static const AVOption options[] = {
     { "movflags", "MOV muxer flags", offsetof(MOVMuxContext, flags), AV_OPT_TYPE_FLAGS, {.i64 = 0}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "rtphint", "Add RTP hint tracks", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_RTP_HINT}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
-    { "moov_size", "maximum moov size so it can be placed at the begin", offsetof(MOVMuxContext, reserved_moov_size), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, 0 },
+    { "moov_size", "maximum moov size so it can be placed at the begin", offsetof(MOVMuxContext, reserved_moov_size), AV_OPT_TYPE_INT, {.i64 = 0}, -1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, 0 },
     { "empty_moov", "Make the initial moov atom empty", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_EMPTY_MOOV}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "frag_keyframe", "Fragment at video keyframes", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_FRAG_KEYFRAME}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "frag_every_frame", "Fragment at every frame", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_FRAG_EVERY_FRAME}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
@@ -152,11 +152,32 @@ static int64_t update_size(AVIOContext *pb, int64_t pos)
 
 static int co64_required(const MOVTrack *track)
 {
-    if (track->entry > 0 && track->cluster[track->entry - 1].pos + track->data_offset > UINT32_MAX)
+    if (track->entry > 0 && track->tables.last_pos + track->data_offset > UINT32_MAX)
         return 1;
     return 0;
 }
 
+static int mov_run_append(MOVRunTable *table, uint32_t value, unsigned int count)
+{
+    MOVSampleRun *runs;
+
+    if (table->nb_runs && table->runs[table->nb_runs - 1].value == value) {
+        table->runs[table->nb_runs - 1].count += count;
+        return 0;
+    }
+    if (table->nb_runs >= UINT_MAX / sizeof(*table->runs) - 1)
+        return AVERROR(ENOMEM);
+    runs = av_fast_realloc(table->runs, &table->runs_size,
+                           (table->nb_runs + 1) * sizeof(*table->runs));
+    if (!runs)
+        return AVERROR(ENOMEM);
+    table->runs = runs;
+    table->runs[table->nb_runs].count = count;
+    table->runs[table->nb_runs].value = value;
+    table->nb_runs++;
+    return 0;
+}
+
 static int is_cover_image(const AVStream *st)
 {
     /* Eg. AV_DISPOSITION_ATTACHED_PIC | AV_DISPOSITION_TIMED_THUMBNAILS
@@ -185,14 +206,12 @@ static int mov_write_stco_tag(AVIOContext *pb, MOVTrack *track)
     else
         ffio_wfourcc(pb, "stco");
     avio_wb32(pb, 0); /* version & flags */
-    avio_wb32(pb, track->chunkCount); /* entry count */
-    for (i = 0; i < track->entry; i++) {
-        if (!track->cluster[i].chunkNum)
-            continue;
+    avio_wb32(pb, track->tables.nb_chunks); /* entry count */
+    for (i = 0; i < track->tables.nb_chunks; i++) {
         if (mode64 == 1)
-            avio_wb64(pb, track->cluster[i].pos + track->data_offset);
+            avio_wb64(pb, track->tables.chunk_offsets[i] + track->data_offset);
         else
-            avio_wb32(pb, track->cluster[i].pos + track->data_offset);
+            avio_wb32(pb, track->tables.chunk_offsets[i] + track->data_offset);
     }
     return update_size(pb, pos);
 }
@@ -200,34 +219,26 @@ static int mov_write_stco_tag(AVIOContext *pb, MOVTrack *track)
 /* Sample size atom */
 static int mov_write_stsz_tag(AVIOContext *pb, MOVTrack *track)
 {
-    int equalChunks = 1;
-    int i, j, entries = 0, tst = -1, oldtst = -1;
+    const MOVRunTable *sizes = &track->tables.sizes;
+    int i, j, entries = 0;
 
     int64_t pos = avio_tell(pb);
     avio_wb32(pb, 0); /* size */
     ffio_wfourcc(pb, "stsz");
     avio_wb32(pb, 0); /* version & flags */
 
-    for (i = 0; i < track->entry; i++) {
-        tst = track->cluster[i].size / track->cluster[i].entries;
-        if (oldtst != -1 && tst != oldtst)
-            equalChunks = 0;
-        oldtst = tst;
-        entries += track->cluster[i].entries;
-    }
-    if (equalChunks && track->entry) {
-        int sSize = track->entry ? track->cluster[0].size / track->cluster[0].entries : 0;
-        sSize = FFMAX(1, sSize); // adpcm mono case could make sSize == 0
+    for (i = 0; i < sizes->nb_runs; i++)
+        entries += sizes->runs[i].count;
+    if (sizes->nb_runs == 1) {
+        int sSize = FFMAX(1, sizes->runs[0].value); // adpcm mono case could make sSize == 0
         avio_wb32(pb, sSize); // sample size
         avio_wb32(pb, entries); // sample count
     } else {
         avio_wb32(pb, 0); // sample size
         avio_wb32(pb, entries); // sample count
-        for (i = 0; i < track->entry; i++) {
-            for (j = 0; j < track->cluster[i].entries; j++) {
-                avio_wb32(pb, track->cluster[i].size /
-                          track->cluster[i].entries);
-            }
+        for (i = 0; i < sizes->nb_runs; i++) {
+            for (j = 0; j < sizes->runs[i].count; j++)
+                avio_wb32(pb, sizes->runs[i].value);
         }
     }
     return update_size(pb, pos);
@@ -236,7 +247,11 @@ static int mov_write_stsz_tag(AVIOContext *pb, MOVTrack *track)
 /* Sample to chunk atom */
 static int mov_write_stsc_tag(AVIOContext *pb, MOVTrack *track)
 {
-    int index = 0, oldval = -1, i;
+    const MOVSampleTables *tables = &track->tables;
+    const MOVRunTable *chunk_samples = &tables->chunk_samples;
+    int64_t oldval = -1;
+    unsigned int chunk = 1;
+    int index = 0, i;
     int64_t entryPos, curpos;
 
     int64_t pos = avio_tell(pb);
@@ -244,15 +259,20 @@ static int mov_write_stsc_tag(AVIOContext *pb, MOVTrack *track)
     ffio_wfourcc(pb, "stsc");
     avio_wb32(pb, 0); // version & flags
     entryPos = avio_tell(pb);
-    avio_wb32(pb, track->chunkCount); // entry count
-    for (i = 0; i < track->entry; i++) {
-        if (oldval != track->cluster[i].samples_in_chunk && track->cluster[i].chunkNum) {
-            avio_wb32(pb, track->cluster[i].chunkNum); // first chunk
-            avio_wb32(pb, track->cluster[i].samples_in_chunk); // samples per chunk
+    avio_wb32(pb, tables->nb_chunks); // entry count
+    /* the last chunk is not part of the runs as it could still grow */
+    for (i = 0; i <= chunk_samples->nb_runs && tables->nb_chunks; i++) {
+        uint32_t samples = i < chunk_samples->nb_runs ? chunk_samples->runs[i].value
+                                                      : tables->last_chunk_samples;
+        if (oldval != samples) {
+            avio_wb32(pb, chunk); // first chunk
+            avio_wb32(pb, samples); // samples per chunk
             avio_wb32(pb, 0x1); // sample description index
-            oldval = track->cluster[i].samples_in_chunk;
+            oldval = samples;
             index++;
         }
+        if (i < chunk_samples->nb_runs)
+            chunk += chunk_samples->runs[i].count;
     }
     curpos = avio_tell(pb);
     avio_seek(pb, entryPos, SEEK_SET);
@@ -265,18 +285,21 @@ static int mov_write_stsc_tag(AVIOContext *pb, MOVTrack *track)
 /* Sync sample atom */
 static int mov_write_stss_tag(AVIOContext *pb, MOVTrack *track, uint32_t flag)
 {
+    const MOVRunTable *flags = &track->tables.flags;
     int64_t curpos, entryPos;
-    int i, index = 0;
+    int i, j, sample = 1, index = 0;
     int64_t pos = avio_tell(pb);
     avio_wb32(pb, 0); // size
     ffio_wfourcc(pb, flag == MOV_SYNC_SAMPLE ? "stss" : "stps");
     avio_wb32(pb, 0); // version & flags
     entryPos = avio_tell(pb);
     avio_wb32(pb, track->entry); // entry count
-    for (i = 0; i < track->entry; i++) {
-        if (track->cluster[i].flags & flag) {
-            avio_wb32(pb, i + 1);
-            index++;
+    for (i = 0; i < flags->nb_runs; i++) {
+        for (j = 0; j < flags->runs[i].count; j++, sample++) {
+            if (flags->runs[i].value & flag) {
+                avio_wb32(pb, sample);
+                index++;
+            }
         }
     }
     curpos = avio_tell(pb);
@@ -289,23 +312,25 @@ static int mov_write_stss_tag(AVIOContext *pb, MOVTrack *track, uint32_t flag)
 /* Sample dependency atom */
 static int mov_write_sdtp_tag(AVIOContext *pb, MOVTrack *track)
 {
-    int i;
+    const MOVRunTable *flags = &track->tables.flags;
+    int i, j;
     uint8_t leading, dependent, reference, redundancy;
     int64_t pos = avio_tell(pb);
     avio_wb32(pb, 0); // size
     ffio_wfourcc(pb, "sdtp");
     avio_wb32(pb, 0); // version & flags
-    for (i = 0; i < track->entry; i++) {
+    for (i = 0; i < flags->nb_runs; i++) {
         dependent = MOV_SAMPLE_DEPENDENCY_YES;
         leading = reference = redundancy = MOV_SAMPLE_DEPENDENCY_UNKNOWN;
-        if (track->cluster[i].flags & MOV_DISPOSABLE_SAMPLE) {
+        if (flags->runs[i].value & MOV_DISPOSABLE_SAMPLE) {
             reference = MOV_SAMPLE_DEPENDENCY_NO;
         }
-        if (track->cluster[i].flags & MOV_SYNC_SAMPLE) {
+        if (flags->runs[i].value & MOV_SYNC_SAMPLE) {
             dependent = MOV_SAMPLE_DEPENDENCY_NO;
         }
-        avio_w8(pb, (leading << 6)   | (dependent << 4) |
-                    (reference << 2) | redundancy);
+        for (j = 0; j < flags->runs[i].count; j++)
+            avio_w8(pb, (leading << 6)   | (dependent << 4) |
+                        (reference << 2) | redundancy);
     }
     return update_size(pb, pos);
 }
@@ -635,13 +660,9 @@ static void put_descr(AVIOContext *pb, int tag, unsigned int size)
 
 static unsigned compute_avg_bitrate(MOVTrack *track)
 {
-    uint64_t size = 0;
-    int i;
     if (!track->track_duration)
         return 0;
-    for (i = 0; i < track->entry; i++)
-        size += track->cluster[i].size;
-    return size * 8 * track->timescale / track->track_duration;
+    return track->tables.data_size * 8 * track->timescale / track->track_duration;
 }
 
 struct mpeg4_bit_rate_values {
@@ -1102,12 +1123,13 @@ static int mov_get_lpcm_flags(enum AVCodecID codec_id)
 
 static int get_cluster_duration(MOVTrack *track, int cluster_idx)
 {
+    int nb_entries = track->entry - track->cluster_start;
     int64_t next_dts;
 
-    if (cluster_idx >= track->entry)
+    if (cluster_idx >= nb_entries)
         return 0;
 
-    if (cluster_idx + 1 == track->entry)
+    if (cluster_idx + 1 == nb_entries)
         next_dts = track->track_duration + track->start_dts;
     else
         next_dts = track->cluster[cluster_idx + 1].dts;
@@ -1122,8 +1144,6 @@ static int get_cluster_duration(MOVTrack *track, int cluster_idx)
 
 static int get_samples_per_packet(MOVTrack *track)
 {
-    int i, first_duration;
-
 // return track->par->frame_size;
 
     /* use 1 for raw PCM */
@@ -1131,14 +1151,9 @@ static int get_samples_per_packet(MOVTrack *track)
         return 1;
 
     /* check to see if duration is constant for all clusters */
-    if (!track->entry)
+    if (track->tables.durations.nb_runs != 1)
         return 0;
-    first_duration = get_cluster_duration(track, 0);
-    for (i = 1; i < track->entry; i++) {
-        if (get_cluster_duration(track, i) != first_duration)
-            return 0;
-    }
-    return first_duration;
+    return track->tables.durations.runs[0].value;
 }
 
 static int mov_write_btrt_tag(AVIOContext *pb, MOVTrack *track)
@@ -2455,26 +2470,11 @@ static int mov_write_stsd_tag(AVFormatContext *s, AVIOContext *pb, MOVMuxContext
 static int mov_write_ctts_tag(AVFormatContext *s, AVIOContext *pb, MOVTrack *track)
 {
     MOVMuxContext *mov = s->priv_data;
-    MOVCtts *ctts_entries;
-    uint32_t entries = 0;
+    const MOVSampleRun *ctts_entries = track->tables.cts.runs;
+    uint32_t entries = track->tables.cts.nb_runs;
     uint32_t atom_size;
     int i;
 
-    ctts_entries = av_malloc_array((track->entry + 1), sizeof(*ctts_entries)); /* worst case */
-    if (!ctts_entries)
-        return AVERROR(ENOMEM);
-    ctts_entries[0].count = 1;
-    ctts_entries[0].duration = track->cluster[0].cts;
-    for (i = 1; i < track->entry; i++) {
-        if (track->cluster[i].cts == ctts_entries[entries].duration) {
-            ctts_entries[entries].count++; /* compress */
-        } else {
-            entries++;
-            ctts_entries[entries].duration = track->cluster[i].cts;
-            ctts_entries[entries].count = 1;
-        }
-    }
-    entries++; /* last one */
     atom_size = 16 + (entries * 8);
     avio_wb32(pb, atom_size); /* size */
     ffio_wfourcc(pb, "ctts");
@@ -2486,44 +2486,25 @@ static int mov_write_ctts_tag(AVFormatContext *s, AVIOContext *pb, MOVTrack *tra
     avio_wb32(pb, entries); /* entry count */
     for (i = 0; i < entries; i++) {
         avio_wb32(pb, ctts_entries[i].count);
-        avio_wb32(pb, ctts_entries[i].duration);
+        avio_wb32(pb, ctts_entries[i].value);
     }
-    av_free(ctts_entries);
     return atom_size;
 }
 
 /* Time to sample atom */
 static int mov_write_stts_tag(AVIOContext *pb, MOVTrack *track)
 {
-    MOVStts *stts_entries = NULL;
-    uint32_t entries = -1;
+    const MOVSampleRun *stts_entries = track->tables.durations.runs;
+    MOVSampleRun pcm_entry;
+    uint32_t entries = track->tables.durations.nb_runs;
     uint32_t atom_size;
     int i;
 
     if (track->par->codec_type == AVMEDIA_TYPE_AUDIO && !track->audio_vbr) {
-        stts_entries = av_malloc(sizeof(*stts_entries)); /* one entry */
-        if (!stts_entries)
-            return AVERROR(ENOMEM);
-        stts_entries[0].count = track->sample_count;
-        stts_entries[0].duration = 1;
+        pcm_entry.count = track->sample_count;
+        pcm_entry.value = 1;
+        stts_entries = &pcm_entry; /* one entry */
         entries = 1;
-    } else {
-        if (track->entry) {
-            stts_entries = av_malloc_array(track->entry, sizeof(*stts_entries)); /* worst case */
-            if (!stts_entries)
-                return AVERROR(ENOMEM);
-        }
-        for (i = 0; i < track->entry; i++) {
-            int duration = get_cluster_duration(track, i);
-            if (i && duration == stts_entries[entries].duration) {
-                stts_entries[entries].count++; /* compress */
-            } else {
-                entries++;
-                stts_entries[entries].duration = duration;
-                stts_entries[entries].count = 1;
-            }
-        }
-        entries++; /* last one */
     }
     atom_size = 16 + (entries * 8);
     avio_wb32(pb, atom_size); /* size */
@@ -2532,9 +2513,8 @@ static int mov_write_stts_tag(AVIOContext *pb, MOVTrack *track)
     avio_wb32(pb, entries); /* entry count */
     for (i = 0; i < entries; i++) {
         avio_wb32(pb, stts_entries[i].count);
-        avio_wb32(pb, stts_entries[i].duration);
+        avio_wb32(pb, stts_entries[i].value);
     }
-    av_free(stts_entries);
     return atom_size;
 }
 
@@ -2562,9 +2542,10 @@ static int mov_preroll_write_stbl_atoms(AVIOContext *pb, MOVTrack *track)
     };
 
     struct sgpd_entry *sgpd_entries = NULL;
+    unsigned int sgpd_entries_size = 0;
     int entries = -1;
     int group = 0;
-    int i, j;
+    int i, j, k;
 
     const int OPUS_SEEK_PREROLL_MS = 80;
     int roll_samples = av_rescale_q(OPUS_SEEK_PREROLL_MS,
@@ -2574,40 +2555,67 @@ static int mov_preroll_write_stbl_atoms(AVIOContext *pb, MOVTrack *track)
     if (!track->entry)
         return 0;
 
-    sgpd_entries = av_malloc_array(track->entry, sizeof(*sgpd_entries));
-    if (!sgpd_entries)
-        return AVERROR(ENOMEM);
-
     av_assert0(track->par->codec_id == AV_CODEC_ID_OPUS || track->par->codec_id == AV_CODEC_ID_AAC);
 
     if (track->par->codec_id == AV_CODEC_ID_OPUS) {
-        for (i = 0; i < track->entry; i++) {
+        const MOVRunTable *durations = &track->tables.durations;
+        /* durations of the preceding 33 samples, any longer roll
+         * distance is rejected anyway */
+        int history[33];
+        const int history_size = FF_ARRAY_ELEMS(history);
+        int64_t preceding = 0;
+
+        for (i = 0, j = 0, k = 0; j < durations->nb_runs; i++) {
             int roll_samples_remaining = roll_samples;
             int distance = 0;
-            for (j = i - 1; j >= 0; j--) {
-                roll_samples_remaining -= get_cluster_duration(track, j);
+            while (distance < FFMIN(i, history_size)) {
+                roll_samples_remaining -= history[(i - 1 - distance) % history_size];
                 distance++;
                 if (roll_samples_remaining <= 0)
                     break;
             }
-            /* We don't have enough preceeding samples to compute a valid
-               roll_distance here, so this sample can't be independently
-               decoded. */
-            if (roll_samples_remaining > 0)
+            if (roll_samples_remaining > 0) {
+                /* The roll distance would be longer than the history. */
+                if (roll_samples - preceding <= 0) {
+                    av_free(sgpd_entries);
+                    return AVERROR_INVALIDDATA;
+                }
+                /* We don't have enough preceeding samples to compute a valid
+                   roll_distance here, so this sample can't be independently
+                   decoded. */
                 distance = 0;
+            }
             /* Verify distance is a maximum of 32 (2.5ms) packets. */
-            if (distance > 32)
+            if (distance > 32) {
+                av_free(sgpd_entries);
                 return AVERROR_INVALIDDATA;
+            }
             if (i && distance == sgpd_entries[entries].roll_distance) {
                 sgpd_entries[entries].count++;
             } else {
+                void *tmp = av_fast_realloc(sgpd_entries, &sgpd_entries_size,
+                                            (entries + 2) * sizeof(*sgpd_entries));
+                if (!tmp) {
+                    av_free(sgpd_entries);
+                    return AVERROR(ENOMEM);
+                }
+                sgpd_entries = tmp;
                 entries++;
                 sgpd_entries[entries].count = 1;
                 sgpd_entries[entries].roll_distance = distance;
                 sgpd_entries[entries].group_description_index = distance ? ++group : 0;
             }
+            history[i % history_size] = durations->runs[j].value;
+            preceding += durations->runs[j].value;
+            if (++k == durations->runs[j].count) {
+                j++;
+                k = 0;
+            }
         }
     } else {
+        sgpd_entries = av_malloc(sizeof(*sgpd_entries));
+        if (!sgpd_entries)
+            return AVERROR(ENOMEM);
         entries++;
         sgpd_entries[entries].count = track->sample_count;
         sgpd_entries[entries].roll_distance = 1;
@@ -3207,14 +3215,14 @@ static int mov_write_edts_tag(AVIOContext *pb, MOVMuxContext *mov,
     int64_t start_dts = track->start_dts;
 
     if (track->entry) {
-        if (start_dts != track->cluster[0].dts || start_ct != track->cluster[0].cts) {
+        if (start_dts != track->tables.first_dts || start_ct != track->tables.first_cts) {
 
             av_log(mov->fc, AV_LOG_DEBUG,
                    "EDTS using dts:%"PRId64" cts:%d instead of dts:%"PRId64" cts:%"PRId64" tid:%d\n",
-                   track->cluster[0].dts, track->cluster[0].cts,
+                   track->tables.first_dts, track->tables.first_cts,
                    start_dts, start_ct, track->track_id);
-            start_dts = track->cluster[0].dts;
-            start_ct  = track->cluster[0].cts;
+            start_dts = track->tables.first_dts;
+            start_ct  = track->tables.first_cts;
         }
     }
 
@@ -3428,13 +3436,12 @@ static int mov_write_trak_tag(AVFormatContext *s, AVIOContext *pb, MOVMuxContext
 {
     int64_t pos = avio_tell(pb);
     int entry_backup = track->entry;
-    int chunk_backup = track->chunkCount;
     int ret;
 
     /* If we want to have an empty moov, but some samples already have been
      * buffered (delay_moov), pretend that no samples have been written yet. */
     if (mov->flags & FF_MOV_FLAG_EMPTY_MOOV)
-        track->chunkCount = track->entry = 0;
+        track->entry = 0;
 
     avio_wb32(pb, 0); /* size */
     ffio_wfourcc(pb, "trak");
@@ -3445,7 +3452,7 @@ static int mov_write_trak_tag(AVFormatContext *s, AVIOContext *pb, MOVMuxContext
     if (track->start_dts != AV_NOPTS_VALUE) {
         if (mov->use_editlist)
             mov_write_edts_tag(pb, mov, track);  // PSP Movies and several other cases require edts box
-        else if ((track->entry && track->cluster[0].dts) || track->mode == MODE_PSP || is_clcp_track(track))
+        else if ((track->entry && track->tables.first_dts) || track->mode == MODE_PSP || is_clcp_track(track))
             av_log(mov->fc, AV_LOG_WARNING,
                    "Not writing any edit list even though one would have been required\n");
     }
@@ -3472,7 +3479,6 @@ static int mov_write_trak_tag(AVFormatContext *s, AVIOContext *pb, MOVMuxContext
     }
     mov_write_track_udta_tag(pb, mov, st);
     track->entry = entry_backup;
-    track->chunkCount = chunk_backup;
     return update_size(pb, pos);
 }
 
@@ -4150,27 +4156,90 @@ static int mov_write_uuidusmt_tag(AVIOContext *pb, AVFormatContext *s)
     return 0;
 }
 
-static void build_chunks(MOVTrack *trk)
+static void mov_free_sample_tables(MOVSampleTables *tables)
 {
-    int i;
-    MOVIentry *chunk = &trk->cluster[0];
-    uint64_t chunkSize = chunk->size;
-    chunk->chunkNum = 1;
-    if (trk->chunkCount)
-        return;
-    trk->chunkCount = 1;
-    for (i = 1; i<trk->entry; i++){
-        if (chunk->pos + chunkSize == trk->cluster[i].pos &&
-            chunkSize + trk->cluster[i].size < (1<<20)){
-            chunkSize             += trk->cluster[i].size;
-            chunk->samples_in_chunk += trk->cluster[i].entries;
+    av_freep(&tables->durations.runs);
+    av_freep(&tables->cts.runs);
+    av_freep(&tables->flags.runs);
+    av_freep(&tables->sizes.runs);
+    av_freep(&tables->chunk_samples.runs);
+    av_freep(&tables->chunk_offsets);
+    memset(tables, 0, sizeof(*tables));
+}
+
+/*
+ * Fold the first nb_entries entries of the cluster into the sample tables.
+ * Entries that are contiguous in the file are grouped into chunks of less
+ * than 1 MiB.
+ */
+static int mov_fold_entries(MOVTrack *trk, int nb_entries)
+{
+    MOVSampleTables *tables = &trk->tables;
+    int i, ret;
+
+    for (i = 0; i < nb_entries; i++) {
+        const MOVIentry *e = &trk->cluster[i];
+
+        if (!tables->nb_entries) {
+            tables->first_dts = e->dts;
+            tables->first_cts = e->cts;
+        }
+        if (tables->nb_chunks &&
+            tables->chunk_offsets[tables->nb_chunks - 1] + tables->last_chunk_size == e->pos &&
+            tables->last_chunk_size + e->size < (1 << 20)) {
+            tables->last_chunk_size    += e->size;
+            tables->last_chunk_samples += e->entries;
         } else {
-            trk->cluster[i].chunkNum = chunk->chunkNum+1;
-            chunk=&trk->cluster[i];
-            chunkSize = chunk->size;
-            trk->chunkCount++;
+            uint64_t *offsets;
+
+            if (tables->nb_chunks &&
+                (ret = mov_run_append(&tables->chunk_samples, tables->last_chunk_samples, 1)) < 0)
+                return ret;
+            if (tables->nb_chunks >= UINT_MAX / sizeof(*offsets) - 1)
+                return AVERROR(ENOMEM);
+            offsets = av_fast_realloc(tables->chunk_offsets, &tables->chunk_offsets_size,
+                                      (tables->nb_chunks + 1) * sizeof(*offsets));
+            if (!offsets)
+                return AVERROR(ENOMEM);
+            tables->chunk_offsets = offsets;
+            tables->chunk_offsets[tables->nb_chunks++] = e->pos;
+            tables->last_chunk_size    = e->size;
+            tables->last_chunk_samples = e->entries;
         }
+
+        if ((ret = mov_run_append(&tables->durations, get_cluster_duration(trk, i), 1)) < 0 ||
+            (ret = mov_run_append(&tables->cts, e->cts, 1)) < 0 ||
+            (ret = mov_run_append(&tables->flags, e->flags, 1)) < 0 ||
+            (ret = mov_run_append(&tables->sizes, e->size / e->entries, e->entries)) < 0)
+            return ret;
+        tables->last_pos   = e->pos;
+        tables->data_size += e->size;
+        tables->nb_entries++;
+    }
+
+    return 0;
+}
+
+/*
+ * Complete the sample tables of a track before writing the moov atom. The
+ * moov atom of fragmented files only describes the entries still in the
+ * cluster, so the tables are rebuilt from them.
+ */
+static int mov_build_sample_tables(MOVMuxContext *mov, MOVTrack *trk)
+{
+    int ret;
+
+    if (mov->flags & FF_MOV_FLAG_FRAGMENT) {
+        mov_free_sample_tables(&trk->tables);
+        if (mov->flags & FF_MOV_FLAG_EMPTY_MOOV)
+            return 0;
+        return mov_fold_entries(trk, trk->entry);
     }
+
+    if ((ret = mov_fold_entries(trk, trk->entry - trk->cluster_start)) < 0)
+        return ret;
+    trk->cluster_start = trk->entry;
+    return 0;
 }
 
 /**
@@ -4234,9 +4303,6 @@ static int mov_write_moov_tag(AVIOContext *pb, MOVMuxContext *mov,
             continue;
 
         mov->tracks[i].time     = mov->time;
-
-        if (mov->tracks[i].entry)
-            build_chunks(&mov->tracks[i]);
     }
 
     if (mov->chapter_track)
@@ -4275,6 +4341,12 @@ static int mov_write_moov_tag(AVIOContext *pb, MOVMuxContext *mov,
         }
     }
 
+    for (i = 0; i < mov->nb_streams; i++) {
+        int ret = mov_build_sample_tables(mov, &mov->tracks[i]);
+        if (ret < 0)
+            return ret;
+    }
+
     mov_write_mvhd_tag(pb, mov);
     if (mov->mode != MODE_MOV && !mov->iods_skip)
         mov_write_iods_tag(pb, mov);
@@ -5258,7 +5330,7 @@ static int mov_parse_mpeg2_frame(AVPacket *pkt, uint32_t *flags)
     return 0;
 }
 
-static void mov_parse_vc1_frame(AVPacket *pkt, MOVTrack *trk)
+static int mov_parse_vc1_frame(AVPacket *pkt, MOVTrack *trk)
 {
     const uint8_t *start, *next, *end = pkt->data + pkt->size;
     int seq = 0, entry = 0;
@@ -5287,9 +5359,12 @@ static void mov_parse_vc1_frame(AVPacket *pkt, MOVTrack *trk)
         trk->vc1_info.first_packet_seen  = 1;
     } else if ((seq && !trk->vc1_info.packet_seq) ||
                (entry && !trk->vc1_info.packet_entry)) {
+        MOVRunTable *flags = &trk->tables.flags;
         int i;
-        for (i = 0; i < trk->entry; i++)
+        for (i = 0; i < trk->entry - trk->cluster_start; i++)
             trk->cluster[i].flags &= ~MOV_SYNC_SAMPLE;
+        for (i = 0; i < flags->nb_runs; i++)
+            flags->runs[i].value &= ~MOV_SYNC_SAMPLE;
         trk->has_keyframes = 0;
         if (seq)
             trk->vc1_info.packet_seq = 1;
@@ -5301,7 +5376,22 @@ static void mov_parse_vc1_frame(AVPacket *pkt, MOVTrack *trk)
                 (!entry || trk->vc1_info.first_packet_entry)) {
                 /* First packet had the same headers as this one, readd the
                  * sync sample flag. */
-                trk->cluster[0].flags |= MOV_SYNC_SAMPLE;
+                if (!trk->cluster_start) {
+                    trk->cluster[0].flags |= MOV_SYNC_SAMPLE;
+                } else if (flags->runs[0].count == 1) {
+                    flags->runs[0].value |= MOV_SYNC_SAMPLE;
+                } else {
+                    MOVSampleRun *runs = av_fast_realloc(flags->runs, &flags->runs_size,
+                                                         (flags->nb_runs + 1) * sizeof(*runs));
+                    if (!runs)
+                        return AVERROR(ENOMEM);
+                    memmove(runs + 1, runs, flags->nb_runs * sizeof(*runs));
+                    runs[0].count  = 1;
+                    runs[0].value |= MOV_SYNC_SAMPLE;
+                    runs[1].count--;
+                    flags->runs = runs;
+                    flags->nb_runs++;
+                }
                 trk->has_keyframes = 1;
             }
         }
@@ -5313,9 +5403,10 @@ static void mov_parse_vc1_frame(AVPacket *pkt, MOVTrack *trk)
     else if (trk->vc1_info.packet_entry)
         key = entry;
     if (key) {
-        trk->cluster[trk->entry].flags |= MOV_SYNC_SAMPLE;
+        trk->cluster[trk->entry - trk->cluster_start].flags |= MOV_SYNC_SAMPLE;
         trk->has_keyframes++;
     }
+    return 0;
 }
 
 static void mov_parse_truehd_frame(AVPacket *pkt, MOVTrack *trk)
@@ -5330,7 +5421,7 @@ static void mov_parse_truehd_frame(AVPacket *pkt, MOVTrack *trk)
         return;
 
     if (AV_RB32(pkt->data + 4) == 0xF8726FBA) {
-        trk->cluster[trk->entry].flags |= MOV_SYNC_SAMPLE;
+        trk->cluster[trk->entry - trk->cluster_start].flags |= MOV_SYNC_SAMPLE;
         trk->has_keyframes++;
     }
 
@@ -5654,7 +5745,7 @@ static int check_pkt(AVFormatContext *s, AVPacket *pkt)
     uint64_t duration;
 
     if (trk->entry) {
-        ref = trk->cluster[trk->entry - 1].dts;
+        ref = trk->cluster[trk->entry - trk->cluster_start - 1].dts;
     } else if (   trk->start_dts != AV_NOPTS_VALUE
                && !trk->frag_discont) {
         ref = trk->start_dts + trk->track_duration;
@@ -5690,6 +5781,7 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
     MOVTrack *trk = &mov->tracks[pkt->stream_index];
     AVCodecParameters *par = trk->par;
     AVProducerReferenceTime *prft;
+    MOVIentry *sample;
     unsigned int samples_in_chunk = 0;
     int size = pkt->size, ret = 0, offset = 0;
     size_t prft_size;
@@ -5886,8 +5978,17 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
         }
     }
 
-    if (trk->entry >= trk->cluster_capacity) {
-        unsigned new_capacity = trk->entry + MOV_INDEX_CLUSTER_SIZE;
+    if (!(mov->flags & FF_MOV_FLAG_FRAGMENT) &&
+        trk->entry - trk->cluster_start >= MOV_INDEX_CLUSTER_SIZE) {
+        /* Fold all but the last entry, whose duration is not known yet. */
+        int nb_entries = trk->entry - trk->cluster_start - 1;
+        if ((ret = mov_fold_entries(trk, nb_entries)) < 0)
+            goto err;
+        trk->cluster[0]     = trk->cluster[nb_entries];
+        trk->cluster_start += nb_entries;
+    }
+    if (trk->entry - trk->cluster_start >= trk->cluster_capacity) {
+        unsigned new_capacity = trk->entry - trk->cluster_start + MOV_INDEX_CLUSTER_SIZE;
         void *cluster = av_realloc_array(trk->cluster, new_capacity, sizeof(*trk->cluster));
         if (!cluster) {
             ret = AVERROR(ENOMEM);
@@ -5896,14 +5997,13 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
         trk->cluster          = cluster;
         trk->cluster_capacity = new_capacity;
     }
+    sample = &trk->cluster[trk->entry - trk->cluster_start];
 
-    trk->cluster[trk->entry].pos              = avio_tell(pb) - size;
-    trk->cluster[trk->entry].samples_in_chunk = samples_in_chunk;
-    trk->cluster[trk->entry].chunkNum         = 0;
-    trk->cluster[trk->entry].size             = size;
-    trk->cluster[trk->entry].entries          = samples_in_chunk;
-    trk->cluster[trk->entry].dts              = pkt->dts;
-    trk->cluster[trk->entry].pts              = pkt->pts;
+    sample->pos     = avio_tell(pb) - size;
+    sample->size    = size;
+    sample->entries = samples_in_chunk;
+    sample->dts     = pkt->dts;
+    sample->pts     = pkt->pts;
     if (!trk->squash_fragment_samples_to_one &&
         !trk->entry && trk->start_dts != AV_NOPTS_VALUE) {
         if (!trk->frag_discont) {
@@ -5911,7 +6011,7 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
              * of the last packet of the previous fragment based on track_duration,
              * which might not exactly match our dts. Therefore adjust the dts
              * of this packet to be what the previous packets duration implies. */
-            trk->cluster[trk->entry].dts = trk->start_dts + trk->track_duration;
+            sample->dts = trk->start_dts + trk->track_duration;
             /* We also may have written the pts and the corresponding duration
              * in sidx/tfrf/tfxd tags; make sure the sidx pts and duration match up with
              * the next fragment. This means the cts of the first sample must
@@ -5920,7 +6020,7 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
             if ((mov->flags & FF_MOV_FLAG_DASH &&
                 !(mov->flags & (FF_MOV_FLAG_GLOBAL_SIDX | FF_MOV_FLAG_SKIP_SIDX))) ||
                 mov->mode == MODE_ISM)
-                pkt->pts = pkt->dts + trk->end_pts - trk->cluster[trk->entry].dts;
+                pkt->pts = pkt->dts + trk->end_pts - sample->dts;
         } else {
             /* New fragment, but discontinuous from previous fragments.
              * Pretend the duration sum of the earlier fragments is
@@ -5937,7 +6037,7 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
          * to signal the difference in starting time without an edit list.
          * Thus move the timestamp for this first sample to 0, increasing
          * its duration instead. */
-        trk->cluster[trk->entry].dts = trk->start_dts = 0;
+        sample->dts = trk->start_dts = 0;
     }
     if (trk->start_dts == AV_NOPTS_VALUE) {
         trk->start_dts = pkt->dts;
@@ -5969,44 +6069,43 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
     }
     if (pkt->dts != pkt->pts)
         trk->flags |= MOV_TRACK_CTTS;
-    trk->cluster[trk->entry].cts   = pkt->pts - pkt->dts;
-    trk->cluster[trk->entry].flags = 0;
+    sample->cts   = pkt->pts - pkt->dts;
+    sample->flags = 0;
     if (trk->start_cts == AV_NOPTS_VALUE)
         trk->start_cts = pkt->pts - pkt->dts;
     if (trk->end_pts == AV_NOPTS_VALUE)
-        trk->end_pts = trk->cluster[trk->entry].dts +
-                       trk->cluster[trk->entry].cts + pkt->duration;
+        trk->end_pts = sample->dts + sample->cts + pkt->duration;
     else
-        trk->end_pts = FFMAX(trk->end_pts, trk->cluster[trk->entry].dts +
-                                           trk->cluster[trk->entry].cts +
+        trk->end_pts = FFMAX(trk->end_pts, sample->dts + sample->cts +
                                            pkt->duration);
 
     if (par->codec_id == AV_CODEC_ID_VC1) {
-        mov_parse_vc1_frame(pkt, trk);
+        if ((ret = mov_parse_vc1_frame(pkt, trk)) < 0)
+            goto err;
     } else if (par->codec_id == AV_CODEC_ID_TRUEHD) {
         mov_parse_truehd_frame(pkt, trk);
     } else if (pkt->flags & AV_PKT_FLAG_KEY) {
         if (mov->mode == MODE_MOV && par->codec_id == AV_CODEC_ID_MPEG2VIDEO &&
             trk->entry > 0) { // force sync sample for the first key frame
-            mov_parse_mpeg2_frame(pkt, &trk->cluster[trk->entry].flags);
-            if (trk->cluster[trk->entry].flags & MOV_PARTIAL_SYNC_SAMPLE)
+            mov_parse_mpeg2_frame(pkt, &sample->flags);
+            if (sample->flags & MOV_PARTIAL_SYNC_SAMPLE)
                 trk->flags |= MOV_TRACK_STPS;
         } else {
-            trk->cluster[trk->entry].flags = MOV_SYNC_SAMPLE;
+            sample->flags = MOV_SYNC_SAMPLE;
         }
-        if (trk->cluster[trk->entry].flags & MOV_SYNC_SAMPLE)
+        if (sample->flags & MOV_SYNC_SAMPLE)
             trk->has_keyframes++;
     }
     if (pkt->flags & AV_PKT_FLAG_DISPOSABLE) {
-        trk->cluster[trk->entry].flags |= MOV_DISPOSABLE_SAMPLE;
+        sample->flags |= MOV_DISPOSABLE_SAMPLE;
         trk->has_disposable++;
     }
 
     prft = (AVProducerReferenceTime *)av_packet_get_side_data(pkt, AV_PKT_DATA_PRFT, &prft_size);
     if (prft && prft_size == sizeof(AVProducerReferenceTime))
-        memcpy(&trk->cluster[trk->entry].prft, prft, prft_size);
+        memcpy(&sample->prft, prft, prft_size);
     else
-        memset(&trk->cluster[trk->entry].prft, 0, sizeof(AVProducerReferenceTime));
+        memset(&sample->prft, 0, sizeof(AVProducerReferenceTime));
 
     trk->entry++;
     trk->sample_count += samples_in_chunk;
@@ -6467,6 +6566,7 @@ static void mov_free(AVFormatContext *s)
         else if (track->tag == MKTAG('t','m','c','d') && mov->nb_meta_tmcd)
             av_freep(&track->par);
         av_freep(&track->cluster);
+        mov_free_sample_tables(&track->tables);
         av_freep(&track->frag_info);
         av_packet_free(&track->cover_image);
 
@@ -6554,6 +6654,79 @@ static int mov_create_dvd_sub_decoder_specific_info(MOVTrack *track,
     return 0;
 }
 
+/*
+ * Estimate an upper bound of the moov atom size from the stream durations,
+ * before they are rescaled to the track timescales. Returns 0 if it can not
+ * be estimated.
+ */
+static int mov_estimate_moov_size(AVFormatContext *s)
+{
+    MOVMuxContext *mov = s->priv_data;
+    const AVDictionaryEntry *t = NULL;
+    int64_t size = 4096;
+
+    if (mov->flags & (FF_MOV_FLAG_FRAGMENT | FF_MOV_FLAG_RTP_HINT) ||
+        mov->encryption_scheme_str)
+        return 0;
+
+    while ((t = av_dict_get(s->metadata, "", t, AV_DICT_IGNORE_SUFFIX)))
+        size += 32 + strlen(t->key) + strlen(t->value);
+
+    /* chapter track and chpl, one sample and title per chapter */
+    if (s->nb_chapters)
+        size += 2048;
+    for (int i = 0; i < s->nb_chapters; i++) {
+        t = av_dict_get(s->chapters[i]->metadata, "title", NULL, 0);
+        size += 2 * (32 + (t ? strlen(t->value) : 0));
+    }
+
+    for (int i = 0; i < s->nb_streams; i++) {
+        const AVStream *st = s->streams[i];
+        const AVCodecParameters *par = st->codecpar;
+        int64_t nb_samples;
+
+        /* track, media and sample description boxes, timecode track */
+        size += 2 * 2048 + par->extradata_size;
+        t = NULL;
+        while ((t = av_dict_get(st->metadata, "", t, AV_DICT_IGNORE_SUFFIX)))
+            size += 32 + strlen(t->key) + strlen(t->value);
+
+        if (st->nb_frames > 0) {
+            nb_samples = st->nb_frames;
+        } else if (st->duration > 0) {
+            AVRational rate;
+
+            switch (par->codec_type) {
+            case AVMEDIA_TYPE_VIDEO:
+                rate = st->avg_frame_rate;
+                break;
+            case AVMEDIA_TYPE_AUDIO:
+                rate = (AVRational){ par->sample_rate, par->frame_size };
+                break;
+            default:
+                return 0;
+            }
+            if (rate.num <= 0 || rate.den <= 0)
+                return 0;
+            nb_samples = av_rescale_q_rnd(st->duration, st->time_base, av_inv_q(rate),
+                                          AV_ROUND_UP) + 1;
+        } else {
+            return 0;
+        }
+
+        /* at worst one entry per sample in every table, whatever the codec:
+         * stts, stsz, and one chunk per sample in stsc and co64, then stss,
+         * stps, sdtp, ctts, and the sbgp and sgpd pre-roll groups */
+        size += nb_samples * (8 + 4 + 12 + 8 +
+                              4 + 4 + 1 + 8 +
+                              8 + 2);
+        if (size > INT_MAX)
+            return 0;
+    }
+
+    return size;
+}
+
 static int mov_init(AVFormatContext *s)
 {
     MOVMuxContext *mov = s->priv_data;
@@ -6608,7 +6781,15 @@ static int mov_init(AVFormatContext *s)
         mov->flags &= ~FF_MOV_FLAG_SKIP_SIDX;
     }
 
-    if (mov->flags & FF_MOV_FLAG_FASTSTART) {
+    if (mov->reserved_moov_size < 0) {
+        mov->reserved_moov_size = mov_estimate_moov_size(s);
+        if (!mov->reserved_moov_size)
+            av_log(s, AV_LOG_WARNING, "Unable to estimate the moov size, not reserving space for it\n");
+    }
+
+    /* with a reserved size, faststart only moves the mdat if the moov does not fit */
+    if (mov->flags & FF_MOV_FLAG_FASTSTART &&
+        (!mov->reserved_moov_size || mov->flags & FF_MOV_FLAG_FRAGMENT)) {
         mov->reserved_moov_size = -1;
     }
 
@@ -7025,7 +7206,7 @@ static int mov_write_header(AVFormatContext *s)
             !mov->max_fragment_duration && !mov->max_fragment_size)
             mov->flags |= FF_MOV_FLAG_FRAG_KEYFRAME;
     } else {
-        if (mov->flags & FF_MOV_FLAG_FASTSTART)
+        if (mov->flags & FF_MOV_FLAG_FASTSTART && mov->reserved_moov_size < 0)
             mov->reserved_header_pos = avio_tell(pb);
         mov_write_mdat_tag(pb, mov);
     }
@@ -7174,6 +7355,74 @@ static int shift_data(AVFormatContext *s)
     return ff_format_shift_data(s, mov->reserved_header_pos, moov_size);
 }
 
+/*
+ * Write the moov atom into the space reserved with moov_size and pad the
+ * remainder with a free atom. With faststart, a moov atom which does not fit
+ * is still written in front of the mdat, by shifting it as much as needed.
+ */
+static int mov_write_reserved_moov(AVFormatContext *s, int64_t moov_pos)
+{
+    MOVMuxContext *mov = s->priv_data;
+    AVIOContext *pb = s->pb;
+    int reserved = mov->reserved_moov_size;
+    int moov_size, shift = 0, size, ret;
+
+    moov_size = get_moov_size(s);
+    if (moov_size < 0)
+        return moov_size;
+
+    if (moov_size + 8 > reserved) {
+        if (!(mov->flags & FF_MOV_FLAG_FASTSTART)) {
+            if (reserved < 8) {
+                av_log(s, AV_LOG_ERROR, "reserved_moov_size is too small, needed %d additional\n",
+                       moov_size + 8 - reserved);
+                return AVERROR(EINVAL);
+            }
+            av_log(s, AV_LOG_WARNING, "The moov atom (%d bytes) does not fit the %d "
+                   "reserved bytes, writing it at the end of the file\n",
+                   moov_size, reserved);
+            avio_seek(pb, mov->reserved_header_pos, SEEK_SET);
+            avio_wb32(pb, reserved);
+            ffio_wfourcc(pb, "free");
+            ffio_fill(pb, 0, reserved - 8);
+            avio_seek(pb, moov_pos, SEEK_SET);
+            return mov_write_moov_tag(pb, mov, s);
+        }
+        av_log(s, AV_LOG_WARNING, "The moov atom (%d bytes) does not fit the %d "
+               "reserved bytes, starting second pass: shifting the mdat\n",
+               moov_size, reserved);
+
+        /* the chunk offset table can switch from stco to co64 as the offsets
+         * grow, so recompute the size until it fits; the shift is rounded
+         * up so that the data is not moved in tiny blocks */
+        do {
+            int new_shift = FFALIGN(moov_size + 8 - reserved, 4096);
+            for (int i = 0; i < mov->nb_streams; i++)
+                mov->tracks[i].data_offset += new_shift - shift;
+            shift = new_shift;
+            moov_size = get_moov_size(s);
+            if (moov_size < 0)
+                return moov_size;
+        } while (moov_size + 8 > reserved + shift);
+
+        /* the data to shift ends at the current position */
+        avio_seek(pb, moov_pos, SEEK_SET);
+        if ((ret = ff_format_shift_data(s, mov->reserved_header_pos + reserved, shift)) < 0)
+            return ret;
+    }
+
+    avio_seek(pb, mov->reserved_header_pos, SEEK_SET);
+    if ((ret = mov_write_moov_tag(pb, mov, s)) < 0)
+        return ret;
+    size = reserved + shift - (avio_tell(pb) - mov->reserved_header_pos);
+    avio_wb32(pb, size);
+    ffio_wfourcc(pb, "free");
+    ffio_fill(pb, 0, size - 8);
+    avio_seek(pb, moov_pos + shift, SEEK_SET);
+
+    return 0;
+}
+
 static int mov_write_trailer(AVFormatContext *s)
 {
     MOVMuxContext *mov = s->priv_data;
@@ -7245,7 +7494,10 @@ static int mov_write_trailer(AVFormatContext *s)
         }
         avio_seek(pb, mov->reserved_moov_size > 0 ? mov->reserved_header_pos : moov_pos, SEEK_SET);
 
-        if (mov->flags & FF_MOV_FLAG_FASTSTART) {
+        if (mov->reserved_moov_size > 0) {
+            if ((res = mov_write_reserved_moov(s, moov_pos)) < 0)
+                return res;
+        } else if (mov->flags & FF_MOV_FLAG_FASTSTART) {
             av_log(s, AV_LOG_INFO, "Starting second pass: moving the moov atom to the beginning of the file\n");
             res = shift_data(s);
             if (res < 0)
@@ -7253,19 +7505,6 @@ static int mov_write_trailer(AVFormatContext *s)
             avio_seek(pb, mov->reserved_header_pos, SEEK_SET);
             if ((res = mov_write_moov_tag(pb, mov, s)) < 0)
                 return res;
-        } else if (mov->reserved_moov_size > 0) {
-            int64_t size;
-            if ((res = mov_write_moov_tag(pb, mov, s)) < 0)
-                return res;
-            size = mov->reserved_moov_size - (avio_tell(pb) - mov->reserved_header_pos);
-            if (size < 8){
-                av_log(s, AV_LOG_ERROR, "reserved_moov_size is too small, needed %"PRId64" additional\n", 8-size);
-                return AVERROR(EINVAL);
-            }
-            avio_wb32(pb, size);
-            ffio_wfourcc(pb, "free");
-            ffio_fill(pb, 0, size - 8);
-            avio_seek(pb, moov_pos, SEEK_SET);
         } else {
             if ((res = mov_write_moov_tag(pb, mov, s)) < 0)
                 return res;
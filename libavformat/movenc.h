@@ -49,8 +49,6 @@ typedef struct MOVIentry {
     int64_t      dts;
     int64_t      pts;
     unsigned int size;
-    unsigned int samples_in_chunk;
-    unsigned int chunkNum;              ///< Chunk number if the current entry is a chunk start otherwise 0
     unsigned int entries;
     int          cts;
 #define MOV_SYNC_SAMPLE         0x0001
@@ -60,6 +58,40 @@ typedef struct MOVIentry {
     AVProducerReferenceTime prft;
 } MOVIentry;
 
+typedef struct MOVSampleRun {
+    unsigned int count;
+    uint32_t     value;
+} MOVSampleRun;
+
+typedef struct MOVRunTable {
+    MOVSampleRun *runs;
+    unsigned int  nb_runs;
+    unsigned int  runs_size;
+} MOVRunTable;
+
+/**
+ * Run-length coded sample tables. Entries are folded into them while
+ * muxing, so that the index takes memory in proportion to the number of
+ * runs rather than to the number of samples.
+ */
+typedef struct MOVSampleTables {
+    MOVRunTable durations;      ///< sample durations, per entry
+    MOVRunTable cts;            ///< composition time offsets, per entry
+    MOVRunTable flags;          ///< MOV_*_SAMPLE flags, per entry
+    MOVRunTable sizes;          ///< sample sizes, per sample
+    MOVRunTable chunk_samples;  ///< samples per chunk, all but the last chunk
+    uint64_t    *chunk_offsets;
+    unsigned int chunk_offsets_size;
+    unsigned int nb_chunks;
+    unsigned int last_chunk_samples;
+    uint64_t    last_chunk_size;
+    unsigned int nb_entries;
+    uint64_t    last_pos;       ///< position of the last entry
+    uint64_t    data_size;
+    int64_t     first_dts;
+    int         first_cts;
+} MOVSampleTables;
+
 typedef struct HintSample {
     uint8_t *data;
     int size;
@@ -91,7 +123,6 @@ typedef struct MOVTrack {
     int         last_sample_is_subtitle_end;
     long        sample_count;
     long        sample_size;
-    long        chunkCount;
     int         has_keyframes;
     int         has_disposable;
 #define MOV_TRACK_CTTS         0x0001
@@ -114,6 +145,8 @@ typedef struct MOVTrack {
     uint8_t     *vos_data;
     MOVIentry   *cluster;
     unsigned    cluster_capacity;
+    int         cluster_start; ///< index of the entry in cluster[0], the ones before are in tables
+    MOVSampleTables tables;
     int         audio_vbr;
     int         height; ///< active picture (w/o VBI) height for D-10/IMX
     uint32_t    tref_tag;
@@ -0,0 +1,147 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Prefetch windows of the async protocol over a local file: a jump into or
+ * shortly after a buffered range reuses its window, other jumps replace the
+ * least recently used window, and every window is topped up in the
+ * background while the reads are served from another one.
+ */
+
+#include "libavformat/async.c"
+
+#include "libavutil/lfg.h"
+
+#define KB          1024
+#define FILE_SIZE   (4096 * KB + 123)
+#define PREFETCH    (64 * KB)
+#define READ_BACK   (16 * KB)
+#define NB_WINDOWS  3
+
+static uint8_t data[FILE_SIZE];
+
+static int write_file(const char *path)
+{
+    FILE *f = fopen(path, "wb");
+    int ret;
+
+    if (!f)
+        return 1;
+    ret = fwrite(data, 1, FILE_SIZE, f) != FILE_SIZE;
+    ret |= fclose(f);
+    return ret;
+}
+
+static int open_async(URLContext **h, const char *path)
+{
+    AVDictionary *opts = NULL;
+    char *url = av_asprintf("async:file:%s", path);
+    int ret;
+
+    if (!url)
+        return AVERROR(ENOMEM);
+    av_dict_set_int(&opts, "prefetch_size", PREFETCH, 0);
+    av_dict_set_int(&opts, "read_back_size", READ_BACK, 0);
+    av_dict_set_int(&opts, "prefetch_windows", NB_WINDOWS, 0);
+    ret = ffurl_open_whitelist(h, url, AVIO_FLAG_READ, NULL, &opts,
+                               NULL, NULL, NULL);
+    av_dict_free(&opts);
+    av_free(url);
+    return ret;
+}
+
+/* wait until every window in use is full or at the end of the input */
+static void wait_filled(Context *c)
+{
+    pthread_mutex_lock(&c->mutex);
+    while (1) {
+        int pending = 0;
+        for (int i = 0; i < c->nb_windows; i++)
+            pending |= c->windows[i].last_used && window_can_fill(&c->windows[i]);
+        if (!pending)
+            break;
+        pthread_cond_signal(&c->cond_wakeup_background);
+        pthread_cond_wait(&c->cond_wakeup_main, &c->mutex);
+    }
+    pthread_mutex_unlock(&c->mutex);
+}
+
+/* seek to pos, read size bytes in chunks, compare them with the file
+ * content and print the window they were served from */
+static int check_jump(URLContext *h, const char *name, int64_t pos, int size)
+{
+    Context *c = h->priv_data;
+    uint8_t buf[1000];
+    int len = 0, ret;
+
+    wait_filled(c);
+    ret = ffurl_seek(h, pos, SEEK_SET) != pos;
+    while (!ret && len < size) {
+        int n = ffurl_read(h, buf, FFMIN(size - len, sizeof(buf)));
+        if (n == AVERROR_EOF)
+            break;
+        ret = n <= 0 || memcmp(buf, data + pos + len, n);
+        len += n;
+    }
+    ret |= len != FFMIN(size, FILE_SIZE - pos);
+
+    pthread_mutex_lock(&c->mutex);
+    printf("%s: window %d, starting at %"PRId64": %s\n", name, c->active,
+           c->windows[c->active].ring.pos, ret ? "FAIL" : "OK");
+    pthread_mutex_unlock(&c->mutex);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    URLContext *h = NULL;
+    AVLFG lfg;
+    int ret = 0;
+
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <temporary file>\n", argv[0]);
+        return 1;
+    }
+
+    av_lfg_init(&lfg, 1);
+    for (int i = 0; i < FILE_SIZE; i++)
+        data[i] = av_lfg_get(&lfg);
+    if (write_file(argv[1]) || open_async(&h, argv[1]) < 0)
+        return 1;
+
+    ret |= check_jump(h, "start", 0, 20 * KB);
+    /* within the read back data and shortly after the buffered data, the
+     * window is read forwards up to the position */
+    ret |= check_jump(h, "backward in read back", 10 * KB, 1000);
+    ret |= check_jump(h, "short forward", 200 * KB, 1000);
+    /* far jumps take the unused windows first */
+    ret |= check_jump(h, "far forward", 1000 * KB, 1000);
+    ret |= check_jump(h, "far forward again", 2000 * KB, 1000);
+    /* the ranges prefetched in the other windows are reused */
+    ret |= check_jump(h, "back to first range", 201 * KB, PREFETCH);
+    ret |= check_jump(h, "back to second range", 1001 * KB, 1000);
+    /* the third range is then the least recently used one, and the first
+     * range after it */
+    ret |= check_jump(h, "far forward, replacing", 3000 * KB, 1000);
+    ret |= check_jump(h, "far backward, replacing", 640 * KB, 1000);
+    ret |= check_jump(h, "second range kept", 1002 * KB, 1000);
+    ret |= check_jump(h, "end", FILE_SIZE - 1000, 2000);
+    ffurl_closep(&h);
+    remove(argv[1]);
+    return ret;
+}
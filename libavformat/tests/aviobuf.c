@@ -0,0 +1,157 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Adaptive read buffer of an AVIOContext over a dummy protocol which logs
+ * the size of the reads and the access hints it receives: the buffer grows
+ * up to max_buffer_size on sequential reads and shrinks back after seeks.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/error.h"
+#include "libavutil/lfg.h"
+#include "libavutil/mem.h"
+#include "libavformat/avio_internal.h"
+#include "libavformat/url.h"
+
+#define DATA_SIZE       (4 << 20)
+#define MAX_BUFFER_SIZE (256 << 10)
+
+static uint8_t data[DATA_SIZE];
+
+static struct {
+    int64_t pos;
+    int     last_read_size;
+    int     nb_reads;
+    int     nb_seeks;
+} dummy;
+
+static int dummy_read(URLContext *h, unsigned char *buf, int size)
+{
+    if (dummy.pos >= DATA_SIZE)
+        return AVERROR_EOF;
+    size = FFMIN(size, DATA_SIZE - dummy.pos);
+    memcpy(buf, data + dummy.pos, size);
+    dummy.pos += size;
+    dummy.nb_reads++;
+    if (size != dummy.last_read_size && dummy.pos < DATA_SIZE)
+        printf("read size %d\n", size);
+    dummy.last_read_size = size;
+    return size;
+}
+
+static int64_t dummy_seek(URLContext *h, int64_t pos, int whence)
+{
+    if (whence == AVSEEK_SIZE)
+        return DATA_SIZE;
+    if (whence != SEEK_SET || pos < 0)
+        return AVERROR(EINVAL);
+    dummy.nb_seeks++;
+    return dummy.pos = pos;
+}
+
+static int dummy_advise(URLContext *h, int64_t offset, int64_t len,
+                        enum URLAdvice advice)
+{
+    static const char *const names[] = {
+        [URL_ADVISE_NORMAL]     = "normal",
+        [URL_ADVISE_SEQUENTIAL] = "sequential",
+        [URL_ADVISE_WILLNEED]   = "willneed",
+    };
+
+    printf("advice %s %"PRId64" %"PRId64"\n", names[advice], offset, len);
+    return 0;
+}
+
+static const URLProtocol dummy_protocol = {
+    .name       = "dummy",
+    .url_read   = dummy_read,
+    .url_seek   = dummy_seek,
+    .url_advise = dummy_advise,
+};
+
+/* read size bytes at pos in small reads and compare them with the data */
+static int check_read(AVIOContext *pb, int64_t pos, int size)
+{
+    uint8_t buf[4096];
+    int len = 0;
+
+    if (avio_seek(pb, pos, SEEK_SET) != pos)
+        return 1;
+    while (len < size) {
+        int n = avio_read(pb, buf, FFMIN(size - len, sizeof(buf)));
+        if (n <= 0 || memcmp(buf, data + pos + len, n))
+            return 1;
+        len += n;
+    }
+    return 0;
+}
+
+int main(void)
+{
+    URLContext h = {
+        .av_class        = &ffurl_context_class,
+        .prot            = &dummy_protocol,
+        .flags           = AVIO_FLAG_READ,
+        .max_buffer_size = MAX_BUFFER_SIZE,
+    };
+    AVIOContext *pb = NULL;
+    AVLFG lfg;
+    int ret;
+
+    av_lfg_init(&lfg, 1);
+    for (int i = 0; i < DATA_SIZE; i++)
+        data[i] = av_lfg_get(&lfg);
+
+    if (ffio_fdopen(&pb, &h) < 0)
+        return 1;
+
+    /* the buffer doubles after four refills without seeks, sequential
+     * access is signalled when it first grows, and while it is enlarged
+     * every refill is followed by a hint for the next one */
+    printf("sequential read\n");
+    ret = check_read(pb, 0, DATA_SIZE / 2);
+    printf("buffer size %d, %d reads, %d seeks: %s\n", pb->buffer_size,
+           dummy.nb_reads, dummy.nb_seeks, ret ? "FAIL" : "OK");
+
+    /* every second seek done before a buffer's worth of data was read
+     * halves the buffer, normal access is signalled at the initial size */
+    printf("seeks\n");
+    ret = 0;
+    dummy.nb_reads = dummy.nb_seeks = 0;
+    for (int i = 0; i < 8; i++)
+        ret |= check_read(pb, (i & 1 ? 0 : DATA_SIZE / 2) + i * 1000, 1000);
+    printf("buffer size %d, %d reads, %d seeks: %s\n", pb->buffer_size,
+           dummy.nb_reads, dummy.nb_seeks, ret ? "FAIL" : "OK");
+
+    /* seeks after reading more than a buffer's worth do not shrink it */
+    printf("long reads after seeks\n");
+    ret = check_read(pb, 100000, 500000);
+    dummy.nb_reads = dummy.nb_seeks = 0;
+    for (int i = 0; i < 4; i++)
+        ret |= check_read(pb, (i & 1 ? 0 : DATA_SIZE / 2) + i * 1000, MAX_BUFFER_SIZE + 1);
+    printf("buffer size %d, %d reads, %d seeks: %s\n", pb->buffer_size,
+           dummy.nb_reads, dummy.nb_seeks, ret ? "FAIL" : "OK");
+
+    av_freep(&pb->buffer);
+    avio_context_free(&pb);
+    return 0;
+}
@@ -0,0 +1,396 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Block cache of the cache protocol over a minimal HTTP server on the
+ * loopback interface: the memory tier evicts the least recently used block,
+ * the disk tier serves the blocks of a later open while the ETag or
+ * Last-Modified header of the resource is unchanged, is not used without a
+ * validator and stays under disk_cache_size. Local files are validated by
+ * their modification time.
+ */
+
+#include "libavformat/cache.c"
+
+#include <signal.h>
+
+#include "libavutil/lfg.h"
+#include "libavutil/thread.h"
+#include "libavformat/network.h"
+
+#define BLOCK_SIZE 4096
+#define NB_BLOCKS  11
+#define FILE_SIZE  ((NB_BLOCKS - 1) * BLOCK_SIZE + 100)
+#define MAX_CONNS  64
+
+static uint8_t data[FILE_SIZE + 1];
+
+static struct {
+    int             fd;
+    pthread_t       thread;
+    pthread_t       conns[MAX_CONNS];
+    int             nb_conns;
+    pthread_mutex_t mutex;
+    /* headers of the resource, empty when not sent */
+    char            etag[32];
+    char            last_modified[64];
+} server;
+
+static void fill_data(unsigned seed)
+{
+    AVLFG lfg;
+
+    av_lfg_init(&lfg, seed);
+    for (int i = 0; i < sizeof(data); i++)
+        data[i] = av_lfg_get(&lfg);
+}
+
+/* change the content of the resource, keeping its size */
+static void set_resource(unsigned seed, const char *etag, const char *last_modified)
+{
+    pthread_mutex_lock(&server.mutex);
+    fill_data(seed);
+    av_strlcpy(server.etag, etag, sizeof(server.etag));
+    av_strlcpy(server.last_modified, last_modified, sizeof(server.last_modified));
+    pthread_mutex_unlock(&server.mutex);
+}
+
+static int send_all(int fd, const void *buf, int size)
+{
+    const uint8_t *p = buf;
+
+    while (size > 0) {
+        int ret = send(fd, p, size, 0);
+        if (ret <= 0)
+            return -1;
+        p    += ret;
+        size -= ret;
+    }
+    return 0;
+}
+
+/* serve GET requests with an optional Range on a persistent connection */
+static void *serve_connection(void *arg)
+{
+    int fd = (intptr_t)arg;
+    char req[4096] = "", head[512];
+    int len = 0;
+
+    while (1) {
+        char *end = NULL, *range;
+        int64_t start = 0, last = FILE_SIZE - 1;
+        int n, ret;
+
+        while (!(end = strstr(req, "\r\n\r\n"))) {
+            n = recv(fd, req + len, sizeof(req) - 1 - len, 0);
+            if (n <= 0)
+                goto end;
+            len += n;
+            req[len] = 0;
+        }
+        end += 4;
+
+        if ((range = av_stristr(req, "\r\nRange: bytes="))) {
+            char *p;
+            start = strtoll(range + 15, &p, 10);
+            if (*p == '-' && p[1] >= '0' && p[1] <= '9')
+                last = FFMIN(strtoll(p + 1, NULL, 10), FILE_SIZE - 1);
+            n = snprintf(head, sizeof(head), "HTTP/1.1 206 Partial Content\r\n"
+                         "Content-Range: bytes %"PRId64"-%"PRId64"/%d\r\n",
+                         start, last, FILE_SIZE);
+        } else {
+            n = snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\n");
+        }
+        pthread_mutex_lock(&server.mutex);
+        if (*server.etag)
+            n += snprintf(head + n, sizeof(head) - n, "ETag: %s\r\n", server.etag);
+        if (*server.last_modified)
+            n += snprintf(head + n, sizeof(head) - n, "Last-Modified: %s\r\n",
+                          server.last_modified);
+        n += snprintf(head + n, sizeof(head) - n, "Accept-Ranges: bytes\r\n"
+                      "Content-Length: %"PRId64"\r\n\r\n", last - start + 1);
+
+        len -= end - req;
+        memmove(req, end, len + 1);
+
+        ret = send_all(fd, head, n) < 0 ||
+              send_all(fd, data + start, last - start + 1) < 0;
+        pthread_mutex_unlock(&server.mutex);
+        if (ret)
+            break;
+    }
+end:
+    closesocket(fd);
+    return NULL;
+}
+
+static void *serve(void *arg)
+{
+    while (1) {
+        int fd = accept(server.fd, NULL, NULL), one = 1;
+        if (fd < 0)
+            break;
+        /* the header and the body are sent separately */
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (server.nb_conns == MAX_CONNS ||
+            pthread_create(&server.conns[server.nb_conns], NULL,
+                           serve_connection, (void *)(intptr_t)fd)) {
+            closesocket(fd);
+            continue;
+        }
+        server.nb_conns++;
+    }
+    return NULL;
+}
+
+static int server_start(void)
+{
+    struct sockaddr_in addr = { 0 };
+    socklen_t addrlen = sizeof(addr);
+
+    server.fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (server.fd < 0)
+        return -1;
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(server.fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(server.fd, 16) < 0 ||
+        getsockname(server.fd, (struct sockaddr *)&addr, &addrlen) < 0)
+        return -1;
+    pthread_mutex_init(&server.mutex, NULL);
+    if (pthread_create(&server.thread, NULL, serve, NULL))
+        return -1;
+    return ntohs(addr.sin_port);
+}
+
+static void server_stop(void)
+{
+    shutdown(server.fd, SHUT_RDWR);
+    closesocket(server.fd);
+    pthread_join(server.thread, NULL);
+    for (int i = 0; i < server.nb_conns; i++)
+        pthread_join(server.conns[i], NULL);
+    pthread_mutex_destroy(&server.mutex);
+}
+
+static int write_file(const char *path, int size, time_t mtime)
+{
+    struct utimbuf times = { mtime, mtime };
+    FILE *f = fopen(path, "wb");
+    int ret;
+
+    if (!f)
+        return 1;
+    ret = fwrite(data, 1, size, f) != size;
+    ret |= fclose(f);
+    return ret || utime(path, &times) < 0;
+}
+
+static int open_cache(URLContext **h, const char *url, const char *dir,
+                      int64_t disk_cache_size)
+{
+    AVDictionary *opts = NULL;
+    char *cache_url = av_asprintf("cache:%s", url);
+    int ret;
+
+    if (!cache_url)
+        return AVERROR(ENOMEM);
+    av_dict_set_int(&opts, "block_size", BLOCK_SIZE, 0);
+    av_dict_set_int(&opts, "mem_cache_size", 3 * BLOCK_SIZE, 0);
+    av_dict_set_int(&opts, "prefetch_blocks", 0, 0);
+    av_dict_set(&opts, "cache_dir", dir, 0);
+    av_dict_set_int(&opts, "disk_cache_size", disk_cache_size, 0);
+    ret = ffurl_open_whitelist(h, cache_url, AVIO_FLAG_READ, NULL, &opts,
+                               NULL, NULL, NULL);
+    av_dict_free(&opts);
+    av_free(cache_url);
+    return ret;
+}
+
+/* read [pos, pos + size) in chunks and compare it with the resource */
+static int check_read(URLContext *h, int64_t pos, int size, int file_size)
+{
+    uint8_t buf[BLOCK_SIZE];
+    int len = 0;
+
+    if (ffurl_seek(h, pos, SEEK_SET) != pos)
+        return 1;
+    while (len < size) {
+        int n = ffurl_read(h, buf, FFMIN(size - len, 1000));
+        if (n == AVERROR_EOF)
+            break;
+        if (n <= 0 || memcmp(buf, data + pos + len, n))
+            return 1;
+        len += n;
+    }
+    return len != FFMIN(size, file_size - pos);
+}
+
+static int check_block(URLContext *h, int64_t index)
+{
+    return check_read(h, index * BLOCK_SIZE, BLOCK_SIZE, FILE_SIZE);
+}
+
+static void print_stats(const char *name, URLContext *h, int ret)
+{
+    Context *c = h->priv_data;
+
+    printf("%s: misses %"PRId64", disk hits %"PRId64", memory hits %"PRId64": %s\n",
+           name, c->cache_miss, c->disk_hit, c->cache_hit, ret ? "FAIL" : "OK");
+}
+
+/* open the resource and read it whole */
+static int read_whole(const char *name, const char *url, const char *dir)
+{
+    URLContext *h = NULL;
+    int ret;
+
+    if (open_cache(&h, url, dir, 0) < 0)
+        return 1;
+    ret = check_read(h, 0, FILE_SIZE, FILE_SIZE);
+    print_stats(name, h, ret);
+    ffurl_closep(&h);
+    return 0;
+}
+
+/* total size of the block files in dir, removing them if clean is set */
+static int64_t dir_size(const char *dir, int clean)
+{
+    DIR *d = opendir(dir);
+    struct dirent *entry;
+    int64_t size = 0;
+
+    if (!d)
+        return -1;
+    while ((entry = readdir(d))) {
+        char *path;
+        struct stat st;
+
+        if (entry->d_name[0] == '.')
+            continue;
+        path = av_asprintf("%s/%s", dir, entry->d_name);
+        if (path && !stat(path, &st))
+            size += st.st_size;
+        if (path && clean)
+            unlink(path);
+        av_free(path);
+    }
+    closedir(d);
+    return size;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path, *dir;
+    URLContext *h = NULL;
+    Context *c;
+    char url[64];
+    int port, ret;
+
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <temporary file> <temporary directory>\n", argv[0]);
+        return 1;
+    }
+    path = argv[1];
+    dir  = argv[2];
+
+#ifdef SIGPIPE
+    signal(SIGPIPE, SIG_IGN);
+#endif
+    if (mkdir(dir, 0777) < 0 && errno != EEXIST)
+        return 1;
+    dir_size(dir, 1);
+
+    if ((port = server_start()) < 0) {
+        fprintf(stderr, "Could not start the server\n");
+        return 1;
+    }
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/data", port);
+    set_resource(1, "\"1\"", "");
+
+    /* every block is missed once, the last three stay in memory */
+    if (open_cache(&h, url, dir, 0) < 0)
+        return 1;
+    c = h->priv_data;
+    ret = check_read(h, 0, FILE_SIZE + 1, FILE_SIZE);
+    print_stats("first read", h, ret);
+
+    /* 0 comes from disk and evicts 8, 9 moves to the front, 5 comes from
+     * disk and evicts 10, which is then the least recently used */
+    ret  = check_block(h, 0);
+    ret |= check_block(h, 9);
+    ret |= check_block(h, 5);
+    ret |= find_block(c, 8) || find_block(c, 10) ||
+           !find_block(c, 0) || !find_block(c, 9) || !find_block(c, 5);
+    ret |= c->lru_first->index != 5 || c->lru_last->index != 0;
+    print_stats("least recently used", h, ret);
+    ffurl_closep(&h);
+
+    /* a later open is served from disk while the validators are unchanged,
+     * a resource of the same size with another one is read again */
+    if (read_whole("same etag", url, dir))
+        return 1;
+    set_resource(2, "\"2\"", "");
+    if (read_whole("changed etag", url, dir))
+        return 1;
+
+    set_resource(3, "", "Mon, 02 Jan 2023 10:00:00 GMT");
+    if (read_whole("last modified", url, dir) ||
+        read_whole("same last modified", url, dir))
+        return 1;
+    set_resource(4, "", "Mon, 02 Jan 2023 10:00:01 GMT");
+    if (read_whole("changed last modified", url, dir))
+        return 1;
+
+    /* without a validator a change could not be detected, the disk tier
+     * is not used */
+    set_resource(5, "", "");
+    if (read_whole("no validator", url, dir))
+        return 1;
+    set_resource(6, "", "");
+    if (read_whole("no validator, changed", url, dir))
+        return 1;
+
+    /* local files are validated by their modification time */
+    fill_data(7);
+    if (write_file(path, FILE_SIZE, 1000000000) ||
+        read_whole("file", path, dir) ||
+        read_whole("same file", path, dir))
+        return 1;
+    fill_data(8);
+    if (write_file(path, FILE_SIZE, 1000000001) ||
+        read_whole("changed file", path, dir))
+        return 1;
+
+    /* the least recently used files are deleted down to the limit on open,
+     * the directory is then trimmed whenever it grows past it */
+    set_resource(9, "\"9\"", "");
+    if (open_cache(&h, url, dir, 8 * BLOCK_SIZE) < 0)
+        return 1;
+    ret = dir_size(dir, 0) > 8 * BLOCK_SIZE;
+    ret |= check_read(h, 0, FILE_SIZE, FILE_SIZE);
+    ret |= dir_size(dir, 0) > 8 * BLOCK_SIZE;
+    ffurl_closep(&h);
+    printf("disk cache size limit: %s\n", ret ? "FAIL" : "OK");
+
+    server_stop();
+    dir_size(dir, 1);
+    rmdir(dir);
+    remove(path);
+    return 0;
+}
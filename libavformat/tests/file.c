@@ -0,0 +1,138 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Read a file with each read_mode of the file protocol: sequentially, after
+ * seeks and, where the mode allows it, after the file has grown while open.
+ * io_uring falls back to read() where the kernel does not support it, the
+ * output is the same either way.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/dict.h"
+#include "libavutil/error.h"
+#include "libavutil/lfg.h"
+#include "libavformat/url.h"
+
+#define BLOCK_SIZE 4096
+#define FILE_SIZE  (3 * BLOCK_SIZE + 1000)
+#define GROW_SIZE  3000
+
+static uint8_t data[FILE_SIZE + GROW_SIZE];
+
+static int write_file(const char *path, const uint8_t *buf, int size, const char *mode)
+{
+    FILE *f = fopen(path, mode);
+    int ret;
+
+    if (!f)
+        return 1;
+    ret = fwrite(buf, 1, size, f) != size;
+    ret |= fclose(f);
+    return ret;
+}
+
+/* read size bytes at pos and compare them with the file content */
+static int check_read(URLContext *h, int64_t pos, int size, int file_size)
+{
+    uint8_t buf[2 * BLOCK_SIZE];
+    int64_t ret = ffurl_seek(h, pos, SEEK_SET);
+    int len = 0;
+
+    if (ret != pos)
+        return 1;
+    while (len < size) {
+        int n = ffurl_read(h, buf + len, size - len);
+        if (n == AVERROR_EOF)
+            break;
+        if (n <= 0)
+            return 1;
+        len += n;
+    }
+    return len != FFMIN(size, FFMAX(file_size - pos, 0)) || memcmp(buf, data + pos, len);
+}
+
+static int test_mode(const char *path, const char *mode, int grow)
+{
+    AVDictionary *opts = NULL;
+    URLContext *h = NULL;
+    AVLFG lfg;
+    int ret;
+
+    if (write_file(path, data, FILE_SIZE, "wb"))
+        return 1;
+
+    av_dict_set(&opts, "read_mode", mode, 0);
+    av_dict_set_int(&opts, "io_uring_depth", 2, 0);
+    av_dict_set_int(&opts, "io_uring_block_size", BLOCK_SIZE, 0);
+    ret = ffurl_open_whitelist(&h, path, AVIO_FLAG_READ, NULL, &opts,
+                               NULL, NULL, NULL);
+    av_dict_free(&opts);
+    if (ret < 0)
+        return 1;
+
+    /* sequential, across the blocks queued ahead and the end of the file */
+    for (int64_t pos = 0; pos < FILE_SIZE + BLOCK_SIZE; pos += 1500)
+        ret |= check_read(h, pos, 1500, FILE_SIZE);
+
+    /* backward and forward seeks, in and out of the readahead window */
+    av_lfg_init(&lfg, 0x5eed);
+    for (int i = 0; i < 200; i++) {
+        int64_t pos = av_lfg_get(&lfg) % FILE_SIZE;
+        ret |= check_read(h, pos, 1 + av_lfg_get(&lfg) % (2 * BLOCK_SIZE), FILE_SIZE);
+    }
+
+    /* the last block is read short, then the file grows: reading on from
+     * the end of that block must return the appended data */
+    if (grow) {
+        ret |= check_read(h, 3 * BLOCK_SIZE, FILE_SIZE - 3 * BLOCK_SIZE, FILE_SIZE);
+        ret |= write_file(path, data + FILE_SIZE, GROW_SIZE, "ab");
+        ret |= check_read(h, FILE_SIZE, GROW_SIZE, FILE_SIZE + GROW_SIZE);
+        ret |= check_read(h, 3 * BLOCK_SIZE, 2 * BLOCK_SIZE, FILE_SIZE + GROW_SIZE);
+        ret |= check_read(h, FILE_SIZE + GROW_SIZE, 10, FILE_SIZE + GROW_SIZE);
+    }
+
+    ffurl_closep(&h);
+
+    printf("read_mode %s: %s\n", mode, ret ? "FAIL" : "OK");
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    AVLFG lfg;
+    int ret = 0;
+
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <temporary file>\n", argv[0]);
+        return 1;
+    }
+
+    av_lfg_init(&lfg, 1);
+    for (int i = 0; i < sizeof(data); i++)
+        data[i] = av_lfg_get(&lfg);
+
+    ret |= test_mode(argv[1], "read",     1);
+    ret |= test_mode(argv[1], "mmap",     0);
+    ret |= test_mode(argv[1], "io_uring", 1);
+
+    remove(argv[1]);
+    return ret;
+}
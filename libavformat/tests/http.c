@@ -0,0 +1,263 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Read a resource with parallel range requests from a minimal HTTP server
+ * on the loopback interface, and check that it is split into aligned
+ * request_size chunks which are reassembled in order, also across seeks.
+ */
+
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/lfg.h"
+#include "libavutil/thread.h"
+#include "libavformat/network.h"
+#include "libavformat/url.h"
+
+#define REQUEST_SIZE 4096
+#define DATA_SIZE    (10 * REQUEST_SIZE + 123)
+#define NB_CHUNKS    ((DATA_SIZE + REQUEST_SIZE - 1) / REQUEST_SIZE)
+#define MAX_CONNS    64
+
+static uint8_t data[DATA_SIZE];
+
+static struct {
+    int             fd;
+    pthread_t       thread;
+    pthread_t       conns[MAX_CONNS];
+    int             nb_conns;
+    pthread_mutex_t mutex;
+    /* range requests other than the initial open */
+    int             nb_chunk_requests;
+    int             unaligned;
+    int             chunk_requests[NB_CHUNKS];
+} server;
+
+static int send_all(int fd, const void *buf, int size)
+{
+    const uint8_t *p = buf;
+
+    while (size > 0) {
+        int ret = send(fd, p, size, 0);
+        if (ret <= 0)
+            return -1;
+        p    += ret;
+        size -= ret;
+    }
+    return 0;
+}
+
+static void log_range(int64_t start, int64_t end, int has_end)
+{
+    pthread_mutex_lock(&server.mutex);
+    if (has_end) {
+        int64_t index = start / REQUEST_SIZE;
+        server.nb_chunk_requests++;
+        if (start % REQUEST_SIZE || index >= NB_CHUNKS ||
+            end != FFMIN(start + REQUEST_SIZE, DATA_SIZE) - 1)
+            server.unaligned++;
+        else
+            server.chunk_requests[index]++;
+    }
+    pthread_mutex_unlock(&server.mutex);
+}
+
+/* serve GET requests with an optional Range on a persistent connection */
+static void *serve_connection(void *arg)
+{
+    int fd = (intptr_t)arg;
+    char req[4096] = "", head[256];
+    int len = 0;
+
+    while (1) {
+        char *end = NULL, *range;
+        int64_t start = 0, last = DATA_SIZE - 1;
+        int has_end = 0, n;
+
+        while (!(end = strstr(req, "\r\n\r\n"))) {
+            n = recv(fd, req + len, sizeof(req) - 1 - len, 0);
+            if (n <= 0)
+                goto end;
+            len += n;
+            req[len] = 0;
+        }
+        end += 4;
+
+        if ((range = av_stristr(req, "\r\nRange: bytes="))) {
+            char *p;
+            start = strtoll(range + 15, &p, 10);
+            if (*p == '-' && p[1] >= '0' && p[1] <= '9') {
+                last    = FFMIN(strtoll(p + 1, NULL, 10), DATA_SIZE - 1);
+                has_end = 1;
+            }
+            log_range(start, last, has_end);
+            n = snprintf(head, sizeof(head), "HTTP/1.1 206 Partial Content\r\n"
+                         "Content-Range: bytes %"PRId64"-%"PRId64"/%d\r\n",
+                         start, last, DATA_SIZE);
+        } else {
+            n = snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\n");
+        }
+        n += snprintf(head + n, sizeof(head) - n, "Accept-Ranges: bytes\r\n"
+                      "Content-Length: %"PRId64"\r\n\r\n", last - start + 1);
+
+        len -= end - req;
+        memmove(req, end, len + 1);
+
+        if (send_all(fd, head, n) < 0 ||
+            send_all(fd, data + start, last - start + 1) < 0)
+            break;
+    }
+end:
+    closesocket(fd);
+    return NULL;
+}
+
+static void *serve(void *arg)
+{
+    while (1) {
+        int fd = accept(server.fd, NULL, NULL), one = 1;
+        if (fd < 0)
+            break;
+        /* the header and the body are sent separately */
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (server.nb_conns == MAX_CONNS ||
+            pthread_create(&server.conns[server.nb_conns], NULL,
+                           serve_connection, (void *)(intptr_t)fd)) {
+            closesocket(fd);
+            continue;
+        }
+        server.nb_conns++;
+    }
+    return NULL;
+}
+
+static int server_start(void)
+{
+    struct sockaddr_in addr = { 0 };
+    socklen_t addrlen = sizeof(addr);
+    int port;
+
+    server.fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (server.fd < 0)
+        return -1;
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(server.fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(server.fd, 16) < 0 ||
+        getsockname(server.fd, (struct sockaddr *)&addr, &addrlen) < 0)
+        return -1;
+    port = ntohs(addr.sin_port);
+    pthread_mutex_init(&server.mutex, NULL);
+    if (pthread_create(&server.thread, NULL, serve, NULL))
+        return -1;
+    return port;
+}
+
+static void server_stop(void)
+{
+    shutdown(server.fd, SHUT_RDWR);
+    closesocket(server.fd);
+    pthread_join(server.thread, NULL);
+    for (int i = 0; i < server.nb_conns; i++)
+        pthread_join(server.conns[i], NULL);
+    pthread_mutex_destroy(&server.mutex);
+}
+
+static int open_url(URLContext **h, const char *url)
+{
+    AVDictionary *opts = NULL;
+    int ret;
+
+    av_dict_set_int(&opts, "parallel_requests", 3, 0);
+    av_dict_set_int(&opts, "request_size", REQUEST_SIZE, 0);
+    ret = ffurl_open_whitelist(h, url, AVIO_FLAG_READ, NULL, &opts,
+                               NULL, NULL, NULL);
+    av_dict_free(&opts);
+    return ret;
+}
+
+/* read [pos, pos + size) in reads of at most 1000 bytes and compare it */
+static int check_read(URLContext *h, int64_t pos, int size)
+{
+    uint8_t buf[1000];
+    int len = 0;
+
+    if (ffurl_seek(h, pos, SEEK_SET) != pos)
+        return 1;
+    while (len < size) {
+        int n = ffurl_read(h, buf, FFMIN(size - len, sizeof(buf)));
+        if (n == AVERROR_EOF)
+            break;
+        if (n <= 0 || memcmp(buf, data + pos + len, n))
+            return 1;
+        len += n;
+    }
+    return len != FFMIN(size, DATA_SIZE - pos);
+}
+
+int main(void)
+{
+    URLContext *h = NULL;
+    char url[64];
+    AVLFG lfg;
+    int port, ret, once = 1;
+
+#ifdef SIGPIPE
+    signal(SIGPIPE, SIG_IGN);
+#endif
+    av_lfg_init(&lfg, 1);
+    for (int i = 0; i < DATA_SIZE; i++)
+        data[i] = av_lfg_get(&lfg);
+
+    if ((port = server_start()) < 0) {
+        fprintf(stderr, "Could not start the server\n");
+        return 1;
+    }
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/data", port);
+
+    /* every chunk is requested exactly once when reading sequentially */
+    if (open_url(&h, url) < 0)
+        return 1;
+    ret = check_read(h, 0, DATA_SIZE + 1);
+    ffurl_closep(&h);
+    for (int i = 0; i < NB_CHUNKS; i++)
+        once &= server.chunk_requests[i] == 1;
+    printf("sequential read: %s, %d chunk requests, %d unaligned, each chunk once: %s\n",
+           ret ? "FAIL" : "OK", server.nb_chunk_requests, server.unaligned,
+           once ? "yes" : "no");
+
+    /* seeks within and outside of the window of chunks being fetched */
+    if (open_url(&h, url) < 0)
+        return 1;
+    ret = 0;
+    for (int i = 0; i < 100; i++) {
+        int64_t pos = av_lfg_get(&lfg) % DATA_SIZE;
+        ret |= check_read(h, pos, 1 + av_lfg_get(&lfg) % (3 * REQUEST_SIZE));
+    }
+    ret |= check_read(h, DATA_SIZE - 10, 100);
+    ffurl_closep(&h);
+    printf("seeks: %s, %d unaligned\n", ret ? "FAIL" : "OK", server.unaligned);
+
+    server_stop();
+    return 0;
+}
@@ -19,6 +19,7 @@
  */
 
 #include "config.h"
+#include "config_components.h"
 
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mathematics.h"
@@ -73,11 +74,20 @@ int clear_duration;
 int force_iobuf_size;
 int do_interleave;
 int fake_pkt_duration;
+int pkt_size = 8;
 
 int num_warnings;
 
 int check_faults;
 
+// Seekable output, kept in memory
+int seekable;
+uint8_t *mem_buf;
+int mem_size, mem_pos;
+int stream_duration;
+uint32_t written[2][1024];
+int nb_written[2];
+
 
 static void count_warnings(void *avcl, int level, const char *fmt, va_list vl)
 {
@@ -135,6 +145,69 @@ static int io_write_data_type(void *opaque, uint8_t *buf, int size,
     return io_write(opaque, buf, size);
 }
 
+static int mem_write(void *opaque, uint8_t *buf, int size)
+{
+    if (mem_pos + size > mem_size) {
+        uint8_t *tmp = av_realloc(mem_buf, mem_pos + size);
+        if (!tmp)
+            return AVERROR(ENOMEM);
+        mem_buf  = tmp;
+        mem_size = mem_pos + size;
+    }
+    memcpy(mem_buf + mem_pos, buf, size);
+    mem_pos += size;
+    return size;
+}
+
+static int mem_read(void *opaque, uint8_t *buf, int size)
+{
+    int *pos = opaque;
+    size = FFMIN(size, mem_size - *pos);
+    if (size <= 0)
+        return AVERROR_EOF;
+    memcpy(buf, mem_buf + *pos, size);
+    *pos += size;
+    return size;
+}
+
+static int64_t mem_seek(void *opaque, int64_t offset, int whence)
+{
+    int *pos = opaque ? opaque : &mem_pos;
+    if (whence == AVSEEK_SIZE)
+        return mem_size;
+    if (whence == SEEK_CUR)
+        offset += *pos;
+    else if (whence == SEEK_END)
+        offset += mem_size;
+    if (offset < 0 || offset > INT_MAX)
+        return AVERROR(EINVAL);
+    *pos = offset;
+    return offset;
+}
+
+// Reopens the output for reading, as done when shifting data for faststart
+static int mem_open(AVFormatContext *s, AVIOContext **pb, const char *url,
+                    int flags, AVDictionary **options)
+{
+    int *pos = av_mallocz(sizeof(*pos));
+    uint8_t *buf = av_malloc(4096);
+    if (!pos || !buf || !(*pb = avio_alloc_context(buf, 4096, 0, pos, mem_read,
+                                                    NULL, mem_seek))) {
+        av_free(pos);
+        av_free(buf);
+        return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
+static int mem_close(AVFormatContext *s, AVIOContext *pb)
+{
+    av_free(pb->opaque);
+    av_freep(&pb->buffer);
+    avio_context_free(&pb);
+    return 0;
+}
+
 static void init_out(const char *name)
 {
     char buf[100];
@@ -153,6 +226,13 @@ static void init_out(const char *name)
 static void close_out(void)
 {
     int i;
+    if (seekable) {
+        av_md5_update(md5, mem_buf, mem_size);
+        out_size = mem_size;
+        if (out)
+            fwrite(mem_buf, 1, mem_size, out);
+        mem_size = mem_pos = 0;
+    }
     av_md5_final(md5, hash);
     for (i = 0; i < HASH_SIZE; i++)
         printf("%02x", hash[i]);
@@ -186,10 +266,18 @@ static void init_fps(int bf, int audio_preroll, int fps)
     ctx->oformat = av_guess_format(format, NULL, NULL);
     if (!ctx->oformat)
         exit(1);
-    ctx->pb = avio_alloc_context(iobuf, iobuf_size, 1, NULL, NULL, io_write, NULL);
-    if (!ctx->pb)
-        exit(1);
-    ctx->pb->write_data_type = io_write_data_type;
+    if (seekable) {
+        ctx->pb = avio_alloc_context(iobuf, iobuf_size, 1, NULL, NULL, mem_write, mem_seek);
+        if (!ctx->pb)
+            exit(1);
+        ctx->io_open   = mem_open;
+        ctx->io_close2 = mem_close;
+    } else {
+        ctx->pb = avio_alloc_context(iobuf, iobuf_size, 1, NULL, NULL, io_write, NULL);
+        if (!ctx->pb)
+            exit(1);
+        ctx->pb->write_data_type = io_write_data_type;
+    }
     ctx->flags |= AVFMT_FLAG_BITEXACT;
 
     st = avformat_new_stream(ctx, NULL);
@@ -206,6 +294,10 @@ static void init_fps(int bf, int audio_preroll, int fps)
     if (!st->codecpar->extradata)
         exit(1);
     memcpy(st->codecpar->extradata, h264_extradata, sizeof(h264_extradata));
+    if (stream_duration) {
+        st->avg_frame_rate = (AVRational){ fps, 1 };
+        st->duration = stream_duration * st->time_base.den;
+    }
     video_st = st;
 
     st = avformat_new_stream(ctx, NULL);
@@ -222,6 +314,10 @@ static void init_fps(int bf, int audio_preroll, int fps)
     if (!st->codecpar->extradata)
         exit(1);
     memcpy(st->codecpar->extradata, aac_extradata, sizeof(aac_extradata));
+    if (stream_duration) {
+        st->codecpar->frame_size = 1024;
+        st->duration = stream_duration * st->time_base.den;
+    }
     audio_st = st;
 
     if (avformat_write_header(ctx, &opts) < 0)
@@ -236,6 +332,7 @@ static void init_fps(int bf, int audio_preroll, int fps)
         audio_preroll = 2048LL * audio_st->time_base.den / audio_st->codecpar->sample_rate;
 
     bframes = bf;
+    nb_written[0] = nb_written[1] = 0;
     video_dts = bframes ? -duration : 0;
     audio_dts = -audio_preroll;
 }
@@ -249,7 +346,7 @@ static void mux_frames(int n, int c)
 {
     int end_frames = frames + n;
     while (1) {
-        uint8_t pktdata[8] = { 0 };
+        uint8_t pktdata[256] = { 0 };
         av_packet_unref(pkt);
 
         if (av_compare_ts(audio_dts, audio_st->time_base, video_dts, video_st->time_base) < 0) {
@@ -295,7 +392,7 @@ static void mux_frames(int n, int c)
             pkt->duration = 0;
         AV_WB32(pktdata + 4, pkt->pts);
         pkt->data = pktdata;
-        pkt->size = 8;
+        pkt->size = pkt_size;
         if (skip_write)
             continue;
         if (skip_write_audio && pkt->stream_index == 1)
@@ -306,6 +403,9 @@ static void mux_frames(int n, int c)
             pkt->dts += (1LL<<32);
         }
 
+        if (nb_written[pkt->stream_index] < FF_ARRAY_ELEMS(written[0]))
+            written[pkt->stream_index][nb_written[pkt->stream_index]++] = AV_RB32(pktdata + 4);
+
         if (do_interleave)
             av_interleaved_write_frame(ctx, pkt);
         else
@@ -347,6 +447,61 @@ static void finish(void)
     ctx = NULL;
 }
 
+// Checks that the moov atom precedes the mdat and that the seekable output
+// reads back as written
+/* check that the moov atom is in front of or after the mdat, and that the
+ * output reads back as written */
+static void check_moov(int in_front)
+{
+    int pos = 0, moov = -1, mdat = -1;
+
+    while (pos + 8 <= mem_size) {
+        uint32_t size = AV_RB32(mem_buf + pos);
+        uint32_t tag  = AV_RL32(mem_buf + pos + 4);
+        if (tag == MKTAG('m','o','o','v'))
+            moov = pos;
+        else if (tag == MKTAG('m','d','a','t'))
+            mdat = pos;
+        if (size < 8)
+            break;
+        pos += size;
+    }
+    if (in_front)
+        check(moov >= 0 && mdat > moov, "moov atom not in front of the mdat");
+    else
+        check(mdat >= 0 && moov > mdat, "moov atom not after the mdat");
+
+#if CONFIG_MOV_DEMUXER
+    {
+        AVFormatContext *in = avformat_alloc_context();
+        AVPacket *rpkt = av_packet_alloc();
+        int n[2] = { 0 }, ok = 1, pos = 0;
+
+        if (!in || !rpkt || mem_open(NULL, &in->pb, NULL, AVIO_FLAG_READ, NULL) < 0)
+            exit(1);
+        in->pb->opaque = &pos;
+        in->flags |= AVFMT_FLAG_NOPARSE;
+        if (avformat_open_input(&in, NULL, av_find_input_format("mov"), NULL) < 0) {
+            ok = 0;
+        } else {
+            while (av_read_frame(in, rpkt) >= 0) {
+                int i = rpkt->stream_index;
+                ok &= i < 2 && rpkt->size == pkt_size && n[i] < nb_written[i] &&
+                      AV_RB32(rpkt->data + 4) == written[i][n[i]];
+                n[i] += i < 2;
+                av_packet_unref(rpkt);
+            }
+            ok &= n[0] == nb_written[0] && n[1] == nb_written[1];
+        }
+        check(ok, "output does not read back as written");
+        av_freep(&in->pb->buffer);
+        avio_context_free(&in->pb);
+        avformat_close_input(&in);
+        av_packet_free(&rpkt);
+    }
+#endif
+}
+
 static void help(void)
 {
     printf("movenc-test [-w]\n"
@@ -787,6 +942,63 @@ int main(int argc, char **argv)
     finish();
     close_out();
 
+    // Write the moov atom into the space reserved with moov_size.
+    seekable = 1;
+    init_out("moov-size");
+    av_dict_set(&opts, "moov_size", "4096", 0);
+    init(1, 1);
+    mux_gops(2);
+    finish();
+    check_moov(1);
+    close_out();
+
+    // With faststart, the mdat is shifted if the reserved space is too small,
+    // with more data than is moved at once.
+    init_count_warnings();
+    pkt_size = 256;
+    init_out("faststart-moov-size-small");
+    av_dict_set(&opts, "movflags", "faststart", 0);
+    av_dict_set(&opts, "moov_size", "100", 0);
+    init(1, 1);
+    mux_gops(20);
+    finish();
+    check_moov(1);
+    close_out();
+    pkt_size = 8;
+    reset_count_warnings();
+    check(num_warnings > 0, "No warning printed for a moov atom not fitting the reserved space");
+
+    // Without faststart, the moov atom is written at the end if it does not
+    // fit the reserved space.
+    init_count_warnings();
+    init_out("moov-size-small");
+    av_dict_set(&opts, "moov_size", "100", 0);
+    init(1, 1);
+    mux_gops(2);
+    finish();
+    check_moov(0);
+    close_out();
+    reset_count_warnings();
+    check(num_warnings > 0, "No warning printed for a moov atom written at the end");
+
+    // Estimate the reserved space from the stream durations; it must be
+    // large enough not to shift the mdat.
+    init_count_warnings();
+    stream_duration = 2;
+    init_out("faststart-moov-size-estimated");
+    av_dict_set(&opts, "movflags", "faststart", 0);
+    av_dict_set(&opts, "moov_size", "-1", 0);
+    init(1, 1);
+    mux_gops(2);
+    finish();
+    check_moov(1);
+    close_out();
+    stream_duration = 0;
+    reset_count_warnings();
+    check(num_warnings == 0, "Warnings printed for an estimated moov size");
+    seekable = 0;
+
+    av_free(mem_buf);
     av_free(md5);
     av_packet_free(&pkt);
 
@@ -48,8 +48,18 @@ typedef struct URLContext {
     const char *protocol_whitelist;
     const char *protocol_blacklist;
     int min_packet_size;        /**< if non zero, the stream is packetized with this min packet size */
+    int max_buffer_size;        /**< if non zero, the size up to which the AVIOContext buffer grows on sequential reads */
 } URLContext;
 
+/**
+ * Access pattern hints for url_advise().
+ */
+enum URLAdvice {
+    URL_ADVISE_NORMAL,          ///< no particular access pattern
+    URL_ADVISE_SEQUENTIAL,      ///< the data will be read sequentially
+    URL_ADVISE_WILLNEED,        ///< the given range will be read soon
+};
+
 typedef struct URLProtocol {
     const char *name;
     int     (*url_open)( URLContext *h, const char *url, int flags);
@@ -85,6 +95,11 @@ typedef struct URLProtocol {
     int (*url_get_multi_file_handle)(URLContext *h, int **handles,
                                      int *numhandles);
     int (*url_get_short_seek)(URLContext *h);
+    /**
+     * Give the protocol a hint about how the given range of the resource
+     * will be accessed. len 0 means until the end of the resource.
+     */
+    int (*url_advise)(URLContext *h, int64_t offset, int64_t len, enum URLAdvice advice);
     int (*url_shutdown)(URLContext *h, int flags);
     const AVClass *priv_data_class;
     int priv_data_size;
@@ -253,6 +268,17 @@ int ffurl_get_multi_file_handle(URLContext *h, int **handles, int *numhandles);
  */
 int ffurl_get_short_seek(URLContext *h);
 
+/**
+ * Give the protocol a hint about how a range of the resource will be
+ * accessed.
+ *
+ * @param offset start of the range
+ * @param len    length of the range, 0 for the rest of the resource
+ * @return >= 0 on success, AVERROR(ENOSYS) if the protocol ignores hints,
+ *         another AVERROR on failure
+ */
+int ffurl_advise(URLContext *h, int64_t offset, int64_t len, enum URLAdvice advice);
+
 /**
  * Signal the URLContext that we are done reading or writing the stream.
  *
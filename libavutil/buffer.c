@@ -273,6 +273,7 @@ AVBufferPool *av_buffer_pool_init2(size_t size, void *opaque,
     pool->pool_free = pool_free;
 
     atomic_init(&pool->refcount, 1);
+    atomic_init(&pool->released, 0);
 
     return pool;
 }
@@ -289,12 +290,18 @@ AVBufferPool *av_buffer_pool_init(size_t size, AVBufferRef* (*alloc)(size_t size
     pool->alloc    = alloc ? alloc : av_buffer_alloc;
 
     atomic_init(&pool->refcount, 1);
+    atomic_init(&pool->released, 0);
 
     return pool;
 }
 
 static void buffer_pool_flush(AVBufferPool *pool)
 {
+    BufferPoolEntry *released;
+
+    released = (BufferPoolEntry *)atomic_exchange_explicit(&pool->released, 0,
+                                                           memory_order_acquire);
+
     while (pool->pool) {
         BufferPoolEntry *buf = pool->pool;
         pool->pool = buf->next;
@@ -302,6 +309,14 @@ static void buffer_pool_flush(AVBufferPool *pool)
         buf->free(buf->opaque, buf->data);
         av_freep(&buf);
     }
+
+    while (released) {
+        BufferPoolEntry *buf = released;
+        released = buf->next;
+
+        buf->free(buf->opaque, buf->data);
+        av_freep(&buf);
+    }
 }
 
 /*
@@ -341,13 +356,20 @@ static void pool_release_buffer(void *opaque, uint8_t *data)
     BufferPoolEntry *buf = opaque;
     AVBufferPool *pool = buf->pool;
 
+    uintptr_t head;
+
     if(CONFIG_MEMORY_POISONING)
         memset(buf->data, FF_MEMORY_POISON, pool->size);
 
-    ff_mutex_lock(&pool->mutex);
-    buf->next = pool->pool;
-    pool->pool = buf;
-    ff_mutex_unlock(&pool->mutex);
+    /* the mutex is only needed to take buffers from the pool, returning them
+     * is a lock-free push onto the released list */
+    head = atomic_load_explicit(&pool->released, memory_order_relaxed);
+    do {
+        buf->next = (BufferPoolEntry *)head;
+    } while (!atomic_compare_exchange_weak_explicit(&pool->released, &head,
+                                                    (uintptr_t)buf,
+                                                    memory_order_release,
+                                                    memory_order_relaxed));
 
     if (atomic_fetch_sub_explicit(&pool->refcount, 1, memory_order_acq_rel) == 1)
         buffer_pool_free(pool);
@@ -390,6 +412,9 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
     BufferPoolEntry *buf;
 
     ff_mutex_lock(&pool->mutex);
+    if (!pool->pool)
+        pool->pool = (BufferPoolEntry *)atomic_exchange_explicit(&pool->released, 0,
+                                                                 memory_order_acquire);
     buf = pool->pool;
     if (buf) {
         memset(&buf->buffer, 0, sizeof(buf->buffer));
@@ -89,6 +89,13 @@ struct AVBufferPool {
     AVMutex mutex;
     BufferPoolEntry *pool;
 
+    /*
+     * Buffers returned to the pool are pushed onto this list without taking
+     * the mutex (it holds a BufferPoolEntry pointer). It is only ever emptied
+     * as a whole, with the mutex held, so no ABA problem can arise.
+     */
+    atomic_uintptr_t released;
+
     /*
      * This is used to track when the pool is to be freed.
      * The pointer to the pool itself held by the caller is considered to
@@ -110,6 +110,21 @@ int av_cpu_count(void);
  */
 void av_cpu_force_count(int count);
 
+/**
+ * Make the slice threading of the codec, filter, scaling and resampling
+ * contexts created after this call use one process-wide pool of worker
+ * threads instead of creating their own threads. Each context still runs
+ * at most as many jobs in parallel as its own thread count, but the total
+ * number of worker threads is bounded by count.
+ *
+ * Frame threading and codecs that need a slice threading main function
+ * keep their own threads.
+ *
+ * @param count number of threads in the shared pool, 0 (the default)
+ *              gives every context its own threads
+ */
+void av_set_shared_thread_count(int count);
+
 /**
  * Get the maximum data alignment that may be required by FFmpeg.
  *
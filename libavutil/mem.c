@@ -25,6 +25,8 @@
  */
 
 #define _XOPEN_SOURCE 600
+#define _DEFAULT_SOURCE
+#define _BSD_SOURCE // needed for madvise()
 
 #include "config.h"
 
@@ -36,6 +38,9 @@
 #if HAVE_MALLOC_H
 #include <malloc.h>
 #endif
+#if HAVE_MADVISE
+#include <sys/mman.h>
+#endif
 
 #include "attributes.h"
 #include "avassert.h"
@@ -64,6 +69,14 @@ void  free(void *ptr);
 
 #define ALIGN (HAVE_AVX512 ? 64 : (HAVE_AVX ? 32 : 16))
 
+#if HAVE_POSIX_MEMALIGN && HAVE_MADVISE && defined(MADV_HUGEPAGE)
+#define HUGEPAGE_ALLOC 1
+/* the size of a transparent huge page on x86 and aarch64 with 4k pages */
+#define HUGEPAGE_SIZE (1 << 21)
+#else
+#define HUGEPAGE_ALLOC 0
+#endif
+
 /* NOTE: if you want to override these functions with your own
  * implementations (not recommended) you have to link libav* as
  * dynamic libraries and remove -Wl,-Bsymbolic from the linker flags.
@@ -75,6 +88,13 @@ void av_max_alloc(size_t max){
     atomic_store_explicit(&max_alloc_size, max, memory_order_relaxed);
 }
 
+static atomic_size_t hugepage_threshold = ATOMIC_VAR_INIT(0);
+
+void av_hugepage_threshold(size_t threshold)
+{
+    atomic_store_explicit(&hugepage_threshold, threshold, memory_order_relaxed);
+}
+
 static int size_mult(size_t a, size_t b, size_t *r)
 {
     size_t t;
@@ -96,10 +116,26 @@ static int size_mult(size_t a, size_t b, size_t *r)
 void *av_malloc(size_t size)
 {
     void *ptr = NULL;
+#if HUGEPAGE_ALLOC
+    size_t threshold;
+#endif
 
     if (size > atomic_load_explicit(&max_alloc_size, memory_order_relaxed))
         return NULL;
 
+#if HUGEPAGE_ALLOC
+    threshold = atomic_load_explicit(&hugepage_threshold, memory_order_relaxed);
+    if (threshold && size >= threshold) {
+        /* align to a huge page boundary so that the whole block can be
+         * backed by huge pages, the memory is still released with free() */
+        if (posix_memalign(&ptr, HUGEPAGE_SIZE, size))
+            ptr = NULL;
+        else if (size >= HUGEPAGE_SIZE)
+            /* only the whole huge pages inside the block, the tail may be
+             * shared with other heap blocks */
+            madvise(ptr, size & ~((size_t)HUGEPAGE_SIZE - 1), MADV_HUGEPAGE);
+    } else
+#endif
 #if HAVE_POSIX_MEMALIGN
     if (size) //OS X on SDK 10.6 has a broken posix_memalign implementation
     if (posix_memalign(&ptr, ALIGN, size))
@@ -689,6 +689,23 @@ int av_size_mult(size_t a, size_t b, size_t *r);
  */
 void av_max_alloc(size_t max);
 
+/**
+ * Request huge pages for large allocations.
+ *
+ * Blocks of at least `threshold` bytes allocated with av_malloc() and the
+ * functions built on it are aligned to a huge page boundary and the kernel
+ * is asked to back them with transparent huge pages, reducing TLB misses
+ * when large frame buffers are processed. The memory is still freed with
+ * av_free(). This is a hint, it has no effect on systems without
+ * transparent huge page support.
+ *
+ * By default this is disabled.
+ *
+ * @param threshold minimum size of the blocks to allocate in huge pages,
+ *                  0 to disable
+ */
+void av_hugepage_threshold(size_t threshold);
+
 /**
  * @}
  * @}
@@ -17,25 +17,35 @@
  */
 
 #include <stdatomic.h>
+#include <string.h>
 #include "cpu.h"
 #include "internal.h"
 #include "slicethread.h"
 #include "mem.h"
 #include "thread.h"
+#include "time.h"
 #include "avassert.h"
 
 #if HAVE_PTHREADS || HAVE_W32THREADS || HAVE_OS2THREADS
 
+/* number of polls of a wake-up flag before going to sleep, a waiter doubles
+ * its spin count after a wake-up caught while spinning and halves it after
+ * having to sleep, within these bounds; every poll pauses the CPU */
+#define MIN_SPIN 64
+#define MAX_SPIN (1 << 12)
+
 typedef struct WorkerContext {
     AVSliceThread   *ctx;
     pthread_mutex_t mutex;
     pthread_cond_t  cond;
     pthread_t       thread;
-    int             done;
+    atomic_int      wake;
+    int             spin;
 } WorkerContext;
 
 struct AVSliceThread {
     WorkerContext   *workers;
+    int             shared;
     int             nb_threads;
     int             nb_active_threads;
     int             nb_jobs;
@@ -44,49 +54,264 @@ struct AVSliceThread {
     atomic_uint     current_job;
     pthread_mutex_t done_mutex;
     pthread_cond_t  done_cond;
-    int             done;
+    atomic_int      done;
     int             finished;
 
+    int             spin;
+    int             max_spin;
+
+    int             stats;
+    int64_t         *busy_time;     ///< per thread time spent in jobs in the last execute
+    AVSliceThreadStats last_stats;
+
     void            *priv;
     void            (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads);
     void            (*main_func)(void *priv);
+
+    /* shared pool mode, protected by pool_mutex */
+    AVSliceThread   *next;
+    int             queued;
+    int             running;
 };
 
+/*
+ * Process-wide pool of worker threads, used instead of per-context workers
+ * when av_set_shared_thread_count() was called with a nonzero count.
+ *
+ * A context executing jobs is queued in the pool. Idle pool threads take a
+ * thread slot (threadnr) of the first queued context and run its jobs, the
+ * calling thread always takes part too, so all jobs get done even when the
+ * pool is busy with other contexts.
+ */
+static atomic_int      shared_thread_count = ATOMIC_VAR_INIT(0);
+
+static AVMutex         pool_init_mutex = AV_MUTEX_INITIALIZER;
+static AVMutex         pool_mutex      = AV_MUTEX_INITIALIZER;
+static pthread_cond_t  pool_cond;
+static pthread_t      *pool_threads;
+static int             pool_nb_threads;
+static int             pool_nb_users;
+static int             pool_finished;
+static AVSliceThread  *pool_queue;
+
+/* the busy time is stored after every job, before the next job is taken,
+ * so that it is visible to the thread which sees all the jobs done */
+static av_always_inline void run_job(AVSliceThread *ctx, int jobnr, int threadnr,
+                                     int64_t *busy)
+{
+    int64_t start = ctx->stats ? av_gettime_relative() : 0;
+
+    ctx->worker_func(ctx->priv, jobnr, threadnr, ctx->nb_jobs, ctx->nb_active_threads);
+    if (ctx->stats) {
+        *busy += av_gettime_relative() - start;
+        ctx->busy_time[threadnr] = *busy;
+    }
+}
+
+/* let the sibling hyperthread run while polling */
+static av_always_inline void cpu_relax(void)
+{
+#if HAVE_INLINE_ASM && (ARCH_X86 || ARCH_AARCH64)
+#if ARCH_X86
+    __asm__ volatile ("pause" ::: "memory");
+#else
+    __asm__ volatile ("yield" ::: "memory");
+#endif
+#endif
+}
+
+/* poll flag for a while before the caller goes to sleep, return 1 if it was
+ * set meanwhile */
+static int spin_wait(atomic_int *flag, int *spin, int max_spin)
+{
+    for (int i = 0; i < *spin; i++) {
+        if (atomic_load_explicit(flag, memory_order_acquire)) {
+            *spin = FFMIN(*spin * 2, max_spin);
+            return 1;
+        }
+        cpu_relax();
+    }
+    *spin = FFMAX(*spin / 2, FFMIN(MIN_SPIN, max_spin));
+    return 0;
+}
+
 static int run_jobs(AVSliceThread *ctx)
 {
     unsigned nb_jobs    = ctx->nb_jobs;
     unsigned nb_active_threads = ctx->nb_active_threads;
     unsigned first_job    = atomic_fetch_add_explicit(&ctx->first_job, 1, memory_order_acq_rel);
     unsigned current_job  = first_job;
+    int64_t busy = 0;
 
     do {
-        ctx->worker_func(ctx->priv, current_job, first_job, nb_jobs, nb_active_threads);
+        run_job(ctx, current_job, first_job, &busy);
     } while ((current_job = atomic_fetch_add_explicit(&ctx->current_job, 1, memory_order_acq_rel)) < nb_jobs);
 
     return current_job == nb_jobs + nb_active_threads - 1;
 }
 
-static void *attribute_align_arg thread_worker(void *v)
+/* take a thread slot in a shared pool context and run jobs until none are
+ * left, all jobs have been taken when this returns */
+static void run_shared_jobs(AVSliceThread *ctx)
 {
-    WorkerContext *w = v;
-    AVSliceThread *ctx = w->ctx;
+    unsigned nb_jobs           = ctx->nb_jobs;
+    unsigned nb_active_threads = ctx->nb_active_threads;
+    unsigned threadnr          = atomic_fetch_add_explicit(&ctx->first_job, 1, memory_order_acq_rel);
+    unsigned jobnr;
+    int64_t busy = 0;
+
+    if (threadnr >= nb_active_threads)
+        return;
+
+    while ((jobnr = atomic_fetch_add_explicit(&ctx->current_job, 1, memory_order_acq_rel)) < nb_jobs)
+        run_job(ctx, jobnr, threadnr, &busy);
+}
+
+/* must be called with pool_mutex held */
+static void pool_dequeue(AVSliceThread *ctx)
+{
+    AVSliceThread **p = &pool_queue;
+
+    while (*p != ctx)
+        p = &(*p)->next;
+    *p = ctx->next;
+    ctx->next   = NULL;
+    ctx->queued = 0;
+}
+
+static void *attribute_align_arg pool_worker(void *v)
+{
+    pthread_mutex_lock(&pool_mutex);
+    while (!pool_finished) {
+        AVSliceThread *ctx = pool_queue;
+
+        if (!ctx) {
+            pthread_cond_wait(&pool_cond, &pool_mutex);
+            continue;
+        }
+
+        ctx->running++;
+        pthread_mutex_unlock(&pool_mutex);
+
+        run_shared_jobs(ctx);
+
+        pthread_mutex_lock(&pool_mutex);
+        if (ctx->queued)
+            pool_dequeue(ctx);
+        if (!--ctx->running)
+            pthread_cond_signal(&ctx->done_cond);
+    }
+    pthread_mutex_unlock(&pool_mutex);
+
+    return NULL;
+}
+
+static void pool_uninit(void)
+{
+    pthread_mutex_lock(&pool_mutex);
+    pool_finished = 1;
+    pthread_cond_broadcast(&pool_cond);
+    pthread_mutex_unlock(&pool_mutex);
+
+    for (int i = 0; i < pool_nb_threads; i++)
+        pthread_join(pool_threads[i], NULL);
+
+    pthread_cond_destroy(&pool_cond);
+    av_freep(&pool_threads);
+    pool_nb_threads = 0;
+}
+
+/* return the number of pool threads or a negative AVERROR,
+ * must be called with pool_init_mutex held */
+static int pool_init(int nb_threads)
+{
+    int ret;
+
+    if (pool_nb_users)
+        return pool_nb_threads;
+
+    pool_threads = av_calloc(nb_threads, sizeof(*pool_threads));
+    if (!pool_threads)
+        return AVERROR(ENOMEM);
+
+    if (ret = pthread_cond_init(&pool_cond, NULL)) {
+        av_freep(&pool_threads);
+        return AVERROR(ret);
+    }
+    pool_finished = 0;
+
+    for (int i = 0; i < nb_threads; i++) {
+        if (ret = pthread_create(&pool_threads[i], NULL, pool_worker, NULL)) {
+            pool_uninit();
+            return AVERROR(ret);
+        }
+        pool_nb_threads++;
+    }
+
+    return pool_nb_threads;
+}
+
+static void shared_execute(AVSliceThread *ctx, int nb_jobs)
+{
+    ctx->nb_jobs           = nb_jobs;
+    ctx->nb_active_threads = FFMIN(nb_jobs, ctx->nb_threads);
+    atomic_store_explicit(&ctx->first_job, 0, memory_order_relaxed);
+    atomic_store_explicit(&ctx->current_job, 0, memory_order_relaxed);
+
+    pthread_mutex_lock(&pool_mutex);
+    if (ctx->nb_active_threads > 1) {
+        AVSliceThread **p = &pool_queue;
+
+        while (*p)
+            p = &(*p)->next;
+        *p = ctx;
+        ctx->queued = 1;
+        if (ctx->nb_active_threads > 2)
+            pthread_cond_broadcast(&pool_cond);
+        else
+            pthread_cond_signal(&pool_cond);
+    }
+    pthread_mutex_unlock(&pool_mutex);
+
+    run_shared_jobs(ctx);
 
+    /* all jobs have been taken, wait for the pool threads still running them */
+    pthread_mutex_lock(&pool_mutex);
+    if (ctx->queued)
+        pool_dequeue(ctx);
+    while (ctx->running)
+        pthread_cond_wait(&ctx->done_cond, &pool_mutex);
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+static void wake_worker(WorkerContext *w)
+{
+    atomic_store_explicit(&w->wake, 1, memory_order_release);
     pthread_mutex_lock(&w->mutex);
     pthread_cond_signal(&w->cond);
+    pthread_mutex_unlock(&w->mutex);
+}
 
-    while (1) {
-        w->done = 1;
-        while (w->done)
-            pthread_cond_wait(&w->cond, &w->mutex);
+static void *attribute_align_arg thread_worker(void *v)
+{
+    WorkerContext *w = v;
+    AVSliceThread *ctx = w->ctx;
 
-        if (ctx->finished) {
+    while (1) {
+        if (!spin_wait(&w->wake, &w->spin, ctx->max_spin)) {
+            pthread_mutex_lock(&w->mutex);
+            while (!atomic_load_explicit(&w->wake, memory_order_acquire))
+                pthread_cond_wait(&w->cond, &w->mutex);
             pthread_mutex_unlock(&w->mutex);
-            return NULL;
         }
+        atomic_store_explicit(&w->wake, 0, memory_order_relaxed);
+
+        if (ctx->finished)
+            return NULL;
 
         if (run_jobs(ctx)) {
+            atomic_store_explicit(&ctx->done, 1, memory_order_release);
             pthread_mutex_lock(&ctx->done_mutex);
-            ctx->done = 1;
             pthread_cond_signal(&ctx->done_cond);
             pthread_mutex_unlock(&ctx->done_mutex);
         }
@@ -100,8 +325,44 @@ int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
 {
     AVSliceThread *ctx;
     int nb_workers, i;
+    int shared = atomic_load_explicit(&shared_thread_count, memory_order_relaxed);
 
     av_assert0(nb_threads >= 0);
+
+    /* main_func may wait for the jobs, which needs dedicated threads */
+    if (shared > 0 && !main_func && nb_threads != 1) {
+        int nb_pool;
+
+        *pctx = ctx = av_mallocz(sizeof(*ctx));
+        if (!ctx)
+            return AVERROR(ENOMEM);
+
+        ff_mutex_lock(&pool_init_mutex);
+        nb_pool = pool_init(shared);
+        if (nb_pool >= 0)
+            pool_nb_users++;
+        ff_mutex_unlock(&pool_init_mutex);
+        if (nb_pool < 0) {
+            av_freep(pctx);
+            return nb_pool;
+        }
+
+        ctx->shared      = 1;
+        ctx->priv        = priv;
+        ctx->worker_func = worker_func;
+        ctx->nb_threads  = nb_threads ? nb_threads : nb_pool + 1;
+        pthread_cond_init(&ctx->done_cond, NULL);
+        ctx->busy_time   = av_calloc(ctx->nb_threads, sizeof(*ctx->busy_time));
+        if (!ctx->busy_time) {
+            avpriv_slicethread_free(pctx);
+            return AVERROR(ENOMEM);
+        }
+        atomic_init(&ctx->first_job, 0);
+        atomic_init(&ctx->current_job, 0);
+
+        return ctx->nb_threads;
+    }
+
     if (!nb_threads) {
         int nb_cpus = av_cpu_count();
         if (nb_cpus > 1)
@@ -118,7 +379,9 @@ int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
     if (!ctx)
         return AVERROR(ENOMEM);
 
-    if (nb_workers && !(ctx->workers = av_calloc(nb_workers, sizeof(*ctx->workers)))) {
+    if (nb_workers && !(ctx->workers = av_calloc(nb_workers, sizeof(*ctx->workers))) ||
+        !(ctx->busy_time = av_calloc(nb_threads, sizeof(*ctx->busy_time)))) {
+        av_freep(&ctx->workers);
         av_freep(pctx);
         return AVERROR(ENOMEM);
     }
@@ -130,44 +393,71 @@ int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
     ctx->nb_active_threads = 0;
     ctx->nb_jobs     = 0;
     ctx->finished    = 0;
+    /* spinning only pays off while every thread can have its own core */
+    ctx->max_spin    = nb_threads <= av_cpu_count() + 1 ? MAX_SPIN : 0;
+    ctx->spin        = ctx->max_spin;
 
     atomic_init(&ctx->first_job, 0);
     atomic_init(&ctx->current_job, 0);
     pthread_mutex_init(&ctx->done_mutex, NULL);
     pthread_cond_init(&ctx->done_cond, NULL);
-    ctx->done        = 0;
+    atomic_init(&ctx->done, 0);
 
     for (i = 0; i < nb_workers; i++) {
         WorkerContext *w = &ctx->workers[i];
         int ret;
-        w->ctx = ctx;
+        w->ctx  = ctx;
+        w->spin = ctx->max_spin;
+        atomic_init(&w->wake, 0);
         pthread_mutex_init(&w->mutex, NULL);
         pthread_cond_init(&w->cond, NULL);
-        pthread_mutex_lock(&w->mutex);
-        w->done = 0;
 
         if (ret = pthread_create(&w->thread, NULL, thread_worker, w)) {
             ctx->nb_threads = main_func ? i : i + 1;
-            pthread_mutex_unlock(&w->mutex);
             pthread_cond_destroy(&w->cond);
             pthread_mutex_destroy(&w->mutex);
             avpriv_slicethread_free(pctx);
             return AVERROR(ret);
         }
-
-        while (!w->done)
-            pthread_cond_wait(&w->cond, &w->mutex);
-        pthread_mutex_unlock(&w->mutex);
     }
 
     return nb_threads;
 }
 
+static void update_stats(AVSliceThread *ctx, int64_t start)
+{
+    AVSliceThreadStats *st = &ctx->last_stats;
+
+    st->wall_time     = av_gettime_relative() - start;
+    st->busy_time     = 0;
+    st->max_busy_time = 0;
+    st->nb_threads    = ctx->nb_active_threads;
+    st->nb_jobs       = ctx->nb_jobs;
+    for (int i = 0; i < ctx->nb_active_threads; i++) {
+        st->busy_time    += ctx->busy_time[i];
+        st->max_busy_time = FFMAX(st->max_busy_time, ctx->busy_time[i]);
+    }
+}
+
 void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs, int execute_main)
 {
     int nb_workers, i, is_last = 0;
+    int64_t start = 0;
 
     av_assert0(nb_jobs > 0);
+
+    if (ctx->stats) {
+        memset(ctx->busy_time, 0, FFMIN(nb_jobs, ctx->nb_threads) * sizeof(*ctx->busy_time));
+        start = av_gettime_relative();
+    }
+
+    if (ctx->shared) {
+        shared_execute(ctx, nb_jobs);
+        if (ctx->stats)
+            update_stats(ctx, start);
+        return;
+    }
+
     ctx->nb_jobs           = nb_jobs;
     ctx->nb_active_threads = FFMIN(nb_jobs, ctx->nb_threads);
     atomic_store_explicit(&ctx->first_job, 0, memory_order_relaxed);
@@ -176,13 +466,8 @@ void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs, int execute_mai
     if (!ctx->main_func || !execute_main)
         nb_workers--;
 
-    for (i = 0; i < nb_workers; i++) {
-        WorkerContext *w = &ctx->workers[i];
-        pthread_mutex_lock(&w->mutex);
-        w->done = 0;
-        pthread_cond_signal(&w->cond);
-        pthread_mutex_unlock(&w->mutex);
-    }
+    for (i = 0; i < nb_workers; i++)
+        wake_worker(&ctx->workers[i]);
 
     if (ctx->main_func && execute_main)
         ctx->main_func(ctx->priv);
@@ -190,12 +475,27 @@ void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs, int execute_mai
         is_last = run_jobs(ctx);
 
     if (!is_last) {
-        pthread_mutex_lock(&ctx->done_mutex);
-        while (!ctx->done)
-            pthread_cond_wait(&ctx->done_cond, &ctx->done_mutex);
-        ctx->done = 0;
-        pthread_mutex_unlock(&ctx->done_mutex);
+        if (!spin_wait(&ctx->done, &ctx->spin, ctx->max_spin)) {
+            pthread_mutex_lock(&ctx->done_mutex);
+            while (!atomic_load_explicit(&ctx->done, memory_order_acquire))
+                pthread_cond_wait(&ctx->done_cond, &ctx->done_mutex);
+            pthread_mutex_unlock(&ctx->done_mutex);
+        }
+        atomic_store_explicit(&ctx->done, 0, memory_order_relaxed);
     }
+
+    if (ctx->stats)
+        update_stats(ctx, start);
+}
+
+void avpriv_slicethread_set_stats(AVSliceThread *ctx, int enable)
+{
+    ctx->stats = !!enable;
+}
+
+void avpriv_slicethread_get_stats(const AVSliceThread *ctx, AVSliceThreadStats *stats)
+{
+    *stats = ctx->last_stats;
 }
 
 void avpriv_slicethread_free(AVSliceThread **pctx)
@@ -207,18 +507,26 @@ void avpriv_slicethread_free(AVSliceThread **pctx)
         return;
 
     ctx = *pctx;
+
+    if (ctx->shared) {
+        ff_mutex_lock(&pool_init_mutex);
+        if (!--pool_nb_users)
+            pool_uninit();
+        ff_mutex_unlock(&pool_init_mutex);
+
+        pthread_cond_destroy(&ctx->done_cond);
+        av_freep(&ctx->busy_time);
+        av_freep(pctx);
+        return;
+    }
+
     nb_workers = ctx->nb_threads;
     if (!ctx->main_func)
         nb_workers--;
 
     ctx->finished = 1;
-    for (i = 0; i < nb_workers; i++) {
-        WorkerContext *w = &ctx->workers[i];
-        pthread_mutex_lock(&w->mutex);
-        w->done = 0;
-        pthread_cond_signal(&w->cond);
-        pthread_mutex_unlock(&w->mutex);
-    }
+    for (i = 0; i < nb_workers; i++)
+        wake_worker(&ctx->workers[i]);
 
     for (i = 0; i < nb_workers; i++) {
         WorkerContext *w = &ctx->workers[i];
@@ -230,9 +538,15 @@ void avpriv_slicethread_free(AVSliceThread **pctx)
     pthread_cond_destroy(&ctx->done_cond);
     pthread_mutex_destroy(&ctx->done_mutex);
     av_freep(&ctx->workers);
+    av_freep(&ctx->busy_time);
     av_freep(pctx);
 }
 
+void av_set_shared_thread_count(int count)
+{
+    atomic_store_explicit(&shared_thread_count, FFMAX(count, 0), memory_order_relaxed);
+}
+
 #else /* HAVE_PTHREADS || HAVE_W32THREADS || HAVE_OS32THREADS */
 
 int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
@@ -254,4 +568,18 @@ void avpriv_slicethread_free(AVSliceThread **pctx)
     av_assert0(!pctx || !*pctx);
 }
 
+void avpriv_slicethread_set_stats(AVSliceThread *ctx, int enable)
+{
+    av_assert0(0);
+}
+
+void avpriv_slicethread_get_stats(const AVSliceThread *ctx, AVSliceThreadStats *stats)
+{
+    av_assert0(0);
+}
+
+void av_set_shared_thread_count(int count)
+{
+}
+
 #endif /* HAVE_PTHREADS || HAVE_W32THREADS || HAVE_OS32THREADS */
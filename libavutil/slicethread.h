@@ -19,8 +19,23 @@
 #ifndef AVUTIL_SLICETHREAD_H
 #define AVUTIL_SLICETHREAD_H
 
+#include <stdint.h>
+
 typedef struct AVSliceThread AVSliceThread;
 
+/**
+ * Statistics of the last avpriv_slicethread_execute() call, only collected
+ * when enabled with avpriv_slicethread_set_stats(). Times are in
+ * microseconds.
+ */
+typedef struct AVSliceThreadStats {
+    int64_t wall_time;      ///< duration of the execute call
+    int64_t busy_time;      ///< time spent in jobs, summed over all threads
+    int64_t max_busy_time;  ///< time spent in jobs by the busiest thread
+    int     nb_threads;     ///< number of threads the jobs were spread over
+    int     nb_jobs;
+} AVSliceThreadStats;
+
 /**
  * Create slice threading context.
  * @param pctx slice threading context returned here
@@ -49,4 +64,17 @@ void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs, int execute_mai
  */
 void avpriv_slicethread_free(AVSliceThread **pctx);
 
+/**
+ * Enable or disable the collection of execution statistics.
+ * Idle time is wall_time * nb_threads - busy_time, a max_busy_time well
+ * above busy_time / nb_threads means the jobs were uneven and more jobs
+ * would balance the load better.
+ */
+void avpriv_slicethread_set_stats(AVSliceThread *ctx, int enable);
+
+/**
+ * Retrieve the statistics of the last execute call.
+ */
+void avpriv_slicethread_get_stats(const AVSliceThread *ctx, AVSliceThreadStats *stats);
+
 #endif
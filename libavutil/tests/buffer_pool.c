@@ -0,0 +1,133 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * This test program gets and releases buffers from one AVBufferPool in
+ * several threads at once and checks that no buffer is ever handed out
+ * twice. When called with arguments ([threads [iterations]]) it also
+ * prints the average cost of a get/unref pair.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/buffer.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/thread.h"
+#include "libavutil/time.h"
+
+#define MAX_THREADS 64
+#define HELD        4
+#define BUF_SIZE    1024
+
+typedef struct ThreadData {
+    AVBufferPool *pool;
+    int           idx;
+    int           iterations;
+    int           errors;
+} ThreadData;
+
+static void *thread_main(void *arg)
+{
+    ThreadData *td = arg;
+    AVBufferRef *held[HELD] = { NULL };
+
+    for (int i = 0; i < td->iterations; i++) {
+        AVBufferRef **ref = &held[i % HELD];
+
+        if (*ref) {
+            if (AV_RN32((*ref)->data)     != td->idx ||
+                AV_RN32((*ref)->data + 4) != i - HELD)
+                td->errors++;
+            av_buffer_unref(ref);
+        }
+
+        *ref = av_buffer_pool_get(td->pool);
+        if (!*ref) {
+            td->errors++;
+            break;
+        }
+        AV_WN32((*ref)->data,     td->idx);
+        AV_WN32((*ref)->data + 4, i);
+    }
+
+    for (int i = 0; i < HELD; i++)
+        av_buffer_unref(&held[i]);
+
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    ThreadData td[MAX_THREADS];
+    pthread_t threads[MAX_THREADS];
+    AVBufferPool *pool;
+    AVBufferRef *last;
+    int nb_threads = argc > 1 ? atoi(argv[1]) : 4;
+    int iterations = argc > 2 ? atoi(argv[2]) : 100000;
+    int64_t start;
+    int errors = 0;
+    int ret;
+
+    if (nb_threads < 1 || nb_threads > MAX_THREADS || iterations < 1) {
+        fprintf(stderr, "usage: %s [threads [iterations]]\n", argv[0]);
+        return 1;
+    }
+
+    pool = av_buffer_pool_init(BUF_SIZE, NULL);
+    if (!pool)
+        return 1;
+
+    start = av_gettime_relative();
+    for (int i = 0; i < nb_threads; i++) {
+        td[i].pool       = pool;
+        td[i].idx        = i;
+        td[i].iterations = iterations;
+        td[i].errors     = 0;
+        if ((ret = pthread_create(&threads[i], NULL, thread_main, &td[i]))) {
+            fprintf(stderr, "pthread_create failed: %s.\n", strerror(ret));
+            return 1;
+        }
+    }
+    for (int i = 0; i < nb_threads; i++) {
+        pthread_join(threads[i], NULL);
+        errors += td[i].errors;
+    }
+
+    if (argc > 1) {
+        int64_t elapsed = av_gettime_relative() - start;
+        printf("%d threads, %d iterations: %.1f ns per get/unref\n",
+               nb_threads, iterations, elapsed * 1000.0 / iterations);
+    }
+
+    /* the pool must stay alive until its last buffer is returned */
+    last = av_buffer_pool_get(pool);
+    av_buffer_pool_uninit(&pool);
+    if (!last)
+        return 2;
+    memset(last->data, 0, BUF_SIZE);
+    av_buffer_unref(&last);
+
+    if (errors) {
+        fprintf(stderr, "%d buffers were handed out twice\n", errors);
+        return 3;
+    }
+
+    return 0;
+}
@@ -0,0 +1,102 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/* first, for the feature test macros it defines */
+#include "libavutil/mem.c"
+
+#include <stdio.h>
+
+#if HUGEPAGE_ALLOC && defined(__linux__)
+/* 1 if the mapping containing addr is marked for huge pages, 0 if not,
+ * -1 if that cannot be determined */
+static int is_hugepage_vma(const void *addr)
+{
+    FILE *f = fopen("/proc/self/smaps", "r");
+    char line[1024];
+    int in_vma = 0, ret = -1;
+
+    if (!f)
+        return -1;
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long start, end;
+
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+            in_vma = (uintptr_t)addr >= start && (uintptr_t)addr < end;
+        } else if (in_vma && !strncmp(line, "VmFlags:", 8)) {
+            ret = !!strstr(line, " hg");
+            break;
+        }
+    }
+    fclose(f);
+    return ret;
+}
+#endif
+
+static int test_hugepage(size_t size, size_t threshold)
+{
+    uint8_t *ptr;
+    int ret = 0;
+
+    av_hugepage_threshold(threshold);
+    ptr = av_malloc(size);
+    av_hugepage_threshold(0);
+    if (!ptr)
+        return 1;
+
+    if ((uintptr_t)ptr % ALIGN) {
+        printf("%zu bytes: block not aligned\n", size);
+        ret = 1;
+    }
+    memset(ptr, 0x5a, size);
+
+#if HUGEPAGE_ALLOC
+    if (threshold && size >= threshold && (uintptr_t)ptr % HUGEPAGE_SIZE) {
+        printf("%zu bytes: block not aligned to a huge page\n", size);
+        ret = 1;
+    }
+#if defined(__linux__)
+    /* the advice must cover the whole huge pages of the block, but not the
+     * tail, which may be shared with other heap blocks */
+    if (threshold && size >= HUGEPAGE_SIZE && size % HUGEPAGE_SIZE &&
+        is_hugepage_vma(ptr) > 0 &&
+        is_hugepage_vma(ptr + (size & ~((size_t)HUGEPAGE_SIZE - 1))) > 0) {
+        printf("%zu bytes: huge page advice past the end of the block\n", size);
+        ret = 1;
+    }
+#endif
+#endif
+
+    av_free(ptr);
+    return ret;
+}
+
+int main(void)
+{
+    static const size_t sizes[] = {
+        100, 1 << 20, 1 << 21, (1 << 21) + 4096, 3 << 20, (5 << 20) + 17,
+    };
+    int ret = 0;
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(sizes); i++) {
+        ret |= test_hugepage(sizes[i], 0);
+        ret |= test_hugepage(sizes[i], 1 << 20);
+    }
+    printf("huge page allocations: %s\n", ret ? "FAIL" : "OK");
+
+    return ret;
+}
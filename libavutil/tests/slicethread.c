@@ -0,0 +1,229 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdatomic.h>
+#include <stdio.h>
+
+#include "libavutil/cpu.h"
+#include "libavutil/macros.h"
+#include "libavutil/slicethread.h"
+#include "libavutil/thread.h"
+#include "libavutil/time.h"
+
+#define MAX_JOBS    64
+#define NB_CONTEXTS 3
+#define NB_RUNS     200
+
+typedef struct TestContext {
+    AVSliceThread *thread;
+    int            nb_threads;
+    atomic_int     job_count[MAX_JOBS];
+    atomic_int     errors;
+    atomic_int     main_count;
+    /* if set, every job runs a whole execute call on this context */
+    struct TestContext *nested;
+} TestContext;
+
+static void worker(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    TestContext *t = priv;
+
+    if (jobnr < 0 || jobnr >= nb_jobs || threadnr < 0 || threadnr >= nb_threads ||
+        nb_threads > t->nb_threads || nb_threads > nb_jobs)
+        atomic_fetch_add(&t->errors, 1);
+    else
+        atomic_fetch_add(&t->job_count[jobnr], 1);
+
+    if (t->nested && jobnr == 0)
+        avpriv_slicethread_execute(t->nested->thread, 8, 0);
+}
+
+static void main_func(void *priv)
+{
+    TestContext *t = priv;
+
+    atomic_fetch_add(&t->main_count, 1);
+}
+
+static int test_create_main(TestContext *t, int nb_threads, int with_main)
+{
+    int ret = avpriv_slicethread_create(&t->thread, t, worker,
+                                        with_main ? main_func : NULL, nb_threads);
+
+    if (ret < 0)
+        return ret;
+    t->nb_threads = ret;
+    for (int i = 0; i < MAX_JOBS; i++)
+        atomic_init(&t->job_count[i], 0);
+    atomic_init(&t->errors, 0);
+    atomic_init(&t->main_count, 0);
+    t->nested = NULL;
+    return 0;
+}
+
+static int test_create(TestContext *t, int nb_threads)
+{
+    return test_create_main(t, nb_threads, 0);
+}
+
+/* run nb_jobs jobs and check that each of them ran exactly once */
+static int test_execute_main(TestContext *t, int nb_jobs, int execute_main)
+{
+    int ret = 0;
+
+    avpriv_slicethread_execute(t->thread, nb_jobs, execute_main);
+    for (int i = 0; i < MAX_JOBS; i++)
+        if (atomic_exchange(&t->job_count[i], 0) != (i < nb_jobs))
+            ret = 1;
+    if (atomic_exchange(&t->errors, 0))
+        ret = 1;
+    if (atomic_exchange(&t->main_count, 0) != execute_main)
+        ret = 1;
+    return ret;
+}
+
+static int test_execute(TestContext *t, int nb_jobs)
+{
+    return test_execute_main(t, nb_jobs, 0);
+}
+
+static void *execute_thread(void *arg)
+{
+    TestContext *t = arg;
+    intptr_t ret = 0;
+
+    for (int i = 0; i < NB_RUNS; i++)
+        ret |= test_execute(t, 1 + i % MAX_JOBS);
+    return (void *)ret;
+}
+
+/* several contexts executing at the same time from different threads */
+static int test_concurrent(TestContext *t, int nb)
+{
+    pthread_t threads[NB_CONTEXTS];
+    int ret = 0;
+
+    for (int i = 0; i < nb; i++)
+        if (pthread_create(&threads[i], NULL, execute_thread, &t[i]))
+            return 1;
+    for (int i = 0; i < nb; i++) {
+        void *res;
+        pthread_join(threads[i], &res);
+        ret |= !!res;
+    }
+    return ret;
+}
+
+static int test_shared_pool(void)
+{
+    TestContext t[NB_CONTEXTS];
+    int ret = 0, i;
+
+    av_set_shared_thread_count(4);
+
+    /* 0 threads means the pool size plus the calling thread */
+    for (i = 0; i < NB_CONTEXTS; i++)
+        if (test_create(&t[i], i ? 3 : 0) < 0)
+            return 1;
+    printf("shared pool thread counts: %d %d %d\n",
+           t[0].nb_threads, t[1].nb_threads, t[2].nb_threads);
+
+    ret |= test_concurrent(t, NB_CONTEXTS);
+
+    /* a job waiting for another context must not deadlock the pool */
+    t[0].nested = &t[1];
+    for (i = 0; i < NB_RUNS / 10; i++) {
+        ret |= test_execute(&t[0], 16);
+        for (int j = 0; j < MAX_JOBS; j++)
+            ret |= atomic_exchange(&t[1].job_count[j], 0) != (j < 8);
+    }
+    t[0].nested = NULL;
+
+    for (i = 0; i < NB_CONTEXTS; i++)
+        avpriv_slicethread_free(&t[i].thread);
+
+    /* the pool is stopped with its last user, and started again */
+    if (test_create(&t[0], 2) < 0)
+        return 1;
+    for (i = 0; i < NB_RUNS; i++)
+        ret |= test_execute(&t[0], 1 + i % MAX_JOBS);
+    avpriv_slicethread_free(&t[0].thread);
+
+    av_set_shared_thread_count(0);
+
+    printf("shared pool: %s\n", ret ? "FAIL" : "OK");
+    return ret;
+}
+
+/* the statistics only depend on the job and thread counts, apart from the
+ * times, which can only be checked for consistency */
+static int check_stats(TestContext *t, int nb_jobs)
+{
+    AVSliceThreadStats st;
+
+    avpriv_slicethread_get_stats(t->thread, &st);
+    return st.nb_jobs != nb_jobs || st.nb_threads != FFMIN(nb_jobs, t->nb_threads) ||
+           st.max_busy_time < 0 || st.busy_time < st.max_busy_time ||
+           st.wall_time < st.max_busy_time;
+}
+
+/* dedicated threads, spinning while nb_threads <= cpus + 1, sleeping
+ * right away otherwise */
+static int test_dedicated(const char *name, int nb_threads, int with_main)
+{
+    TestContext t;
+    int ret = 0;
+
+    if (test_create_main(&t, nb_threads, with_main) < 0)
+        return 1;
+
+    /* back to back calls, the workers are caught while spinning */
+    for (int i = 0; i < NB_RUNS; i++)
+        ret |= test_execute_main(&t, 1 + i % MAX_JOBS, with_main && i & 1);
+
+    /* pauses longer than the spin, the workers have to be woken up */
+    for (int i = 0; i < 8; i++) {
+        av_usleep(2000);
+        ret |= test_execute_main(&t, 1 + i * 7, with_main && i & 1);
+    }
+
+    avpriv_slicethread_set_stats(t.thread, 1);
+    for (int i = 0; i < NB_RUNS / 10; i++) {
+        int nb_jobs = 1 + i * 3 % MAX_JOBS;
+        ret |= test_execute(&t, nb_jobs);
+        ret |= check_stats(&t, nb_jobs);
+    }
+
+    avpriv_slicethread_free(&t.thread);
+
+    printf("%s: %s\n", name, ret ? "FAIL" : "OK");
+    return ret;
+}
+
+int main(void)
+{
+    int nb_cpus = av_cpu_count();
+    int ret = 0;
+
+    ret |= test_dedicated("spin", FFMIN(nb_cpus + 1, 4), 0);
+    ret |= test_dedicated("spin, main function", FFMIN(nb_cpus + 1, 4), 1);
+    ret |= test_dedicated("no spin", 2 * nb_cpus + 2, 0);
+    ret |= test_shared_pool();
+
+    return ret;
+}
@@ -142,6 +142,9 @@ static const AVOption options[]={
 { "kaiser_beta"         , "set swr Kaiser window beta"  , OFFSET(kaiser_beta)    , AV_OPT_TYPE_DOUBLE  , {.dbl=9                     }, 2      , 16        , PARAM },
 
 { "output_sample_bits"  , "set swr number of output sample bits", OFFSET(dither.output_sample_bits), AV_OPT_TYPE_INT  , {.i64=0   }, 0      , 64        , PARAM },
+
+{ "threads"             , "set the number of threads processing the channels", OFFSET(user_nb_threads), AV_OPT_TYPE_INT, {.i64=1 }, 0, INT_MAX, PARAM, "threads" },
+    { "auto"            , "select automatically"        , 0                      , AV_OPT_TYPE_CONST, { .i64 = 0 }, INT_MIN, INT_MAX, PARAM, "threads" },
 {0}
 };
 
@@ -450,12 +450,74 @@ static int set_compensation(ResampleContext *c, int sample_delta, int compensati
     return 0;
 }
 
-static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed){
+typedef struct ResampleJob {
+    ResampleContext *c;
+    AudioData *dst, *src;
+    int dst_size;
+    int64_t index2, incr;
+    int (*resample_func)(struct ResampleContext *c, void *dst,
+                         const void *src, int n, int update_ctx);
+} ResampleJob;
+
+static void resample_job(void *arg, int jobnr, int nb_jobs)
+{
+    ResampleJob *j = arg;
+    const int start = j->dst->ch_count *  jobnr      / nb_jobs;
+    const int end   = j->dst->ch_count * (jobnr + 1) / nb_jobs;
+
+    for (int i = start; i < end; i++) {
+        if (j->resample_func)
+            j->resample_func(j->c, j->dst->ch[i], j->src->ch[i], j->dst_size, 0);
+        else
+            j->c->dsp.resample_one(j->dst->ch[i], j->src->ch[i], j->dst_size,
+                                   j->index2, j->incr);
+    }
+}
+
+/**
+ * Advance the filter position by n output samples the same way
+ * resample_common / resample_linear do with update_ctx set.
+ *
+ * @return number of input samples consumed
+ */
+static int advance_ctx(ResampleContext *c, int n)
+{
+    int index = c->index;
+    int frac  = c->frac;
+    int sample_index = 0;
+
+    while (index >= c->phase_count) {
+        sample_index++;
+        index -= c->phase_count;
+    }
+
+    while (n--) {
+        frac  += c->dst_incr_mod;
+        index += c->dst_incr_div;
+        if (frac >= c->src_incr) {
+            frac -= c->src_incr;
+            index++;
+        }
+
+        while (index >= c->phase_count) {
+            sample_index++;
+            index -= c->phase_count;
+        }
+    }
+
+    c->frac  = frac;
+    c->index = index;
+
+    return sample_index;
+}
+
+static int multiple_resample(SwrContext *s, ResampleContext *c, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed){
     int i;
     int av_unused mm_flags = av_get_cpu_flags();
     int need_emms = c->format == AV_SAMPLE_FMT_S16P && ARCH_X86_32 &&
                     (mm_flags & (AV_CPU_FLAG_MMX2 | AV_CPU_FLAG_SSE2)) == AV_CPU_FLAG_MMX2;
     int64_t max_src_size = (INT64_MAX/2 / c->phase_count) / c->src_incr;
+    int nb_jobs;
 
     if (c->compensation_distance)
         dst_size = FFMIN(dst_size, c->compensation_distance);
@@ -470,17 +532,20 @@ static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, A
 
         dst_size = FFMAX(FFMIN(dst_size, new_size), 0);
         if (dst_size > 0) {
-            for (i = 0; i < dst->ch_count; i++) {
-                c->dsp.resample_one(dst->ch[i], src->ch[i], dst_size, index2, incr);
-                if (i+1 == dst->ch_count) {
-                    c->index += dst_size * c->dst_incr_div;
-                    c->index += (c->frac + dst_size * (int64_t)c->dst_incr_mod) / c->src_incr;
-                    av_assert2(c->index >= 0);
-                    *consumed = c->index;
-                    c->frac   = (c->frac + dst_size * (int64_t)c->dst_incr_mod) % c->src_incr;
-                    c->index = 0;
-                }
+            nb_jobs = swri_get_nb_jobs(s, dst->ch_count, dst_size);
+            if (nb_jobs > 1) {
+                ResampleJob job = { c, dst, src, dst_size, index2, incr };
+                swri_execute(s, resample_job, &job, nb_jobs);
+            } else {
+                for (i = 0; i < dst->ch_count; i++)
+                    c->dsp.resample_one(dst->ch[i], src->ch[i], dst_size, index2, incr);
             }
+            c->index += dst_size * c->dst_incr_div;
+            c->index += (c->frac + dst_size * (int64_t)c->dst_incr_mod) / c->src_incr;
+            av_assert2(c->index >= 0);
+            *consumed = c->index;
+            c->frac   = (c->frac + dst_size * (int64_t)c->dst_incr_mod) % c->src_incr;
+            c->index = 0;
         }
     } else {
         int64_t end_index = (1LL + src_size - c->filter_length) * c->phase_count;
@@ -495,8 +560,17 @@ static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, A
              * when frac and dst_incr_mod are zero */
             resample_func = (c->linear && (c->frac || c->dst_incr_mod)) ?
                             c->dsp.resample_linear : c->dsp.resample_common;
-            for (i = 0; i < dst->ch_count; i++)
-                *consumed = resample_func(c, dst->ch[i], src->ch[i], dst_size, i+1 == dst->ch_count);
+            nb_jobs = swri_get_nb_jobs(s, dst->ch_count, dst_size);
+            if (nb_jobs > 1) {
+                /* every channel reads the filter position, so it is only
+                 * advanced once all of them are done */
+                ResampleJob job = { c, dst, src, dst_size, 0, 0, resample_func };
+                swri_execute(s, resample_job, &job, nb_jobs);
+                *consumed = advance_ctx(c, dst_size);
+            } else {
+                for (i = 0; i < dst->ch_count; i++)
+                    *consumed = resample_func(c, dst->ch[i], src->ch[i], dst_size, i+1 == dst->ch_count);
+            }
         }
     }
 
@@ -186,6 +186,8 @@ static void clear_context(SwrContext *s){
     swri_audio_convert_free(&s->out_convert);
     swri_audio_convert_free(&s->full_convert);
     swri_rematrix_free(s);
+    avpriv_slicethread_free(&s->slicethread);
+    s->nb_threads = 1;
 
     s->delayed_samples_fixup = 0;
     s->flushed = 0;
@@ -209,6 +211,61 @@ av_cold void swr_close(SwrContext *s){
     clear_context(s);
 }
 
+static void slice_worker(void *priv, int jobnr, int threadnr,
+                         int nb_jobs, int nb_threads)
+{
+    SwrContext *s = priv;
+
+    s->job_func(s->job_arg, jobnr, nb_jobs);
+}
+
+static av_cold int init_threads(SwrContext *s)
+{
+    int ret;
+
+    if (s->user_nb_threads == 1)
+        return 0;
+
+    ret = avpriv_slicethread_create(&s->slicethread, s, slice_worker, NULL,
+                                    s->user_nb_threads);
+    if (ret == AVERROR(ENOSYS)) {
+        av_log(s, AV_LOG_WARNING, "Threads are not supported, using a single thread\n");
+        return 0;
+    } else if (ret < 0) {
+        return ret;
+    }
+
+    s->nb_threads = ret;
+    return 0;
+}
+
+/* below this many samples per job, the synchronization costs more than the
+ * work that is split */
+#define MIN_SAMPLES_PER_JOB 4096
+
+int swri_get_nb_jobs(SwrContext *s, int nb_channels, int len)
+{
+    int64_t samples = (int64_t)nb_channels * len;
+
+    if (s->nb_threads <= 1 || nb_channels < 2 || samples < 2 * MIN_SAMPLES_PER_JOB)
+        return 1;
+
+    return FFMIN3(s->nb_threads, nb_channels, samples / MIN_SAMPLES_PER_JOB);
+}
+
+void swri_execute(SwrContext *s, swri_job_func *func, void *arg, int nb_jobs)
+{
+    if (nb_jobs <= 1 || !s->slicethread) {
+        for (int i = 0; i < nb_jobs; i++)
+            func(arg, i, nb_jobs);
+        return;
+    }
+
+    s->job_func = func;
+    s->job_arg  = arg;
+    avpriv_slicethread_execute(s->slicethread, nb_jobs, 0);
+}
+
 av_cold int swr_init(struct SwrContext *s){
     int ret;
     char l1[1024], l2[1024];
@@ -232,6 +289,10 @@ av_cold int swr_init(struct SwrContext *s){
         av_log(s, AV_LOG_ERROR, "Requested output sample rate %d is invalid\n", s->out_sample_rate);
         return AVERROR(EINVAL);
     }
+
+    if ((ret = init_threads(s)) < 0)
+        return ret;
+
     s->used_ch_count = s->user_used_ch_count;
 #if FF_API_OLD_CHANNEL_LAYOUT
     s->out.ch_count  = s-> user_out_ch_count;
@@ -585,6 +646,44 @@ static void buf_set(AudioData *out, AudioData *in, int count){
     }
 }
 
+typedef struct ConvertJob {
+    AudioConvert *ac;
+    AudioData *out, *in;
+    int len;
+} ConvertJob;
+
+static void convert_job(void *arg, int jobnr, int nb_jobs)
+{
+    ConvertJob *j = arg;
+    /* split on multiples of 16 samples so the SIMD paths stay usable */
+    const int start = (j->len * (int64_t) jobnr      / nb_jobs) & ~15;
+    const int end   = jobnr + 1 == nb_jobs ? j->len :
+                      (j->len * (int64_t)(jobnr + 1) / nb_jobs) & ~15;
+    AudioData out = *j->out, in = *j->in;
+
+    if (end <= start)
+        return;
+
+    buf_set(&out, j->out, start);
+    buf_set(&in,  j->in,  start);
+    swri_audio_convert(j->ac, &out, &in, end - start);
+}
+
+/**
+ * Sample format conversion, split in ranges of samples over the threads.
+ */
+static void audio_convert(SwrContext *s, AudioConvert *ac,
+                          AudioData *out, AudioData *in, int len)
+{
+    ConvertJob job = { ac, out, in, len };
+    int nb_jobs = swri_get_nb_jobs(s, out->ch_count, len);
+
+    if (nb_jobs > 1)
+        swri_execute(s, convert_job, &job, nb_jobs);
+    else
+        swri_audio_convert(ac, out, in, len);
+}
+
 /**
  *
  * @return number of samples output per channel
@@ -619,7 +718,7 @@ static int resample(SwrContext *s, AudioData *out_param, int out_count,
         int ret, size, consumed;
         if(!s->resample_in_constraint && s->in_buffer_count){
             buf_set(&tmp, &s->in_buffer, s->in_buffer_index);
-            ret= s->resampler->multiple_resample(s->resample, &out, out_count, &tmp, s->in_buffer_count, &consumed);
+            ret= s->resampler->multiple_resample(s, s->resample, &out, out_count, &tmp, s->in_buffer_count, &consumed);
             out_count -= ret;
             ret_sum += ret;
             buf_set(&out, &out, ret);
@@ -639,7 +738,7 @@ static int resample(SwrContext *s, AudioData *out_param, int out_count,
 
         if((s->flushed || in_count > padless) && !s->in_buffer_count){
             s->in_buffer_index=0;
-            ret= s->resampler->multiple_resample(s->resample, &out, out_count, &in, FFMAX(in_count-padless, 0), &consumed);
+            ret= s->resampler->multiple_resample(s, s->resample, &out, out_count, &in, FFMAX(in_count-padless, 0), &consumed);
             out_count -= ret;
             ret_sum += ret;
             buf_set(&out, &out, ret);
@@ -692,7 +791,7 @@ static int swr_convert_internal(struct SwrContext *s, AudioData *out, int out_co
 
     if(s->full_convert){
         av_assert0(!s->resample);
-        swri_audio_convert(s->full_convert, out, in, in_count);
+        audio_convert(s, s->full_convert, out, in, in_count);
         return out_count;
     }
 
@@ -743,7 +842,7 @@ static int swr_convert_internal(struct SwrContext *s, AudioData *out, int out_co
     }
 
     if(in != postin){
-        swri_audio_convert(s->in_convert, postin, in, in_count);
+        audio_convert(s, s->in_convert, postin, in, in_count);
     }
 
     if(s->resample_first){
@@ -809,7 +908,7 @@ static int swr_convert_internal(struct SwrContext *s, AudioData *out, int out_co
             s->dither.noise_pos += out_count;
         }
 //FIXME packed doesn't need more than 1 chan here!
-        swri_audio_convert(s->out_convert, out, conv_src, out_count);
+        audio_convert(s, s->out_convert, out, conv_src, out_count);
     }
     return out_count;
 }
@@ -23,6 +23,7 @@
 
 #include "swresample.h"
 #include "libavutil/channel_layout.h"
+#include "libavutil/slicethread.h"
 #include "config.h"
 
 #define SWR_CH_MAX 64
@@ -42,6 +43,11 @@ typedef void (mix_2_1_func_type)(void *out, const void *in1, const void *in2, vo
 
 typedef void (mix_any_func_type)(uint8_t **out, const uint8_t **in1, void *coeffp, integer len);
 
+/**
+ * Job run by swri_execute(); jobnr is in [0, nb_jobs).
+ */
+typedef void (swri_job_func)(void *arg, int jobnr, int nb_jobs);
+
 typedef struct AudioData{
     uint8_t *ch[SWR_CH_MAX];    ///< samples buffer per channel
     uint8_t *data;              ///< samples buffer
@@ -71,7 +77,7 @@ struct DitherContext {
 typedef struct ResampleContext * (* resample_init_func)(struct ResampleContext *c, int out_rate, int in_rate, int filter_size, int phase_shift, int linear,
                                     double cutoff, enum AVSampleFormat format, enum SwrFilterType filter_type, double kaiser_beta, double precision, int cheby, int exact_rational);
 typedef void    (* resample_free_func)(struct ResampleContext **c);
-typedef int     (* multiple_resample_func)(struct ResampleContext *c, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed);
+typedef int     (* multiple_resample_func)(struct SwrContext *s, struct ResampleContext *c, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed);
 typedef int     (* resample_flush_func)(struct SwrContext *c);
 typedef int     (* set_compensation_func)(struct ResampleContext *c, int sample_delta, int compensation_distance);
 typedef int64_t (* get_delay_func)(struct SwrContext *s, int64_t base);
@@ -188,12 +194,30 @@ struct SwrContext {
 
     mix_any_func_type *mix_any_f;
 
+    int user_nb_threads;                            ///< User set number of threads
+    int nb_threads;                                 ///< number of threads in use
+    AVSliceThread *slicethread;                     ///< thread pool splitting the work over channels
+    swri_job_func *job_func;                        ///< job currently run by swri_execute()
+    void *job_arg;                                  ///< opaque argument of job_func
+
     /* TODO: callbacks for ASM optimizations */
 };
 
 av_warn_unused_result
 int swri_realloc_audio(AudioData *a, int count);
 
+/**
+ * Get the number of jobs the processing of nb_channels channels of len
+ * samples each should be split into, 1 if it is not worth threading.
+ */
+int swri_get_nb_jobs(SwrContext *s, int nb_channels, int len);
+
+/**
+ * Run func for every jobnr in [0, nb_jobs), on the thread pool if there is
+ * one, and wait for all of them to finish.
+ */
+void swri_execute(SwrContext *s, swri_job_func *func, void *arg, int nb_jobs);
+
 void swri_noise_shaping_int16 (SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count);
 void swri_noise_shaping_int32 (SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count);
 void swri_noise_shaping_float (SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count);
@@ -26,6 +26,8 @@
  */
 
 #include "libavutil/attributes.h"
+#include "libavutil/common.h"
+#include "libavutil/x86/asm.h"
 #include "libavutil/x86/cpu.h"
 #include "libswresample/resample.h"
 
@@ -46,6 +48,455 @@ RESAMPLE_FUNCS(double, sse2);
 RESAMPLE_FUNCS(double, avx);
 RESAMPLE_FUNCS(double, fma3);
 
+#if HAVE_AVX2_INLINE && ARCH_X86_64
+
+/*
+ * Inline kernels for the formats and instruction sets resample.asm lacks:
+ * int32, double with AVX2 and float and double with AVX-512.
+ *
+ * Only the dot products of the filter taps are SIMD, the stepping through
+ * the phases, the rounding, the linear interpolation and the clipping are
+ * those of resample_template.c. The taps are read up to filter_alloc, a
+ * multiple of 8 whose extra coefficients are zero, except in the extra
+ * phase used by the linear interpolation, which is corrected for.
+ * The int32 products are accumulated in 64 bits with vpmuldq on the even
+ * and the odd samples, so the output is identical to the C code.
+ */
+
+#define LOAD_SRC_INT32(R, ld, addr)                                     \
+    ld "  " addr ", %%" R "mm4                                   \n\t"  \
+    "vpsrlq   $32, %%" R "mm4, %%" R "mm5                        \n\t"
+
+/* acc += the products of the filter taps at addr with mm4 and mm5 */
+#define MAC_INT32(R, ld, addr, acc)                                     \
+    ld "  " addr ", %%" R "mm6                                   \n\t"  \
+    "vpmuldq  %%" R "mm6, %%" R "mm4, %%" R "mm7                 \n\t"  \
+    "vpsrlq   $32, %%" R "mm6, %%" R "mm6                        \n\t"  \
+    "vpmuldq  %%" R "mm6, %%" R "mm5, %%" R "mm6                 \n\t"  \
+    "vpaddq   %%" R "mm7, %%" R "mm" acc ", %%" R "mm" acc "     \n\t"  \
+    "vpaddq   %%" R "mm6, %%" R "mm" acc ", %%" R "mm" acc "     \n\t"
+
+#define MAC_FP(R, ps, addr, acc)                                        \
+    "vfmadd231" ps " " addr ", %%" R "mm4, %%" R "mm" acc "      \n\t"
+
+#define REDUCE_INT32_Z(acc)                                             \
+    "vextracti64x4 $1, %%zmm" acc ", %%ymm6                      \n\t"  \
+    "vpaddq   %%ymm6, %%ymm" acc ", %%ymm" acc "                 \n\t"
+
+#define REDUCE_INT32_Y(acc)                                             \
+    "vextracti128 $1, %%ymm" acc ", %%xmm6                       \n\t"  \
+    "vpaddq   %%xmm6, %%xmm" acc ", %%xmm" acc "                 \n\t"  \
+    "vpshufd  $0x4e, %%xmm" acc ", %%xmm6                        \n\t"  \
+    "vpaddq   %%xmm6, %%xmm" acc ", %%xmm" acc "                 \n\t"
+
+#define REDUCE_FP_Z(ps, acc)                                            \
+    "vextractf64x4 $1, %%zmm" acc ", %%ymm6                      \n\t"  \
+    "vadd" ps "   %%ymm6, %%ymm" acc ", %%ymm" acc "             \n\t"
+
+#define REDUCE_FLT_Y(acc)                                               \
+    "vextractf128 $1, %%ymm" acc ", %%xmm6                       \n\t"  \
+    "vaddps   %%xmm6, %%xmm" acc ", %%xmm" acc "                 \n\t"  \
+    "vmovhlps %%xmm" acc ", %%xmm" acc ", %%xmm6                 \n\t"  \
+    "vaddps   %%xmm6, %%xmm" acc ", %%xmm" acc "                 \n\t"  \
+    "vmovshdup %%xmm" acc ", %%xmm6                              \n\t"  \
+    "vaddss   %%xmm6, %%xmm" acc ", %%xmm" acc "                 \n\t"
+
+#define REDUCE_DBL_Y(acc)                                               \
+    "vextractf128 $1, %%ymm" acc ", %%xmm6                       \n\t"  \
+    "vaddpd   %%xmm6, %%xmm" acc ", %%xmm" acc "                 \n\t"  \
+    "vunpckhpd %%xmm" acc ", %%xmm" acc ", %%xmm6                \n\t"  \
+    "vaddsd   %%xmm6, %%xmm" acc ", %%xmm" acc "                 \n\t"
+
+/* sum[k] = sum of src[i] * filter[k][i] for i < len, len a multiple of 8 */
+static av_always_inline void dot_int32_avx2(int64_t *sum, const int32_t *src,
+                                            const int32_t *filter,
+                                            const int32_t *filter2, int len)
+{
+    x86_reg i = -4 * (x86_reg)len;
+
+    if (!filter2) {
+        __asm__ volatile(
+            "vpxor    %%xmm0, %%xmm0, %%xmm0                     \n\t"
+            "1:                                                  \n\t"
+            LOAD_SRC_INT32("y", "vmovdqu", "(%1, %0)")
+            MAC_INT32("y", "vmovdqu", "(%2, %0)", "0")
+            "add      $32, %0                                    \n\t"
+            "jl       1b                                         \n\t"
+            REDUCE_INT32_Y("0")
+            "vmovq    %%xmm0, (%3)                               \n\t"
+            "vzeroupper                                          \n\t"
+            : "+r"(i)
+            : "r"(src + len), "r"(filter + len), "r"(sum)
+            : "memory", XMM_CLOBBERS("xmm0", "xmm4", "xmm5", "xmm6", "xmm7",) "cc"
+        );
+    } else {
+        __asm__ volatile(
+            "vpxor    %%xmm0, %%xmm0, %%xmm0                     \n\t"
+            "vpxor    %%xmm1, %%xmm1, %%xmm1                     \n\t"
+            "1:                                                  \n\t"
+            LOAD_SRC_INT32("y", "vmovdqu", "(%1, %0)")
+            MAC_INT32("y", "vmovdqu", "(%2, %0)", "0")
+            MAC_INT32("y", "vmovdqu", "(%3, %0)", "1")
+            "add      $32, %0                                    \n\t"
+            "jl       1b                                         \n\t"
+            REDUCE_INT32_Y("0")
+            REDUCE_INT32_Y("1")
+            "vmovq    %%xmm0,  (%4)                              \n\t"
+            "vmovq    %%xmm1, 8(%4)                              \n\t"
+            "vzeroupper                                          \n\t"
+            : "+r"(i)
+            : "r"(src + len), "r"(filter + len), "r"(filter2 + len), "r"(sum)
+            : "memory", XMM_CLOBBERS("xmm0", "xmm1", "xmm4", "xmm5", "xmm6", "xmm7",) "cc"
+        );
+    }
+}
+
+static av_always_inline void dot_double_avx2(double *sum, const double *src,
+                                             const double *filter,
+                                             const double *filter2, int len)
+{
+    x86_reg i = -8 * (x86_reg)len;
+
+    if (!filter2) {
+        __asm__ volatile(
+            "vxorpd   %%xmm0, %%xmm0, %%xmm0                     \n\t"
+            "vxorpd   %%xmm1, %%xmm1, %%xmm1                     \n\t"
+            "1:                                                  \n\t"
+            "vmovupd    (%1, %0), %%ymm4                         \n\t"
+            MAC_FP("y", "pd", "(%2, %0)", "0")
+            "vmovupd  32(%1, %0), %%ymm4                         \n\t"
+            MAC_FP("y", "pd", "32(%2, %0)", "1")
+            "add      $64, %0                                    \n\t"
+            "jl       1b                                         \n\t"
+            "vaddpd   %%ymm1, %%ymm0, %%ymm0                     \n\t"
+            REDUCE_DBL_Y("0")
+            "vmovsd   %%xmm0, (%3)                               \n\t"
+            "vzeroupper                                          \n\t"
+            : "+r"(i)
+            : "r"(src + len), "r"(filter + len), "r"(sum)
+            : "memory", XMM_CLOBBERS("xmm0", "xmm1", "xmm4", "xmm6",) "cc"
+        );
+    } else {
+        __asm__ volatile(
+            "vxorpd   %%xmm0, %%xmm0, %%xmm0                     \n\t"
+            "vxorpd   %%xmm1, %%xmm1, %%xmm1                     \n\t"
+            "1:                                                  \n\t"
+            "vmovupd  (%1, %0), %%ymm4                           \n\t"
+            MAC_FP("y", "pd", "(%2, %0)", "0")
+            MAC_FP("y", "pd", "(%3, %0)", "1")
+            "add      $32, %0                                    \n\t"
+            "jl       1b                                         \n\t"
+            REDUCE_DBL_Y("0")
+            REDUCE_DBL_Y("1")
+            "vmovsd   %%xmm0,  (%4)                              \n\t"
+            "vmovsd   %%xmm1, 8(%4)                              \n\t"
+            "vzeroupper                                          \n\t"
+            : "+r"(i)
+            : "r"(src + len), "r"(filter + len), "r"(filter2 + len), "r"(sum)
+            : "memory", XMM_CLOBBERS("xmm0", "xmm1", "xmm4", "xmm6",) "cc"
+        );
+    }
+}
+
+#if HAVE_AVX512_INLINE
+/* the zmm loop covers the multiple of 16 taps, a ymm step the last 8 */
+static av_always_inline void dot_int32_avx512(int64_t *sum, const int32_t *src,
+                                              const int32_t *filter,
+                                              const int32_t *filter2, int len)
+{
+    const int len16 = len & ~15;
+    x86_reg i = -4 * (x86_reg)len16;
+
+    if (!filter2) {
+        __asm__ volatile(
+            "vpxor    %%xmm0, %%xmm0, %%xmm0                     \n\t"
+            "test     %0, %0                                     \n\t"
+            "jz       2f                                         \n\t"
+            "1:                                                  \n\t"
+            LOAD_SRC_INT32("z", "vmovdqu64", "(%1, %0)")
+            MAC_INT32("z", "vmovdqu64", "(%2, %0)", "0")
+            "add      $64, %0                                    \n\t"
+            "jl       1b                                         \n\t"
+            "2:                                                  \n\t"
+            REDUCE_INT32_Z("0")
+            "test     %4, %4                                     \n\t"
+            "jz       3f                                         \n\t"
+            LOAD_SRC_INT32("y", "vmovdqu", "(%1)")
+            MAC_INT32("y", "vmovdqu", "(%2)", "0")
+            "3:                                                  \n\t"
+            REDUCE_INT32_Y("0")
+            "vmovq    %%xmm0, (%3)                               \n\t"
+            "vzeroupper                                          \n\t"
+            : "+r"(i)
+            : "r"(src + len16), "r"(filter + len16), "r"(sum), "r"(len & 8)
+            : "memory", XMM_CLOBBERS("xmm0", "xmm4", "xmm5", "xmm6", "xmm7",) "cc"
+        );
+    } else {
+        __asm__ volatile(
+            "vpxor    %%xmm0, %%xmm0, %%xmm0                     \n\t"
+            "vpxor    %%xmm1, %%xmm1, %%xmm1                     \n\t"
+            "test     %0, %0                                     \n\t"
+            "jz       2f                                         \n\t"
+            "1:                                                  \n\t"
+            LOAD_SRC_INT32("z", "vmovdqu64", "(%1, %0)")
+            MAC_INT32("z", "vmovdqu64", "(%2, %0)", "0")
+            MAC_INT32("z", "vmovdqu64", "(%3, %0)", "1")
+            "add      $64, %0                                    \n\t"
+            "jl       1b                                         \n\t"
+            "2:                                                  \n\t"
+            REDUCE_INT32_Z("0")
+            REDUCE_INT32_Z("1")
+            "test     %5, %5                                     \n\t"
+            "jz       3f                                         \n\t"
+            LOAD_SRC_INT32("y", "vmovdqu", "(%1)")
+            MAC_INT32("y", "vmovdqu", "(%2)", "0")
+            MAC_INT32("y", "vmovdqu", "(%3)", "1")
+            "3:                                                  \n\t"
+            REDUCE_INT32_Y("0")
+            REDUCE_INT32_Y("1")
+            "vmovq    %%xmm0,  (%4)                              \n\t"
+            "vmovq    %%xmm1, 8(%4)                              \n\t"
+            "vzeroupper                                          \n\t"
+            : "+r"(i)
+            : "r"(src + len16), "r"(filter + len16), "r"(filter2 + len16),
+              "r"(sum), "r"(len & 8)
+            : "memory", XMM_CLOBBERS("xmm0", "xmm1", "xmm4", "xmm5", "xmm6", "xmm7",) "cc"
+        );
+    }
+}
+
+static av_always_inline void dot_float_avx512(float *sum, const float *src,
+                                              const float *filter,
+                                              const float *filter2, int len)
+{
+    const int len16 = len & ~15;
+    x86_reg i = -4 * (x86_reg)len16;
+
+    if (!filter2) {
+        __asm__ volatile(
+            "vxorps   %%xmm0, %%xmm0, %%xmm0                     \n\t"
+            "test     %0, %0                                     \n\t"
+            "jz       2f                                         \n\t"
+            "1:                                                  \n\t"
+            "vmovups  (%1, %0), %%zmm4                           \n\t"
+            MAC_FP("z", "ps", "(%2, %0)", "0")
+            "add      $64, %0                                    \n\t"
+            "jl       1b                                         \n\t"
+            "2:                                                  \n\t"
+            REDUCE_FP_Z("ps", "0")
+            "test     %4, %4                                     \n\t"
+            "jz       3f                                         \n\t"
+            "vmovups  (%1), %%ymm4                               \n\t"
+            MAC_FP("y", "ps", "(%2)", "0")
+            "3:                                                  \n\t"
+            REDUCE_FLT_Y("0")
+            "vmovss   %%xmm0, (%3)                               \n\t"
+            "vzeroupper                                          \n\t"
+            : "+r"(i)
+            : "r"(src + len16), "r"(filter + len16), "r"(sum), "r"(len & 8)
+            : "memory", XMM_CLOBBERS("xmm0", "xmm4", "xmm6",) "cc"
+        );
+    } else {
+        __asm__ volatile(
+            "vxorps   %%xmm0, %%xmm0, %%xmm0                     \n\t"
+            "vxorps   %%xmm1, %%xmm1, %%xmm1                     \n\t"
+            "test     %0, %0                                     \n\t"
+            "jz       2f                                         \n\t"
+            "1:                                                  \n\t"
+            "vmovups  (%1, %0), %%zmm4                           \n\t"
+            MAC_FP("z", "ps", "(%2, %0)", "0")
+            MAC_FP("z", "ps", "(%3, %0)", "1")
+            "add      $64, %0                                    \n\t"
+            "jl       1b                                         \n\t"
+            "2:                                                  \n\t"
+            REDUCE_FP_Z("ps", "0")
+            REDUCE_FP_Z("ps", "1")
+            "test     %5, %5                                     \n\t"
+            "jz       3f                                         \n\t"
+            "vmovups  (%1), %%ymm4                               \n\t"
+            MAC_FP("y", "ps", "(%2)", "0")
+            MAC_FP("y", "ps", "(%3)", "1")
+            "3:                                                  \n\t"
+            REDUCE_FLT_Y("0")
+            REDUCE_FLT_Y("1")
+            "vmovss   %%xmm0,  (%4)                              \n\t"
+            "vmovss   %%xmm1, 4(%4)                              \n\t"
+            "vzeroupper                                          \n\t"
+            : "+r"(i)
+            : "r"(src + len16), "r"(filter + len16), "r"(filter2 + len16),
+              "r"(sum), "r"(len & 8)
+            : "memory", XMM_CLOBBERS("xmm0", "xmm1", "xmm4", "xmm6",) "cc"
+        );
+    }
+}
+
+static av_always_inline void dot_double_avx512(double *sum, const double *src,
+                                               const double *filter,
+                                               const double *filter2, int len)
+{
+    x86_reg i = -8 * (x86_reg)len;
+
+    if (!filter2) {
+        __asm__ volatile(
+            "vxorpd   %%xmm0, %%xmm0, %%xmm0                     \n\t"
+            "1:                                                  \n\t"
+            "vmovupd  (%1, %0), %%zmm4                           \n\t"
+            MAC_FP("z", "pd", "(%2, %0)", "0")
+            "add      $64, %0                                    \n\t"
+            "jl       1b                                         \n\t"
+            REDUCE_FP_Z("pd", "0")
+            REDUCE_DBL_Y("0")
+            "vmovsd   %%xmm0, (%3)                               \n\t"
+            "vzeroupper                                          \n\t"
+            : "+r"(i)
+            : "r"(src + len), "r"(filter + len), "r"(sum)
+            : "memory", XMM_CLOBBERS("xmm0", "xmm4", "xmm6",) "cc"
+        );
+    } else {
+        __asm__ volatile(
+            "vxorpd   %%xmm0, %%xmm0, %%xmm0                     \n\t"
+            "vxorpd   %%xmm1, %%xmm1, %%xmm1                     \n\t"
+            "1:                                                  \n\t"
+            "vmovupd  (%1, %0), %%zmm4                           \n\t"
+            MAC_FP("z", "pd", "(%2, %0)", "0")
+            MAC_FP("z", "pd", "(%3, %0)", "1")
+            "add      $64, %0                                    \n\t"
+            "jl       1b                                         \n\t"
+            REDUCE_FP_Z("pd", "0")
+            REDUCE_FP_Z("pd", "1")
+            REDUCE_DBL_Y("0")
+            REDUCE_DBL_Y("1")
+            "vmovsd   %%xmm0,  (%4)                              \n\t"
+            "vmovsd   %%xmm1, 8(%4)                              \n\t"
+            "vzeroupper                                          \n\t"
+            : "+r"(i)
+            : "r"(src + len), "r"(filter + len), "r"(filter2 + len), "r"(sum)
+            : "memory", XMM_CLOBBERS("xmm0", "xmm1", "xmm4", "xmm6",) "cc"
+        );
+    }
+}
+#endif /* HAVE_AVX512_INLINE */
+
+/* rounding and clipping of the int32 sums as done by resample_template.c */
+#define OUT_int32(v)  av_clipl_int32((v) + (1 << 29) >> 30)
+#define OUT_float(v)  (v)
+#define OUT_double(v) (v)
+
+#define LERP_int32(v, v2)  ((v) + ((v2) - (v)) / c->src_incr * frac)
+#define LERP_float(v, v2)  ((v) + ((v2) - (v)) * inv_src_incr * frac)
+#define LERP_double(v, v2) ((v) + ((v2) - (v)) * inv_src_incr * frac)
+
+#define RESAMPLE_INLINE_FUNCS(type, opt, elem, acc)                             \
+static int resample_common_##type##_##opt(ResampleContext *c, void *dest,      \
+                                         const void *source, int n,             \
+                                         int update_ctx)                        \
+{                                                                               \
+    elem *dst = dest;                                                           \
+    const elem *src = source;                                                   \
+    int index = c->index;                                                       \
+    int frac = c->frac;                                                         \
+    int sample_index = 0;                                                       \
+                                                                                \
+    while (index >= c->phase_count) {                                           \
+        sample_index++;                                                         \
+        index -= c->phase_count;                                                \
+    }                                                                           \
+                                                                                \
+    for (int dst_index = 0; dst_index < n; dst_index++) {                       \
+        const elem *filter = (const elem *)c->filter_bank +                     \
+                             c->filter_alloc * index;                           \
+        acc val;                                                                \
+                                                                                \
+        dot_##type##_##opt(&val, src + sample_index, filter, NULL,              \
+                           c->filter_alloc);                                    \
+        dst[dst_index] = OUT_##type(val);                                       \
+                                                                                \
+        frac  += c->dst_incr_mod;                                               \
+        index += c->dst_incr_div;                                               \
+        if (frac >= c->src_incr) {                                              \
+            frac -= c->src_incr;                                                \
+            index++;                                                            \
+        }                                                                       \
+                                                                                \
+        while (index >= c->phase_count) {                                       \
+            sample_index++;                                                     \
+            index -= c->phase_count;                                            \
+        }                                                                       \
+    }                                                                           \
+                                                                                \
+    if (update_ctx) {                                                           \
+        c->frac  = frac;                                                        \
+        c->index = index;                                                       \
+    }                                                                           \
+                                                                                \
+    return sample_index;                                                        \
+}                                                                               \
+                                                                                \
+static int resample_linear_##type##_##opt(ResampleContext *c, void *dest,      \
+                                         const void *source, int n,             \
+                                         int update_ctx)                        \
+{                                                                               \
+    elem *dst = dest;                                                           \
+    const elem *src = source;                                                   \
+    int index = c->index;                                                       \
+    int frac = c->frac;                                                         \
+    int sample_index = 0;                                                       \
+    av_unused double inv_src_incr = 1.0 / c->src_incr;                          \
+                                                                                \
+    while (index >= c->phase_count) {                                           \
+        sample_index++;                                                         \
+        index -= c->phase_count;                                                \
+    }                                                                           \
+                                                                                \
+    for (int dst_index = 0; dst_index < n; dst_index++) {                       \
+        const elem *filter = (const elem *)c->filter_bank +                     \
+                             c->filter_alloc * index;                           \
+        acc val[2];                                                             \
+                                                                                \
+        dot_##type##_##opt(val, src + sample_index, filter,                     \
+                           filter + c->filter_alloc, c->filter_alloc);          \
+        /* the extra phase is phase 0 shifted by one tap, so its tap at     */  \
+        /* filter_length is not padding; the C code does not include it     */  \
+        if (index == c->phase_count - 1 &&                                      \
+            c->filter_length < c->filter_alloc) {                               \
+            const int len = c->filter_length;                                   \
+            val[1] -= src[sample_index + len] *                                 \
+                      (acc)filter[c->filter_alloc + len];                       \
+        }                                                                       \
+        val[0] = LERP_##type(val[0], val[1]);                                   \
+        dst[dst_index] = OUT_##type(val[0]);                                    \
+                                                                                \
+        frac  += c->dst_incr_mod;                                               \
+        index += c->dst_incr_div;                                               \
+        if (frac >= c->src_incr) {                                              \
+            frac -= c->src_incr;                                                \
+            index++;                                                            \
+        }                                                                       \
+                                                                                \
+        while (index >= c->phase_count) {                                       \
+            sample_index++;                                                     \
+            index -= c->phase_count;                                            \
+        }                                                                       \
+    }                                                                           \
+                                                                                \
+    if (update_ctx) {                                                           \
+        c->frac  = frac;                                                        \
+        c->index = index;                                                       \
+    }                                                                           \
+                                                                                \
+    return sample_index;                                                        \
+}
+
+RESAMPLE_INLINE_FUNCS(int32,  avx2, int32_t, int64_t)
+RESAMPLE_INLINE_FUNCS(double, avx2, double,  double)
+#if HAVE_AVX512_INLINE
+RESAMPLE_INLINE_FUNCS(int32,  avx512, int32_t, int64_t)
+RESAMPLE_INLINE_FUNCS(float,  avx512, float,   float)
+RESAMPLE_INLINE_FUNCS(double, avx512, double,  double)
+#endif
+
+#endif /* HAVE_AVX2_INLINE && ARCH_X86_64 */
+
 av_cold void swri_resample_dsp_x86_init(ResampleContext *c)
 {
     int av_unused mm_flags = av_get_cpu_flags();
@@ -65,6 +516,20 @@ av_cold void swri_resample_dsp_x86_init(ResampleContext *c)
             c->dsp.resample_common = ff_resample_common_int16_xop;
         }
         break;
+    case AV_SAMPLE_FMT_S32P:
+#if HAVE_AVX2_INLINE && ARCH_X86_64
+        if (INLINE_AVX2(mm_flags)) {
+            c->dsp.resample_linear = resample_linear_int32_avx2;
+            c->dsp.resample_common = resample_common_int32_avx2;
+        }
+#if HAVE_AVX512_INLINE
+        if (INLINE_AVX512(mm_flags)) {
+            c->dsp.resample_linear = resample_linear_int32_avx512;
+            c->dsp.resample_common = resample_common_int32_avx512;
+        }
+#endif
+#endif
+        break;
     case AV_SAMPLE_FMT_FLTP:
         if (EXTERNAL_SSE(mm_flags)) {
             c->dsp.resample_linear = ff_resample_linear_float_sse;
@@ -82,6 +547,12 @@ av_cold void swri_resample_dsp_x86_init(ResampleContext *c)
             c->dsp.resample_linear = ff_resample_linear_float_fma4;
             c->dsp.resample_common = ff_resample_common_float_fma4;
         }
+#if HAVE_AVX512_INLINE && ARCH_X86_64
+        if (INLINE_AVX512(mm_flags)) {
+            c->dsp.resample_linear = resample_linear_float_avx512;
+            c->dsp.resample_common = resample_common_float_avx512;
+        }
+#endif
         break;
     case AV_SAMPLE_FMT_DBLP:
         if (EXTERNAL_SSE2(mm_flags)) {
@@ -92,10 +563,24 @@ av_cold void swri_resample_dsp_x86_init(ResampleContext *c)
             c->dsp.resample_linear = ff_resample_linear_double_avx;
             c->dsp.resample_common = ff_resample_common_double_avx;
         }
+#if HAVE_AVX2_INLINE && ARCH_X86_64
+        /* without x86asm, or on CPUs where FMA3 is slow */
+        if (INLINE_AVX2(mm_flags) && INLINE_FMA3(mm_flags) &&
+            !EXTERNAL_FMA3_FAST(mm_flags)) {
+            c->dsp.resample_linear = resample_linear_double_avx2;
+            c->dsp.resample_common = resample_common_double_avx2;
+        }
+#endif
         if (EXTERNAL_FMA3_FAST(mm_flags)) {
             c->dsp.resample_linear = ff_resample_linear_double_fma3;
             c->dsp.resample_common = ff_resample_common_double_fma3;
         }
+#if HAVE_AVX512_INLINE && ARCH_X86_64
+        if (INLINE_AVX512(mm_flags)) {
+            c->dsp.resample_linear = resample_linear_double_avx512;
+            c->dsp.resample_common = resample_common_double_avx512;
+        }
+#endif
         break;
     }
 }
@@ -0,0 +1,307 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * scaling of one source frame to several destination frames
+ *
+ * The destinations are produced from the largest to the smallest. With
+ * SWS_MULTI_SHARED_INPUT the source is unpacked / converted once, at source
+ * resolution, to the unsubsampled variant of the common destination format,
+ * and all destinations are scaled from that intermediate frame; chroma is
+ * thus still subsampled only once. With SWS_MULTI_CASCADE every
+ * destination is scaled from the smallest already produced destination of
+ * the same format that is at least as large, so the lower rungs of a ladder
+ * read much less data than the full resolution source.
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/frame.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+
+#include "swscale.h"
+
+typedef struct SwsMultiRung {
+    struct SwsContext *sws;
+    int src_w, src_h, src_format;
+    int dst_w, dst_h, dst_format;
+} SwsMultiRung;
+
+struct SwsMultiContext {
+    int sws_flags;
+    int multi_flags;
+    int threads;
+
+    /* rungs[0] converts the source into the shared intermediate frame,
+     * rungs[i + 1] produces dst[i] */
+    SwsMultiRung *rungs;
+    int           nb_rungs;
+
+    int          *order;
+    unsigned int  order_size;
+
+    AVFrame      *shared;
+};
+
+SwsMultiContext *sws_multi_alloc(int sws_flags, int multi_flags, int threads)
+{
+    SwsMultiContext *m;
+
+    if (threads < 0)
+        return NULL;
+
+    m = av_mallocz(sizeof(*m));
+    if (!m)
+        return NULL;
+
+    m->shared = av_frame_alloc();
+    if (!m->shared) {
+        av_free(m);
+        return NULL;
+    }
+
+    m->sws_flags   = sws_flags;
+    m->multi_flags = multi_flags;
+    m->threads     = threads;
+
+    return m;
+}
+
+void sws_multi_free(SwsMultiContext **pm)
+{
+    SwsMultiContext *m = *pm;
+
+    if (!m)
+        return;
+
+    for (int i = 0; i < m->nb_rungs; i++)
+        sws_freeContext(m->rungs[i].sws);
+    av_freep(&m->rungs);
+    av_freep(&m->order);
+    av_frame_free(&m->shared);
+    av_freep(pm);
+}
+
+static int get_rung(SwsMultiContext *m, SwsMultiRung *r,
+                    const AVFrame *src, const AVFrame *dst)
+{
+    struct SwsContext *c;
+    int ret;
+
+    if (r->sws &&
+        r->src_w == src->width && r->src_h == src->height &&
+        r->src_format == src->format &&
+        r->dst_w == dst->width && r->dst_h == dst->height &&
+        r->dst_format == dst->format)
+        return 0;
+
+    sws_freeContext(r->sws);
+    r->sws = NULL;
+
+    c = sws_alloc_context();
+    if (!c)
+        return AVERROR(ENOMEM);
+
+    if ((ret = av_opt_set_int(c, "srcw",       src->width,     0)) < 0 ||
+        (ret = av_opt_set_int(c, "srch",       src->height,    0)) < 0 ||
+        (ret = av_opt_set_int(c, "src_format", src->format,    0)) < 0 ||
+        (ret = av_opt_set_int(c, "dstw",       dst->width,     0)) < 0 ||
+        (ret = av_opt_set_int(c, "dsth",       dst->height,    0)) < 0 ||
+        (ret = av_opt_set_int(c, "dst_format", dst->format,    0)) < 0 ||
+        (ret = av_opt_set_int(c, "sws_flags",  m->sws_flags,   0)) < 0 ||
+        (ret = av_opt_set_int(c, "threads",    m->threads,     0)) < 0 ||
+        (ret = sws_init_context(c, NULL, NULL)) < 0) {
+        sws_freeContext(c);
+        return ret;
+    }
+
+    r->sws        = c;
+    r->src_w      = src->width;
+    r->src_h      = src->height;
+    r->src_format = src->format;
+    r->dst_w      = dst->width;
+    r->dst_h      = dst->height;
+    r->dst_format = dst->format;
+
+    return 0;
+}
+
+/* sort the destinations by decreasing area, keeping the caller's order
+ * for equal areas */
+static void sort_rungs(int *order, AVFrame *const *dst, int nb_dst)
+{
+    for (int i = 0; i < nb_dst; i++)
+        order[i] = i;
+
+    for (int i = 1; i < nb_dst; i++) {
+        int idx      = order[i];
+        int64_t area = (int64_t)dst[idx]->width * dst[idx]->height;
+        int j;
+
+        for (j = i; j > 0; j--) {
+            const AVFrame *f = dst[order[j - 1]];
+            if ((int64_t)f->width * f->height >= area)
+                break;
+            order[j] = order[j - 1];
+        }
+        order[j] = idx;
+    }
+}
+
+/* the format all destinations share, or AV_PIX_FMT_NONE */
+static enum AVPixelFormat common_format(AVFrame *const *dst, int nb_dst)
+{
+    for (int i = 1; i < nb_dst; i++)
+        if (dst[i]->format != dst[0]->format)
+            return AV_PIX_FMT_NONE;
+    return dst[0]->format;
+}
+
+static int is_jpeg_format(const AVPixFmtDescriptor *desc)
+{
+    return !strncmp(desc->name, "yuvj", 4);
+}
+
+/* the variant of format without chroma subsampling, or AV_PIX_FMT_NONE; the
+ * full range (J) formats map to a full range format */
+static enum AVPixelFormat unsubsampled_format(enum AVPixelFormat format)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format), *d = NULL;
+
+    if (!desc->log2_chroma_w && !desc->log2_chroma_h)
+        return format;
+
+    while ((d = av_pix_fmt_desc_next(d))) {
+        if (d->log2_chroma_w || d->log2_chroma_h ||
+            d->nb_components != desc->nb_components || d->flags != desc->flags ||
+            memcmp(d->comp, desc->comp, sizeof(d->comp)) ||
+            is_jpeg_format(d) != is_jpeg_format(desc))
+            continue;
+        return av_pix_fmt_desc_get_id(d);
+    }
+    return AV_PIX_FMT_NONE;
+}
+
+static int scale_shared_input(SwsMultiContext *m, const AVFrame *src,
+                              enum AVPixelFormat format)
+{
+    AVFrame *shared = m->shared;
+    int ret;
+
+    if (shared->buf[0] &&
+        (shared->width != src->width || shared->height != src->height ||
+         shared->format != format || !av_frame_is_writable(shared)))
+        av_frame_unref(shared);
+
+    shared->width  = src->width;
+    shared->height = src->height;
+    shared->format = format;
+
+    /* allocated here, sws_scale_frame() would use the format without the
+     * J range flag */
+    if (!shared->buf[0] && (ret = av_frame_get_buffer(shared, 0)) < 0)
+        return ret;
+
+    ret = get_rung(m, &m->rungs[0], src, shared);
+    if (ret < 0)
+        return ret;
+
+    return sws_scale_frame(m->rungs[0].sws, shared, src);
+}
+
+int sws_multi_scale_frame(SwsMultiContext *m, AVFrame *const *dst, int nb_dst,
+                          const AVFrame *src)
+{
+    const AVFrame *input = src;
+    enum AVPixelFormat format, shared_format;
+    int ret;
+
+    if (!src || nb_dst <= 0 || !dst)
+        return AVERROR(EINVAL);
+
+    for (int i = 0; i < nb_dst; i++) {
+        if (!dst[i] || dst[i] == src ||
+            dst[i]->width <= 0 || dst[i]->height <= 0 || dst[i]->format < 0)
+            return AVERROR(EINVAL);
+        for (int j = 0; j < i; j++)
+            if (dst[j] == dst[i])
+                return AVERROR(EINVAL);
+    }
+
+    if (nb_dst + 1 > m->nb_rungs) {
+        SwsMultiRung *rungs = av_realloc_array(m->rungs, nb_dst + 1, sizeof(*rungs));
+        if (!rungs)
+            return AVERROR(ENOMEM);
+        memset(rungs + m->nb_rungs, 0, (nb_dst + 1 - m->nb_rungs) * sizeof(*rungs));
+        m->rungs    = rungs;
+        m->nb_rungs = nb_dst + 1;
+    }
+
+    av_fast_malloc(&m->order, &m->order_size, nb_dst * sizeof(*m->order));
+    if (!m->order)
+        return AVERROR(ENOMEM);
+    sort_rungs(m->order, dst, nb_dst);
+
+    format = common_format(dst, nb_dst);
+    shared_format = format != AV_PIX_FMT_NONE ? unsubsampled_format(format)
+                                              : AV_PIX_FMT_NONE;
+    if (m->multi_flags & SWS_MULTI_SHARED_INPUT && nb_dst > 1 &&
+        shared_format != AV_PIX_FMT_NONE &&
+        format != src->format && shared_format != src->format) {
+        ret = scale_shared_input(m, src, shared_format);
+        if (ret < 0)
+            return ret;
+        input = m->shared;
+    }
+
+    for (int i = 0; i < nb_dst; i++) {
+        AVFrame *out       = dst[m->order[i]];
+        const AVFrame *in  = input;
+        SwsMultiRung *rung = &m->rungs[m->order[i] + 1];
+
+        if (m->multi_flags & SWS_MULTI_CASCADE) {
+            int64_t best = INT64_MAX;
+
+            for (int j = 0; j < i; j++) {
+                const AVFrame *f = dst[m->order[j]];
+                int64_t area = (int64_t)f->width * f->height;
+
+                if (f->format == out->format &&
+                    f->width >= out->width && f->height >= out->height &&
+                    area < best) {
+                    in   = f;
+                    best = area;
+                }
+            }
+        }
+
+        ret = get_rung(m, rung, in, out);
+        if (ret < 0)
+            return ret;
+
+        ret = sws_scale_frame(rung->sws, out, in);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
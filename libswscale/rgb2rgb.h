@@ -139,6 +139,22 @@ extern void (*deinterleaveBytes)(const uint8_t *src, uint8_t *dst1, uint8_t *dst
                                  int width, int height, int srcStride,
                                  int dst1Stride, int dst2Stride);
 
+/**
+ * 16-bit versions of interleaveBytes() / deinterleaveBytes(), shifting the
+ * samples left when interleaving and right when deinterleaving, as needed
+ * for the semi-planar formats storing their data in the high bits.
+ * Strides are in bytes.
+ */
+extern void (*interleaveWords)(const uint16_t *src1, const uint16_t *src2,
+                               uint16_t *dst, int width, int height,
+                               int src1Stride, int src2Stride, int dstStride,
+                               int shift);
+
+extern void (*deinterleaveWords)(const uint16_t *src, uint16_t *dst1,
+                                 uint16_t *dst2, int width, int height,
+                                 int srcStride, int dst1Stride, int dst2Stride,
+                                 int shift);
+
 extern void (*vu9_to_vu12)(const uint8_t *src1, const uint8_t *src2,
                            uint8_t *dst1, uint8_t *dst2,
                            int width, int height,
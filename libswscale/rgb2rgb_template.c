@@ -743,6 +743,44 @@ static void deinterleaveBytes_c(const uint8_t *src, uint8_t *dst1, uint8_t *dst2
     }
 }
 
+static void interleaveWords_c(const uint16_t *src1, const uint16_t *src2,
+                              uint16_t *dest, int width, int height,
+                              int src1Stride, int src2Stride, int dstStride,
+                              int shift)
+{
+    int h;
+
+    for (h = 0; h < height; h++) {
+        int w;
+        for (w = 0; w < width; w++) {
+            dest[2 * w + 0] = src1[w] << shift;
+            dest[2 * w + 1] = src2[w] << shift;
+        }
+        dest = (uint16_t *)((uint8_t *)dest + dstStride);
+        src1 = (const uint16_t *)((const uint8_t *)src1 + src1Stride);
+        src2 = (const uint16_t *)((const uint8_t *)src2 + src2Stride);
+    }
+}
+
+static void deinterleaveWords_c(const uint16_t *src, uint16_t *dst1,
+                                uint16_t *dst2, int width, int height,
+                                int srcStride, int dst1Stride, int dst2Stride,
+                                int shift)
+{
+    int h;
+
+    for (h = 0; h < height; h++) {
+        int w;
+        for (w = 0; w < width; w++) {
+            dst1[w] = src[2 * w + 0] >> shift;
+            dst2[w] = src[2 * w + 1] >> shift;
+        }
+        src  = (const uint16_t *)((const uint8_t *)src + srcStride);
+        dst1 = (uint16_t *)((uint8_t *)dst1 + dst1Stride);
+        dst2 = (uint16_t *)((uint8_t *)dst2 + dst2Stride);
+    }
+}
+
 static inline void vu9_to_vu12_c(const uint8_t *src1, const uint8_t *src2,
                                  uint8_t *dst1, uint8_t *dst2,
                                  int width, int height,
@@ -982,6 +1020,8 @@ static av_cold void rgb2rgb_init_c(void)
     ff_rgb24toyv12     = ff_rgb24toyv12_c;
     interleaveBytes    = interleaveBytes_c;
     deinterleaveBytes  = deinterleaveBytes_c;
+    interleaveWords    = interleaveWords_c;
+    deinterleaveWords  = deinterleaveWords_c;
     vu9_to_vu12        = vu9_to_vu12_c;
     yvu9_to_yuy2       = yvu9_to_yuy2_c;
 
@@ -629,118 +629,124 @@ static int check_image_pointers(const uint8_t * const data[4], enum AVPixelForma
     return 1;
 }
 
-static void xyz12Torgb48(struct SwsContext *c, uint16_t *dst,
-                         const uint16_t *src, int stride, int h)
-{
-    int xp,yp;
-    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(c->srcFormat);
+#define RD16(p) (be ? AV_RB16(p) : AV_RL16(p))
+#define WR16(p, v) do { if (be) AV_WB16(p, v); else AV_WL16(p, v); } while (0)
 
-    for (yp=0; yp<h; yp++) {
-        for (xp=0; xp+2<stride; xp+=3) {
+static av_always_inline void
+xyz12Torgb48_template(const SwsContext *c, uint8_t *dst, ptrdiff_t dst_stride,
+                      const uint8_t *src, ptrdiff_t src_stride, int w, int h,
+                      int be)
+{
+    const int16_t *xyzgamma = c->xyzgamma;
+    const int16_t *rgbgamma = c->rgbgamma;
+    const int m00 = c->xyz2rgb_matrix[0][0], m01 = c->xyz2rgb_matrix[0][1], m02 = c->xyz2rgb_matrix[0][2];
+    const int m10 = c->xyz2rgb_matrix[1][0], m11 = c->xyz2rgb_matrix[1][1], m12 = c->xyz2rgb_matrix[1][2];
+    const int m20 = c->xyz2rgb_matrix[2][0], m21 = c->xyz2rgb_matrix[2][1], m22 = c->xyz2rgb_matrix[2][2];
+    int xp, yp;
+
+    for (yp = 0; yp < h; yp++) {
+        const uint16_t *s = (const uint16_t *)(src + yp * src_stride);
+        uint16_t       *d = (uint16_t *)(dst + yp * dst_stride);
+
+        for (xp = 0; xp < 3 * w; xp += 3) {
             int x, y, z, r, g, b;
 
-            if (desc->flags & AV_PIX_FMT_FLAG_BE) {
-                x = AV_RB16(src + xp + 0);
-                y = AV_RB16(src + xp + 1);
-                z = AV_RB16(src + xp + 2);
-            } else {
-                x = AV_RL16(src + xp + 0);
-                y = AV_RL16(src + xp + 1);
-                z = AV_RL16(src + xp + 2);
-            }
-
-            x = c->xyzgamma[x>>4];
-            y = c->xyzgamma[y>>4];
-            z = c->xyzgamma[z>>4];
+            x = xyzgamma[RD16(s + xp + 0) >> 4];
+            y = xyzgamma[RD16(s + xp + 1) >> 4];
+            z = xyzgamma[RD16(s + xp + 2) >> 4];
 
             // convert from XYZlinear to sRGBlinear
-            r = c->xyz2rgb_matrix[0][0] * x +
-                c->xyz2rgb_matrix[0][1] * y +
-                c->xyz2rgb_matrix[0][2] * z >> 12;
-            g = c->xyz2rgb_matrix[1][0] * x +
-                c->xyz2rgb_matrix[1][1] * y +
-                c->xyz2rgb_matrix[1][2] * z >> 12;
-            b = c->xyz2rgb_matrix[2][0] * x +
-                c->xyz2rgb_matrix[2][1] * y +
-                c->xyz2rgb_matrix[2][2] * z >> 12;
-
-            // limit values to 12-bit depth
-            r = av_clip_uintp2(r, 12);
-            g = av_clip_uintp2(g, 12);
-            b = av_clip_uintp2(b, 12);
-
-            // convert from sRGBlinear to RGB and scale from 12bit to 16bit
-            if (desc->flags & AV_PIX_FMT_FLAG_BE) {
-                AV_WB16(dst + xp + 0, c->rgbgamma[r] << 4);
-                AV_WB16(dst + xp + 1, c->rgbgamma[g] << 4);
-                AV_WB16(dst + xp + 2, c->rgbgamma[b] << 4);
-            } else {
-                AV_WL16(dst + xp + 0, c->rgbgamma[r] << 4);
-                AV_WL16(dst + xp + 1, c->rgbgamma[g] << 4);
-                AV_WL16(dst + xp + 2, c->rgbgamma[b] << 4);
-            }
+            r = m00 * x + m01 * y + m02 * z >> 12;
+            g = m10 * x + m11 * y + m12 * z >> 12;
+            b = m20 * x + m21 * y + m22 * z >> 12;
+
+            // limit values to 12-bit depth, convert from sRGBlinear to RGB
+            // and scale from 12bit to 16bit
+            WR16(d + xp + 0, rgbgamma[av_clip_uintp2(r, 12)] << 4);
+            WR16(d + xp + 1, rgbgamma[av_clip_uintp2(g, 12)] << 4);
+            WR16(d + xp + 2, rgbgamma[av_clip_uintp2(b, 12)] << 4);
         }
-        src += stride;
-        dst += stride;
     }
 }
 
-static void rgb48Toxyz12(struct SwsContext *c, uint16_t *dst,
-                         const uint16_t *src, int stride, int h)
+static av_always_inline void
+rgb48Toxyz12_template(const SwsContext *c, uint8_t *dst, ptrdiff_t dst_stride,
+                      const uint8_t *src, ptrdiff_t src_stride, int w, int h,
+                      int be)
 {
-    int xp,yp;
-    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(c->dstFormat);
-
-    for (yp=0; yp<h; yp++) {
-        for (xp=0; xp+2<stride; xp+=3) {
+    const int16_t *rgbgammainv = c->rgbgammainv;
+    const int16_t *xyzgammainv = c->xyzgammainv;
+    const int m00 = c->rgb2xyz_matrix[0][0], m01 = c->rgb2xyz_matrix[0][1], m02 = c->rgb2xyz_matrix[0][2];
+    const int m10 = c->rgb2xyz_matrix[1][0], m11 = c->rgb2xyz_matrix[1][1], m12 = c->rgb2xyz_matrix[1][2];
+    const int m20 = c->rgb2xyz_matrix[2][0], m21 = c->rgb2xyz_matrix[2][1], m22 = c->rgb2xyz_matrix[2][2];
+    int xp, yp;
+
+    for (yp = 0; yp < h; yp++) {
+        const uint16_t *s = (const uint16_t *)(src + yp * src_stride);
+        uint16_t       *d = (uint16_t *)(dst + yp * dst_stride);
+
+        for (xp = 0; xp < 3 * w; xp += 3) {
             int x, y, z, r, g, b;
 
-            if (desc->flags & AV_PIX_FMT_FLAG_BE) {
-                r = AV_RB16(src + xp + 0);
-                g = AV_RB16(src + xp + 1);
-                b = AV_RB16(src + xp + 2);
-            } else {
-                r = AV_RL16(src + xp + 0);
-                g = AV_RL16(src + xp + 1);
-                b = AV_RL16(src + xp + 2);
-            }
-
-            r = c->rgbgammainv[r>>4];
-            g = c->rgbgammainv[g>>4];
-            b = c->rgbgammainv[b>>4];
+            r = rgbgammainv[RD16(s + xp + 0) >> 4];
+            g = rgbgammainv[RD16(s + xp + 1) >> 4];
+            b = rgbgammainv[RD16(s + xp + 2) >> 4];
 
             // convert from sRGBlinear to XYZlinear
-            x = c->rgb2xyz_matrix[0][0] * r +
-                c->rgb2xyz_matrix[0][1] * g +
-                c->rgb2xyz_matrix[0][2] * b >> 12;
-            y = c->rgb2xyz_matrix[1][0] * r +
-                c->rgb2xyz_matrix[1][1] * g +
-                c->rgb2xyz_matrix[1][2] * b >> 12;
-            z = c->rgb2xyz_matrix[2][0] * r +
-                c->rgb2xyz_matrix[2][1] * g +
-                c->rgb2xyz_matrix[2][2] * b >> 12;
-
-            // limit values to 12-bit depth
-            x = av_clip_uintp2(x, 12);
-            y = av_clip_uintp2(y, 12);
-            z = av_clip_uintp2(z, 12);
-
-            // convert from XYZlinear to X'Y'Z' and scale from 12bit to 16bit
-            if (desc->flags & AV_PIX_FMT_FLAG_BE) {
-                AV_WB16(dst + xp + 0, c->xyzgammainv[x] << 4);
-                AV_WB16(dst + xp + 1, c->xyzgammainv[y] << 4);
-                AV_WB16(dst + xp + 2, c->xyzgammainv[z] << 4);
-            } else {
-                AV_WL16(dst + xp + 0, c->xyzgammainv[x] << 4);
-                AV_WL16(dst + xp + 1, c->xyzgammainv[y] << 4);
-                AV_WL16(dst + xp + 2, c->xyzgammainv[z] << 4);
-            }
+            x = m00 * r + m01 * g + m02 * b >> 12;
+            y = m10 * r + m11 * g + m12 * b >> 12;
+            z = m20 * r + m21 * g + m22 * b >> 12;
+
+            // limit values to 12-bit depth, convert from XYZlinear to X'Y'Z'
+            // and scale from 12bit to 16bit
+            WR16(d + xp + 0, xyzgammainv[av_clip_uintp2(x, 12)] << 4);
+            WR16(d + xp + 1, xyzgammainv[av_clip_uintp2(y, 12)] << 4);
+            WR16(d + xp + 2, xyzgammainv[av_clip_uintp2(z, 12)] << 4);
         }
-        src += stride;
-        dst += stride;
     }
 }
 
+#undef RD16
+#undef WR16
+
+#define XYZ_FUNCS(ext, be)                                                      \
+static void xyz12Torgb48_ ## ext ## _c(const SwsContext *c, uint8_t *dst,       \
+                                       ptrdiff_t dst_stride, const uint8_t *src,\
+                                       ptrdiff_t src_stride, int w, int h)      \
+{                                                                               \
+    xyz12Torgb48_template(c, dst, dst_stride, src, src_stride, w, h, be);       \
+}                                                                               \
+                                                                                \
+static void rgb48Toxyz12_ ## ext ## _c(const SwsContext *c, uint8_t *dst,       \
+                                       ptrdiff_t dst_stride, const uint8_t *src,\
+                                       ptrdiff_t src_stride, int w, int h)      \
+{                                                                               \
+    rgb48Toxyz12_template(c, dst, dst_stride, src, src_stride, w, h, be);       \
+}
+
+XYZ_FUNCS(le, 0)
+XYZ_FUNCS(be, 1)
+
+av_cold void ff_sws_init_xyzdsp(SwsContext *c)
+{
+    c->xyz12Torgb48 = isBE(c->srcFormat) ? xyz12Torgb48_be_c : xyz12Torgb48_le_c;
+    c->rgb48Toxyz12 = isBE(c->dstFormat) ? rgb48Toxyz12_be_c : rgb48Toxyz12_le_c;
+
+    if (ARCH_X86)
+        ff_sws_init_xyzdsp_x86(c);
+}
+
+/* whether the source / destination needs an XYZ conversion around scaling */
+static int xyz_src_conversion(const SwsContext *c)
+{
+    return c->srcXYZ && !(c->dstXYZ && c->srcW == c->dstW && c->srcH == c->dstH);
+}
+
+static int xyz_dst_conversion(const SwsContext *c)
+{
+    return c->dstXYZ && !(c->srcXYZ && c->srcW == c->dstW && c->srcH == c->dstH);
+}
+
 static void update_palette(SwsContext *c, const uint32_t *pal)
 {
     for (int i = 0; i < 256; i++) {
@@ -975,7 +981,7 @@ static int scale_internal(SwsContext *c,
         src2[0] = base;
     }
 
-    if (c->srcXYZ && !(c->dstXYZ && c->srcW==c->dstW && c->srcH==c->dstH)) {
+    if (xyz_src_conversion(c) && !c->src_xyz_converted) {
         uint8_t *base;
 
         av_fast_malloc(&c->xyz_scratch, &c->xyz_scratch_allocated,
@@ -986,7 +992,7 @@ static int scale_internal(SwsContext *c,
         base = srcStride[0] < 0 ? c->xyz_scratch - srcStride[0] * (srcSliceH-1) :
                                   c->xyz_scratch;
 
-        xyz12Torgb48(c, (uint16_t*)base, (const uint16_t*)src2[0], srcStride[0]/2, srcSliceH);
+        c->xyz12Torgb48(c, base, srcStride[0], src2[0], srcStride[0], c->srcW, srcSliceH);
         src2[0] = base;
     }
 
@@ -1043,22 +1049,22 @@ static int scale_internal(SwsContext *c,
                       dst2, dstStride2, dstSliceY, dstSliceH);
     }
 
-    if (c->dstXYZ && !(c->srcXYZ && c->srcW==c->dstW && c->srcH==c->dstH)) {
-        uint16_t *dst16;
+    if (xyz_dst_conversion(c)) {
+        uint8_t *dst16;
 
         if (scale_dst) {
-            dst16 = (uint16_t *)dst2[0];
+            dst16 = dst2[0];
         } else {
             int dstY = c->dstY ? c->dstY : srcSliceY + srcSliceH;
 
             av_assert0(dstY >= ret);
             av_assert0(ret >= 0);
             av_assert0(c->dstH >= dstY);
-            dst16 = (uint16_t*)(dst2[0] + (dstY - ret) * dstStride2[0]);
+            dst16 = dst2[0] + (dstY - ret) * dstStride2[0];
         }
 
         /* replace on the same data */
-        rgb48Toxyz12(c, dst16, dst16, dstStride2[0]/2, ret);
+        c->rgb48Toxyz12(c, dst16, dstStride2[0], dst16, dstStride2[0], c->dstW, ret);
     }
 
     /* reset slice direction at end of frame */
@@ -1073,6 +1079,7 @@ void sws_frame_end(struct SwsContext *c)
     av_frame_unref(c->frame_src);
     av_frame_unref(c->frame_dst);
     c->src_ranges.nb_ranges = 0;
+    c->xyz_src_ready = 0;
 }
 
 int sws_frame_start(struct SwsContext *c, AVFrame *dst, const AVFrame *src)
@@ -1117,6 +1124,30 @@ int sws_send_slice(struct SwsContext *c, unsigned int slice_start,
     return 0;
 }
 
+/**
+ * Convert the whole XYZ source frame to RGB48 once, split over the slice
+ * threads, instead of having every slice context convert it.
+ */
+static int convert_xyz_src_threaded(SwsContext *c)
+{
+    const int stride = c->frame_src->linesize[0];
+
+    av_fast_malloc(&c->xyz_scratch, &c->xyz_scratch_allocated,
+                   FFABS(stride) * c->srcH + 32);
+    if (!c->xyz_scratch)
+        return AVERROR(ENOMEM);
+
+    c->xyz_src = stride < 0 ? c->xyz_scratch - stride * (c->srcH - 1) :
+                              c->xyz_scratch;
+
+    c->xyz_src_pass = 1;
+    avpriv_slicethread_execute(c->slicethread, c->nb_slice_ctx, 0);
+    c->xyz_src_pass = 0;
+
+    c->xyz_src_ready = 1;
+    return 0;
+}
+
 unsigned int sws_receive_slice_alignment(const struct SwsContext *c)
 {
     if (c->slice_ctx)
@@ -1149,6 +1180,13 @@ int sws_receive_slice(struct SwsContext *c, unsigned int slice_start,
         int nb_jobs = c->slice_ctx[0]->dither == SWS_DITHER_ED ? 1 : c->nb_slice_ctx;
         int ret = 0;
 
+        if (!c->xyz_src_ready && xyz_src_conversion(c->slice_ctx[0]) &&
+            !c->slice_ctx[0]->cascaded_context[0]) {
+            ret = convert_xyz_src_threaded(c);
+            if (ret < 0)
+                return ret;
+        }
+
         c->dst_slice_start  = slice_start;
         c->dst_slice_height = slice_height;
 
@@ -1222,7 +1260,20 @@ void ff_sws_slice_worker(void *priv, int jobnr, int threadnr,
     const int slice_end    = FFMIN((jobnr + 1) * slice_height, parent->dst_slice_height);
     int err = 0;
 
+    if (parent->xyz_src_pass) {
+        const ptrdiff_t stride = parent->frame_src->linesize[0];
+        const int y0 = (int64_t)c->srcH *  jobnr      / nb_jobs;
+        const int y1 = (int64_t)c->srcH * (jobnr + 1) / nb_jobs;
+
+        c->xyz12Torgb48(c, parent->xyz_src + y0 * stride, stride,
+                        parent->frame_src->data[0] + y0 * stride, stride,
+                        c->srcW, y1 - y0);
+        return;
+    }
+
     if (slice_end > slice_start) {
+        const uint8_t *src[4] = { parent->frame_src->data[0], parent->frame_src->data[1],
+                                  parent->frame_src->data[2], parent->frame_src->data[3] };
         uint8_t *dst[4] = { NULL };
 
         for (int i = 0; i < FF_ARRAY_ELEMS(dst) && parent->frame_dst->data[i]; i++) {
@@ -1233,10 +1284,16 @@ void ff_sws_slice_worker(void *priv, int jobnr, int threadnr,
             dst[i] = parent->frame_dst->data[i] + offset;
         }
 
-        err = scale_internal(c, (const uint8_t * const *)parent->frame_src->data,
+        if (parent->xyz_src_ready)
+            src[0] = parent->xyz_src;
+        c->src_xyz_converted = parent->xyz_src_ready;
+
+        err = scale_internal(c, src,
                              parent->frame_src->linesize, 0, c->srcH,
                              dst, parent->frame_dst->linesize,
                              parent->dst_slice_start + slice_start, slice_end - slice_start);
+
+        c->src_xyz_converted = 0;
     }
 
     parent->slice_err[threadnr] = err;
@@ -242,6 +242,68 @@ int sws_scale(struct SwsContext *c, const uint8_t *const srcSlice[],
  */
 int sws_scale_frame(struct SwsContext *c, AVFrame *dst, const AVFrame *src);
 
+/**
+ * Context for scaling one source frame to several destination frames at
+ * once, e.g. to all the renditions of an adaptive bitrate ladder.
+ */
+typedef struct SwsMultiContext SwsMultiContext;
+
+/**
+ * Convert the source once to the format shared by all the destinations, at
+ * source resolution, and scale every destination from that intermediate
+ * frame. If that format has subsampled chroma, the intermediate frame uses
+ * its variant without subsampling (e.g. yuv444p for yuv420p), so chroma is
+ * still subsampled only once. Has no effect if the destinations do not all
+ * have the same format, or if no such variant exists.
+ */
+#define SWS_MULTI_SHARED_INPUT 0x1
+/**
+ * Scale each destination from the smallest, already produced destination of
+ * the same format that is at least as large, instead of from the source.
+ * Destinations are produced in order of decreasing area.
+ *
+ * @note The smaller destinations are then filtered more than once, so their
+ *       quality is slightly lower than with independent scaling. With
+ *       subsampled formats their chroma is resampled from already subsampled
+ *       chroma. Use it when speed matters more than the last bit of quality.
+ */
+#define SWS_MULTI_CASCADE      0x2
+
+/**
+ * Allocate a multi-output scaling context.
+ *
+ * @param sws_flags   scaler flags (SWS_BICUBIC etc.) of all the scaling
+ *                    contexts created internally
+ * @param multi_flags a combination of SWS_MULTI_* flags
+ * @param threads     number of slice threads of each scaling context, 0 for
+ *                    automatic
+ * @return the context, NULL on failure
+ */
+SwsMultiContext *sws_multi_alloc(int sws_flags, int multi_flags, int threads);
+
+/**
+ * Free the multi-output scaling context and everything associated with it,
+ * and set the pointer to NULL.
+ */
+void sws_multi_free(SwsMultiContext **m);
+
+/**
+ * Scale the source frame to all the destination frames.
+ *
+ * The scaling contexts are created on the first call and reused as long as
+ * the frame geometries and formats do not change.
+ *
+ * @param dst    array of nb_dst distinct destination frames. Their width,
+ *               height and format must be set; their data buffers may either
+ *               be allocated by the caller or left clear, in which case they
+ *               are allocated as with sws_scale_frame().
+ * @param nb_dst number of destination frames
+ * @param src    the source frame
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int sws_multi_scale_frame(SwsMultiContext *m, AVFrame *const *dst, int nb_dst,
+                          const AVFrame *src);
+
 /**
  * Initialize the scaling process for a given pair of source/destination frames.
  * Must be called before any calls to sws_send_slice() and sws_receive_slice().
@@ -550,6 +550,15 @@ typedef struct SwsContext {
     int16_t xyz2rgb_matrix[3][4];
     int16_t rgb2xyz_matrix[3][4];
 
+    /**
+     * Convert between XYZ12 and RGB48 using the gamma tables and matrices
+     * above. w is in pixels, strides are in bytes; src and dst may be equal.
+     */
+    void (*xyz12Torgb48)(const struct SwsContext *c, uint8_t *dst, ptrdiff_t dst_stride,
+                         const uint8_t *src, ptrdiff_t src_stride, int w, int h);
+    void (*rgb48Toxyz12)(const struct SwsContext *c, uint8_t *dst, ptrdiff_t dst_stride,
+                         const uint8_t *src, ptrdiff_t src_stride, int w, int h);
+
     /* function pointers for swscale() */
     yuv2planar1_fn yuv2plane1;
     yuv2planarX_fn yuv2planeX;
@@ -671,6 +680,13 @@ typedef struct SwsContext {
     uint8_t     *xyz_scratch;
     unsigned int xyz_scratch_allocated;
 
+    // with slice threading, the XYZ source is converted once per frame by
+    // all the slice threads into xyz_scratch, xyz_src points to its first line
+    uint8_t     *xyz_src;
+    int          xyz_src_ready;     ///< xyz_src holds the current frame
+    int          xyz_src_pass;      ///< the slice workers convert the source
+    int          src_xyz_converted; ///< set on slice contexts scaling xyz_src
+
     unsigned int dst_slice_align;
     atomic_int   stride_unaligned_warned;
     atomic_int   data_unaligned_warned;
@@ -953,6 +969,8 @@ void ff_get_unscaled_swscale_arm(SwsContext *c);
 void ff_get_unscaled_swscale_aarch64(SwsContext *c);
 
 void ff_sws_init_scale(SwsContext *c);
+void ff_sws_init_xyzdsp(SwsContext *c);
+void ff_sws_init_xyzdsp_x86(SwsContext *c);
 
 void ff_sws_init_input_funcs(SwsContext *c);
 void ff_sws_init_output_funcs(SwsContext *c,
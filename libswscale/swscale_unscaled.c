@@ -323,6 +323,186 @@ static int planar8ToP01xleWrapper(SwsContext *c, const uint8_t *src[],
 
 #undef output_pixel
 
+static void copyPlane16Shift(const uint8_t *src, int srcStride,
+                             int srcSliceY, int srcSliceH, int width,
+                             uint8_t *dst, int dstStride, int shift)
+{
+    int x, y;
+
+    if (!shift) {
+        copyPlane(src, srcStride, srcSliceY, srcSliceH, 2 * width,
+                  dst, dstStride);
+        return;
+    }
+
+    dst += dstStride * srcSliceY;
+    for (y = 0; y < srcSliceH; y++) {
+        const uint16_t *s = (const uint16_t *)src;
+        uint16_t *d = (uint16_t *)dst;
+
+        if (shift > 0) {
+            for (x = 0; x < width; x++)
+                d[x] = s[x] << shift;
+        } else {
+            for (x = 0; x < width; x++)
+                d[x] = s[x] >> -shift;
+        }
+        src += srcStride;
+        dst += dstStride;
+    }
+}
+
+/* native endian yuv4xxp10/16 -> p0/p2/p4 10/16 of the same depth */
+static int planarToPxxxWrapper(SwsContext *c, const uint8_t *src[],
+                               int srcStride[], int srcSliceY,
+                               int srcSliceH, uint8_t *dstParam[],
+                               int dstStride[])
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(c->dstFormat);
+    const int shift = desc->comp[0].shift;
+    const int chrY  = AV_CEIL_RSHIFT(srcSliceY, c->chrSrcVSubSample);
+    const int chrH  = AV_CEIL_RSHIFT(srcSliceH, c->chrSrcVSubSample);
+    uint8_t *dst    = dstParam[1] + dstStride[1] * chrY;
+
+    copyPlane16Shift(src[0], srcStride[0], srcSliceY, srcSliceH, c->srcW,
+                     dstParam[0], dstStride[0], shift);
+
+    interleaveWords((const uint16_t *)src[1], (const uint16_t *)src[2],
+                    (uint16_t *)dst, c->chrSrcW, chrH,
+                    srcStride[1], srcStride[2], dstStride[1], shift);
+
+    return srcSliceH;
+}
+
+/* native endian p0/p2/p4 10/16 -> yuv4xxp10/16 of the same depth */
+static int pxxxToPlanarWrapper(SwsContext *c, const uint8_t *src[],
+                               int srcStride[], int srcSliceY,
+                               int srcSliceH, uint8_t *dstParam[],
+                               int dstStride[])
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(c->srcFormat);
+    const int shift = desc->comp[0].shift;
+    const int chrY  = AV_CEIL_RSHIFT(srcSliceY, c->chrSrcVSubSample);
+    const int chrH  = AV_CEIL_RSHIFT(srcSliceH, c->chrSrcVSubSample);
+    uint8_t *dst1   = dstParam[1] + dstStride[1] * chrY;
+    uint8_t *dst2   = dstParam[2] + dstStride[2] * chrY;
+
+    copyPlane16Shift(src[0], srcStride[0], srcSliceY, srcSliceH, c->srcW,
+                     dstParam[0], dstStride[0], -shift);
+
+    deinterleaveWords((const uint16_t *)src[1], (uint16_t *)dst1,
+                      (uint16_t *)dst2, c->chrSrcW, chrH,
+                      srcStride[1], dstStride[1], dstStride[2], shift);
+
+    return srcSliceH;
+}
+
+/* v scaled from srcDepth to dstDepth bits the way the generic scaler does it:
+ * shifted left when widening, rounded and clipped when narrowing */
+static av_always_inline int convertDepth(int v, int srcDepth, int dstDepth)
+{
+    const int shift = srcDepth - dstDepth;
+
+    if (shift <= 0)
+        return v << -shift;
+    return FFMIN((v + (1 << (shift - 1))) >> shift, (1 << dstDepth) - 1);
+}
+
+static void convertPlane16(const uint8_t *src, int srcStride, int width, int height,
+                           uint8_t *dst, int dstStride, int srcDepth, int dstDepth)
+{
+    int x, y;
+
+    if (dstDepth >= srcDepth) {
+        copyPlane16Shift(src, srcStride, 0, height, width, dst, dstStride,
+                         dstDepth - srcDepth);
+        return;
+    }
+
+    for (y = 0; y < height; y++) {
+        const uint16_t *s = (const uint16_t *)src;
+        uint16_t *d = (uint16_t *)dst;
+
+        for (x = 0; x < width; x++)
+            d[x] = convertDepth(s[x], srcDepth, dstDepth);
+        src += srcStride;
+        dst += dstStride;
+    }
+}
+
+/* native endian yuv422p9..16 <-> yuv444p9..16 with SWS_POINT: the chroma
+ * samples are duplicated when upsampling and the odd ones are kept when
+ * downsampling, which is what the generic scaler does for an even width */
+static int planar422To444Wrapper(SwsContext *c, const uint8_t *src[],
+                                 int srcStride[], int srcSliceY,
+                                 int srcSliceH, uint8_t *dstParam[],
+                                 int dstStride[])
+{
+    const int srcDepth = av_pix_fmt_desc_get(c->srcFormat)->comp[0].depth;
+    const int dstDepth = av_pix_fmt_desc_get(c->dstFormat)->comp[0].depth;
+    int plane, x, y;
+
+    convertPlane16(src[0], srcStride[0], c->srcW, srcSliceH,
+                   dstParam[0] + dstStride[0] * srcSliceY, dstStride[0],
+                   srcDepth, dstDepth);
+
+    for (plane = 1; plane < 3; plane++) {
+        const uint8_t *srcPtr = src[plane];
+        uint8_t *dstPtr = dstParam[plane] + dstStride[plane] * srcSliceY;
+
+        if (dstDepth >= srcDepth) {
+            interleaveWords((const uint16_t *)srcPtr, (const uint16_t *)srcPtr,
+                            (uint16_t *)dstPtr, c->chrSrcW, srcSliceH,
+                            srcStride[plane], srcStride[plane], dstStride[plane],
+                            dstDepth - srcDepth);
+            continue;
+        }
+
+        for (y = 0; y < srcSliceH; y++) {
+            const uint16_t *s = (const uint16_t *)srcPtr;
+            uint16_t *d = (uint16_t *)dstPtr;
+
+            for (x = 0; x < c->chrSrcW; x++)
+                d[2 * x] = d[2 * x + 1] = convertDepth(s[x], srcDepth, dstDepth);
+            srcPtr += srcStride[plane];
+            dstPtr += dstStride[plane];
+        }
+    }
+
+    return srcSliceH;
+}
+
+static int planar444To422Wrapper(SwsContext *c, const uint8_t *src[],
+                                 int srcStride[], int srcSliceY,
+                                 int srcSliceH, uint8_t *dstParam[],
+                                 int dstStride[])
+{
+    const int srcDepth = av_pix_fmt_desc_get(c->srcFormat)->comp[0].depth;
+    const int dstDepth = av_pix_fmt_desc_get(c->dstFormat)->comp[0].depth;
+    int plane, x, y;
+
+    convertPlane16(src[0], srcStride[0], c->srcW, srcSliceH,
+                   dstParam[0] + dstStride[0] * srcSliceY, dstStride[0],
+                   srcDepth, dstDepth);
+
+    for (plane = 1; plane < 3; plane++) {
+        const uint8_t *srcPtr = src[plane];
+        uint8_t *dstPtr = dstParam[plane] + dstStride[plane] * srcSliceY;
+
+        for (y = 0; y < srcSliceH; y++) {
+            const uint16_t *s = (const uint16_t *)srcPtr;
+            uint16_t *d = (uint16_t *)dstPtr;
+
+            for (x = 0; x < c->chrDstW; x++)
+                d[x] = convertDepth(s[2 * x + 1], srcDepth, dstDepth);
+            srcPtr += srcStride[plane];
+            dstPtr += dstStride[plane];
+        }
+    }
+
+    return srcSliceH;
+}
+
 static int planarToYuy2Wrapper(SwsContext *c, const uint8_t *src[],
                                int srcStride[], int srcSliceY, int srcSliceH,
                                uint8_t *dstParam[], int dstStride[])
@@ -1966,6 +2146,19 @@ static int planarCopyWrapper(SwsContext *c, const uint8_t *src[],
 }
 
 
+/* yuv422p9..16 or yuv444p9..16 in native endianness, without alpha */
+static int is422To444Candidate(enum AVPixelFormat pix_fmt)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(pix_fmt);
+
+    return isPlanarYUV(pix_fmt) && !isSemiPlanarYUV(pix_fmt) &&
+           desc->nb_components == 3 && desc->log2_chroma_w <= 1 &&
+           !desc->log2_chroma_h && !desc->comp[0].shift &&
+           desc->comp[0].depth > 8 && desc->comp[0].depth <= 16 &&
+           !(desc->flags & AV_PIX_FMT_FLAG_FLOAT) &&
+           isBE(pix_fmt) == HAVE_BIGENDIAN;
+}
+
 #define IS_DIFFERENT_ENDIANESS(src_fmt, dst_fmt, pix_fmt)          \
     ((src_fmt == pix_fmt ## BE && dst_fmt == pix_fmt ## LE) ||     \
      (src_fmt == pix_fmt ## LE && dst_fmt == pix_fmt ## BE))
@@ -2019,6 +2212,33 @@ void ff_get_unscaled_swscale(SwsContext *c)
         (dstFormat == AV_PIX_FMT_P010 || dstFormat == AV_PIX_FMT_P016)) {
         c->convert_unscaled = planarToP01xWrapper;
     }
+    /* yuv4xxp10/16 <-> p0/p2/p4 10/16, native endian, same depth */
+    if ((dstFormat == AV_PIX_FMT_P210 &&
+         (srcFormat == AV_PIX_FMT_YUV422P10 || srcFormat == AV_PIX_FMT_YUVA422P10)) ||
+        (dstFormat == AV_PIX_FMT_P410 &&
+         (srcFormat == AV_PIX_FMT_YUV444P10 || srcFormat == AV_PIX_FMT_YUVA444P10)) ||
+        (dstFormat == AV_PIX_FMT_P216 &&
+         (srcFormat == AV_PIX_FMT_YUV422P16 || srcFormat == AV_PIX_FMT_YUVA422P16)) ||
+        (dstFormat == AV_PIX_FMT_P416 &&
+         (srcFormat == AV_PIX_FMT_YUV444P16 || srcFormat == AV_PIX_FMT_YUVA444P16))) {
+        c->convert_unscaled = planarToPxxxWrapper;
+    }
+    if ((srcFormat == AV_PIX_FMT_P010 && dstFormat == AV_PIX_FMT_YUV420P10) ||
+        (srcFormat == AV_PIX_FMT_P210 && dstFormat == AV_PIX_FMT_YUV422P10) ||
+        (srcFormat == AV_PIX_FMT_P410 && dstFormat == AV_PIX_FMT_YUV444P10) ||
+        (srcFormat == AV_PIX_FMT_P016 && dstFormat == AV_PIX_FMT_YUV420P16) ||
+        (srcFormat == AV_PIX_FMT_P216 && dstFormat == AV_PIX_FMT_YUV422P16) ||
+        (srcFormat == AV_PIX_FMT_P416 && dstFormat == AV_PIX_FMT_YUV444P16)) {
+        c->convert_unscaled = pxxxToPlanarWrapper;
+    }
+    /* yuv422p9..16 <-> yuv444p9..16, native endian, nearest neighbour */
+    if ((flags & SWS_POINT) && !(c->srcW & 1) &&
+        is422To444Candidate(srcFormat) && is422To444Candidate(dstFormat)) {
+        if (c->chrSrcHSubSample == 1 && c->chrDstHSubSample == 0)
+            c->convert_unscaled = planar422To444Wrapper;
+        else if (c->chrSrcHSubSample == 0 && c->chrDstHSubSample == 1)
+            c->convert_unscaled = planar444To422Wrapper;
+    }
     /* yuv420p_to_p01xle */
     if ((srcFormat == AV_PIX_FMT_YUV420P || srcFormat == AV_PIX_FMT_YUVA420P) &&
         (dstFormat == AV_PIX_FMT_P010LE || dstFormat == AV_PIX_FMT_P016LE)) {
@@ -0,0 +1,223 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Compare the output of sws_multi_scale_frame() with independent scaling of
+ * the source to every destination: bit-exact without flags, within a small
+ * mean error with SWS_MULTI_SHARED_INPUT and SWS_MULTI_CASCADE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libavutil/lfg.h"
+#include "libavutil/pixdesc.h"
+
+#include "libswscale/swscale.h"
+
+#define SRC_W 320
+#define SRC_H 240
+#define SWS_FLAGS (SWS_BICUBIC | SWS_ACCURATE_RND | SWS_BITEXACT)
+
+static const struct {
+    int w, h;
+} ladder[] = {
+    { 320, 240 }, { 96, 72 }, { 240, 180 }, { 160, 120 },
+};
+#define NB_DST (sizeof(ladder) / sizeof(ladder[0]))
+
+static AVFrame *alloc_frame(int w, int h, enum AVPixelFormat format)
+{
+    AVFrame *frame = av_frame_alloc();
+
+    if (!frame)
+        return NULL;
+    frame->width  = w;
+    frame->height = h;
+    frame->format = format;
+    if (av_frame_get_buffer(frame, 0) < 0)
+        av_frame_free(&frame);
+    return frame;
+}
+
+/* smooth gradients with some noise, packed rgb24 */
+static void fill_source(AVFrame *src)
+{
+    AVLFG lfg;
+
+    av_lfg_init(&lfg, 0xdeadbeef);
+    for (int y = 0; y < src->height; y++) {
+        uint8_t *p = src->data[0] + y * src->linesize[0];
+        for (int x = 0; x < src->width; x++) {
+            int n = av_lfg_get(&lfg) & 7;
+            p[3 * x + 0] = (x * 255 / src->width + n) & 0xff;
+            p[3 * x + 1] = (y * 255 / src->height + n) & 0xff;
+            p[3 * x + 2] = ((x + y) * 2 + n) & 0xff;
+        }
+    }
+}
+
+/* mean absolute difference over all the planes of two frames */
+static double frame_diff(const AVFrame *a, const AVFrame *b)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(a->format);
+    uint64_t sum = 0, count = 0;
+
+    for (int p = 0; p < 3; p++) {
+        int w = p ? AV_CEIL_RSHIFT(a->width,  desc->log2_chroma_w) : a->width;
+        int h = p ? AV_CEIL_RSHIFT(a->height, desc->log2_chroma_h) : a->height;
+
+        for (int y = 0; y < h; y++) {
+            const uint8_t *pa = a->data[p] + y * a->linesize[p];
+            const uint8_t *pb = b->data[p] + y * b->linesize[p];
+            for (int x = 0; x < w; x++)
+                sum += abs(pa[x] - pb[x]);
+        }
+        count += w * h;
+    }
+    return (double)sum / count;
+}
+
+static int run_test(const AVFrame *src, AVFrame *const *ref,
+                    enum AVPixelFormat format, int multi_flags, double max_diff)
+{
+    SwsMultiContext *m = sws_multi_alloc(SWS_FLAGS, multi_flags, 1);
+    AVFrame *dst[NB_DST] = { NULL };
+    int ret = AVERROR(ENOMEM), fail = 0;
+
+    if (!m)
+        return ret;
+
+    for (int i = 0; i < NB_DST; i++) {
+        dst[i] = alloc_frame(ladder[i].w, ladder[i].h, format);
+        if (!dst[i])
+            goto end;
+    }
+
+    /* the second pass reuses the contexts created by the first one */
+    for (int pass = 0; pass < 2; pass++) {
+        ret = sws_multi_scale_frame(m, dst, NB_DST, src);
+        if (ret < 0)
+            goto end;
+
+        for (int i = 0; i < NB_DST; i++) {
+            double diff = frame_diff(dst[i], ref[i]);
+            if (max_diff ? diff > max_diff : diff != 0) {
+                fprintf(stderr, "flags %d, pass %d, %dx%d: mean difference %f\n",
+                        multi_flags, pass, ladder[i].w, ladder[i].h, diff);
+                fail = 1;
+            }
+        }
+    }
+
+    printf("%s, multi_flags %d: %s\n", av_get_pix_fmt_name(format),
+           multi_flags, fail ? "FAIL" : "OK");
+    ret = fail ? AVERROR_BUG : 0;
+
+end:
+    for (int i = 0; i < NB_DST; i++)
+        av_frame_free(&dst[i]);
+    sws_multi_free(&m);
+    return ret;
+}
+
+static int test_format(const AVFrame *src, enum AVPixelFormat format)
+{
+    static const int modes[] = {
+        0,
+        SWS_MULTI_SHARED_INPUT,
+        SWS_MULTI_CASCADE,
+        SWS_MULTI_SHARED_INPUT | SWS_MULTI_CASCADE,
+    };
+    AVFrame *ref[NB_DST] = { NULL };
+    struct SwsContext *sws = NULL;
+    int ret = AVERROR(ENOMEM);
+
+    for (int i = 0; i < NB_DST; i++) {
+        ref[i] = alloc_frame(ladder[i].w, ladder[i].h, format);
+        if (!ref[i])
+            goto end;
+        sws = sws_getCachedContext(sws, src->width, src->height, src->format,
+                                   ref[i]->width, ref[i]->height, format,
+                                   SWS_FLAGS, NULL, NULL, NULL);
+        if (!sws)
+            goto end;
+        ret = sws_scale_frame(sws, ref[i], src);
+        if (ret < 0)
+            goto end;
+    }
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(modes); i++) {
+        /* the shared-input and cascaded results differ from independent
+         * scaling only by the rounding of the extra filtering steps */
+        ret = run_test(src, ref, format, modes[i], modes[i] ? 0.5 : 0);
+        if (ret < 0)
+            goto end;
+    }
+
+end:
+    for (int i = 0; i < NB_DST; i++)
+        av_frame_free(&ref[i]);
+    sws_freeContext(sws);
+    return ret;
+}
+
+static int test_errors(const AVFrame *src)
+{
+    SwsMultiContext *m = sws_multi_alloc(SWS_FLAGS, 0, 1);
+    AVFrame *dst[2];
+    int ret;
+
+    if (!m)
+        return AVERROR(ENOMEM);
+
+    dst[0] = dst[1] = alloc_frame(64, 48, AV_PIX_FMT_YUV420P);
+    if (!dst[0]) {
+        sws_multi_free(&m);
+        return AVERROR(ENOMEM);
+    }
+    ret = sws_multi_scale_frame(m, dst, 2, src);
+    printf("duplicate destination: %s\n", ret == AVERROR(EINVAL) ? "rejected" : "accepted");
+    ret = sws_multi_scale_frame(m, dst, 0, src);
+    printf("no destination: %s\n", ret == AVERROR(EINVAL) ? "rejected" : "accepted");
+
+    av_frame_free(&dst[0]);
+    sws_multi_free(&m);
+    return 0;
+}
+
+int main(void)
+{
+    AVFrame *src = alloc_frame(SRC_W, SRC_H, AV_PIX_FMT_RGB24);
+    int ret;
+
+    if (!src)
+        return 1;
+    fill_source(src);
+
+    if ((ret = test_format(src, AV_PIX_FMT_YUV420P)) < 0 ||
+        (ret = test_format(src, AV_PIX_FMT_YUV444P)) < 0 ||
+        (ret = test_format(src, AV_PIX_FMT_YUVJ420P)) < 0 ||
+        (ret = test_errors(src)) < 0)
+        fprintf(stderr, "test failed: %s\n", av_err2str(ret));
+
+    av_frame_free(&src);
+    return ret < 0;
+}
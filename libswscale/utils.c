@@ -892,7 +892,8 @@ static void fill_xyztables(struct SwsContext *c)
         {1689, 1464,  739},
         { 871, 2929,  296},
         {  79,  488, 3891} };
-    static int16_t xyzgamma_tab[4096], rgbgamma_tab[4096], xyzgammainv_tab[4096], rgbgammainv_tab[4096];
+    /* one entry of padding for the dword gathers of the x86 versions */
+    static int16_t xyzgamma_tab[4096 + 1], rgbgamma_tab[4096 + 1], xyzgammainv_tab[4096 + 1], rgbgammainv_tab[4096 + 1];
 
     memcpy(c->xyz2rgb_matrix, xyz2rgb_matrix, sizeof(c->xyz2rgb_matrix));
     memcpy(c->rgb2xyz_matrix, rgb2xyz_matrix, sizeof(c->rgb2xyz_matrix));
@@ -1162,8 +1163,10 @@ static void handle_formats(SwsContext *c)
     c->dst0Alpha |= handle_0alpha(&c->dstFormat);
     c->srcXYZ    |= handle_xyz(&c->srcFormat);
     c->dstXYZ    |= handle_xyz(&c->dstFormat);
-    if (c->srcXYZ || c->dstXYZ)
+    if (c->srcXYZ || c->dstXYZ) {
         fill_xyztables(c);
+        ff_sws_init_xyzdsp(c);
+    }
 }
 
 SwsContext *sws_alloc_context(void)
@@ -129,6 +129,104 @@ DECLARE_ALIGNED(8, extern const uint64_t, ff_bgr2UVOffset);
 #define RENAME(a) a ## _3dnow
 #include "rgb2rgb_template.c"
 
+#if HAVE_AVX2_INLINE
+static void interleaveWords_avx2(const uint16_t *src1, const uint16_t *src2,
+                                 uint16_t *dest, int width, int height,
+                                 int src1Stride, int src2Stride, int dstStride,
+                                 int shift)
+{
+    int h;
+
+    for (h = 0; h < height; h++) {
+        int w;
+
+        if (width >= 16) {
+            __asm__ volatile(
+                "vmovd                   %4, %%xmm3         \n\t"
+                "xor      %%"FF_REG_a", %%"FF_REG_a"         \n\t"
+                "1:                                         \n\t"
+                "vmovdqu   (%1, %%"FF_REG_a"), %%ymm0       \n\t"
+                "vmovdqu   (%2, %%"FF_REG_a"), %%ymm1       \n\t"
+                "vpsllw           %%xmm3, %%ymm0, %%ymm0    \n\t"
+                "vpsllw           %%xmm3, %%ymm1, %%ymm1    \n\t"
+                "vpunpcklwd       %%ymm1, %%ymm0, %%ymm2    \n\t"
+                "vpunpckhwd       %%ymm1, %%ymm0, %%ymm0    \n\t"
+                "vperm2i128 $0x20, %%ymm0, %%ymm2, %%ymm1   \n\t"
+                "vperm2i128 $0x31, %%ymm0, %%ymm2, %%ymm2   \n\t"
+                "vmovdqu          %%ymm1,   (%0, %%"FF_REG_a", 2) \n\t"
+                "vmovdqu          %%ymm2, 32(%0, %%"FF_REG_a", 2) \n\t"
+                "add                 $32, %%"FF_REG_a"      \n\t"
+                "cmp                  %3, %%"FF_REG_a"      \n\t"
+                " jb                  1b                    \n\t"
+                "vzeroupper                                 \n\t"
+                :: "r"(dest), "r"(src1), "r"(src2),
+                   "r"(2 * ((x86_reg)width & ~15)), "r"(shift)
+                : "memory", XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm3",) "%"FF_REG_a
+            );
+        }
+        for (w = width & ~15; w < width; w++) {
+            dest[2 * w + 0] = src1[w] << shift;
+            dest[2 * w + 1] = src2[w] << shift;
+        }
+        dest = (uint16_t *)((uint8_t *)dest + dstStride);
+        src1 = (const uint16_t *)((const uint8_t *)src1 + src1Stride);
+        src2 = (const uint16_t *)((const uint8_t *)src2 + src2Stride);
+    }
+}
+
+static void deinterleaveWords_avx2(const uint16_t *src, uint16_t *dst1,
+                                   uint16_t *dst2, int width, int height,
+                                   int srcStride, int dst1Stride, int dst2Stride,
+                                   int shift)
+{
+    int h;
+
+    for (h = 0; h < height; h++) {
+        int w;
+
+        if (width >= 16) {
+            __asm__ volatile(
+                "vmovd                   %4, %%xmm4         \n\t"
+                "vmovd                   %5, %%xmm5         \n\t"
+                "vpcmpeqd         %%ymm6, %%ymm6, %%ymm6    \n\t"
+                "vpsrld              $16, %%ymm6, %%ymm6    \n\t"
+                "xor      %%"FF_REG_a", %%"FF_REG_a"         \n\t"
+                "1:                                         \n\t"
+                "vmovdqu   (%0, %%"FF_REG_a", 2), %%ymm0    \n\t"
+                "vmovdqu 32(%0, %%"FF_REG_a", 2), %%ymm1    \n\t"
+                "vpand            %%ymm6, %%ymm0, %%ymm2    \n\t"
+                "vpand            %%ymm6, %%ymm1, %%ymm3    \n\t"
+                "vpsrld           %%xmm4, %%ymm2, %%ymm2    \n\t"
+                "vpsrld           %%xmm4, %%ymm3, %%ymm3    \n\t"
+                "vpsrld           %%xmm5, %%ymm0, %%ymm0    \n\t"
+                "vpsrld           %%xmm5, %%ymm1, %%ymm1    \n\t"
+                "vpackusdw        %%ymm3, %%ymm2, %%ymm2    \n\t"
+                "vpackusdw        %%ymm1, %%ymm0, %%ymm0    \n\t"
+                "vpermq        $0xD8, %%ymm2, %%ymm2        \n\t"
+                "vpermq        $0xD8, %%ymm0, %%ymm0        \n\t"
+                "vmovdqu          %%ymm2, (%1, %%"FF_REG_a") \n\t"
+                "vmovdqu          %%ymm0, (%2, %%"FF_REG_a") \n\t"
+                "add                 $32, %%"FF_REG_a"      \n\t"
+                "cmp                  %3, %%"FF_REG_a"      \n\t"
+                " jb                  1b                    \n\t"
+                "vzeroupper                                 \n\t"
+                :: "r"(src), "r"(dst1), "r"(dst2),
+                   "r"(2 * ((x86_reg)width & ~15)), "r"(shift), "r"(shift + 16)
+                : "memory", XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm3",
+                                         "xmm4", "xmm5", "xmm6",) "%"FF_REG_a
+            );
+        }
+        for (w = width & ~15; w < width; w++) {
+            dst1[w] = src[2 * w + 0] >> shift;
+            dst2[w] = src[2 * w + 1] >> shift;
+        }
+        src  = (const uint16_t *)((const uint8_t *)src + srcStride);
+        dst1 = (uint16_t *)((uint8_t *)dst1 + dst1Stride);
+        dst2 = (uint16_t *)((uint8_t *)dst2 + dst2Stride);
+    }
+}
+#endif /* HAVE_AVX2_INLINE */
+
 /*
  RGB15->RGB16 original by Strepto/Astral
  ported to gcc & bugfixed : A'rpi
@@ -175,6 +273,12 @@ av_cold void rgb2rgb_init_x86(void)
         rgb2rgb_init_sse2();
     if (INLINE_AVX(cpu_flags))
         rgb2rgb_init_avx();
+#if HAVE_AVX2_INLINE
+    if (INLINE_AVX2(cpu_flags)) {
+        interleaveWords   = interleaveWords_avx2;
+        deinterleaveWords = deinterleaveWords_avx2;
+    }
+#endif
 #endif /* HAVE_INLINE_ASM */
 
     if (EXTERNAL_MMXEXT(cpu_flags)) {
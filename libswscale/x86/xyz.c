@@ -0,0 +1,180 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem_internal.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libswscale/swscale_internal.h"
+
+#if HAVE_AVX2_INLINE && ARCH_X86_64
+
+/*
+ * XYZ12 <-> RGB48 conversion.
+ *
+ * Both directions are a gamma table lookup, a 3x3 matrix, a clip to 12 bits
+ * and a second table lookup. The tables have 4096 entries, too many to be
+ * held in registers and looked up with permutes, and vpgatherdd is slower
+ * than scalar loads on many CPUs, so the lookups are plain loads in C into
+ * planar buffers of XYZ_BLOCK pixels. The matrix and the clip are done in
+ * place on these buffers, 16 pixels at a time: the first two components
+ * are interleaved into word pairs and the third with zeros, so that each
+ * output component is the sum of two vpmaddwd.
+ */
+
+#define XYZ_BLOCK 256
+
+/* coefficient pairs of the rows, then the clip limit */
+typedef struct XYZCoeffs {
+    int32_t m01[3];
+    int32_t m2[3];
+    int16_t max;
+} XYZCoeffs;
+
+/* one output component of the 16 pixels, clipped to 12 bits, to dst */
+#define MATRIX_ROW(row, dst)                                            \
+    "vpbroadcastd " #row "*4(%4), %%ymm8                         \n\t"  \
+    "vpbroadcastd " #row "*4+12(%4), %%ymm9                      \n\t"  \
+    "vpmaddwd %%ymm8, %%ymm3, %%ymm10                            \n\t"  \
+    "vpmaddwd %%ymm9, %%ymm5, %%ymm11                            \n\t"  \
+    "vpaddd   %%ymm11, %%ymm10, %%ymm10                          \n\t"  \
+    "vpmaddwd %%ymm8, %%ymm4, %%ymm8                             \n\t"  \
+    "vpmaddwd %%ymm9, %%ymm6, %%ymm9                             \n\t"  \
+    "vpaddd   %%ymm9, %%ymm8, %%ymm8                             \n\t"  \
+    "vpsrad   $12, %%ymm10, %%ymm10                              \n\t"  \
+    "vpsrad   $12, %%ymm8, %%ymm8                                \n\t"  \
+    "vpackssdw %%ymm8, %%ymm10, %%ymm10                          \n\t"  \
+    "vpmaxsw  %%ymm7, %%ymm10, %%ymm10                           \n\t"  \
+    "vpminsw  %%ymm12, %%ymm10, %%ymm10                          \n\t"  \
+    "vmovdqa  %%ymm10, (" dst ")                                 \n\t"
+
+static void xyz_matrix_avx2(int16_t *x, int16_t *y, int16_t *z,
+                            x86_reg blocks, const XYZCoeffs *coeffs)
+{
+    __asm__ volatile(
+        "vpxor    %%xmm7, %%xmm7, %%xmm7                         \n\t"
+        "vpbroadcastw 24(%4), %%ymm12                            \n\t"
+        "1:                                                      \n\t"
+        "vmovdqa  (%0), %%ymm0                                   \n\t"
+        "vmovdqa  (%1), %%ymm1                                   \n\t"
+        "vmovdqa  (%2), %%ymm2                                   \n\t"
+        "vpunpcklwd %%ymm1, %%ymm0, %%ymm3                       \n\t"
+        "vpunpckhwd %%ymm1, %%ymm0, %%ymm4                       \n\t"
+        "vpunpcklwd %%ymm7, %%ymm2, %%ymm5                       \n\t"
+        "vpunpckhwd %%ymm7, %%ymm2, %%ymm6                       \n\t"
+        MATRIX_ROW(0, "%0")
+        MATRIX_ROW(1, "%1")
+        MATRIX_ROW(2, "%2")
+        "add      $32, %0                                        \n\t"
+        "add      $32, %1                                        \n\t"
+        "add      $32, %2                                        \n\t"
+        "dec      %3                                             \n\t"
+        "jnz      1b                                             \n\t"
+        "vzeroupper                                              \n\t"
+        : "+r"(x), "+r"(y), "+r"(z), "+r"(blocks)
+        : "r"(coeffs)
+        : "memory",
+          XMM_CLOBBERS("xmm0", "xmm1", "xmm2",  "xmm3",  "xmm4",  "xmm5",  "xmm6",
+                       "xmm7", "xmm8", "xmm9", "xmm10", "xmm11", "xmm12",)
+          "cc"
+    );
+}
+
+#define RD16(p) (be ? AV_RB16(p) : AV_RL16(p))
+#define WR16(p, v) do { if (be) AV_WB16(p, v); else AV_WL16(p, v); } while (0)
+
+static av_always_inline void
+xyz_convert_avx2(uint8_t *dst, ptrdiff_t dst_stride,
+                 const uint8_t *src, ptrdiff_t src_stride, int w, int h,
+                 const int16_t *lut_in, const int16_t *lut_out,
+                 const int16_t (*matrix)[4], int be)
+{
+    DECLARE_ALIGNED(32, int16_t, buf)[3][XYZ_BLOCK];
+    XYZCoeffs coeffs = { .max = 0xfff };
+
+    for (int i = 0; i < 3; i++) {
+        coeffs.m01[i] = (uint16_t)matrix[i][0] | (uint32_t)(uint16_t)matrix[i][1] << 16;
+        coeffs.m2[i]  = (uint16_t)matrix[i][2];
+    }
+
+    for (int y = 0; y < h; y++) {
+        const uint16_t *s = (const uint16_t *)(src + y * src_stride);
+        uint16_t       *d = (uint16_t *)(dst + y * dst_stride);
+
+        for (int x = 0; x < w; x += XYZ_BLOCK) {
+            const int n = FFMIN(w - x, XYZ_BLOCK);
+
+            for (int i = 0; i < n; i++) {
+                buf[0][i] = lut_in[RD16(s + 3 * i + 0) >> 4];
+                buf[1][i] = lut_in[RD16(s + 3 * i + 1) >> 4];
+                buf[2][i] = lut_in[RD16(s + 3 * i + 2) >> 4];
+            }
+            /* the matrix is applied to whole vectors, the pixels past the
+             * end of the line must be initialized */
+            for (int i = n; i & 15; i++)
+                buf[0][i] = buf[1][i] = buf[2][i] = 0;
+            xyz_matrix_avx2(buf[0], buf[1], buf[2], (n + 15) >> 4, &coeffs);
+            for (int i = 0; i < n; i++) {
+                WR16(d + 3 * i + 0, lut_out[buf[0][i]] << 4);
+                WR16(d + 3 * i + 1, lut_out[buf[1][i]] << 4);
+                WR16(d + 3 * i + 2, lut_out[buf[2][i]] << 4);
+            }
+            s += 3 * n;
+            d += 3 * n;
+        }
+    }
+}
+
+#define XYZ_FUNCS(ext, be)                                                      \
+static void xyz12Torgb48_ ## ext ## _avx2(const SwsContext *c, uint8_t *dst,    \
+                                          ptrdiff_t dst_stride,                 \
+                                          const uint8_t *src,                   \
+                                          ptrdiff_t src_stride, int w, int h)   \
+{                                                                               \
+    xyz_convert_avx2(dst, dst_stride, src, src_stride, w, h,                    \
+                     c->xyzgamma, c->rgbgamma, c->xyz2rgb_matrix, be);          \
+}                                                                               \
+                                                                                \
+static void rgb48Toxyz12_ ## ext ## _avx2(const SwsContext *c, uint8_t *dst,    \
+                                          ptrdiff_t dst_stride,                 \
+                                          const uint8_t *src,                   \
+                                          ptrdiff_t src_stride, int w, int h)   \
+{                                                                               \
+    xyz_convert_avx2(dst, dst_stride, src, src_stride, w, h,                    \
+                     c->rgbgammainv, c->xyzgammainv, c->rgb2xyz_matrix, be);    \
+}
+
+XYZ_FUNCS(le, 0)
+XYZ_FUNCS(be, 1)
+
+#endif /* HAVE_AVX2_INLINE && ARCH_X86_64 */
+
+av_cold void ff_sws_init_xyzdsp_x86(SwsContext *c)
+{
+#if HAVE_AVX2_INLINE && ARCH_X86_64
+    int cpu_flags = av_get_cpu_flags();
+
+    if (INLINE_AVX2(cpu_flags) && !(cpu_flags & AV_CPU_FLAG_AVXSLOW)) {
+        c->xyz12Torgb48 = isBE(c->srcFormat) ? xyz12Torgb48_be_avx2 : xyz12Torgb48_le_avx2;
+        c->rgb48Toxyz12 = isBE(c->dstFormat) ? rgb48Toxyz12_be_avx2 : rgb48Toxyz12_le_avx2;
+    }
+#endif
+}
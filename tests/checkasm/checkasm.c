@@ -138,6 +138,9 @@ static const struct {
     #if CONFIG_OPUS_DECODER
         { "opusdsp", checkasm_check_opusdsp },
     #endif
+    #if CONFIG_PCMDSP
+        { "pcmdsp", checkasm_check_pcmdsp },
+    #endif
     #if CONFIG_PIXBLOCKDSP
         { "pixblockdsp", checkasm_check_pixblockdsp },
     #endif
@@ -189,10 +192,14 @@ static const struct {
         { "vf_threshold", checkasm_check_vf_threshold },
     #endif
 #endif
+#if CONFIG_SWRESAMPLE
+    { "swr_resample", checkasm_check_swr_resample },
+#endif
 #if CONFIG_SWSCALE
     { "sw_gbrp", checkasm_check_sw_gbrp },
     { "sw_rgb", checkasm_check_sw_rgb },
     { "sw_scale", checkasm_check_sw_scale },
+    { "sw_xyz", checkasm_check_sw_xyz },
 #endif
 #if CONFIG_AVUTIL
         { "fixed_dsp", checkasm_check_fixed_dsp },
@@ -0,0 +1,85 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavcodec/pcmdsp.h"
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem_internal.h"
+
+#define MAX_SAMPLES 256
+/* room for the largest buffer plus the unaligned offsets tested */
+#define BUF_SIZE    (MAX_SAMPLES * 4 + 64)
+
+#define randomize_buffers()                 \
+    do {                                    \
+        int i;                              \
+        for (i = 0; i < BUF_SIZE; i += 4) { \
+            uint32_t r = rnd();             \
+            AV_WN32A(src + i, r);           \
+            r = rnd();                      \
+            AV_WN32A(dst0 + i, r);          \
+            AV_WN32A(dst1 + i, r);          \
+        }                                   \
+    } while (0)
+
+void checkasm_check_pcmdsp(void)
+{
+    LOCAL_ALIGNED_32(uint8_t, src,  [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [BUF_SIZE]);
+    PCMDSPContext h;
+    int len;
+
+    ff_pcmdsp_init(&h);
+
+    if (check_func(h.unpack_s24le, "unpack_s24le")) {
+        declare_func(void, int32_t *dst, const uint8_t *src, int len);
+
+        for (len = 16; len <= MAX_SAMPLES; len += 16) {
+            /* the input is a byte stream, test unaligned reads */
+            int offset = (len / 16) % 3;
+
+            randomize_buffers();
+            call_ref((int32_t *)dst0, src + offset, len);
+            call_new((int32_t *)dst1, src + offset, len);
+            if (memcmp(dst0, dst1, BUF_SIZE))
+                fail();
+        }
+        bench_new((int32_t *)dst1, src, MAX_SAMPLES);
+    }
+    report("unpack_s24le");
+
+    if (check_func(h.pack_s24le, "pack_s24le")) {
+        declare_func(void, uint8_t *dst, const int32_t *src, int len);
+
+        for (len = 16; len <= MAX_SAMPLES; len += 16) {
+            int offset = (len / 16) % 3;
+
+            randomize_buffers();
+            call_ref(dst0 + offset, (const int32_t *)src, len);
+            call_new(dst1 + offset, (const int32_t *)src, len);
+            /* nothing past the last packed sample must be written */
+            if (memcmp(dst0, dst1, BUF_SIZE))
+                fail();
+        }
+        bench_new(dst1, (const int32_t *)src, MAX_SAMPLES);
+    }
+    report("pack_s24le");
+}
@@ -179,6 +179,93 @@ static void check_interleave_bytes(void)
     }
 }
 
+static void check_interleave_words(void)
+{
+    static const int shifts[] = { 0, 6 };
+    LOCAL_ALIGNED_16(uint16_t, src0, [MAX_STRIDE*MAX_HEIGHT]);
+    LOCAL_ALIGNED_16(uint16_t, src1, [MAX_STRIDE*MAX_HEIGHT]);
+    LOCAL_ALIGNED_16(uint16_t, dst0, [2*MAX_STRIDE*MAX_HEIGHT]);
+    LOCAL_ALIGNED_16(uint16_t, dst1, [2*MAX_STRIDE*MAX_HEIGHT]);
+
+    declare_func(void, const uint16_t *, const uint16_t *, uint16_t *,
+                 int, int, int, int, int, int);
+
+    for (int s = 0; s < FF_ARRAY_ELEMS(shifts); s++) {
+        const int shift = shifts[s];
+
+        for (int i = 0; i < MAX_STRIDE * MAX_HEIGHT; i++) {
+            src0[i] = rnd() & (0xFFFF >> shift);
+            src1[i] = rnd() & (0xFFFF >> shift);
+        }
+
+        if (check_func(interleaveWords, "interleave_words_shift%d", shift)) {
+            for (int i = 0; i <= 16; i++) {
+                // Try all widths [1,16], and try one random width.
+                int w = i > 0 ? i : (1 + (rnd() % (MAX_STRIDE-2)));
+                int h = 1 + (rnd() % (MAX_HEIGHT-2));
+
+                memset(dst0, 0, 4 * MAX_STRIDE * MAX_HEIGHT);
+                memset(dst1, 0, 4 * MAX_STRIDE * MAX_HEIGHT);
+
+                call_ref(src0, src1, dst0, w, h, 2 * MAX_STRIDE, 2 * MAX_STRIDE,
+                         4 * MAX_STRIDE, shift);
+                call_new(src0, src1, dst1, w, h, 2 * MAX_STRIDE, 2 * MAX_STRIDE,
+                         4 * MAX_STRIDE, shift);
+                // Check a one pixel-pair edge around the destination area,
+                // to catch overwrites past the end.
+                checkasm_check(uint16_t, dst0, 4*MAX_STRIDE, dst1, 4*MAX_STRIDE,
+                               2 * w + 2, h + 1, "dst");
+            }
+
+            bench_new(src0, src1, dst1, MAX_STRIDE, MAX_HEIGHT,
+                      2 * MAX_STRIDE, 2 * MAX_STRIDE, 4 * MAX_STRIDE, shift);
+        }
+    }
+}
+
+static void check_deinterleave_words(void)
+{
+    static const int shifts[] = { 0, 6 };
+    LOCAL_ALIGNED_16(uint16_t, src,   [2*MAX_STRIDE*MAX_HEIGHT]);
+    LOCAL_ALIGNED_16(uint16_t, dst0u, [MAX_STRIDE*MAX_HEIGHT]);
+    LOCAL_ALIGNED_16(uint16_t, dst0v, [MAX_STRIDE*MAX_HEIGHT]);
+    LOCAL_ALIGNED_16(uint16_t, dst1u, [MAX_STRIDE*MAX_HEIGHT]);
+    LOCAL_ALIGNED_16(uint16_t, dst1v, [MAX_STRIDE*MAX_HEIGHT]);
+
+    declare_func(void, const uint16_t *, uint16_t *, uint16_t *,
+                 int, int, int, int, int, int);
+
+    randomize_buffers((uint8_t *)src, 4 * MAX_STRIDE * MAX_HEIGHT);
+
+    for (int s = 0; s < FF_ARRAY_ELEMS(shifts); s++) {
+        const int shift = shifts[s];
+
+        if (check_func(deinterleaveWords, "deinterleave_words_shift%d", shift)) {
+            for (int i = 0; i <= 16; i++) {
+                int w = i > 0 ? i : (1 + (rnd() % (MAX_STRIDE-2)));
+                int h = 1 + (rnd() % (MAX_HEIGHT-2));
+
+                memset(dst0u, 0, 2 * MAX_STRIDE * MAX_HEIGHT);
+                memset(dst0v, 0, 2 * MAX_STRIDE * MAX_HEIGHT);
+                memset(dst1u, 0, 2 * MAX_STRIDE * MAX_HEIGHT);
+                memset(dst1v, 0, 2 * MAX_STRIDE * MAX_HEIGHT);
+
+                call_ref(src, dst0u, dst0v, w, h, 4 * MAX_STRIDE,
+                         2 * MAX_STRIDE, 2 * MAX_STRIDE, shift);
+                call_new(src, dst1u, dst1v, w, h, 4 * MAX_STRIDE,
+                         2 * MAX_STRIDE, 2 * MAX_STRIDE, shift);
+                checkasm_check(uint16_t, dst0u, 2*MAX_STRIDE, dst1u, 2*MAX_STRIDE,
+                               w + 1, h + 1, "dst_u");
+                checkasm_check(uint16_t, dst0v, 2*MAX_STRIDE, dst1v, 2*MAX_STRIDE,
+                               w + 1, h + 1, "dst_v");
+            }
+
+            bench_new(src, dst1u, dst1v, MAX_STRIDE, MAX_HEIGHT,
+                      4 * MAX_STRIDE, 2 * MAX_STRIDE, 2 * MAX_STRIDE, shift);
+        }
+    }
+}
+
 void checkasm_check_sw_rgb(void)
 {
     ff_sws_rgb2rgb_init();
@@ -203,4 +290,10 @@ void checkasm_check_sw_rgb(void)
 
     check_interleave_bytes();
     report("interleave_bytes");
+
+    check_interleave_words();
+    report("interleave_words");
+
+    check_deinterleave_words();
+    report("deinterleave_words");
 }
@@ -0,0 +1,110 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem_internal.h"
+
+#include "libswscale/swscale.h"
+#include "libswscale/swscale_internal.h"
+
+#include "checkasm.h"
+
+#define randomize_buffers(buf, size)      \
+    do {                                  \
+        int j;                            \
+        for (j = 0; j < size; j+=4)       \
+            AV_WN32(buf + j, rnd());      \
+    } while (0)
+
+#define MAX_WIDTH  512
+#define HEIGHT     2
+/* 16 pixels of padding at the end of each line */
+#define STRIDE     ((MAX_WIDTH + 16) * 6)
+
+static const int widths[] = { 1, 7, 16, 63, 128, 511, 512 };
+
+static void check_xyz(struct SwsContext *ctx, int to_rgb)
+{
+    static const enum AVPixelFormat fmts[] = { AV_PIX_FMT_RGB48LE, AV_PIX_FMT_RGB48BE };
+    static const char *const ends[] = { "le", "be" };
+    int e, i;
+
+    LOCAL_ALIGNED_32(uint8_t, src,  [STRIDE * HEIGHT]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [STRIDE * HEIGHT]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [STRIDE * HEIGHT]);
+
+    declare_func(void, const SwsContext *c, uint8_t *dst, ptrdiff_t dst_stride,
+                 const uint8_t *src, ptrdiff_t src_stride, int w, int h);
+
+    randomize_buffers(src, STRIDE * HEIGHT);
+
+    for (e = 0; e < FF_ARRAY_ELEMS(fmts); e++) {
+        ctx->srcFormat = ctx->dstFormat = fmts[e];
+        ff_sws_init_xyzdsp(ctx);
+
+        for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+            const int w = widths[i];
+
+            if (check_func(to_rgb ? ctx->xyz12Torgb48 : ctx->rgb48Toxyz12,
+                           "%s_%s_%d", to_rgb ? "xyz12Torgb48" : "rgb48Toxyz12",
+                           ends[e], w)) {
+                memset(dst0, 0xFF, STRIDE * HEIGHT);
+                memset(dst1, 0xFF, STRIDE * HEIGHT);
+
+                call_ref(ctx, dst0, STRIDE, src, STRIDE, w, HEIGHT);
+                call_new(ctx, dst1, STRIDE, src, STRIDE, w, HEIGHT);
+
+                /* the padding must not be written either */
+                if (memcmp(dst0, dst1, STRIDE * HEIGHT))
+                    fail();
+
+                /* the destination conversion is done in place */
+                memcpy(dst0, src, STRIDE * HEIGHT);
+                memcpy(dst1, src, STRIDE * HEIGHT);
+                call_ref(ctx, dst0, STRIDE, dst0, STRIDE, w, HEIGHT);
+                call_new(ctx, dst1, STRIDE, dst1, STRIDE, w, HEIGHT);
+                if (memcmp(dst0, dst1, STRIDE * HEIGHT))
+                    fail();
+
+                bench_new(ctx, dst1, STRIDE, src, STRIDE, w, HEIGHT);
+            }
+        }
+    }
+}
+
+void checkasm_check_sw_xyz(void)
+{
+    struct SwsContext *ctx;
+
+    ctx = sws_getContext(MAX_WIDTH, HEIGHT, AV_PIX_FMT_XYZ12LE,
+                         MAX_WIDTH, HEIGHT, AV_PIX_FMT_RGB48LE,
+                         SWS_BILINEAR, NULL, NULL, NULL);
+    if (!ctx)
+        fail();
+
+    check_xyz(ctx, 1);
+    report("xyz12Torgb48");
+
+    check_xyz(ctx, 0);
+    report("rgb48Toxyz12");
+
+    sws_freeContext(ctx);
+}
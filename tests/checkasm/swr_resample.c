@@ -0,0 +1,150 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/mem_internal.h"
+
+#include "libswresample/resample.h"
+
+#include "checkasm.h"
+
+#define DST_LEN 256
+/* enough input for DST_LEN outputs at the largest rate ratio tested, plus
+ * the filter length and the SIMD overread */
+#define SRC_LEN 1024
+
+static const struct {
+    int in_rate, out_rate, filter_size;
+} rates[] = {
+    { 44100, 48000, 32 },
+    { 48000, 44100, 32 },
+    { 96000, 44100, 32 },
+    /* shorter than one 512-bit vector of taps */
+    { 44100, 48000,  8 },
+};
+
+static void randomize_src(uint8_t *buf, enum AVSampleFormat fmt)
+{
+    int i;
+
+    for (i = 0; i < SRC_LEN; i++) {
+        switch (fmt) {
+        case AV_SAMPLE_FMT_S16P: ((int16_t *)buf)[i] = (int16_t)rnd() >> 1;   break;
+        case AV_SAMPLE_FMT_S32P: ((int32_t *)buf)[i] = (int32_t)rnd() >> 1;   break;
+        case AV_SAMPLE_FMT_FLTP: ((float   *)buf)[i] = rnd() / (float)UINT_MAX * 2 - 1;  break;
+        case AV_SAMPLE_FMT_DBLP: ((double  *)buf)[i] = rnd() / (double)UINT_MAX * 2 - 1; break;
+        }
+    }
+}
+
+static int dst_equal(const uint8_t *dst0, const uint8_t *dst1,
+                     enum AVSampleFormat fmt, int n)
+{
+    switch (fmt) {
+    case AV_SAMPLE_FMT_FLTP:
+        return float_near_abs_eps_array((const float *)dst0,
+                                        (const float *)dst1, 1e-4, n);
+    case AV_SAMPLE_FMT_DBLP:
+        return double_near_abs_eps_array((const double *)dst0,
+                                         (const double *)dst1, 1e-10, n);
+    default:
+        return !memcmp(dst0, dst1, n * av_get_bytes_per_sample(fmt));
+    }
+}
+
+static void check_resample(enum AVSampleFormat fmt, const char *name, int linear)
+{
+    LOCAL_ALIGNED_32(uint8_t, src,  [SRC_LEN * 8]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_LEN * 8]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_LEN * 8]);
+    int i;
+
+    declare_func(int, ResampleContext *c, void *dst, const void *src,
+                 int n, int update_ctx);
+
+    randomize_src(src, fmt);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(rates); i++) {
+        ResampleContext *c;
+        int index, frac, ret0, ret1;
+
+        c = swri_resampler.init(NULL, rates[i].out_rate, rates[i].in_rate,
+                                rates[i].filter_size, 10, linear, 0.97, fmt, SWR_FILTER_TYPE_KAISER,
+                                9, 0, 0, 0);
+        if (!c) {
+            fail();
+            return;
+        }
+
+        index = rnd() % c->phase_count;
+        frac  = rnd() % c->src_incr;
+
+        if (check_func(linear ? c->dsp.resample_linear : c->dsp.resample_common,
+                       "resample_%s_%s_%d_%d_%d", linear ? "linear" : "common", name,
+                       rates[i].in_rate, rates[i].out_rate, rates[i].filter_size)) {
+            int index0, frac0;
+
+            memset(dst0, 0, DST_LEN * 8);
+            memset(dst1, 0, DST_LEN * 8);
+
+            c->index = index;
+            c->frac  = frac;
+            ret0 = call_ref(c, dst0, src, DST_LEN, 1);
+            index0 = c->index;
+            frac0  = c->frac;
+
+            c->index = index;
+            c->frac  = frac;
+            ret1 = call_new(c, dst1, src, DST_LEN, 1);
+
+            if (ret0 != ret1 || index0 != c->index || frac0 != c->frac ||
+                !dst_equal(dst0, dst1, fmt, DST_LEN))
+                fail();
+
+            c->index = index;
+            c->frac  = frac;
+            bench_new(c, dst1, src, DST_LEN, 0);
+        }
+
+        swri_resampler.free(&c);
+    }
+}
+
+void checkasm_check_swr_resample(void)
+{
+    static const struct {
+        enum AVSampleFormat fmt;
+        const char *name;
+    } fmts[] = {
+        { AV_SAMPLE_FMT_S16P, "int16"  },
+        { AV_SAMPLE_FMT_S32P, "int32"  },
+        { AV_SAMPLE_FMT_FLTP, "float"  },
+        { AV_SAMPLE_FMT_DBLP, "double" },
+    };
+    int i;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(fmts); i++)
+        check_resample(fmts[i].fmt, fmts[i].name, 0);
+    report("resample_common");
+
+    for (i = 0; i < FF_ARRAY_ELEMS(fmts); i++)
+        check_resample(fmts[i].fmt, fmts[i].name, 1);
+    report("resample_linear");
+}
@@ -0,0 +1,39 @@
+DASHENC_DEPS = DASH_MUXER HLS_DEMUXER MOV_DEMUXER LAVFI_INDEV TESTSRC_FILTER \
+               AEVALSRC_FILTER MPEG4_ENCODER MP2FIXED_ENCODER
+
+# Two representations written to tests/data/dash_<name>/, with the HLS
+# playlists the tests read them back through.
+define DASHENC_GEN
+tests/data/dash_$(1)/out.mpd: TAG = GEN
+tests/data/dash_$(1)/out.mpd: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$$(Q)mkdir -p tests/data/dash_$(1)
+	$$(M)$(TARGET_EXEC) $(TARGET_PATH)/$$< -nostdin \
+	-f lavfi -i testsrc=size=160x120:rate=10 \
+	-f lavfi -i "aevalsrc=cos(2*PI*t)*sin(2*PI*(440+4*t)*t):d=4" \
+	-t 4 -map 0 -map 1 -c:v mpeg4 -q:v 5 -g 10 -c:a mp2fixed \
+	-flags +bitexact -fflags +bitexact -sws_flags +accurate_rnd+bitexact \
+	-seg_duration 1 -use_template 1 -use_timeline 0 -hls_playlist 1 $(2) \
+	$(TARGET_PATH)/tests/data/dash_$(1)/out.mpd 2>/dev/null
+endef
+
+DASHENC_LHLS = -strict experimental -streaming 1 -lhls 1 -frag_type duration -frag_duration 0.5
+DASHENC_ASYNC = -async_io 1 -async_io_queue_size 2
+
+$(eval $(call DASHENC_GEN,lhls,$(DASHENC_LHLS)))
+$(eval $(call DASHENC_GEN,lhls_async,$(DASHENC_LHLS) $(DASHENC_ASYNC)))
+$(eval $(call DASHENC_GEN,async,$(DASHENC_ASYNC)))
+
+# The output written by the I/O threads is the same as the synchronous one,
+# with and without streaming.
+FATE_DASHENC-$(call ALLYES, $(DASHENC_DEPS)) += fate-dash-lhls fate-dash-lhls-async fate-dash-async
+fate-dash-lhls: tests/data/dash_lhls/out.mpd
+fate-dash-lhls: CMD = framecrc -i $(TARGET_PATH)/tests/data/dash_lhls/master.m3u8 -map 0 -c copy
+fate-dash-lhls-async: tests/data/dash_lhls_async/out.mpd
+fate-dash-lhls-async: CMD = framecrc -i $(TARGET_PATH)/tests/data/dash_lhls_async/master.m3u8 -map 0 -c copy
+fate-dash-lhls-async: REF = $(SRC_PATH)/tests/ref/fate/dash-lhls
+fate-dash-async: tests/data/dash_async/out.mpd
+fate-dash-async: CMD = framecrc -i $(TARGET_PATH)/tests/data/dash_async/master.m3u8 -map 0 -c copy
+fate-dash-async: REF = $(SRC_PATH)/tests/ref/fate/dash-lhls
+
+FATE_FFMPEG += $(FATE_DASHENC-yes)
+fate-dashenc: $(FATE_DASHENC-yes)
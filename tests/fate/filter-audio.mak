@@ -401,6 +401,10 @@ FATE_AFILTER-yes += fate-filter-formats
 fate-filter-formats: libavfilter/tests/formats$(EXESUF)
 fate-filter-formats: CMD = run libavfilter/tests/formats$(EXESUF)
 
+FATE_AFILTER-yes += fate-filter-buffersink-batch
+fate-filter-buffersink-batch: libavfilter/tests/buffersink$(EXESUF)
+fate-filter-buffersink-batch: CMD = run libavfilter/tests/buffersink$(EXESUF)
+
 FATE_SAMPLES_AVCONV += $(FATE_AFILTER_SAMPLES-yes)
 FATE_FFMPEG += $(FATE_AFILTER-yes)
 fate-afilter: $(FATE_AFILTER-yes) $(FATE_AFILTER_SAMPLES-yes)
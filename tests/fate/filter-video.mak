@@ -83,6 +83,14 @@ fate-filter-testsrc2-yuv444p: CMD = framecrc -lavfi testsrc2=r=7:d=10 -pix_fmt y
 FATE_FILTER-$(call ALLYES, TESTSRC2_FILTER) += fate-filter-testsrc2-rgb24
 fate-filter-testsrc2-rgb24: CMD = framecrc -lavfi testsrc2=r=7:d=10 -pix_fmt rgb24
 
+# 14 frames on 4 threads, so that the last batch is a partial one
+FATE_FILTER-$(call ALLYES, TESTSRC2_FILTER FORMAT_FILTER LUT1D_FILTER) += fate-filter-lut1d-frame-threads
+fate-filter-lut1d-frame-threads: CMD = framecrc -auto_conversion_filters -filter_complex_threads 4 -lavfi testsrc2=r=7:d=2,format=rgb48,lut1d=interp=cosine:thread_type=frame -pix_fmt rgb48
+
+FATE_FILTER-$(call ALLYES, TESTSRC2_FILTER FORMAT_FILTER LUT1D_FILTER) += fate-filter-lut1d-slice-threads
+fate-filter-lut1d-slice-threads: CMD = framecrc -auto_conversion_filters -filter_complex_threads 4 -lavfi testsrc2=r=7:d=2,format=rgb48,lut1d=interp=cosine:thread_type=slice -pix_fmt rgb48
+fate-filter-lut1d-slice-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-lut1d-frame-threads
+
 FATE_FILTER-$(call ALLYES, LAVFI_INDEV TESTSRC2_FILTER) += fate-filter-testsrc2-rgba
 fate-filter-testsrc2-rgba: CMD = framecrc -lavfi testsrc2=r=7:d=10 -pix_fmt rgba
 
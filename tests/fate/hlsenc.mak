@@ -41,6 +41,21 @@ fate-hls-live-endlist: CMD = md5 -i $(SRC) -af hdcd=process_stereo=false -t 20 -
 fate-hls-live-endlist: CMP = oneline
 fate-hls-live-endlist: REF = e189ce781d9c87882f58e3929455167b
 
+tests/data/live_endlist_async.m3u8: TAG = GEN
+tests/data/live_endlist_async.m3u8: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< -nostdin \
+        -f lavfi -i "aevalsrc=cos(2*PI*t)*sin(2*PI*(440+4*t)*t):d=20" -f hls -hls_time 3 -map 0 \
+        -hls_list_size 0 -hls_flags temp_file -async_io 1 -async_io_queue_size 2 \
+        -codec:a mp2fixed -hls_segment_filename $(TARGET_PATH)/tests/data/live_endlist_async_%d.ts \
+        $(TARGET_PATH)/tests/data/live_endlist_async.m3u8 2>/dev/null
+
+FATE_HLSENC-$(call ALLYES, HLS_DEMUXER MPEGTS_MUXER MPEGTS_DEMUXER AEVALSRC_FILTER LAVFI_INDEV MP2FIXED_ENCODER) += fate-hls-live-endlist-async
+fate-hls-live-endlist-async: tests/data/live_endlist_async.m3u8
+fate-hls-live-endlist-async: SRC = $(TARGET_PATH)/tests/data/live_endlist_async.m3u8
+fate-hls-live-endlist-async: CMD = md5 -i $(SRC) -af hdcd=process_stereo=false -t 20 -f s24le
+fate-hls-live-endlist-async: CMP = oneline
+fate-hls-live-endlist-async: REF = e189ce781d9c87882f58e3929455167b
+
 tests/data/hls_segment_size.m3u8: TAG = GEN
 tests/data/hls_segment_size.m3u8: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
 	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< -nostdin \
@@ -97,6 +112,19 @@ FATE_HLSENC-$(call ALLYES, HLS_DEMUXER MPEGTS_MUXER MPEGTS_DEMUXER AEVALSRC_FILT
 fate-hls-fmp4: tests/data/hls_fmp4.m3u8
 fate-hls-fmp4: CMD = framecrc -auto_conversion_filters -flags +bitexact -i $(TARGET_PATH)/tests/data/hls_fmp4.m3u8 -vf setpts=N*23
 
+tests/data/hls_fmp4_async.m3u8: TAG = GEN
+tests/data/hls_fmp4_async.m3u8: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< -nostdin \
+	-f lavfi -i "aevalsrc=cos(2*PI*t)*sin(2*PI*(440+4*t)*t):d=5" -map 0 -codec:a mp2fixed \
+	-hls_segment_type fmp4 -hls_fmp4_init_filename hls_fmp4_async_init.mp4 -hls_fmp4_init_resend 1 \
+	-hls_list_size 0 -hls_time 1 -async_io 1 -async_io_queue_size 2 \
+	-hls_segment_filename "$(TARGET_PATH)/tests/data/hls_fmp4_async_%d.m4s" \
+	$(TARGET_PATH)/tests/data/hls_fmp4_async.m3u8 2>/dev/null
+
+FATE_HLSENC-$(call ALLYES, HLS_DEMUXER MOV_MUXER MOV_DEMUXER AEVALSRC_FILTER LAVFI_INDEV MP2FIXED_ENCODER) += fate-hls-fmp4-async
+fate-hls-fmp4-async: tests/data/hls_fmp4_async.m3u8
+fate-hls-fmp4-async: CMD = framecrc -flags +bitexact -i $(TARGET_PATH)/tests/data/hls_fmp4_async.m3u8 -c copy
+
 tests/data/hls_fmp4_ac3.m3u8: TAG = GEN
 tests/data/hls_fmp4_ac3.m3u8: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
 	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< -nostdin \
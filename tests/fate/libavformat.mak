@@ -1,6 +1,24 @@
-#FATE_LIBAVFORMAT-$(HAVE_PTHREADS) += fate-async
-#fate-async: libavformat/tests/async$(EXESUF)
-#fate-async: CMD = run libavformat/tests/async
+FATE_LIBAVFORMAT-$(call ALLYES, ASYNC_PROTOCOL FILE_PROTOCOL) += fate-async
+fate-async: libavformat/tests/async$(EXESUF)
+fate-async: CMD = run libavformat/tests/async$(EXESUF) $(TARGET_PATH)/tests/data/fate/async.tmp
+
+FATE_LIBAVFORMAT-yes += fate-aviobuf
+fate-aviobuf: libavformat/tests/aviobuf$(EXESUF)
+fate-aviobuf: CMD = run libavformat/tests/aviobuf$(EXESUF)
+
+FATE_CACHE-$(HAVE_THREADS) += fate-cache
+FATE_LIBAVFORMAT-$(call ALLYES, CACHE_PROTOCOL FILE_PROTOCOL HTTP_PROTOCOL) += $(FATE_CACHE-yes)
+fate-cache: libavformat/tests/cache$(EXESUF)
+fate-cache: CMD = run libavformat/tests/cache$(EXESUF) $(TARGET_PATH)/tests/data/fate/cache.tmp $(TARGET_PATH)/tests/data/fate/cache.dir
+
+FATE_LIBAVFORMAT-$(CONFIG_FILE_PROTOCOL) += fate-file
+fate-file: libavformat/tests/file$(EXESUF)
+fate-file: CMD = run libavformat/tests/file$(EXESUF) $(TARGET_PATH)/tests/data/fate/file.tmp
+
+FATE_HTTP-$(HAVE_THREADS) += fate-http-parallel
+FATE_LIBAVFORMAT-$(CONFIG_HTTP_PROTOCOL) += $(FATE_HTTP-yes)
+fate-http-parallel: libavformat/tests/http$(EXESUF)
+fate-http-parallel: CMD = run libavformat/tests/http$(EXESUF)
 
 FATE_LIBAVFORMAT-$(CONFIG_NETWORK) += fate-noproxy
 fate-noproxy: libavformat/tests/noproxy$(EXESUF)
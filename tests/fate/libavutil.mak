@@ -47,6 +47,11 @@ FATE_LIBAVUTIL += fate-bprint
 fate-bprint: libavutil/tests/bprint$(EXESUF)
 fate-bprint: CMD = run libavutil/tests/bprint$(EXESUF)
 
+FATE_LIBAVUTIL-$(HAVE_THREADS) += fate-buffer_pool
+fate-buffer_pool: libavutil/tests/buffer_pool$(EXESUF)
+fate-buffer_pool: CMD = run libavutil/tests/buffer_pool$(EXESUF)
+fate-buffer_pool: CMP = null
+
 FATE_LIBAVUTIL += fate-cpu
 fate-cpu: libavutil/tests/cpu$(EXESUF)
 fate-cpu: CMD = runecho libavutil/tests/cpu$(EXESUF) $(CPUFLAGS:%=-c%) $(THREADS:%=-t%)
@@ -112,6 +117,10 @@ FATE_LIBAVUTIL += fate-md5
 fate-md5: libavutil/tests/md5$(EXESUF)
 fate-md5: CMD = run libavutil/tests/md5$(EXESUF)
 
+FATE_LIBAVUTIL += fate-mem
+fate-mem: libavutil/tests/mem$(EXESUF)
+fate-mem: CMD = run libavutil/tests/mem$(EXESUF)
+
 FATE_LIBAVUTIL += fate-murmur3
 fate-murmur3: libavutil/tests/murmur3$(EXESUF)
 fate-murmur3: CMD = run libavutil/tests/murmur3$(EXESUF)
@@ -148,6 +157,10 @@ FATE_LIBAVUTIL += fate-sha512
 fate-sha512: libavutil/tests/sha512$(EXESUF)
 fate-sha512: CMD = run libavutil/tests/sha512$(EXESUF)
 
+FATE_LIBAVUTIL-$(HAVE_THREADS) += fate-slicethread
+fate-slicethread: libavutil/tests/slicethread$(EXESUF)
+fate-slicethread: CMD = run libavutil/tests/slicethread$(EXESUF)
+
 FATE_LIBAVUTIL += fate-tree
 fate-tree: libavutil/tests/tree$(EXESUF)
 fate-tree: CMD = run libavutil/tests/tree$(EXESUF)
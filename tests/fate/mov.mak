@@ -160,6 +160,71 @@ FATE_MOV_FFMPEG-$(call ALLYES, FILE_PROTOCOL PIPE_PROTOCOL \
 fate-mov-channel-description: tests/data/asynth-44100-1.wav tests/data/filtergraphs/mov-channel-description
 fate-mov-channel-description: CMD = transcode wav $(TARGET_PATH)/tests/data/asynth-44100-1.wav mov "-filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/mov-channel-description -map [outFL] -map [outFR] -map [outFC] -map [outLFE] -map [outBL] -map [outBR] -map [outDL] -map [outDR] -c:a pcm_s16le" "-map 0 -c copy -frames:a 0"
 
+# More samples than one lazy index batch, with B-frames; the fragmented file
+# keeps part of them in the moov and the rest in trun boxes. The lazily
+# built index must give the same packets as the eager one.
+MOV_LAZY_INDEX_DEPS = FILE_PROTOCOL PIPE_PROTOCOL MD5_PROTOCOL LAVFI_INDEV \
+                      TESTSRC_FILTER SCALE_FILTER MPEG4_ENCODER MOV_MUXER  \
+                      MOV_DEMUXER FRAMECRC_MUXER
+
+define MOV_LAZY_INDEX_GEN
+tests/data/mov-lazy-index-$(1).mp4: TAG = GEN
+tests/data/mov-lazy-index-$(1).mp4: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$$(M)$(TARGET_EXEC) $(TARGET_PATH)/$$< -nostdin \
+	-f lavfi -i testsrc=size=32x32:rate=25 -t 80 -c:v mpeg4 -bf 2 -g 25 \
+	-flags +bitexact -fflags +bitexact -sws_flags +accurate_rnd+bitexact $(2) \
+	-y $(TARGET_PATH)/$$@ 2>/dev/null
+
+FATE_MOV_FFMPEG-$(call ALLYES, $(MOV_LAZY_INDEX_DEPS)) += fate-mov-lazy-index-$(1) fate-mov-lazy-index-$(1)-lazy \
+                                                          fate-mov-lazy-index-$(1)-ss fate-mov-lazy-index-$(1)-ss-lazy
+fate-mov-lazy-index-$(1) fate-mov-lazy-index-$(1)-lazy fate-mov-lazy-index-$(1)-ss fate-mov-lazy-index-$(1)-ss-lazy: tests/data/mov-lazy-index-$(1).mp4
+fate-mov-lazy-index-$(1) fate-mov-lazy-index-$(1)-lazy fate-mov-lazy-index-$(1)-ss fate-mov-lazy-index-$(1)-ss-lazy: CMP = oneline
+fate-mov-lazy-index-$(1):         CMD = md5pipe -lazy_index 0 -i $(TARGET_PATH)/tests/data/mov-lazy-index-$(1).mp4 -c copy -bitexact -f framecrc
+fate-mov-lazy-index-$(1)-lazy:    CMD = md5pipe -lazy_index 1 -i $(TARGET_PATH)/tests/data/mov-lazy-index-$(1).mp4 -c copy -bitexact -f framecrc
+fate-mov-lazy-index-$(1)-ss:      CMD = md5pipe -lazy_index 0 -ss 60 -i $(TARGET_PATH)/tests/data/mov-lazy-index-$(1).mp4 -c copy -bitexact -f framecrc
+fate-mov-lazy-index-$(1)-ss-lazy: CMD = md5pipe -lazy_index 1 -ss 60 -i $(TARGET_PATH)/tests/data/mov-lazy-index-$(1).mp4 -c copy -bitexact -f framecrc
+fate-mov-lazy-index-$(1) fate-mov-lazy-index-$(1)-lazy:       REF = $$(MOV_LAZY_INDEX_MD5)
+fate-mov-lazy-index-$(1)-ss fate-mov-lazy-index-$(1)-ss-lazy: REF = $$(MOV_LAZY_INDEX_SS_MD5)
+endef
+
+MOV_LAZY_INDEX_MD5    = e11051ba6703ffa63bcdc8a810a10274
+MOV_LAZY_INDEX_SS_MD5 = 3ca591062f1bda3c36b6dc7f3ab90b9c
+
+$(eval $(call MOV_LAZY_INDEX_GEN,plain,))
+$(eval $(call MOV_LAZY_INDEX_GEN,frag,-movflags frag_keyframe -min_frag_duration 50000000))
+
+# More video samples than two index clusters, with B-frames and variable
+# frame durations, interleaved with audio. The run-length coded sample tables
+# of the plain file must describe the same packets as the per-sample trun
+# boxes of the fragmented one, stream by stream.
+MOV_SAMPLE_TABLES_DEPS = FILE_PROTOCOL LAVFI_INDEV TESTSRC_FILTER AEVALSRC_FILTER \
+                         SELECT_FILTER SCALE_FILTER MPEG4_ENCODER MP2FIXED_ENCODER \
+                         MOV_MUXER MOV_DEMUXER
+
+MOV_SAMPLE_TABLES_PROBE = -bitexact -ignore_editlist 1 -show_data_hash CRC32 \
+                          -show_entries packet=stream_index,pts,dts,size,flags,data_hash -of csv=p=0
+
+define MOV_SAMPLE_TABLES_GEN
+tests/data/mov-sample-tables-$(1).mp4: TAG = GEN
+tests/data/mov-sample-tables-$(1).mp4: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$$(M)$(TARGET_EXEC) $(TARGET_PATH)/$$< -nostdin \
+	-f lavfi -i testsrc=size=32x32:rate=50 -f lavfi -i "aevalsrc=sin(440*2*PI*t):s=22050:d=10" \
+	-t 50 -vf "select=mod(n\,7)-3" -vsync passthrough -c:v mpeg4 -bf 2 -g 50 -c:a mp2fixed \
+	-flags +bitexact -fflags +bitexact -sws_flags +accurate_rnd+bitexact -use_editlist 0 $(2) \
+	-y $(TARGET_PATH)/$$@ 2>/dev/null
+
+FATE_MOV_SAMPLE_TABLES-$(call ALLYES, $(MOV_SAMPLE_TABLES_DEPS)) += fate-mov-sample-tables-$(1)
+fate-mov-sample-tables-$(1): tests/data/mov-sample-tables-$(1).mp4
+fate-mov-sample-tables-$(1): CMD = run ffprobe$(PROGSSUF)$(EXESUF) $$(MOV_SAMPLE_TABLES_PROBE) -select_streams v $(TARGET_PATH)/tests/data/mov-sample-tables-$(1).mp4; \
+                                  run ffprobe$(PROGSSUF)$(EXESUF) $$(MOV_SAMPLE_TABLES_PROBE) -select_streams a $(TARGET_PATH)/tests/data/mov-sample-tables-$(1).mp4
+fate-mov-sample-tables-$(1): REF = $(SRC_PATH)/tests/ref/fate/mov-sample-tables
+endef
+
+$(eval $(call MOV_SAMPLE_TABLES_GEN,plain,))
+$(eval $(call MOV_SAMPLE_TABLES_GEN,frag,-movflags frag_keyframe+empty_moov))
+
+FATE_FFMPEG_FFPROBE += $(FATE_MOV_SAMPLE_TABLES-yes)
+
 FATE_FFMPEG += $(FATE_MOV_FFMPEG-yes)
 
-fate-mov: $(FATE_MOV) $(FATE_MOV_FFMPEG-yes) $(FATE_MOV_FFPROBE) $(FATE_MOV_FASTSTART) $(FATE_MOV_FFMPEG_FFPROBE-yes)
+fate-mov: $(FATE_MOV) $(FATE_MOV_FFMPEG-yes) $(FATE_MOV_FFPROBE) $(FATE_MOV_FASTSTART) $(FATE_MOV_FFMPEG_FFPROBE-yes) $(FATE_MOV_SAMPLE_TABLES-yes)
@@ -27,6 +27,22 @@ fate-dcinema-encode: tests/data/asynth-96000-6.wav
 fate-dcinema-encode: SRC = tests/data/asynth-96000-6.wav
 fate-dcinema-encode: CMD = enc_dec_pcm daud framemd5 s16le $(SRC) -c:a pcm_s24daud -frames:a 20
 
+tests/data/pcm_s24le_6ch.wav: TAG = GEN
+tests/data/pcm_s24le_6ch.wav: tests/data/asynth-96000-6.wav ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/ffmpeg$(PROGSSUF)$(EXESUF) -nostdin \
+        -i $(TARGET_PATH)/tests/data/asynth-96000-6.wav -af "aeval=val(ch)*255/256:c=same" -c:a pcm_s24le \
+        -bitexact -y $(TARGET_PATH)/$@ 2>/dev/null
+
+# the s24le decoder outputs s32 by default and s32p on request, both must
+# give the same planar samples
+FATE_PCM-$(call ALLYES, PCM_S24LE_ENCODER PCM_S24LE_DECODER WAV_MUXER WAV_DEMUXER \
+                        PCM_S24LE_PLANAR_ENCODER FRAMEMD5_MUXER AEVAL_FILTER   \
+                        ARESAMPLE_FILTER) += fate-pcm-s24le-s32 fate-pcm-s24le-s32p
+fate-pcm-s24le-s32 fate-pcm-s24le-s32p: tests/data/pcm_s24le_6ch.wav
+fate-pcm-s24le-s32: CMD = framemd5 -auto_conversion_filters -i $(TARGET_PATH)/tests/data/pcm_s24le_6ch.wav -c:a pcm_s24le_planar -frames:a 30
+fate-pcm-s24le-s32p: CMD = framemd5 -request_sample_fmt s32p -i $(TARGET_PATH)/tests/data/pcm_s24le_6ch.wav -c:a pcm_s24le_planar -frames:a 30
+fate-pcm-s24le-s32p: REF = $(SRC_PATH)/tests/ref/fate/pcm-s24le-s32
+
 FATE_FFMPEG += $(FATE_PCM-yes)
 FATE_SAMPLES_AVCONV += $(FATE_SAMPLES_PCM-yes)
 fate-pcm: $(FATE_PCM-yes) $(FATE_SAMPLES_PCM-yes)